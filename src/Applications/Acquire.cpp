@@ -19,6 +19,9 @@
 #include "Rinex.h"
 #include "Rtcm3Station.h"
 #include "SqliteLogger.h"
+#include "NavStore.h"
+#include "OutputPipeline.h"
+#include "MappedFile.h"
 //#include "DgpsStation.h"
 #include "NewRawReceiver.h" 
 #include <stdio.h>
@@ -37,11 +40,13 @@ const char *RawName;
 const char *RtcmName;
 const char *LogName;
 const char *DgpsName;
+const char *NavName;
 const char *Model;
 const char *PortName;
 Position InitialPos;
 extern int DebugLevel;
 int HZ;
+int QueueDepth;
 
 // A flag telling us when to stop
 bool MoreToDo = true;
@@ -64,21 +69,43 @@ int main(int argc, const char** argv)
 		return ShowErrors();
 	}
 
+	// Start with the broadcast orbits saved by earlier sessions
+	NavStore nav(NavName);
+	if (NavName != NULL && nav.Load(*gps) != OK) return ShowErrors();
+
+	// Each output is written on a thread of its own, so a slow one
+	//   doesn't hold up reading the receiver. Files must be complete,
+	//   so they wait for room. A live RTCM stream would rather be current.
+	//   When converting a file, nothing is dropped.
+	bool live = !MappedFile::IsFile(PortName);
+	OutputPipeline* out = new OutputPipeline(*gps);
+
 	// Create the RINEX output file
-	Rinex* rinex = NewRinex(RinexName, *gps);
-	if (rinex == NULL && RinexName != NULL) return ShowErrors();
+	if (RinexName != NULL) {
+		WriterSink<Rinex>* rinex = new WriterSink<Rinex>("RINEX", *gps, OutputSink::Block, QueueDepth);
+		rinex->Out = NewRinex(RinexName, rinex->Gps);
+		if (rinex->Out == NULL || out->Add(rinex) != OK) return ShowErrors();
+	}
 
 	// Create the RTCM output file
-	Rtcm3Station* rtcm = NewRtcm(RtcmName, *gps);
-	if (rtcm == NULL && RtcmName != NULL) return ShowErrors();
+	if (RtcmName != NULL) {
+		OutputSink::Policy policy = live? OutputSink::DropOldest: OutputSink::Block;
+		WriterSink<Rtcm3Station>* rtcm = new WriterSink<Rtcm3Station>("RTCM", *gps, policy, QueueDepth);
+		rtcm->Out = NewRtcm(RtcmName, rtcm->Gps);
+		if (rtcm->Out == NULL || out->Add(rtcm) != OK) return ShowErrors();
+	}
 
 	// Create the DGPS output file
 	//DgpsStation* dgps= NewDgps(DgpsName, *gps);
 	//if (dgps == NULL && DgpsName != NULL) return ShowErrors();
 
         // Create an sqlite log file
-        SqliteLogger* logger = NewLogger(LogName, *gps);
-        if (logger == NULL && LogName != NULL) return ShowErrors();
+	if (LogName != NULL) {
+		WriterSink<SqliteLogger>* logger = new WriterSink<SqliteLogger>("log", *gps, OutputSink::Block, QueueDepth);
+		logger->Out = NewLogger(LogName, logger->Gps);
+		if (logger->Out == NULL || out->Add(logger) != OK) return ShowErrors();
+	}
+	uint32 Dropped[OutputPipeline::MaxSinks] = {0};
 
 	// Get first epoch
 	printf("Waiting for data from %s on port %s\n", Model, PortName);
@@ -96,7 +123,8 @@ int main(int argc, const char** argv)
 		TimeToDate(gps->GpsTime, year, month, day); 
 		TimeToTod(gps->GpsTime, hour, min, sec, nsec);
 		printf("%2d/%02d/%04d %02d:%02d:%02d  ", month,day,year,hour,min,sec);
-		for (int s=0; s<MaxSats; s++) {
+		for (int i=0; i<gps->obs.Count(); i++) {
+			int s = gps->obs.Sat(i);
 			if (gps->obs[s].Valid)
 				if ((*gps)[s].Valid(gps->GpsTime)) printf("*%d ",SatToSvid(s));
 				else                               printf("%d ", SatToSvid(s));
@@ -105,30 +133,35 @@ int main(int argc, const char** argv)
 
             
 
-		// Write it out as Rinex
-		if (rinex != NULL)
-		    if (rinex->OutputEpoch() != OK) return ShowErrors();
+		// Hand it to the Rinex, RTCM and log writers
+		if (out->GetError() != OK) return ShowErrors();
+		if (out->OutputEpoch() != OK) return ShowErrors();
 
-		// Write it out as RTCM
-		if (rtcm != NULL)
-			if (rtcm->OutputEpoch() != OK) return ShowErrors();
-
-                if (logger != NULL)
-                    if (logger->OutputEpoch() != OK) return ShowErrors();
+		// Let the user know if an output is falling behind
+		for (int i=0; i<out->NrSinks; i++) {
+			OutputSink& sink = *out->Sinks[i];
+			if (sink.Dropped != Dropped[i])
+				printf("Warning: %s output is behind. %u epochs dropped\n", sink.Name, (unsigned)sink.Dropped);
+			Dropped[i] = sink.Dropped;
+		}
 
 		// Write it out as DGPS
 //		if (dgps != NULL)
 //			if (dgps->OutputEpoch() != OK) return ShowErrors();
 
-		// Read next epoch of data
-		if (gps->NextEpoch() != OK) return ShowErrors();
+		// Save any new broadcast orbits
+		if (NavName != NULL && nav.Update(*gps) != OK) return ShowErrors();
+
+		// Read next epoch of data. At the end of a file, finish writing first.
+		if (gps->NextEpoch() != OK) {
+			delete out;
+			return ShowErrors();
+		}
 	}
 
 	// Done
-	delete rinex;
+	delete out;
 //	delete dgps;
-	delete rtcm;
-        delete logger;
 	delete gps;
 
 	return 0;
@@ -149,7 +182,9 @@ bool Configure(int argc, const char** argv)
 	RinexName = NULL;
 	RtcmName = NULL;
         LogName = NULL;
+	NavName = NULL;
 	HZ = 1;
+	QueueDepth = 64;
 
 	// Process each option
 	int i;
@@ -160,11 +195,13 @@ bool Configure(int argc, const char** argv)
 		else if (Match(argv[i], "-rtcm=", RtcmName))      ;
                 else if (Match(argv[i], "-log=", LogName))        ;
 		else if (Match(argv[i], "-dgps=", DgpsName))      ;
+		else if (Match(argv[i], "-navstore=", NavName))   ;
 		else if (Match(argv[i], "-x=", val))  InitialPos.x = atof(val);
 		else if (Match(argv[i], "-y=", val))  InitialPos.y = atof(val);
 		else if (Match(argv[i], "-z=", val))  InitialPos.z = atof(val);
 		else if (Match(argv[i], "-debug=", val)) DebugLevel = atoi(val);
 		else if (Match(argv[i], "-hz=", val))  HZ = atoi(val);
+		else if (Match(argv[i], "-queue=", val))  QueueDepth = atoi(val);
 		else    return Error("Didn't recognize option %s\n", argv[i]);
 	}
 	
@@ -176,6 +213,7 @@ bool Configure(int argc, const char** argv)
 
 	// Verify we have valid HZ. Must go evenly into one second.
 	if ( HZ <= 0 ||  (100/HZ)*HZ != 100 )  return Error("%dHz is not valid\n", HZ);
+	if (QueueDepth < 1) return Error("The output queue must hold at least one epoch\n");
 
 	debug("Configure: RawName=%s Rinex=%s Rtcm=%s Receiver=%s port=%s\n",
 		RawName, RinexName, RtcmName, Model, PortName);
@@ -198,6 +236,8 @@ void DisplayHelp()
 	printf("   RawFile  - output file for raw gps data\n");
 	printf("   RinexFile - output file for Rinex observation data\n");
 	printf("   RtcmFile - output file for Rtcm data\n");
+	printf("   -navstore=NavFile - keep the broadcast orbits between sessions\n");
+	printf("   -queue=N  - epochs each output may fall behind (default 64)\n");
 	printf("\n");
 	printf("Note: the input ""port"" can actually be a data file.\n");
 	printf("   Acquire can also be used to convert one data file to another\n");
@@ -18,6 +18,7 @@
 #include "SqliteLogger.h"
 #include "Rtcm3Station.h"
 #include "Rs232.h"
+#include "StreamReader.h"
 #include "RawAC12.h"
 #include <stdio.h>
 
@@ -74,22 +75,40 @@ bool GpsSession(const char *SerialName, const char *Logname, int Port, const cha
 {
     // Initialize the gps receiver
     Rs232   in(SerialName);
-    RawAC12 gps(in);
+    StreamReader reader(in);
+    RawAC12 gps(reader);
     if (gps.GetError() != OK)
         return Error("Unable to init the AC12  on port %s\n", SerialName);
 
+    // From now on, keep the port drained while we write
+    if (reader.Start() != OK)
+        return Error("Unable to start reading port %s\n", SerialName);
+
     // Create the RTCM output file
     SqliteLogger  Log(LogName, gps, 1234);
     if (Log.GetError() != OK)
         return Error();
 
     // Repeat forever
+    uint32 overruns = 0;
     for (;;) {
         // Read next epoch of data
         if (gps.NextEpoch() != OK) return Error("Can't get gps data\n");
 
         Display(gps);
 
+        // Warn if we fell far enough behind to lose data
+        if (reader.Overruns != overruns) {
+            overruns = reader.Overruns;
+            printf("Warning: %u overruns reading the port, headroom=%u bytes\n",
+                   (unsigned)overruns, (unsigned)reader.Headroom());
+        }
+
+        // Warn if the epoch sat in the ring for a while before we got to it
+        Time waited = GetCurrentTime() - reader.Received();
+        if (waited > NsecPerSec)
+            printf("Warning: the epoch waited %.1f seconds to be read\n", S(waited));
+
         // Write it out as RTCM
         if (Log.OutputEpoch() != OK) return Error("Can't write observations to Sqlite\n");
     }
@@ -107,7 +126,8 @@ void Display(RawReceiver& gps)
     TimeToDate(gps.GpsTime, year, month, day); 
     TimeToTod(gps.GpsTime, hour, min, sec, nsec);
     printf("%2d/%02d/%04d %02d:%02d:%02d  ", month,day,year,hour,min,sec);
-    for (int s=0; s<MaxSats; s++) {
+    for (int i=0; i<gps.obs.Count(); i++) {
+        int s = gps.obs.Sat(i);
         if (gps.obs[s].Valid)
             if (gps[s].Valid(gps.GpsTime)) printf("*%d ",SatToSvid(s));
             else                            printf("%d ", SatToSvid(s));
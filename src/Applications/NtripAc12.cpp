@@ -18,6 +18,7 @@
 #include "NtripServer.h"
 #include "Rtcm3Station.h"
 #include "Rs232.h"
+#include "StreamReader.h"
 #include "RawAC12.h"
 #include <stdio.h>
 
@@ -74,10 +75,15 @@ bool GpsSession()
     debug("GpsSession: starting\n");
     // Initialize the gps receiver
     Rs232   in(SerialName);
-    RawAC12 gps(in);
+    StreamReader reader(in);
+    RawAC12 gps(reader);
     if (gps.GetError() != OK)
         return Error("Unable to init the AC12  on port %s\n", SerialName);
 
+    // From now on, keep the port drained while we write
+    if (reader.Start() != OK)
+        return Error("Unable to start reading port %s\n", SerialName);
+
     // Create the RTCM output file
     //OutputFile out(RtcmName);
     NtripServer out(CasterName, Port, Mount, User, Password);
@@ -88,12 +94,20 @@ bool GpsSession()
         return Error();
 
     // Repeat forever
+    uint32 overruns = 0;
     for (;;) {
         // Read next epoch of data
         if (gps.NextEpoch() != OK) return Error("Can't get gps data\n");
 
         Display(gps);
 
+        // Warn if we fell far enough behind to lose data
+        if (reader.Overruns != overruns) {
+            overruns = reader.Overruns;
+            printf("Warning: %u overruns reading the port, headroom=%u bytes\n",
+                   (unsigned)overruns, (unsigned)reader.Headroom());
+        }
+
         // Write it out as RTCM
         if (rtcm.OutputEpoch() != OK) 
            return Error("Can't send RTCM to caster\n");
@@ -112,7 +126,8 @@ void Display(RawReceiver& gps)
     TimeToDate(gps.GpsTime, year, month, day); 
     TimeToTod(gps.GpsTime, hour, min, sec, nsec);
     printf("%2d/%02d/%04d %02d:%02d:%02d  ", month,day,year,hour,min,sec);
-    for (int s=0; s<MaxSats; s++) {
+    for (int i=0; i<gps.obs.Count(); i++) {
+        int s = gps.obs.Sat(i);
         if (gps.obs[s].Valid)
             if (gps[s].Valid(gps.GpsTime)) printf("*%d ",SatToSvid(s));
             else                            printf("%d ", SatToSvid(s));
@@ -16,8 +16,10 @@
 // Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "NtripClient.h"
+#include "BufferIn.h"
 #include "RawRtcm3.h"
 #include "SqliteLogger.h"
+#include "NavStore.h"
 #include <stdio.h>
 
 bool Configure(int argc, const char** argv);
@@ -32,6 +34,7 @@ const char *CasterName;
 const char *Port;
 const char *Mount;
 const char *LogName;
+const char *NavName;
 int StationId;
 extern int DebugLevel;
 
@@ -73,11 +76,16 @@ bool LoggerSession()
     debug("LoggerSession: starting\n");
     // Initialize the gps receiver
     NtripClient   in(CasterName, Port, Mount, User, Password);
-    RawRtcm3 gps(in);
+    BufferIn buffered(in);
+    RawRtcm3 gps(buffered);
     if (gps.GetError() != OK)
         return Error("Unable to read RTCM3.1 data from %s:%s/%s:%s:%s\n", 
                       CasterName, Port, Mount, User, Password);
 
+    // Start with the broadcast orbits saved by earlier sessions
+    NavStore nav(NavName);
+    if (NavName != NULL && nav.Load(gps) != OK) return Error();
+
     // Open the logger database
     SqliteLogger log(LogName, gps, StationId);
     if (log.GetError() != OK)
@@ -93,6 +101,9 @@ bool LoggerSession()
         // Write it to the log
         if (log.OutputEpoch() != OK) 
            return Error("Can't write gps data to log\n");
+
+        // Save any new broadcast orbits
+        if (NavName != NULL && nav.Update(gps) != OK) return Error();
     }
 
     // Done
@@ -108,7 +119,8 @@ void Display(RawReceiver& gps)
     TimeToDate(gps.GpsTime, year, month, day); 
     TimeToTod(gps.GpsTime, hour, min, sec, nsec);
     printf("%2d/%02d/%04d %02d:%02d:%02d  ", month,day,year,hour,min,sec);
-    for (int s=0; s<MaxSats; s++) {
+    for (int i=0; i<gps.obs.Count(); i++) {
+        int s = gps.obs.Sat(i);
         if (gps.obs[s].Valid)
             if (gps[s].Valid(gps.GpsTime)) printf("*%d ",SatToSvid(s));
             else                            printf("%d ", SatToSvid(s));
@@ -128,6 +140,7 @@ bool Configure(int argc, const char** argv)
         Mount = 0;
         CasterName = "localhost";
         LogName = "log.sqlite";
+        NavName = NULL;
         StationId = 0;   // should come from Gps??
 
 	// Process each option
@@ -142,6 +155,7 @@ bool Configure(int argc, const char** argv)
                 else if (Match(argv[i], "-user=", User))  ;
                 else if (Match(argv[i], "-password=", Password))  ;
                 else if (Match(argv[i], "-log=", LogName)) ;
+                else if (Match(argv[i], "-navstore=", NavName)) ;
 		else    return Error("Didn't recognize option %s\n", argv[i]);
 	}
 	
@@ -167,6 +181,7 @@ void DisplayHelp()
         printf("   -caster=CasterName - name or ip address of NTRIP caster\n");
         printf("   -port=TcpPortNr - tcp port number of NTRIP caster (2101)\n");
         printf("   -mnt=MountPoint - NTRIP mount point\n");
+        printf("   -navstore=NavFile - keep the broadcast orbits between sessions\n");
         printf("   -debug=n  Debug level, 0=none ... 9=lots\n");
 	printf("\n");
 
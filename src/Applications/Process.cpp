@@ -20,7 +20,10 @@
 #include "RawReceiver.h"  
 #include "RawSimulator.h"
 #include "DoubleDiff.h"
+#include "MultiRover.h"
 #include "SP3.h" 
+#include "NavStore.h"
+#include "BestEphemerides.h"
 #include "NewRawReceiver.h"
 #include "OutputFile.h"
 #include "Logger.h"
@@ -92,20 +95,29 @@ bool ResidualFile::PrintResiduals(DoubleDiff& dbl)
 
 
 bool Process(int argc, const char** argv);
+bool ProcessFleet(RawReceiver& base, Ephemerides& eph);
 bool Configure(int argc, const char** argv);
 bool DisplayOptions();
+bool OutputPosition(PositionFormatter& Output, LocalEnu& BaseCentered, LocalEnu& RovingCentered,
+					Time time, Position& pos, double cep, double fit);
 
 
 // run string parameters
 static const char* BaseModel;
 static const char* BasePortName;
-static const char* RovingModel;
-static const char* RovingPortName;
+static const char* RovingModel[MaxRovers];
+static const char* RovingPortName[MaxRovers];
+static int NrRovers;
 static const char* Sp3Name;
+static const char* Sp3Cache;
+static const char* NavName;
 static const char* OutputName;
+static const char* SmoothName;
 static enum {SPACES, COMMAS} OutputType;
 static bool Static;
+static bool Kalman;
 extern bool CodeOnly;
+extern bool FixIntegers;
 extern int DebugLevel;
 static enum {WGS84, ECEF, ENU, TEST} PositionType;
 static bool Simulator;
@@ -130,25 +142,43 @@ bool Process(int argc, const char** argv)
         double MinRange = 9999e99;
         double MaxRange = -9999e99;
 
-	// Open up the two sources of raw measurements
+	// Open up the base's raw measurements
 	RawReceiver* base = NewRawReceiver(BaseModel, BasePortName);
-	RawReceiver* roving = NewRawReceiver(RovingModel, RovingPortName);
-	if (base == NULL || roving == NULL) return Error();
+	if (base == NULL) return Error();
 
-	// Read the first epoch so we have initial position estimates
+	// Start with the broadcast orbits saved by earlier runs
+	NavStore Nav(NavName);
+	if (NavName != NULL && Nav.Load(*base) != OK) return Error();
+
+	// Read the first epoch so we have an initial position estimate
 	if (Range(base->Pos) == 0 && base->NextEpoch() != OK) return Error("Can't read first epoch from base\n");
-	if (Range(roving->Pos) == 0 && roving->NextEpoch() != OK) return Error("Can't read first epoch from rover\n");
 
 	// Configure the event logger to use base receiver's time clock
 	EventSetTime(&base->GpsTime);
  
-	// By default, we'll get the ephemerides from the base unit
-	Ephemerides *eph = base;
+	// Get each satellite's orbit from the best source available,
+	//   preferring the sp3 file if given, then the base unit.
+	BestEphemerides best;
+	Ephemerides *eph = &best;
+	if (Sp3Name != NULL) {
+		SP3* sp3 = new SP3(Sp3Name, Sp3Cache);
+		if (sp3 == NULL || best.Add(*sp3) != OK) return Error();
+	}
+	if (best.Add(*base) != OK) return Error();
+
+	// Several rovers share the work on the base.
+	//   (The rovers are read by other threads, so their orbits aren't shared.)
+	if (NrRovers > 1) {
+		if (ProcessFleet(*base, *eph) != OK) return Error();
+		if (NavName != NULL && Nav.Update(*base) != OK) return Error();
+		return OK;
+	}
 
-	// Open the sp3 file if given
-	if (Sp3Name != NULL)
-		eph = new SP3(Sp3Name);
-	if (eph == NULL) return Error();
+	// Open up the rover's raw measurements, and use its orbits as well
+	RawReceiver* roving = NewRawReceiver(RovingModel[0], RovingPortName[0]);
+	if (roving == NULL) return Error();
+	if (Range(roving->Pos) == 0 && roving->NextEpoch() != OK) return Error("Can't read first epoch from rover\n");
+	if (best.Add(*roving) != OK) return Error();
 
 	// Open the output file
 	PositionFormatter Output(OutputName, PositionType, OutputType);
@@ -162,6 +192,10 @@ bool Process(int argc, const char** argv)
 	DoubleDiff dbl(*eph, *base, *roving);
 	if (Static)
 		dbl.BeginStatic();
+	if (Kalman)
+		dbl.UseKalmanFilter();
+	if (SmoothName != NULL && dbl.BeginSmoothing(SmoothName) != OK)
+		return Error("Can't save epochs for smoothing in %s\n", SmoothName);
 
 	// Setup ENU coordinates centered at the base station
 	LocalEnu BaseCentered(base->Pos);
@@ -175,17 +209,9 @@ bool Process(int argc, const char** argv)
 	// do for each position until "done"
 	while (dbl.NextPosition(time, pos, cep, fit) == OK) {
 
-		// Convert the ECEF position to the desired form
-		Triple triple;
-		if      (PositionType == ECEF)     triple = pos;
-		else if (PositionType == WGS84)    triple = PositionToWgs84(pos);
-		else if (PositionType == ENU)      triple = BaseCentered.ToEnu(pos);
-		else if (PositionType == TEST)     triple = RovingCentered.ToEnu(pos);
-
-		// Display the position
-		Output.PrintTime(base->GpsTime);
-		if (cep == -1)   Output.Write("  *** No Data ***\n");
-		else             Output.Data(triple[0], triple[1], triple[2], cep, fit);
+		// Display the position, unless waiting to smooth it
+		if (SmoothName == NULL)
+			OutputPosition(Output, BaseCentered, RovingCentered, time, pos, cep, fit);
 
 		Residuals.PrintResiduals(dbl);
 
@@ -196,18 +222,118 @@ bool Process(int argc, const char** argv)
         printf("The base ranged from %.3f km to %.3f km\n", MinRange, MaxRange);
         debug ("The base ranged from %.3f km to %.3f km\n", MinRange, MaxRange);
 
+	// Keep the broadcast orbits for later runs
+	if (NavName != NULL && Nav.Update(*base) != OK) return Error();
+
+	// Go back over the saved epochs and display the smoothed positions
+	if (SmoothName != NULL) {
+		if (dbl.Smooth() != OK) return Error();
+		Smoother& smoothed = dbl.Smoothed();
+		for (smoothed.Rewind(); !smoothed.Done(); ) {
+			if (smoothed.NextEpoch(time, pos, cep, fit) != OK) return Error();
+			OutputPosition(Output, BaseCentered, RovingCentered, time, pos, cep, fit);
+		}
+	}
+
+	return OK;
+}
+
+
+bool ProcessFleet(RawReceiver& base, Ephemerides& eph)
+// Process each rover against the same base. Rover "r" goes to output file "OutputName.r".
+{
+	MultiRover fleet(eph, base);
+	PositionFormatter* output[MaxRovers];
+	LocalEnu* rovingCentered[MaxRovers];
+	LocalEnu BaseCentered(base.Pos);
+	char name[1024];
+
+	for (int r=0; r<NrRovers; r++) {
+
+		// Open up the rover's raw measurements
+		RawReceiver* roving = NewRawReceiver(RovingModel[r], RovingPortName[r]);
+		if (roving == NULL) return Error();
+		if (Range(roving->Pos) == 0 && roving->NextEpoch() != OK) 
+			return Error("Can't read first epoch from rover %s\n", RovingPortName[r]);
+		rovingCentered[r] = new LocalEnu(roving->Pos);
+
+		// Open the rover's output file
+		snprintf(name, sizeof(name), "%s.%d", OutputName, r);
+		output[r] = new PositionFormatter(name, PositionType, OutputType);
+		if (output[r]->GetError() != OK) return Error("Can't open output file %s\n", name);
+
+		// Create the rover's double difference engine
+		if (fleet.Add(*roving) != OK) return Error();
+		DoubleDiff& dbl = fleet[r];
+		if (Static)
+			dbl.BeginStatic();
+		if (Kalman)
+			dbl.UseKalmanFilter();
+		if (SmoothName != NULL) {
+			snprintf(name, sizeof(name), "%s.%d", SmoothName, r);
+			if (dbl.BeginSmoothing(name) != OK)
+				return Error("Can't save epochs for smoothing in %s\n", name);
+		}
+	}
+
+	// Do for each base epoch until "done", displaying the rovers which have a position
+	while (fleet.NextEpoch() == OK)
+		for (int r=0; r<NrRovers; r++)
+			if (fleet.Common[r] && SmoothName == NULL)
+				OutputPosition(*output[r], BaseCentered, *rovingCentered[r], 
+				               fleet.GpsTime[r], fleet.Pos[r], fleet.Cep[r], fleet.Fit[r]);
+	for (int r=0; r<NrRovers; r++)
+		if (fleet.Failed[r]) return Error();
+
+	// Go back over each rover's saved epochs and display the smoothed positions
+	for (int r=0; r<NrRovers && SmoothName != NULL; r++) {
+		if (fleet[r].Smooth() != OK) return Error();
+		Smoother& smoothed = fleet[r].Smoothed();
+		Time time; Position pos; double cep, fit;
+		for (smoothed.Rewind(); !smoothed.Done(); ) {
+			if (smoothed.NextEpoch(time, pos, cep, fit) != OK) return Error();
+			OutputPosition(*output[r], BaseCentered, *rovingCentered[r], time, pos, cep, fit);
+		}
+	}
+
+	for (int r=0; r<NrRovers; r++) {
+		delete output[r];
+		delete rovingCentered[r];
+	}
 	return OK;
 }
 
 
+bool OutputPosition(PositionFormatter& Output, LocalEnu& BaseCentered, LocalEnu& RovingCentered,
+					Time time, Position& pos, double cep, double fit)
+{
+	// Convert the ECEF position to the desired form
+	Triple triple;
+	if      (PositionType == ECEF)     triple = pos;
+	else if (PositionType == WGS84)    triple = PositionToWgs84(pos);
+	else if (PositionType == ENU)      triple = BaseCentered.ToEnu(pos);
+	else if (PositionType == TEST)     triple = RovingCentered.ToEnu(pos);
+
+	// Display the position
+	Output.PrintTime(time);
+	if (cep == -1)   return Output.Write("  *** No Data ***\n");
+	else             return Output.Data(triple[0], triple[1], triple[2], cep, fit);
+}
+
+
 
  bool Configure(int argc, const char** argv)
  {
      // defaults
 	 CodeOnly = false;
+	 FixIntegers = false;
 	 Static = false;
+	 Kalman = false;
 	 Sp3Name = NULL;
+	 Sp3Cache = NULL;
+	 NavName = NULL;
 	 OutputName = NULL;
+	 SmoothName = NULL;
 	 OutputType = SPACES;
 	 Simulator = false;
 
@@ -218,7 +344,12 @@ bool Process(int argc, const char** argv)
 
 		 if (Same(argv[i], "-codeonly"))     CodeOnly = true;
 		 else if (Same(argv[i], "-static"))  Static = true;
+		 else if (Same(argv[i], "-kalman"))  Kalman = true;
+		 else if (Same(argv[i], "-fix"))     FixIntegers = true;
 		 else if (Match(argv[i], "-sp3=", Sp3Name))   ;
+		 else if (Match(argv[i], "-sp3cache=", Sp3Cache))  ;
+		 else if (Match(argv[i], "-navstore=", NavName))   ;
+		 else if (Match(argv[i], "-smooth=", SmoothName))  ;
 		 else if (Match(argv[i], "-ecef=", OutputName))    PositionType = ECEF;
 		 else if (Match(argv[i], "-enu=", OutputName))     PositionType = ENU;
 		 else if (Match(argv[i], "-wgs84=", OutputName))   PositionType = WGS84;
@@ -229,16 +360,23 @@ bool Process(int argc, const char** argv)
 		 else    return Error("Didn't recognize option %s\n", argv[i]);
 	 }
 
+	 if (Kalman && SmoothName != NULL)
+		 return Error("Smoothing needs the least squares solution, not -kalman\n");
+
 	 if (OutputName == NULL)
 		 return Error("Need to specify an output file. (eg. ""-wgs84=file.out"") \n");
 
-	 if (argc-i < 4)
-		 return Error("Need to specify: BaseModel BaseFile RovingModel RovingFile\n");
+	 if (argc-i < 4 || (argc-i)%2 != 0)
+		 return Error("Need to specify: BaseModel BaseFile RovingModel RovingFile ...\n");
+	 if ((argc-i)/2 - 1 > MaxRovers)
+		 return Error("No more than %d rovers\n", MaxRovers);
 
 	 BaseModel = argv[i];
 	 BasePortName = argv[i+1];
-	 RovingModel = argv[i+2];
-	 RovingPortName = argv[i+3];
+	 for (NrRovers=0, i+=2; i<argc; NrRovers++, i+=2) {
+		 RovingModel[NrRovers] = argv[i];
+		 RovingPortName[NrRovers] = argv[i+1];
+	 }
 
 	 return OK;
  }
@@ -247,13 +385,15 @@ bool Process(int argc, const char** argv)
  bool DisplayOptions()
  {
 	 printf("\n");
-     printf("Process [options] BaseModel BaseFile RovingModel RovingFile\n");
+     printf("Process [options] BaseModel BaseFile RovingModel RovingFile [RovingModel RovingFile ...]\n");
 	 printf("     Double difference postprocessor for GPS data\n");
 	 printf("\n");
 	 printf("        BaseModel - the type of gps (or data) for the base receiver\n");
 	 printf("        BaseFile  - the name of base receiver's data file\n");
 	 printf("        RovingModel - type of gps (or data) for the rover\n");
 	 printf("        RovingFile - the name of the roving receiver's data file\n");
+	 printf("     With several rovers, the base is read once and shared. Rover ""n""\n");
+	 printf("       (counting from 0) goes to ""outputfile.n"" and saves epochs in ""tmpfile.n""\n");
      printf("\n");
 	 printf("    The following ""models"" are supported\n");
 	 printf("        RINEX      - Rinex V2.3\n");
@@ -265,8 +405,16 @@ bool Process(int argc, const char** argv)
 	 printf("    Where {options} include any of the following:\n");
 	 printf("        -static    - the roving receiver is standing still\n");
 	 printf("        -codeonly  - do the calculation without carrier phase\n");
+	 printf("        -kalman    - use a Kalman filter rather than least squares\n");
+	 printf("        -fix       - resolve the phase ambiguities to integers\n");
+	 printf("        -smooth=tmpfile - improve earlier positions with the final ambiguities\n");
+	 printf("                     (epochs are saved in ""tmpfile"" until the end)\n");
      printf("        -sp3=ephfile  - use precise ephemerides from ""file""\n");
-	 printf("                     (otherwise, use base receiver's broadcast eph if avail)\n");
+	 printf("                     (otherwise, or where it has none, use the broadcast eph\n");
+	 printf("                      from the base, then the rover)\n");
+	 printf("                     (consecutive files may be given as ""file1,file2,..."")\n");
+	 printf("        -sp3cache=cachefile - keep the sp3 data in binary form for quicker loading\n");
+	 printf("        -navstore=navfile - keep the base's broadcast orbits between runs\n");
 	 printf("        -enu=outputfile  - output ENU from Base\n");
 	 printf("        -ecef=outputfile - output ECEF (XYZ)\n");
 	 printf("        -wgs84=outputfile - output Lat/Lon/Alt (default)\n");
@@ -0,0 +1,77 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "BaseEpoch.h"
+
+
+BaseEpoch::BaseEpoch(RawReceiver& base, Ephemerides& eph)
+: Base(base), Eph(eph)
+{
+	GpsTime = -1;
+}
+
+
+bool BaseEpoch::Next()
+{
+	if (Base.NextEpoch() != OK) return Error();
+	Base.FindActive();
+	GpsTime = Base.GpsTime;
+
+	// Do for each satellite the base is tracking
+	int sat[MaxInView]; Time t[MaxInView]; int n = 0;
+	for (int i=0; i<Base.Active.Count(); i++) {
+		int s = Base.Active[i];
+
+		// The differences assume a common L1 frequency and GPS time
+		if (SatSystem(s) != GPS && SatSystem(s) != SBAS)
+			continue;
+		if (!Base.obs[s].Valid || !Eph[s].Valid(GpsTime))
+			continue;
+		sat[n] = s;  t[n] = GpsTime;  n++;
+	}
+
+	// Get the satellites' positions all at once, skipping those we can't.
+	//   They are corrected for the earth's rotation during the signal's transit
+	//   to the base. The rovers are close by.
+	Position pos[MaxInView]; double adjust[MaxInView]; bool ok[MaxInView];
+	if (Eph.SatPos(n, sat, t, Base.Pos, pos, adjust, ok) != OK)
+		ClearError();
+
+	Sats.Clear();
+	for (int k=0; k<n; k++) {
+		int s = sat[k];
+		if (!ok[k]) {
+			debug("BaseEpoch::Next - no position for satellite %d\n", s);
+			continue;
+		}
+		BaseSatellite* b = Sats.Add(s);
+		if (b == NULL) return Error();
+
+		// The base's half of the single differences
+		b->SatPos = pos[k];
+		b->Offset = Base.Pos - b->SatPos;
+		b->Range = Range(b->Offset);
+	}
+
+	return OK;
+}
+
+
+BaseEpoch::~BaseEpoch()
+{
+}
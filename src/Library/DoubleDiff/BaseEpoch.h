@@ -0,0 +1,64 @@
+#ifndef BASEEPOCH_INCLUDED
+#define BASEEPOCH_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "RawReceiver.h"
+#include "Ephemeris.h"
+#include "SatArray.h"
+
+
+struct BaseSatellite
+{
+	Position SatPos;      // corrected for the earth's rotation during transit to the base
+	Position Offset;      // base position - satellite position
+	double Range;         // distance from satellite to base
+	int Sat;
+
+	BaseSatellite() : SatPos(0), Offset(0), Range(0), Sat(-1) {}
+};
+
+
+//////////////////////////////////////////////////////////////////
+//
+// BaseEpoch - the base station's side of an epoch, worked out once
+//   and shared by every rover processed against the same base.
+//
+//   Next() reads the base's next epoch and finds the position of each
+//   satellite it tracks, along with the satellite's range from the base.
+//   The rovers only read it, so they can work on it at the same time.
+//
+///////////////////////////////////////////////////////////////////
+
+class BaseEpoch
+{
+public:
+	RawReceiver& Base;
+	Ephemerides& Eph;
+	Time GpsTime;
+	SatArray<BaseSatellite, MaxInView> Sats;   // satellites with a known position
+
+public:
+	BaseEpoch(RawReceiver& base, Ephemerides& eph);
+	bool Next();
+	inline const BaseSatellite& operator[](int sat) const {return Sats[sat];}
+	virtual ~BaseEpoch();
+};
+
+#endif // BASEEPOCH_INCLUDED
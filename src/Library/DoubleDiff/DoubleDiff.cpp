@@ -32,10 +32,6 @@
 //
 // TO DO:
 //   o Statistically valid error estimates. 
-//   o (eventually) Integer solution of phase ambiguity variables.
-//   o Save data necessary to move backward in time. This allows us to
-//     use our final values of the phase variables to update earlier estimates 
-//     of positions. (smoothing).
 //   o Allow roving receiver to take up a known station and improve the location
 //     of the stationary receiver.  (eg. stationary is on car in parking lot,
 //     rover stops at a known benchmark for a short time.)
@@ -47,7 +43,24 @@
 
 
 DoubleDiff::DoubleDiff(Ephemerides& e, RawReceiver& s, RawReceiver& r)
-: Eph(e), Base(s), Rover(r), solution(Base.Pos, Rover.Pos)
+: Eph(e), Base(s), Rover(r), Trials(Check, Thread::Processors())
+{
+	Shared = NULL;
+	Begin();
+}
+
+
+DoubleDiff::DoubleDiff(BaseEpoch& s, RawReceiver& r)
+: Eph(s.Eph), Base(s.Base), Rover(r), Trials(Check, 1)
+// A rover sharing the base with others. The rovers keep the processors busy,
+//   so the trial solutions are done in our own thread.
+{
+	Shared = &s;
+	Begin();
+}
+
+
+void DoubleDiff::Begin()
 {
 	// Start with this position estimate
 	LastComputedPosition = Rover.Pos;
@@ -55,10 +68,17 @@ DoubleDiff::DoubleDiff(Ephemerides& e, RawReceiver& s, RawReceiver& r)
 	// Assume Kinematic by default
 	Kinematic = true;
 
+	// Least squares unless asked for a Kalman filter
+	solution = new LeastSquaresSolution(Base.Pos, Rover.Pos);
+
+	// Not smoothing unless asked
+	Store = NULL;
+
 	// Current and previous observations. Pointers so we can swap easily.
 	Obs = new Observations;
 	PreviousObs = new Observations;
 
+	ClearSlips();
 	Reset();
 }
 
@@ -67,16 +87,39 @@ DoubleDiff::DoubleDiff(Ephemerides& e, RawReceiver& s, RawReceiver& r)
 
 bool DoubleDiff::NextPosition(Time& t, Position& pos, double& cep, double& fit)
 {
-    if (Kinematic)
-		solution.NewPosition(LastComputedPosition);
-
     // Advance the two receivers until they have an epoch in common
 	if (DoubleNextEpoch(Base, Rover) != OK)
 		return Error();
 
+	return ProcessEpoch(t, pos, cep, fit);
+}
+
+
+bool DoubleDiff::NextSharedPosition(bool& common, bool& ended, Time& t, Position& pos, double& cep, double& fit)
+// The position at the shared base's current epoch. The base has already been advanced.
+//   If the rover has no matching epoch, "common" is false and there is no position.
+//   If the rover couldn't be read, "ended" is true along with the error.
+{
+	ended = false;
+	if (Shared == NULL) return Error("DoubleDiff::NextSharedPosition - base isn't shared\n");
+	if (CatchUp(common) != OK) {ended = true; return Error();}
+	if (!common) return OK;
+
+	return ProcessEpoch(t, pos, cep, fit);
+}
+
+
+bool DoubleDiff::ProcessEpoch(Time& t, Position& pos, double& cep, double& fit)
+// Find the position once the receivers are at a common epoch
+{
+    if (Kinematic)
+		solution->NewPosition(LastComputedPosition);
+
 	// Save the old observations and get new ones
 	Swap(Obs, PreviousObs);
-	Obs->Init(Base, Rover, Eph);
+	if (Shared != NULL) Obs->Init(*Shared, Rover);
+	else                Obs->Init(Base, Rover, Eph);
+	if (Obs->GetError() != OK) return Error();
 	
 	// Decide which satellites we are going to use
 	Check.SelectSatellites(*Obs, *PreviousObs);
@@ -84,6 +127,9 @@ bool DoubleDiff::NextPosition(Time& t, Position& pos, double& cep, double& fit)
 	// Find the best solution, dropping satellites if necesary
 	if (FindBestSolution(*Obs, pos, cep, fit) != OK) return Error();
 
+	// Save the epoch for smoothing
+	if (Store != NULL && solution->SaveEpoch(GpsTime, pos, cep, fit) != OK) return Error();
+
 	// Keep track of our last position
 	if (cep < 0)     pos = LastComputedPosition;
 	else             LastComputedPosition = pos;
@@ -101,16 +147,22 @@ bool DoubleDiff::NextPosition(Time& t, Position& pos, double& cep, double& fit)
 bool DoubleDiff::FindBestSolution(Observations& Obs, Position& pos, double& cep, double& fit)
 {
 	// Save our current solution so we can roll back if necessary
-	Solution backup = solution;
+	if (solution->Checkpoint() != OK) return Error();
 
-	// Using all the satellites, solve position
-	if (solution.Update(Obs, pos, cep, fit) != OK) return Error();
+	// Using all the satellites, solve position. A failed solve leaves nothing behind.
+	if (solution->Update(Obs, pos, cep, fit) != OK) {
+		solution->Rollback(); solution->Commit();
+		return Error();
+	}
 
 	// If the solution is acceptable (or none found), then done
-	if (Check.Acceptable(Obs, solution)) return OK;
+	if (Check.Acceptable(Obs, *solution)) return solution->Commit();
+
+	// Remember how each satellite contributed to the rejected solution
+	if (solution->GetInfluence(Obs, Diag) != OK) return Error();
 
       // Drop the worst of the satellites.
-      solution = backup;
+      if (solution->Rollback() != OK) return Error();
       double oldfit = fit;
       int Worst1 = -1; int Worst2 = -1;
       if (DropWorst(Obs, Worst1) != OK) return Error();
@@ -119,93 +171,221 @@ bool DoubleDiff::FindBestSolution(Observations& Obs, Position& pos, double& cep,
       if (Worst1 == -1)
           if (Drop2Worst(Obs, Worst1, Worst2) != OK) return Error();
 
+      // Done with trial solutions
+      if (solution->Commit() != OK) return Error();
+
       // If no acceptable solution found, start all over.
       if (Worst1 == -1) {
           Event("Unable get solution. Starting all over.  fit=%.1f\n", oldfit);
-          solution.Reset();
+          solution->Reset();
           cep = -1;
           return OK;
       }
 
       // Calculate the new solution
-	if (solution.Update(Obs, pos, cep, fit)) return Error();  
+	if (solution->Update(Obs, pos, cep, fit)) return Error();  
       Event("Residuals out of bounds, dropping satellites %d and %d.  fit(%.1f-->%.1f)\n", 
                                                        Worst1, Worst2, oldfit, fit);
       return OK;
 }
 
-     
+
+// Fits closer than this are too close to call from the predictions alone
+static const double Tie = 1e-6;
 
 bool DoubleDiff::DropWorst(Observations& Obs, int& WorstSat)
+// Find the satellite whose removal gives the best acceptable fit.
+//   The candidates are ranked from the rejected solution's residuals, and only
+//   the winner is solved for real. If the ranking can't be trusted
+//   (inexact predictions, a near tie, or the winner fails), search the hard way.
 {
-	Solution backup = solution;
-
-	// do for each valid satellite
-	WorstSat = -1; double WorstFit = 999999;
-	for (int s=0; s<MaxSats; s++) {
+	WorstSat = -1; double WorstFit = 999999; double NextFit = 999999;
+	bool Doubtful = !Diag.Valid();
+	for (int i=0; i<Obs.Active.Count() && !Doubtful; i++) {
+		int s = Obs.Active[i];
 		if (!Obs[s].ValidPhase && !Obs[s].ValidCode) continue;
 
-	    // do a temporary reconfiguration without the satellite
-		bool oldphase = Obs[s].ValidPhase; Obs[s].ValidPhase = false;
-		bool oldcode  = Obs[s].ValidCode;  Obs[s].ValidCode = false;
-		debug("DoubledDiff::Update - experimentally droppinng %d\n", s);
-
-		// keep track of the most acceptable configuration (ie worst satellite)
-          Position pos; double cep; double fit;
-	    if (solution.Update(Obs, pos, cep, fit) != OK) return Error();
-		if (Check.Acceptable(Obs, solution) && fit < WorstFit)
-			{WorstSat = s; WorstFit=fit;}
-
-		// Undo the temporary reconfiguration
-		solution = backup;
-		Obs.obs[s].ValidPhase = oldphase;
-		Obs.obs[s].ValidCode = oldcode;
+		bool exact, acceptable; double fit;
+		if (PredictDrop(Obs, s, -1, exact, acceptable, fit) != OK) return Error();
+		if (!exact)               Doubtful = true;
+		else if (!acceptable)     ;
+		else if (fit < WorstFit)  {NextFit = WorstFit; WorstSat = s; WorstFit = fit;}
+		else if (fit < NextFit)   NextFit = fit;
 	}
-	debug("DoubleDiff::Update - WorstSat=%d\n", WorstSat);
+	if (WorstSat != -1 && NextFit <= WorstFit + Tie*abs(WorstFit))
+		Doubtful = true;
+
+	// Confirm the winner with a real solution
+	if (!Doubtful && WorstSat != -1) {
+		bool acceptable; double fit;
+		if (TryDrop(Obs, WorstSat, -1, acceptable, fit) != OK) return Error();
+		Doubtful = !acceptable;
+	}
+	debug("DoubleDiff::DropWorst - predicted WorstSat=%d  fit=%.3f  Doubtful=%d\n",
+		WorstSat, WorstFit, Doubtful);
+
+	if (Doubtful)
+		return SearchWorst(Obs, WorstSat);
 
 	// Drop the worst satellite if any.
       if (WorstSat != -1)
-	     Obs[WorstSat].ValidPhase = Obs[WorstSat].ValidCode = false;
+	     Obs.Entry(WorstSat).ValidPhase = Obs.Entry(WorstSat).ValidCode = false;
 	return OK;
 }
 
 
 
 bool DoubleDiff::Drop2Worst(Observations& Obs, int& Worst1, int& Worst2)
+// Same as DropWorst, but for pairs of satellites.
 {
-	Solution backup = solution;
+	Worst1 = Worst2 = -1; double WorstFit = 999999; double NextFit = 999999;
+	bool Doubtful = !Diag.Valid();
+	for (int i=0; i<Obs.Active.Count() && !Doubtful; i++) for (int j=i+1; j<Obs.Active.Count() && !Doubtful; j++) {
+		int s = Obs.Active[i];  int t = Obs.Active[j];
+		if (!Obs[s].ValidPhase && !Obs[s].ValidCode) continue;
+            if (!Obs[t].ValidPhase && !Obs[t].ValidCode) continue;
+
+		bool exact, acceptable; double fit;
+		if (PredictDrop(Obs, s, t, exact, acceptable, fit) != OK) return Error();
+		if (!exact)               Doubtful = true;
+		else if (!acceptable)     ;
+		else if (fit < WorstFit)  {NextFit = WorstFit; Worst1 = s; Worst2 = t; WorstFit = fit;}
+		else if (fit < NextFit)   NextFit = fit;
+	}
+	if (Worst1 != -1 && NextFit <= WorstFit + Tie*abs(WorstFit))
+		Doubtful = true;
+
+	// Confirm the winner with a real solution
+	if (!Doubtful && Worst1 != -1) {
+		bool acceptable; double fit;
+		if (TryDrop(Obs, Worst1, Worst2, acceptable, fit) != OK) return Error();
+		Doubtful = !acceptable;
+	}
+	debug("DoubleDiff::Drop2Worst - predicted Worst1=%d  Worst2=%d  fit=%.3f  Doubtful=%d\n",
+		Worst1, Worst2, WorstFit, Doubtful);
+
+	if (Doubtful)
+		return Search2Worst(Obs, Worst1, Worst2);
+
+	// Drop the worst satellite if any.
+      if (Worst1 != -1)
+	     Obs.Entry(Worst1).ValidPhase=Obs.Entry(Worst1).ValidCode=Obs.Entry(Worst2).ValidPhase=Obs.Entry(Worst2).ValidCode = false;
+	return OK;
+}
 
+
+
+bool DoubleDiff::SearchWorst(Observations& Obs, int& WorstSat)
+// Find the worst satellite by solving without each satellite in turn
+{
 	// do for each valid satellite
-	Worst1 = Worst2 = -1; double WorstFit = 999999;
-	for (int s=0; s<MaxSats; s++) for (int t=s+1; t<MaxSats; t++) {
+	Trials.Reset();
+	for (int i=0; i<Obs.Active.Count(); i++) {
+		int s = Obs.Active[i];
 		if (!Obs[s].ValidPhase && !Obs[s].ValidCode) continue;
-            if (!Obs[t].ValidPhase && !Obs[t].ValidCode) continue;
+		Trials.Add(s);
+	}
+	if (Trials.Run(*solution, Obs) != OK) return Error();
+
+	// keep track of the most acceptable configuration (ie worst satellite)
+	WorstSat = -1; double WorstFit = 999999;
+	for (int i=0; i<Trials.NrCandidates; i++)
+		if (Trials.Acceptable[i] && Trials.Fit[i] < WorstFit)
+			{WorstSat = Trials.Sat1[i]; WorstFit = Trials.Fit[i];}
+	debug("DoubleDiff::Update - WorstSat=%d\n", WorstSat);
+
+	// Drop the worst satellite if any.
+      if (WorstSat != -1)
+	     Obs.Entry(WorstSat).ValidPhase = Obs.Entry(WorstSat).ValidCode = false;
+	return OK;
+}
+
 
-	    // do a temporary reconfiguration without the satellite
-		bool oldphases = Obs[s].ValidPhase; Obs[s].ValidPhase = false;
-		bool oldcodes  = Obs[s].ValidCode;  Obs[s].ValidCode = false;
-            bool oldphaset = Obs[t].ValidPhase; Obs[t].ValidPhase = false;
-            bool oldcodet  = Obs[t].ValidCode;  Obs[t].ValidCode = false;
-		debug("DoubledDiff::Update - experimentally droppinng %d and %d\n", s, t);
-
-		// keep track of the most acceptable configuration (ie worst satellite)
-          Position pos; double cep; double fit;
-	    if (solution.Update(Obs, pos, cep, fit) != OK) return Error();
-		if (Check.Acceptable(Obs, solution) && fit < WorstFit)
-			{Worst1 = s; Worst2 = t; WorstFit=fit;}
-
-		// Undo the temporary reconfiguration
-		solution = backup;
-		Obs[s].ValidPhase = oldphases;
-		Obs[s].ValidCode = oldcodes;
-            Obs[t].ValidPhase = oldphaset;
-            Obs[t].ValidCode = oldcodet;
+
+bool DoubleDiff::Search2Worst(Observations& Obs, int& Worst1, int& Worst2)
+// Find the two worst satellites by solving without each pair in turn
+{
+	// do for each valid pair of satellites
+	Trials.Reset();
+	for (int i=0; i<Obs.Active.Count(); i++) for (int j=i+1; j<Obs.Active.Count(); j++) {
+		int s = Obs.Active[i];  int t = Obs.Active[j];
+		if (!Obs[s].ValidPhase && !Obs[s].ValidCode) continue;
+            if (!Obs[t].ValidPhase && !Obs[t].ValidCode) continue;
+		Trials.Add(s, t);
 	}
+	if (Trials.Run(*solution, Obs) != OK) return Error();
+
+	// keep track of the most acceptable configuration (ie worst satellite)
+	Worst1 = Worst2 = -1; double WorstFit = 999999;
+	for (int i=0; i<Trials.NrCandidates; i++)
+		if (Trials.Acceptable[i] && Trials.Fit[i] < WorstFit)
+			{Worst1 = Trials.Sat1[i]; Worst2 = Trials.Sat2[i]; WorstFit = Trials.Fit[i];}
 	debug("DoubleDiff::Update - Worst1=%d  Worst2=%d\n", Worst1, Worst2);
 
 	// Drop the worst satellite if any.
       if (Worst1 != -1)
-	     Obs[Worst1].ValidPhase=Obs[Worst1].ValidCode=Obs[Worst2].ValidPhase=Obs[Worst2].ValidCode = false;
+	     Obs.Entry(Worst1).ValidPhase=Obs.Entry(Worst1).ValidCode=Obs.Entry(Worst2).ValidPhase=Obs.Entry(Worst2).ValidCode = false;
+	return OK;
+}
+
+
+
+bool DoubleDiff::PredictDrop(Observations& Obs, int s, int t, 
+							 bool& exact, bool& acceptable, double& fit)
+// Predict the solution without satellites s and t (t may be -1)
+{
+	// do a temporary reconfiguration without the satellites
+	bool oldphases = Obs[s].ValidPhase; Obs.Entry(s).ValidPhase = false;
+	bool oldcodes  = Obs[s].ValidCode;  Obs.Entry(s).ValidCode = false;
+	bool oldphaset, oldcodet;
+	if (t != -1) {
+		oldphaset = Obs[t].ValidPhase; Obs.Entry(t).ValidPhase = false;
+		oldcodet  = Obs[t].ValidCode;  Obs.Entry(t).ValidCode = false;
+	}
+
+	exact = Diag.Predict(s, t) == OK;
+	acceptable = exact && Check.Acceptable(Obs, Diag);
+	fit = Diag.GetFit();
+	debug(2, "DoubleDiff::PredictDrop s=%d t=%d  exact=%d acceptable=%d fit=%.3f\n",
+		s, t, exact, acceptable, fit);
+
+	// Undo the temporary reconfiguration
+	Obs.Entry(s).ValidPhase = oldphases;
+	Obs.Entry(s).ValidCode = oldcodes;
+	if (t != -1) {
+		Obs.Entry(t).ValidPhase = oldphaset;
+		Obs.Entry(t).ValidCode = oldcodet;
+	}
+	return OK;
+}
+
+
+
+bool DoubleDiff::TryDrop(Observations& Obs, int s, int t, bool& acceptable, double& fit)
+// Solve without satellites s and t (t may be -1), then roll back to the checkpoint
+{
+	// do a temporary reconfiguration without the satellites
+	bool oldphases = Obs[s].ValidPhase; Obs.Entry(s).ValidPhase = false;
+	bool oldcodes  = Obs[s].ValidCode;  Obs.Entry(s).ValidCode = false;
+	bool oldphaset, oldcodet;
+	if (t != -1) {
+		oldphaset = Obs[t].ValidPhase; Obs.Entry(t).ValidPhase = false;
+		oldcodet  = Obs[t].ValidCode;  Obs.Entry(t).ValidCode = false;
+	}
+	debug("DoubledDiff::Update - experimentally droppinng %d and %d\n", s, t);
+
+	Position pos; double cep;
+	if (solution->Update(Obs, pos, cep, fit) != OK) return Error();
+	acceptable = Check.Acceptable(Obs, *solution);
+
+	// Undo the temporary reconfiguration
+	if (solution->Rollback() != OK) return Error();
+	Obs.Entry(s).ValidPhase = oldphases;
+	Obs.Entry(s).ValidCode = oldcodes;
+	if (t != -1) {
+		Obs.Entry(t).ValidPhase = oldphaset;
+		Obs.Entry(t).ValidCode = oldcodet;
+	}
 	return OK;
 }
 
@@ -224,12 +404,41 @@ void DoubleDiff::BeginStatic()
 	Kinematic = false;
 }
 
+void DoubleDiff::UseKalmanFilter()
+// Switch to a Kalman filter solution. Starts over from the last position.
+{
+	Event("Using Kalman filter\n");
+	delete solution;
+	solution = new KalmanSolution(Base.Pos, LastComputedPosition);
+}
+
+
+
+
+
+bool DoubleDiff::BeginSmoothing(const char* name)
+// Save each epoch in the named file so the positions can be smoothed at the end
+{
+	Event("Saving epochs for smoothing in %s\n", name);
+	Store = new Smoother(name);
+	if (Store->GetError() != OK) return Error();
+	return solution->Record(Store);
+}
 
 
+bool DoubleDiff::Smooth()
+// Improve the saved positions using the final ambiguities. Read them with Smoothed().
+{
+	if (Store == NULL) return Error("DoubleDiff::Smooth - not saving epochs\n");
+	if (solution->EndRecording() != OK) return Error();
+	return Store->Smooth();
+}
 
 
 DoubleDiff::~DoubleDiff(void)
 {
+	delete solution;
+	delete Store;
 }
 
 
@@ -239,24 +448,16 @@ DoubleDiff::~DoubleDiff(void)
 
 bool DoubleDiff::DoubleNextEpoch(RawReceiver& base, RawReceiver& rover)
 {
-	// Assume the satellites haven't slipped until proven otherwise
-	bool Slip[MaxSats];
-	for (int s=0; s<MaxSats; s++)
-		Slip[s] = false;
-
 	// repeat ... 
 	do {
 		// Decide which receiver is lagging behind
-		RawReceiver& lagging = (base.GpsTime < rover.GpsTime)? 
-                                   base: rover;
+		bool laggingBase = base.GpsTime < rover.GpsTime;
+		RawReceiver& lagging = laggingBase? base: rover;
+
 		// Advance the lagging receiver
 		if (lagging.NextEpoch() != OK) return Error();
-
-		// Update the slip status
-		for (int s=0; s<MaxSats; s++)
-			Slip[s] |= !lagging.obs[s].Valid 
-			        || lagging.obs[s].Slip 
-					|| lagging.obs[s].Phase == 0;
+		lagging.FindActive();
+		Advanced(lagging, laggingBase);
 
     // ... until the epochs match
 	} while (base.GpsTime != rover.GpsTime);
@@ -264,17 +465,79 @@ bool DoubleDiff::DoubleNextEpoch(RawReceiver& base, RawReceiver& rover)
 	// Make note of our time
 	GpsTime = base.GpsTime;
 
-	// Mark the receivers as slipped
-	for (int s=0; s<MaxSats; s++)
-		base.obs[s].Slip = rover.obs[s].Slip = Slip[s];
+	// Mark the receivers as slipped. Only the valid observations are looked at later.
+	MarkSlips(base);
+	MarkSlips(rover);
+	ClearSlips();
 	
 	return OK;
 }
 
 
+bool DoubleDiff::CatchUp(bool& common)
+// Advance the rover to the shared base's epoch, if it has one
+{
+	Advanced(Base, true);
+	while (Rover.GpsTime < Shared->GpsTime) {
+		if (Rover.NextEpoch() != OK) return Error();
+		Rover.FindActive();
+		Advanced(Rover, false);
+	}
+
+	common = (Rover.GpsTime == Shared->GpsTime);
+	if (!common) return OK;
+	GpsTime = Shared->GpsTime;
+
+	// Only the rover is marked since the base belongs to everyone.
+	//   A slip on either side is a slip in the observations.
+	MarkSlips(Rover);
+	ClearSlips();
+
+	return OK;
+}
+
+
+void DoubleDiff::Advanced(RawReceiver& r, bool base)
+// A receiver moved to a new epoch. A satellite has slipped if it slipped in any 
+//   of the epochs we pass, or if it was missing from any of them.
+{
+	// Keep track of the satellites present in every epoch
+	SatSet& seen = base? BaseSeen: RoverSeen;
+	bool& moved = base? BaseMoved: RoverMoved;
+	if (moved) seen.Intersect(r.Active);
+	else       seen = r.Active;
+	moved = true;
+
+	// Update the slip status
+	for (int i=0; i<r.Active.Count(); i++) {
+		int s = r.Active[i];
+		if (r.obs[s].Slip || r.obs[s].Phase == 0)
+			Slipped.Add(s);
+	}
+}
+
+
+void DoubleDiff::MarkSlips(RawReceiver& r)
+{
+	for (int i=0; i<r.Active.Count(); i++) {
+		int s = r.Active[i];
+		r.obs.Entry(s).Slip = Slipped.Contains(s) 
+			         || (BaseMoved && !BaseSeen.Contains(s))
+					 || (RoverMoved && !RoverSeen.Contains(s));
+	}
+}
+
+
+void DoubleDiff::ClearSlips()
+{
+	Slipped.Clear();
+	BaseMoved = RoverMoved = false;
+}
+
+
 void DoubleDiff::Reset()
 {
-	solution.Reset();
+	solution->Reset();
 }
 
 
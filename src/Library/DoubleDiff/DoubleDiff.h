@@ -24,7 +24,11 @@
 #include "RawReceiver.h"
 #include "Observations.h"
 #include "Policy.h"
-#include "Solution.h"
+#include "LeastSquaresSolution.h"
+#include "KalmanSolution.h"
+#include "TrialPool.h"
+#include "Smoother.h"
+#include "BaseEpoch.h"
 
 
 //////////////////////////////////////////////////////////////////
@@ -53,35 +57,67 @@ protected: // Data
 	// Consistency checker
 	Policy Check;
 	
-	// The cumulative solution
-	Solution solution;
+	// The cumulative solution (least squares, or a Kalman filter)
+	Solution* solution;
+
+	// How each satellite influenced the last rejected solution
+	Influence Diag;
+
+	// Workers for trying out solutions without each satellite
+	TrialPool Trials;
+
+	// Where the epochs are saved for smoothing, if anywhere
+	Smoother* Store;
+
+	// The base's epochs, when they are shared with other rovers
+	BaseEpoch* Shared;
+
+	// Slips seen while bringing the receivers to a common epoch
+	SatSet Slipped, BaseSeen, RoverSeen;
+	bool BaseMoved, RoverMoved;
 
 public:
 	DoubleDiff(Ephemerides& e, RawReceiver& s, RawReceiver& r);
+	DoubleDiff(BaseEpoch& s, RawReceiver& r);
 	bool NextPosition(Time& time, Position& pos, double& cep, double& fit);
+	bool NextSharedPosition(bool& common, bool& ended, Time& time, Position& pos, double& cep, double& fit);
 	void BeginStatic();
 	void BeginKinematic();
+	void UseKalmanFilter();
+	bool BeginSmoothing(const char* name);
+	bool Smooth();
+	Smoother& Smoothed()             {return *Store;}
 	virtual ~DoubleDiff(void);
 
 	void LogResiduals();
 
 	// Get information about the solution
 	Time GetTime()                   {return GpsTime;}
-	Position GetPosition()           {return solution.GetPosition();}
-	double GetCep()                  {return solution.GetCep();}   
+	Position GetPosition()           {return solution->GetPosition();}
+	double GetCep()                  {return solution->GetCep();}   
 	bool ValidCode(int sat)          {return (*Obs)[sat].ValidCode;}
 	bool ValidPhase(int sat)         {return (*Obs)[sat].ValidPhase;}
-	double GetCodeResidual(int sat)  {return solution.GetCodeResidual(sat);} 
-	double GetPhaseResidual(int sat) {return solution.GetPhaseResidual(sat);}
+	double GetCodeResidual(int sat)  {return solution->GetCodeResidual(sat);} 
+	double GetPhaseResidual(int sat) {return solution->GetPhaseResidual(sat);}
 
 private: // Procedures
+	void Begin();
     bool DoubleNextEpoch(RawReceiver& base, RawReceiver& rover);
+    bool CatchUp(bool& common);
+    void Advanced(RawReceiver& r, bool base);
+    void MarkSlips(RawReceiver& r);
+    void ClearSlips();
+    bool ProcessEpoch(Time& time, Position& pos, double& cep, double& fit);
 	void NewPosition(Position& pos);
 	bool UpdateObservations(Position& pos, double& cep, double& fit);
 	void Reset();
 	bool FindBestSolution(Observations &Obs, Position& pos, double& cep, double& fit);
         bool DropWorst(Observations& Obs, int& sat);
         bool Drop2Worst(Observations& obs, int& Worst1, int& Worst2);
+        bool SearchWorst(Observations& Obs, int& sat);
+        bool Search2Worst(Observations& obs, int& Worst1, int& Worst2);
+        bool PredictDrop(Observations& Obs, int s, int t, bool& exact, bool& acceptable, double& fit);
+        bool TryDrop(Observations& Obs, int s, int t, bool& acceptable, double& fit);
 };
 
 #endif // DOUBLEDIFF_INCLUDED
@@ -25,7 +25,8 @@
 //   whole waves. In this case, we do a least squares estimate and let
 //   the resultss fall on fractional numbers. We should get a good solution,
 //   but the resulting positions are not as precise as if we figured out the 
-//   exact integers. I hope to add integer "fixed" solutions at a later date.
+//   exact integers. When asked, Solution looks for the integers (Lambda) and
+//   feeds them back here as constraints, giving a "fixed" solution.
 //
 // All of the mathematics is based on Householder transformations. These
 //   linear transformations take the place of conventional "elimination" 
@@ -69,6 +70,11 @@
 //    They allow us to rearrange and eliminate variables to our heart's content
 //    while maintaining the conditions necessary for a good least-squares solution.
 //
+// In practice, LinearEquations does all of the above with Givens rotations, which
+//    are the same orthogonal transforms applied one element at a time. The matrix is
+//    kept upper diagonal between epochs, so each epoch only pays for the equations
+//    it adds, and losing a satellite only rotates the columns after its own.
+//
 // To keep memory management and matrix operations simple, we allocate a single
 //   fixed size matrix.  The first five columns hold Tphase, Tcode, X, Y and Z,
 //   and the subsequent columns contain the ambiguity variables.
@@ -83,6 +89,10 @@
 
 GpsEquations::GpsEquations()
 {
+	for (int s=0; s<MaxSats; s++)
+		SatelliteToColumn[s] = Arc[s] = -1;
+	Store = NULL;
+	NrPending = 0;
 	Reset();
 }
 
@@ -97,6 +107,13 @@ bool GpsEquations::SolvePosition(Position& offset, double& cep, double& fit)
 	if (Solve() != OK)
 		return Error();
 
+	return GetSolution(offset, cep, fit);
+}
+
+
+bool GpsEquations::GetSolution(Position& offset, double& cep, double& fit)
+// The position offset, cep and fit of the equations as last solved
+{
 	fit = GetFit();
 	
 	// Estimate the cep  (needs to be worked on. this is a hack)
@@ -118,10 +135,7 @@ bool GpsEquations::AppendCode(Triple& e, double b, double weight)
 {
 	debug(2, "GpsEquations::AppendCode e=(%g,%g,%g) b=%g weight=%g\n",e[0],e[1],e[2],b,weight);
 	int row = AddRow();
-	A[row][TcCol] = 1   * weight;
-	A[row][XCol] = e[0] * weight;
-	A[row][YCol] = e[1] * weight;
-	A[row][ZCol] = e[2] * weight;
+	CodeRow(e, weight, A[row]);
 	B[row] = b * weight;
 
 	return OK;
@@ -130,24 +144,42 @@ bool GpsEquations::AppendCode(Triple& e, double b, double weight)
 
 bool GpsEquations::AppendPhase(Triple& e, double p, int sat, double v, double nonv, double weight)
 {
-	int col = SatelliteToColumn[sat];
 	debug(2, "GpsEquations::AppendPhase e=(%g,%g,%g) p=%g weight=%g v=%g nonv=%g sat=%d col=%d\n",
-		e[0],e[1],e[2], p, weight, v, nonv, sat, col);
+		e[0],e[1],e[2], p, weight, v, nonv, sat, SatelliteToColumn[sat]);
 	int row = AddRow();
 	if (row == -1) return Error();
-	A[row][TpCol] = 1   * weight;
-	A[row][XCol] = e[0] * weight;
-	A[row][YCol] = e[1] * weight;
-	A[row][ZCol] = e[2] * weight;
+	PhaseRow(e, sat, v, nonv, weight, A[row]);
 	B[row] = p * weight;
-	for (int c = FirstPhase; c<=LastCol; c++)
-	    if (c == col) A[row][c] = v * weight;
-		else          A[row][c] = nonv * weight;
 
 	return OK;
 }
 
 
+void GpsEquations::CodeRow(Triple& e, double weight, double* row)
+{
+	for (int c=0; c<=LastCol; c++)
+		row[c] = 0;
+	row[TcCol] = 1   * weight;
+	row[XCol] = e[0] * weight;
+	row[YCol] = e[1] * weight;
+	row[ZCol] = e[2] * weight;
+}
+
+
+void GpsEquations::PhaseRow(Triple& e, int sat, double v, double nonv, double weight, double* row)
+{
+	int col = SatelliteToColumn[sat];
+	row[TcCol] = 0;
+	row[TpCol] = 1   * weight;
+	row[XCol] = e[0] * weight;
+	row[YCol] = e[1] * weight;
+	row[ZCol] = e[2] * weight;
+	for (int c = FirstPhase; c<=LastCol; c++)
+	    if (c == col) row[c] = v * weight;
+		else          row[c] = nonv * weight;
+}
+
+
 bool GpsEquations::NewPosition()
 {
 	debug("NewPosition  LastRow=%d  LastCol=%d\n", LastRow, LastCol);
@@ -189,6 +221,9 @@ bool GpsEquations::AddPhase(int sat)
 	debug("AddPhase  sat=%d  col=%d\n", sat, col);
 	if (col == -1) return Error();
 	SatelliteToColumn[sat] = col;
+	Phases.Add(sat);
+	if (Store != NULL)
+		Arc[sat] = Store->NewArc();
 
 	return OK;
 }
@@ -200,13 +235,11 @@ bool GpsEquations::DropPhase(int sat)
 	int col = SatelliteToColumn[sat];
 	if (col == -1) return OK;
 	debug("DropPhase  sat=%d  col=%d\n", sat, col);
+	if (RecordArc(false, Arc[sat], X[col]) != OK) return Error();
 
-	// Eliminate the phase variable from all but the last row and delete the last row
-	if (Eliminate(LastRow, col) != OK) return Error();
-	DeleteRow(LastRow);
-
-	// Delete the phase variable
-	DeletePhase(sat);
+	// Eliminate the phase variable along with the one equation which still contains it
+	if (Eliminate(col) != OK) return Error();
+	MoveSatellite(sat, -1);
 
 	return OK;
 }
@@ -218,11 +251,10 @@ bool GpsEquations::DeletePhase(int sat)
 
 	int col = SatelliteToColumn[sat];
 	if (col == -1) return Error("DeletePhase - sat %d already deleted!\n", sat);
-	int LastSat = LastSatellite();
-	debug("DeletePhase: sat=%d  col=%d LastSat=%d LastCol=%d\n", sat, col, LastSat, LastCol);
-	SatelliteToColumn[LastSat] = col;
-	SatelliteToColumn[sat] = -1;
+	debug("DeletePhase: sat=%d  col=%d LastCol=%d\n", sat, col, LastCol);
+	if (RecordArc(false, Arc[sat], X[col]) != OK) return Error();
 	DeleteCol(col);
+	MoveSatellite(sat, -1);
 
 	return OK;
 }
@@ -237,8 +269,20 @@ bool GpsEquations::ChangeReference(int OldRef, int NewRef)
 	
 	// Reuse the new reference satellite's column to hold the former reference satellite's data
 	debug("ChangeReference OldRef=%d  NewRef=%d  RefCol=%d \n", OldRef, NewRef, RefCol);
+	if (Store != NULL) {
+		if (RecordArc(true, Arc[NewRef], X[RefCol]) != OK) return Error();
+		if (Arc[OldRef] == -1) Arc[OldRef] = Store->NewArc();
+	}
 	SatelliteToColumn[OldRef] = RefCol;
 	SatelliteToColumn[NewRef] = -1;
+	Phases.Add(OldRef);
+	Phases.Remove(NewRef);
+
+	// The last solution becomes relative to the new reference too
+	double v = X[RefCol];
+	for (int c=FirstPhase; c<=LastCol; c++)
+		X[c] -= v;
+	X[RefCol] = -v;
 
 	// We need to redefine the Phase variables. As it turns out, all the old cooeficients
 	//   stay the same, but we have to define a column for the previous reference sat.
@@ -250,17 +294,35 @@ bool GpsEquations::ChangeReference(int OldRef, int NewRef)
 		A[r][RefCol] = -sum;
 		debug(4, "    A[%d][%d]=%.3f\n", r, RefCol, A[r][RefCol]);
 	}
+
+	// The new column is full. Move it to the end, where it fits in the triangular matrix.
+	if (MoveColToEnd(RefCol) != OK) return Error();
+	MoveSatellite(OldRef, LastCol);
+
 	return OK;
 }
 
 
+void GpsEquations::MoveSatellite(int sat, int col)
+// Redo the mapping after a satellite's column has been removed (col = -1) 
+//   or moved to the end, shifting the later columns down by one.
+{
+	int OldCol = SatelliteToColumn[sat];
+	for (int i=0; i<Phases.Count(); i++)
+		if (SatelliteToColumn[Phases[i]] > OldCol)
+			SatelliteToColumn[Phases[i]]--;
+	SatelliteToColumn[sat] = col;
+	if (col == -1) Phases.Remove(sat);
+}
+
+
 
 int GpsEquations::LastSatellite()
 // Note: we could keep track of ColumnToSatellite instead of scanning.
 {
-	for (int s=0; s<MaxSats; s++)
-		if (SatelliteToColumn[s] == LastCol)
-			return s;
+	for (int i=0; i<Phases.Count(); i++)
+		if (SatelliteToColumn[Phases[i]] == LastCol)
+			return Phases[i];
 	return -1;
 }
 
@@ -289,6 +351,62 @@ double GpsEquations::GetTp()
 }
 
 
+bool GpsEquations::AmbiguityCovariance(int n, int* sats, double* a, double Q[][MaxChannels])
+// Get the float ambiguities of the given satellites and their covariance (unscaled).
+//   With w = R'\e for each ambiguity's column, the covariance is w.w'
+{
+	double w[MaxChannels][MaxCols];
+	double e[MaxCols];
+	for (int c=0; c<=LastCol; c++)
+		e[c] = 0;
+
+	for (int i=0; i<n; i++) {
+		int col = SatelliteToColumn[sats[i]];
+		if (col == -1) return Error("AmbiguityCovariance - sat %d has no ambiguity\n", sats[i]);
+		a[i] = X[col];
+		e[col] = 1;
+		if (TransposeSolve(e, w[i]) != OK) return Error();
+		e[col] = 0;
+	}
+
+	for (int i=0; i<n; i++)
+		for (int j=0; j<=i; j++) {
+			double sum = 0;
+			for (int c=0; c<=LastCol; c++)
+				sum += w[i][c] * w[j][c];
+			Q[i][j] = Q[j][i] = sum;
+		}
+
+	return OK;
+}
+
+
+bool GpsEquations::FixAmbiguities(int n, int* sats, double* values, double weight)
+// Constrain the ambiguities to integer values and solve again.
+//   The constraints count toward this epoch's fit, and nothing else.
+//   They can't be taken out again, so they belong on a scratch copy of the equations.
+{
+	double r2 = R2;  int count = Count;
+	double totalr2 = TotalR2;  int totalcount = TotalCount;
+
+	for (int i=0; i<n; i++) {
+		int col = SatelliteToColumn[sats[i]];
+		if (col == -1) return Error("FixAmbiguities - sat %d has no ambiguity\n", sats[i]);
+		debug("GpsEquations::FixAmbiguities  sat=%d  float=%.3f  fixed=%.0f\n", 
+			sats[i], X[col], values[i]);
+		int row = AddRow();
+		A[row][col] = weight;
+		B[row] = values[i] * weight;
+	}
+
+	if (Solve() != OK) return Error();
+	R2 += r2;  Count += count;
+	TotalR2 = totalr2;  TotalCount = totalcount;
+
+	return OK;
+}
+
+
 bool GpsEquations::PhaseDefined(int sat)
 {
 	return SatelliteToColumn[sat] != -1;
@@ -298,28 +416,133 @@ bool GpsEquations::PhaseDefined(int sat)
 void GpsEquations::Reset()
 {
 	debug("GpsEquations::Reset\n");
+	EndRecording();
 	LinearEquations::Reset();
 	LastCol = FirstPhase-1;
-	for (int s=0; s<MaxSats; s++)
-		SatelliteToColumn[s] = -1;
+	for (int i=0; i<Phases.Count(); i++)
+		SatelliteToColumn[Phases[i]] = -1;
+	Phases.Clear();
+}
 
+
+
+
+
+bool GpsEquations::Checkpoint()
+{
+	SavedPhases = Phases;
+	for (int i=0; i<Phases.Count(); i++) {
+		SavedColumn[Phases[i]] = SatelliteToColumn[Phases[i]];
+		SavedArc[Phases[i]] = Arc[Phases[i]];
+	}
+	NrPending = 0;
+	return LinearEquations::Checkpoint();
+}
+
+
+bool GpsEquations::Rollback()
+{
+	if (LinearEquations::Rollback() != OK) return Error();
+	for (int i=0; i<Phases.Count(); i++)
+		SatelliteToColumn[Phases[i]] = -1;
+	Phases = SavedPhases;
+	for (int i=0; i<Phases.Count(); i++) {
+		SatelliteToColumn[Phases[i]] = SavedColumn[Phases[i]];
+		Arc[Phases[i]] = SavedArc[Phases[i]];
+	}
+	NrPending = 0;
+	return OK;
 }
 
 
+bool GpsEquations::Commit()
+// Keep the trial, and pass its arc records on to the store
+{
+	LinearEquations::Commit();
+	for (int i=0; i<NrPending; i++)
+		if (RecordArc(Pending[i].Reference, Pending[i].Arc, Pending[i].Value) != OK)
+			return Error();
+	NrPending = 0;
+	return OK;
+}
 
 
+bool GpsEquations::RecordArc(bool reference, int arc, double value)
+// Record an arc's ambiguity, holding it back while there is a checkpoint
+{
+	if (Store == NULL) return OK;
+	if (!Saved)
+		return reference? Store->Reference(arc, value): Store->Drop(arc, value);
+
+	if (NrPending >= MaxPending) 
+		return Error("GpsEquations - too many arc records since the checkpoint\n");
+	Pending[NrPending].Reference = reference;
+	Pending[NrPending].Arc = arc;
+	Pending[NrPending].Value = value;
+	NrPending++;
+	return OK;
+}
+
+
+bool GpsEquations::Record(Smoother* store)
+// Start recording for smoothing. Satellites already present start new arcs.
+{
+	Store = store;
+	for (int i=0; i<Phases.Count(); i++)
+		Arc[Phases[i]] = Store->NewArc();
+	return OK;
+}
+
+
+bool GpsEquations::SaveEpoch(Time t, Position& base, Position& pos, double cep, double fit)
+// Save the rows of R for X, Y and Z, which give the position once the ambiguities are known
+{
+	if (Store == NULL) return OK;
+	if (cep == -1 || LastRow != LastCol)
+		return Store->Epoch(t, base, pos, cep, fit, -1, NULL, NULL, NULL);
+
+	int n = LastCol - FirstPhase + 1;
+	int arcs[MaxChannels];
+	for (int i=0; i<Phases.Count(); i++)
+		arcs[SatelliteToColumn[Phases[i]] - FirstPhase] = Arc[Phases[i]];
+
+	double r[6+3*MaxChannels], b[3];
+	double* p = r;
+	for (int row=XCol; row<=ZCol; row++) {
+		for (int c=row; c<=LastCol; c++)
+			*p++ = A[row][c];
+		b[row-XCol] = B[row];
+	}
+
+	return Store->Epoch(t, base, pos, cep, fit, n, arcs, r, b);
+}
+
+
+bool GpsEquations::EndRecording()
+// The satellites' arcs end with their last solved ambiguities
+{
+	if (Store == NULL) return OK;
+	for (int i=0; i<Phases.Count(); i++)
+		if (RecordArc(false, Arc[Phases[i]], X[SatelliteToColumn[Phases[i]]]) != OK) 
+			return Error();
+	return OK;
+}
+
 
 GpsEquations& GpsEquations::operator=(GpsEquations& src)
 {
 	*(LinearEquations*)this = src;
 	for (int s=0; s<MaxSats; s++)
 		SatelliteToColumn[s] = src.SatelliteToColumn[s];
+	Phases = src.Phases;
 
 	return *this;
 }
 
 GpsEquations::GpsEquations(GpsEquations& src)
 {
+	Store = NULL;
+	NrPending = 0;
 	*this = src;
 }
 
@@ -21,14 +21,30 @@
 
 #include "LinearEquation.h"
 #include "Observations.h"
+#include "Smoother.h"
 
 
-class GpsEquations: public LinearEquations
+class GpsEquations: public LinearEquations<MaxRows, MaxCols>
 {
 protected:
 
 	// How the columns are assigned
 	int SatelliteToColumn[MaxSats];
+	SatSet Phases;           // satellites which have a column
+	int SavedColumn[MaxSats];
+	SatSet SavedPhases;
+
+	// Where to record the equations for smoothing, if anywhere
+	Smoother* Store;
+	int Arc[MaxSats];        // each satellite's current arc in the store
+	int SavedArc[MaxSats];
+
+	// Arc records made after a checkpoint wait here until Commit(),
+	//   so the store only hears from the solution which was kept
+	static const int MaxPending = 3*MaxChannels;
+	struct ArcRecord {bool Reference; int Arc; double Value;};
+	ArcRecord Pending[MaxPending];
+	int NrPending;
 
 public:
 	static const int TcCol=0, TpCol=1, XCol=2, YCol=3, ZCol=4, FirstPhase=5;
@@ -38,7 +54,12 @@ public:
 		double weight);
 	int LastSatellite();
 
+	// Build an equation without appending it
+	void CodeRow(Triple& e, double weight, double* row);
+	void PhaseRow(Triple& e, int sat, double SatVal, double NonsatVal, double weight, double* row);
+
 	bool SolvePosition(Position& pos, double& cep, double& fit);
+	bool GetSolution(Position& pos, double& cep, double& fit);
 	bool NewPosition();
 	bool NewEpoch();
 	void Reset();
@@ -48,6 +69,7 @@ public:
 	bool AddPhase(int sat);
 	bool DeletePhase(int sat);
 	bool PhaseDefined(int sat);
+	SatSet& PhaseSatellites() {return Phases;}
 
 	// Get solution values
 	Position GetOffset();           // The position offset
@@ -56,8 +78,26 @@ public:
 	double GetTp();
 	double GetAmbiguity(int sat);
 
+	// Integer ambiguities
+	bool AmbiguityCovariance(int n, int* sats, double* a, double Q[][MaxChannels]);
+	bool FixAmbiguities(int n, int* sats, double* values, double weight);
+
+	// Record the position equations and ambiguities for smoothing
+	bool Record(Smoother* store);
+	bool SaveEpoch(Time t, Position& base, Position& pos, double cep, double fit);
+	bool EndRecording();
+
+	// Save and restore the equations along with the column assignments
+	bool Checkpoint();
+	bool Rollback();
+	bool Commit();
+
 	GpsEquations(GpsEquations& src);
 	GpsEquations& operator=(GpsEquations& src);
+
+private:
+	void MoveSatellite(int sat, int col);
+	bool RecordArc(bool reference, int arc, double value);
 };
 
 #endif
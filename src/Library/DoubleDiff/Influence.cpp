@@ -0,0 +1,203 @@
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+//
+////////////////////////////////////////////////////////////////////////////
+//
+// When an epoch fails the policy checks, we try leaving out each satellite
+//   (and then each pair of satellites) to find the one which spoiled the
+//   solution. Solving the equations once per candidate is expensive, and
+//   unnecessary. Everything needed to evaluate a candidate is already in the
+//   factorization of the failed solution: the residuals and the hat matrix.
+//
+// An equation which is the only one to define a variable (eg. the phase of a
+//   satellite which was just gained) has leverage 1 and a zero residual.
+//   Leaving it out removes the variable along with the equation, so it changes
+//   nothing. Such equations are skipped rather than made part of the group.
+//
+// The prediction is not exact when leaving out the satellites causes the
+//   equations to be reset or padded with dummy equations. Predict() returns
+//   an error in those cases, and the caller must solve the equations instead.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "Influence.h"
+
+// Leverage this close to one means the equation defines its own variable
+static const double Tiny = 1e-9;
+
+
+Influence::Influence()
+{
+	Reset();
+}
+
+
+void Influence::Reset()
+{
+	LastRow = -1;
+	Cols = 0;
+	Solved = false;
+	R2 = TotalR2 = 0;
+	Count = TotalCount = 0;
+	Fit = 1;
+}
+
+
+bool Influence::Begin(LinearEquations<MaxRows,MaxCols>& eqn)
+{
+	// Start with the overall fit of the solved equations
+	Reset();
+	Solved = eqn.LastRow >= 0 && eqn.LastRow == eqn.LastCol;
+	Cols = eqn.LastCol + 1;
+	R2 = eqn.R2;  Count = eqn.Count;
+	TotalR2 = eqn.TotalR2;  TotalCount = eqn.TotalCount;
+	debug(2, "Influence::Begin  Solved=%d  Cols=%d  R2=%g  Count=%d\n", Solved, Cols, R2, Count);
+
+	return OK;
+}
+
+
+bool Influence::AddRow(LinearEquations<MaxRows,MaxCols>& eqn, int sat, bool phase, double weight,
+					   double resid, const double* row)
+{
+	if (!Solved) return OK;
+	LastRow++;
+	assert(LastRow < MaxRows);
+
+	RowSat[LastRow] = sat;
+	RowPhase[LastRow] = phase;
+	Weight[LastRow] = weight;
+	Resid[LastRow] = resid;
+
+	// Project the equation onto the factored solution
+	if (eqn.TransposeSolve(row, W[LastRow]) != OK) {
+		Solved = false;
+		return Error();
+	}
+
+	// Fill in the new row and column of the hat matrix
+	for (int j=0; j<=LastRow; j++) {
+		double sum = 0;
+		for (int c=0; c<Cols; c++)
+			sum += W[LastRow][c] * W[j][c];
+		H[LastRow][j] = H[j][LastRow] = sum;
+	}
+
+	debug(3, "Influence::AddRow sat=%d phase=%d resid=%.3f leverage=%.3f\n",
+		sat, phase, resid/weight, H[LastRow][LastRow]);
+	return OK;
+}
+
+
+bool Influence::Predict(int sat1, int sat2)
+{
+	if (!Solved) return Error("Influence::Predict - no solution to start from\n");
+
+	// Count the satellites which are now being used, and which would remain
+	bool Code[MaxSats], Phase[MaxSats], CodeLeft[MaxSats], PhaseLeft[MaxSats];
+	for (int s=0; s<MaxSats; s++)
+		Code[s] = Phase[s] = CodeLeft[s] = PhaseLeft[s] = false;
+	for (int r=0; r<=LastRow; r++) {
+		int s = RowSat[r];
+		if (RowPhase[r]) Phase[s] = true; else Code[s] = true;
+		if (Dropped(r, sat1, sat2)) continue;
+		if (RowPhase[r]) PhaseLeft[s] = true; else CodeLeft[s] = true;
+	}
+	int MCode=0, MPhase=0, MCodeLeft=0, MPhaseLeft=0;
+	for (int s=0; s<MaxSats; s++) {
+		MCode += Code[s];  MCodeLeft += CodeLeft[s];
+		MPhase += Phase[s];  MPhaseLeft += PhaseLeft[s];
+	}
+
+	// Too few satellites means a reset or dummy equations. Must be solved for real.
+	if (MCodeLeft < 4 && MPhaseLeft < 4) return Error();
+	if ((MCodeLeft == 0 && MCode > 0) || (MPhaseLeft == 0 && MPhase > 0)) return Error();
+
+	// Gather the equations being left out, skipping those which define their own variable
+	int G[4]; int NrG = 0;
+	for (int r=0; r<=LastRow; r++)
+		if (Dropped(r, sat1, sat2) && 1 - H[r][r] > Tiny) {
+			assert(NrG < 4);
+			G[NrG++] = r;
+		}
+
+	// Solve (I - H[G,G]) v = r[G] using elimination with partial pivoting
+	double M[4][4], v[4];
+	for (int i=0; i<NrG; i++) {
+		for (int j=0; j<NrG; j++)
+			M[i][j] = (i==j) - H[G[i]][G[j]];
+		v[i] = Resid[G[i]];
+	}
+	for (int k=0; k<NrG; k++) {
+		int p = k;
+		for (int i=k+1; i<NrG; i++)
+			if (abs(M[i][k]) > abs(M[p][k])) p = i;
+		if (abs(M[p][k]) < Tiny) return Error();
+		if (p != k) {
+			for (int j=0; j<NrG; j++) Swap(M[k][j], M[p][j]);
+			Swap(v[k], v[p]);
+		}
+		for (int i=k+1; i<NrG; i++) {
+			double f = M[i][k] / M[k][k];
+			for (int j=k; j<NrG; j++) M[i][j] -= f * M[k][j];
+			v[i] -= f * v[k];
+		}
+	}
+	for (int k=NrG-1; k>=0; k--) {
+		for (int j=k+1; j<NrG; j++) v[k] -= M[k][j] * v[j];
+		v[k] /= M[k][k];
+	}
+
+	// Calculate the residuals which remain
+	double NewR2 = R2;
+	for (int i=0; i<NrG; i++)
+		NewR2 -= Resid[G[i]] * v[i];
+	int NewCount = Count - NrG;
+
+	if (NewCount == 0 || TotalCount == 0 || TotalR2 == 0)
+		Fit = 1;
+	else
+		Fit = (NewR2/NewCount) / (TotalR2/TotalCount);
+
+	for (int s=0; s<MaxSats; s++)
+		CodeResidual[s] = PhaseResidual[s] = 0;
+	for (int r=0; r<=LastRow; r++) {
+		if (Dropped(r, sat1, sat2)) continue;
+		double resid = Resid[r];
+		for (int i=0; i<NrG; i++)
+			resid += H[r][G[i]] * v[i];
+		if (RowPhase[r]) PhaseResidual[RowSat[r]] = resid / Weight[r];
+		else             CodeResidual[RowSat[r]] = resid / Weight[r];
+	}
+
+	debug(2, "Influence::Predict sat1=%d sat2=%d  R2=%g-->%g  Count=%d-->%d  Fit=%.3f\n",
+		sat1, sat2, R2, NewR2, Count, NewCount, Fit);
+	return OK;
+}
+
+
+bool Influence::Dropped(int row, int sat1, int sat2)
+{
+	return RowSat[row] == sat1 || RowSat[row] == sat2;
+}
+
+
+Influence::~Influence()
+{
+}
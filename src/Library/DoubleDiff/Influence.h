@@ -0,0 +1,82 @@
+#ifndef INFLUENCE_INCLUDED
+#define INFLUENCE_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "LinearEquation.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// Influence - predicts what a solution would look like with one or two
+//    satellites left out, without solving the equations again.
+//
+// It is built from a single solved epoch. For each equation appended
+//   during that epoch we keep the residual r and w = R'\a, where R is the
+//   upper triangular matrix left by the QR factorization. The hat matrix
+//   is H = W'W. Leaving out a group of equations G then gives
+//      R2'  = R2 - r[G]' (I-H[G,G])^-1 r[G]
+//      r[j]' = r[j] + H[j,G] (I-H[G,G])^-1 r[G]
+//   which is exactly what a fresh solve would produce.
+//
+///////////////////////////////////////////////////////////////////
+
+class Influence
+{
+protected:
+	// One entry for each equation appended in the current epoch
+	int LastRow;
+	int RowSat[MaxRows];
+	bool RowPhase[MaxRows];
+	double Weight[MaxRows];
+	double Resid[MaxRows];            // weighted residual,  a*x - b
+	double W[MaxRows][MaxCols];       // R'\a
+	double H[MaxRows][MaxRows];       // hat matrix for the current equations
+	int Cols;
+
+	// Overall fit of the solved equations
+	double R2, TotalR2;
+	int Count, TotalCount;
+	bool Solved;
+
+	// Predicted results after leaving out satellites
+	double Fit;
+	double CodeResidual[MaxSats];
+	double PhaseResidual[MaxSats];
+
+public:
+	Influence();
+	void Reset();
+	bool Begin(LinearEquations<MaxRows,MaxCols>& eqn);
+	bool AddRow(LinearEquations<MaxRows,MaxCols>& eqn, int sat, bool phase, double weight,
+		        double resid, const double* row);
+	bool Valid() {return Solved;}
+
+	bool Predict(int sat1, int sat2=-1);
+	double GetFit()                  {return Fit;}
+	double GetCodeResidual(int sat)  {return CodeResidual[sat];}
+	double GetPhaseResidual(int sat) {return PhaseResidual[sat];}
+
+	virtual ~Influence();
+
+private:
+	bool Dropped(int row, int sat1, int sat2);
+};
+
+#endif // INFLUENCE_INCLUDED
@@ -0,0 +1,558 @@
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+//
+////////////////////////////////////////////////////////////////////////////
+//
+// An alternative to the least squares Solution. Rather than keeping every
+//   equation since the satellites were acquired, a Kalman filter carries
+//   the estimate and its covariance from one epoch to the next.
+//
+// Each epoch:
+//   o If the rover may have moved, the position is advanced by the velocity
+//     and the covariance grows by the (constant velocity) process noise.
+//   o Lost or slipped satellites lose their ambiguity. If the reference
+//     satellite is lost, the remaining ambiguities are referred to a new one.
+//   o New satellites get an ambiguity from the difference between phase
+//     and code, with a generous uncertainty.
+//   o The double difference code and phase equations are applied as one
+//     update. The differences share the reference satellite's noise,
+//     so the measurement covariance is not diagonal.
+//
+// The update is done with the Cholesky factor L of the innovation
+//   covariance S = HPH' + R. With w = L\v and W = L\(PH')',
+//      X += W'w,   P -= W'W,   and   w'w  is the normalized innovation.
+//
+// The fit is the normalized innovation of this epoch relative to the average
+//   so far, so it means the same as the least squares fit to the consistency checks.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "KalmanSolution.h"
+
+
+
+KalmanSolution::KalmanSolution(Position& basepos, Position& roverpos)
+: Solution(basepos, roverpos)
+{
+	// Default noise model
+	UnitSigma = .01;      // code is weighted .01 (1 m), phase 1 (1 cm)
+	PositionSigma = 100;
+	VelocitySigma = 10;
+	AmbiguitySigma = 10;
+	AccelSigma = 1;
+
+	Reset();
+}
+
+
+
+bool KalmanSolution::NewPosition(Position& pos)
+// The rover may move before the next update
+{
+	debug("KalmanSolution::NewPosition: pos=(%.3f, %.3f, %.3f) Initialized=%d\n",
+		pos.x, pos.y, pos.z, Filter.Initialized);
+	if (!Filter.Initialized)
+		RoverPos = pos;
+	Filter.Moving = true;
+	return OK;
+}
+
+
+
+bool KalmanSolution::Update(Observations& obs, Position& pos, double& cep, double& fit)
+{
+	debug("KalmanSolution::Update BasePos=(%.3f, %.3f, %.3f)  RoverPos=(%.3f, %.3f, %.3f)\n",
+		BasePos.x, BasePos.y, BasePos.z, RoverPos.x, RoverPos.y, RoverPos.z);
+
+	// Advance the filter to the new epoch
+	if (!Filter.Initialized) Initialize();
+	else                     Predict(obs.GpsTime);
+	Filter.Moving = false;
+	Filter.LastTime = obs.GpsTime;
+
+	// Single differences at the predicted position
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		if (!obs[s].ValidCode && !obs[s].ValidPhase) continue;
+		Log(s);
+		SingleDifference(obs[s], e[s], CodeB[s], PhaseB[s]);
+	}
+
+	// Figure which satellites we are now tracking
+	if (UpdateSatellites(obs) != OK) return Error();
+
+	// If not enough satellites, start over
+	int MCode = 0; int MPhase = 0;
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		if (obs[s].ValidCode) MCode++;
+		if (obs[s].ValidPhase) MPhase++;
+	}
+	if (MCode < 4 && MPhase < 4)
+		Reset();
+	else if (MeasurementUpdate(obs) != OK)
+		return Error();
+
+	pos = RoverPos;
+	cep = Filter.Cep;
+	fit = Filter.Fit;
+	return OK;
+}
+
+
+
+void KalmanSolution::Initialize()
+{
+	debug("KalmanSolution::Initialize\n");
+	for (int i=0; i<MaxStates; i++) {
+		Filter.X[i] = 0;
+		for (int j=0; j<MaxStates; j++)
+			Filter.P[i][j] = 0;
+	}
+	for (int i=0; i<3; i++) {
+		Filter.P[PosState+i][PosState+i] = PositionSigma*PositionSigma;
+		Filter.P[VelState+i][VelState+i] = VelocitySigma*VelocitySigma;
+	}
+	Filter.Initialized = true;
+}
+
+
+
+void KalmanSolution::Predict(Time t)
+// Constant velocity model, driven by random acceleration
+{
+	if (!Filter.Moving) return;
+	double dt = S(t - Filter.LastTime);
+	debug("KalmanSolution::Predict dt=%.3f\n", dt);
+	if (dt <= 0) return;
+
+	// X = F X, where F adds velocity*dt to the position
+	RoverPos = RoverPos + Position(Filter.X[VelState], Filter.X[VelState+1],
+		                           Filter.X[VelState+2]) * dt;
+
+	// P = F P F'
+	double (*P)[MaxStates] = Filter.P;
+	for (int i=0; i<3; i++)
+		for (int c=0; c<MaxStates; c++)
+			P[PosState+i][c] += dt * P[VelState+i][c];
+	for (int i=0; i<3; i++)
+		for (int r=0; r<MaxStates; r++)
+			P[r][PosState+i] += dt * P[r][VelState+i];
+
+	// Plus the process noise
+	double q = AccelSigma*AccelSigma;
+	for (int i=0; i<3; i++) {
+		int p = PosState+i;  int v = VelState+i;
+		P[p][p] += q*dt*dt*dt/3;
+		P[p][v] += q*dt*dt/2;
+		P[v][p] += q*dt*dt/2;
+		P[v][v] += q*dt;
+	}
+}
+
+
+
+bool KalmanSolution::UpdateSatellites(Observations& obs)
+{
+	debug("KalmanSolution::UpdateSatellites: ReferenceSat=%d\n", ReferenceSat);
+
+	// Drop lost or slipped satellites
+	for (int k=0; k<MaxChannels; k++) {
+		int s = Filter.AmbiguitySat[k];
+		if (s != -1 && (!obs[s].ValidPhase || obs[s].Slip))
+			DropAmbiguity(k);
+	}
+
+	// Switch reference satellites if it was lost
+	if (ReferenceSat != -1 && (!obs[ReferenceSat].ValidPhase || obs[ReferenceSat].Slip))
+		ChangeReference(obs);
+
+	// If we are starting fresh, need to pick a new reference
+	if (ReferenceSat == -1)
+		ReferenceSat = HighestSatellite(obs, true);
+
+	// Gain the new and slipped satellites
+	if (ReferenceSat != -1)
+		for (int i=0; i<obs.Active.Count(); i++) {
+			int s = obs.Active[i];
+			if (obs[s].ValidPhase && s != ReferenceSat && Slot(s) == -1)
+				AddAmbiguity(obs[s], obs[ReferenceSat]);
+		}
+
+	// The code is differenced separately, since the reference may not have code
+	if (ReferenceSat != -1 && obs[ReferenceSat].ValidCode)
+		Filter.CodeReference = ReferenceSat;
+	else
+		Filter.CodeReference = HighestSatellite(obs, false);
+
+	return OK;
+}
+
+
+
+bool KalmanSolution::MeasurementUpdate(Observations& obs)
+{
+	int Ref = ReferenceSat;  int CodeRef = Filter.CodeReference;
+	double (*P)[MaxStates] = Filter.P;
+	double* X = Filter.X;
+
+	// Build the double difference equations and their innovations
+	double H[MaxMeasurements][MaxStates], v[MaxMeasurements], Var[MaxMeasurements];
+	bool Phase[MaxMeasurements];
+	int m = 0;
+	for (int i=0; i<obs.Active.Count() && CodeRef != -1; i++) {
+		int s = obs.Active[i];
+		if (!obs[s].ValidCode || s == CodeRef) continue;
+		for (int j=0; j<MaxStates; j++)
+			H[m][j] = 0;
+		for (int j=0; j<3; j++)
+			H[m][PosState+j] = e[s][j] - e[CodeRef][j];
+		v[m] = CodeB[s] - CodeB[CodeRef];
+		Var[m] = Sigma(obs[s].CodeWeight) * Sigma(obs[s].CodeWeight);
+		Phase[m] = false;
+		m++;
+	}
+	for (int i=0; i<obs.Active.Count() && Ref != -1; i++) {
+		int s = obs.Active[i];
+		int k = Slot(s);
+		if (!obs[s].ValidPhase || k == -1) continue;
+		for (int j=0; j<MaxStates; j++)
+			H[m][j] = 0;
+		for (int j=0; j<3; j++)
+			H[m][PosState+j] = e[s][j] - e[Ref][j];
+		H[m][FirstAmbiguity+k] = L1WaveLength;
+		v[m] = PhaseB[s] - PhaseB[Ref] - L1WaveLength*X[FirstAmbiguity+k];
+		Var[m] = Sigma(obs[s].PhaseWeight) * Sigma(obs[s].PhaseWeight);
+		Phase[m] = true;
+		m++;
+	}
+	debug("KalmanSolution::MeasurementUpdate  Ref=%d  CodeRef=%d  m=%d\n", Ref, CodeRef, m);
+	if (m == 0) {Filter.Cep = Filter.Fit = -1; return OK;}
+
+	// The reference satellite's noise is common to all of its differences
+	double CodeRefVar = 0, PhaseRefVar = 0;
+	if (CodeRef != -1)
+		CodeRefVar = Sigma(obs[CodeRef].CodeWeight) * Sigma(obs[CodeRef].CodeWeight);
+	if (Ref != -1)
+		PhaseRefVar = Sigma(obs[Ref].PhaseWeight) * Sigma(obs[Ref].PhaseWeight);
+
+	// PH'
+	double PHt[MaxStates][MaxMeasurements];
+	for (int i=0; i<MaxStates; i++)
+		for (int k=0; k<m; k++) {
+			double sum = 0;
+			for (int j=0; j<MaxStates; j++)
+				sum += P[i][j] * H[k][j];
+			PHt[i][k] = sum;
+		}
+
+	// S = HPH' + R,  factored in place into L
+	double L[MaxMeasurements][MaxMeasurements];
+	for (int k=0; k<m; k++)
+		for (int l=0; l<=k; l++) {
+			double sum = 0;
+			for (int j=0; j<MaxStates; j++)
+				sum += H[k][j] * PHt[j][l];
+			if (Phase[k] == Phase[l])
+				sum += Phase[k]? PhaseRefVar: CodeRefVar;
+			if (k == l)
+				sum += Var[k];
+			L[k][l] = sum;
+		}
+	for (int k=0; k<m; k++) {
+		for (int l=0; l<k; l++) {
+			double sum = L[k][l];
+			for (int j=0; j<l; j++)
+				sum -= L[k][j] * L[l][j];
+			L[k][l] = sum / L[l][l];
+		}
+		double sum = L[k][k];
+		for (int j=0; j<k; j++)
+			sum -= L[k][j] * L[k][j];
+		if (sum <= 0)
+			return Error("KalmanSolution::MeasurementUpdate - innovation covariance is singular\n");
+		L[k][k] = sqrt(sum);
+	}
+
+	// w = L\v  and  W = L\(PH')'.  W reuses H, which is no longer needed.
+	double (*W)[MaxStates] = H;
+	double Nis = 0;
+	for (int k=0; k<m; k++) {
+		for (int j=0; j<k; j++)
+			v[k] -= L[k][j] * v[j];
+		v[k] /= L[k][k];
+		Nis += v[k]*v[k];
+		for (int i=0; i<MaxStates; i++) {
+			double sum = PHt[i][k];
+			for (int j=0; j<k; j++)
+				sum -= L[k][j] * W[j][i];
+			W[k][i] = sum / L[k][k];
+		}
+	}
+
+	// X += W'w,  P -= W'W
+	for (int i=0; i<MaxStates; i++) {
+		for (int k=0; k<m; k++)
+			X[i] += W[k][i] * v[k];
+		for (int j=i; j<MaxStates; j++) {
+			double sum = 0;
+			for (int k=0; k<m; k++)
+				sum += W[k][i] * W[k][j];
+			P[i][j] -= sum;
+			P[j][i] = P[i][j];
+		}
+	}
+
+	// Move the position into RoverPos, and recalculate the single differences there
+	RoverPos = RoverPos + Position(X[PosState], X[PosState+1], X[PosState+2]);
+	X[PosState] = X[PosState+1] = X[PosState+2] = 0;
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		if (!obs[s].ValidCode && !obs[s].ValidPhase) continue;
+		SingleDifference(obs[s], e[s], CodeB[s], PhaseB[s]);
+	}
+
+	// Fit compared to the average, and a rough cep
+	Filter.TotalNis += Nis;  Filter.TotalCount += m;
+	if (Filter.TotalNis == 0) Filter.Fit = 1;
+	else                      Filter.Fit = (Nis/m) / (Filter.TotalNis/Filter.TotalCount);
+	Filter.Cep = sqrt(P[PosState][PosState] + P[PosState+1][PosState+1]
+		                                     + P[PosState+2][PosState+2]);
+	debug("KalmanSolution::MeasurementUpdate  Pos=(%.3f, %.3f, %.3f)  Nis=%.3f  fit=%.3f  cep=%.3f\n",
+		RoverPos.x, RoverPos.y, RoverPos.z, Nis, Filter.Fit, Filter.Cep);
+
+	return OK;
+}
+
+
+
+int KalmanSolution::Slot(int sat)
+{
+	for (int k=0; k<MaxChannels; k++)
+		if (Filter.AmbiguitySat[k] == sat)
+			return k;
+	return -1;
+}
+
+
+void KalmanSolution::AddAmbiguity(const Observation& o, const Observation& ref)
+// Start a satellite's ambiguity from the difference between phase and code.
+//   Without code, start from the current position.
+{
+	int k = Slot(-1);
+	if (k == -1) {debug("KalmanSolution::AddAmbiguity - no slot for %d\n", o.Sat); return;}
+	int s = o.Sat;  int r = ref.Sat;
+
+	double N = PhaseB[s] - PhaseB[r];
+	if (o.ValidCode && ref.ValidCode)
+		N -= CodeB[s] - CodeB[r];
+	N /= L1WaveLength;
+
+	int i = FirstAmbiguity + k;
+	Filter.X[i] = N;
+	Filter.P[i][i] = (AmbiguitySigma/L1WaveLength) * (AmbiguitySigma/L1WaveLength);
+	Filter.AmbiguitySat[k] = s;
+	debug("KalmanSolution::AddAmbiguity  sat=%d  slot=%d  N=%.3f\n", s, k, N);
+}
+
+
+void KalmanSolution::DropAmbiguity(int k)
+// Forget the ambiguity. The other states keep their (marginal) covariance.
+{
+	debug("KalmanSolution::DropAmbiguity  sat=%d  slot=%d\n", Filter.AmbiguitySat[k], k);
+	int i = FirstAmbiguity + k;
+	Filter.X[i] = 0;
+	for (int j=0; j<MaxStates; j++)
+		Filter.P[i][j] = Filter.P[j][i] = 0;
+	Filter.AmbiguitySat[k] = -1;
+}
+
+
+void KalmanSolution::ChangeReference(Observations& obs)
+// Refer the ambiguities to the highest satellite which has one.
+//    N(s,new) = N(s,old) - N(new,old)
+{
+	int OldRef = ReferenceSat;
+	int Best = -1;  double BestValue = -2;
+	for (int k=0; k<MaxChannels; k++) {
+		int s = Filter.AmbiguitySat[k];
+		if (s == -1) continue;
+		Position& pos = obs.BasePos;
+		Position satpos = obs[s].SatPos - pos;
+		double SinElev = (pos * satpos) / ( Range(pos) * Range(satpos));
+		if (SinElev > BestValue)
+			{Best = k; BestValue = SinElev;}
+	}
+	debug("KalmanSolution::ChangeReference  OldRef=%d  NewSlot=%d\n", OldRef, Best);
+
+	// If nothing to switch to, start the ambiguities over
+	if (Best == -1) {
+		ReferenceSat = -1;
+		return;
+	}
+
+	// X = T X,  P = T P T'
+	double (*P)[MaxStates] = Filter.P;
+	int b = FirstAmbiguity + Best;
+	for (int k=0; k<MaxChannels; k++) {
+		if (k == Best || Filter.AmbiguitySat[k] == -1) continue;
+		int i = FirstAmbiguity + k;
+		Filter.X[i] -= Filter.X[b];
+		for (int c=0; c<MaxStates; c++)
+			P[i][c] -= P[b][c];
+	}
+	for (int k=0; k<MaxChannels; k++) {
+		if (k == Best || Filter.AmbiguitySat[k] == -1) continue;
+		int i = FirstAmbiguity + k;
+		for (int r=0; r<MaxStates; r++)
+			P[r][i] -= P[r][b];
+	}
+
+	// The new reference no longer has an ambiguity
+	ReferenceSat = Filter.AmbiguitySat[Best];
+	DropAmbiguity(Best);
+}
+
+
+int KalmanSolution::HighestSatellite(Observations& obs, bool phase)
+// The satellite with the highest elevation having valid phase (or code)
+{
+	int Best = -1;  double BestValue = -2;
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		if (phase && !obs[s].ValidPhase) continue;
+		if (!phase && !obs[s].ValidCode) continue;
+		Position& pos = obs.BasePos;
+		Position satpos = obs[s].SatPos - pos;
+		double SinElev = (pos * satpos) / ( Range(pos) * Range(satpos));
+		if (SinElev > BestValue)
+			{Best = s; BestValue = SinElev;}
+	}
+	return Best;
+}
+
+
+
+Position KalmanSolution::GetPosition()
+{
+	return RoverPos;
+}
+
+double KalmanSolution::GetCep()
+{
+	return Filter.Cep;
+}
+
+double KalmanSolution::GetFit()
+{
+	return Filter.Fit;
+}
+
+double KalmanSolution::GetCodeResidual(int sat)
+// Double difference residuals. The reference satellite has none.
+{
+	int Ref = Filter.CodeReference;
+	if (Ref == -1 || sat == Ref) return 0;
+	return -(CodeB[sat] - CodeB[Ref]);
+}
+
+double KalmanSolution::GetPhaseResidual(int sat)
+{
+	int Ref = ReferenceSat;
+	if (Ref == -1 || sat == Ref) return 0;
+	int k = Slot(sat);
+	double N = (k == -1)? 0: Filter.X[FirstAmbiguity+k];
+	return N*L1WaveLength - (PhaseB[sat] - PhaseB[Ref]);
+}
+
+bool KalmanSolution::GetInfluence(Observations& obs, Influence& inf)
+// Influence works from the least squares factorization, which we don't have.
+//   Leaving it invalid makes the caller solve each trial instead.
+{
+	inf.Reset();
+	return OK;
+}
+
+
+
+bool KalmanSolution::Checkpoint()
+{
+	SavedFilter = Filter;
+	SavedRoverPos = RoverPos;
+	SavedReferenceSat = ReferenceSat;
+	ClearLog();
+	Saved = true;
+	return OK;
+}
+
+
+bool KalmanSolution::Rollback()
+{
+	if (!Saved) return Error("KalmanSolution::Rollback - no checkpoint\n");
+	Filter = SavedFilter;
+	RoverPos = SavedRoverPos;
+	ReferenceSat = SavedReferenceSat;
+	UndoLog();
+	return OK;
+}
+
+
+bool KalmanSolution::Commit()
+{
+	ClearLog();
+	Saved = false;
+	return OK;
+}
+
+
+Solution* KalmanSolution::Clone()
+{
+	return new KalmanSolution(*this);
+}
+
+
+bool KalmanSolution::CopyFrom(Solution& src)
+{
+	KalmanSolution* k = dynamic_cast<KalmanSolution*>(&src);
+	if (k == NULL) return false;
+	*this = *k;
+	return true;
+}
+
+
+
+bool KalmanSolution::Reset()
+{
+	debug("KalmanSolution::Reset\n");
+	ReferenceSat = -1;
+	Filter.Initialized = false;
+	Filter.Moving = false;
+	Filter.LastTime = 0;
+	for (int k=0; k<MaxChannels; k++)
+		Filter.AmbiguitySat[k] = -1;
+	Filter.CodeReference = -1;
+	Filter.TotalNis = 0;  Filter.TotalCount = 0;
+	Filter.Fit = Filter.Cep = -1;
+	return OK;
+}
+
+
+KalmanSolution::~KalmanSolution()
+{
+}
@@ -0,0 +1,108 @@
+#ifndef KALMANSOLUTION_INCLUDED
+#define KALMANSOLUTION_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Solution.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// KalmanSolution - a float solution from an extended Kalman filter.
+//
+//   The states are the rover's position and velocity, followed by
+//   a double difference ambiguity (cycles) for each satellite other than
+//   the reference. The clocks are removed by double differencing, so the
+//   code and phase equations of one epoch share the reference satellite's
+//   noise and are applied together as a single update.
+//
+//   The position is kept as an offset from RoverPos, and is folded back into
+//   RoverPos after every update. The covariance is a fixed size, with the
+//   rows and columns of unused ambiguity slots left at zero.
+//
+//   It can be used wherever a Solution is, including trial solutions
+//   and the consistency checks.
+//
+///////////////////////////////////////////////////////////////////
+
+class KalmanSolution: public Solution
+{
+public:
+	static const int PosState=0, VelState=3, FirstAmbiguity=6;
+	static const int MaxStates = FirstAmbiguity + MaxChannels;
+	static const int MaxMeasurements = 2*MaxChannels;
+
+	// Noise model
+	double UnitSigma;        // measurement error (m) of an observation with weight 1
+	double PositionSigma;    // initial position uncertainty (m)
+	double VelocitySigma;    // initial velocity uncertainty (m/s)
+	double AmbiguitySigma;   // initial ambiguity uncertainty (m)
+	double AccelSigma;       // rover acceleration (m/s^2 per sqrt(s))
+
+protected:
+	// Everything needed to restore the filter after a trial
+	struct State {
+		bool Initialized;
+		bool Moving;              // rover may have moved since the last update
+		Time LastTime;
+		double X[MaxStates];
+		double P[MaxStates][MaxStates];
+		int AmbiguitySat[MaxChannels];   // satellite in each ambiguity slot, or -1
+		int CodeReference;
+		double TotalNis;  int TotalCount;
+		double Fit, Cep;
+	};
+	State Filter, SavedFilter;
+
+public:
+	KalmanSolution(Position& basepos, Position& roverpos);
+	virtual bool NewPosition(Position& pos);
+	virtual bool Update(Observations& obs, Position& pos, double& cep, double& fit);
+	virtual bool Reset();
+
+	virtual Position GetPosition();
+	virtual double GetCep();
+	virtual double GetFit();
+	virtual double GetCodeResidual(int sat);
+	virtual double GetPhaseResidual(int sat);
+	virtual bool GetInfluence(Observations& obs, Influence& inf);
+
+	virtual bool Checkpoint();
+	virtual bool Rollback();
+	virtual bool Commit();
+	virtual Solution* Clone();
+	virtual bool CopyFrom(Solution& src);
+
+	virtual ~KalmanSolution();
+
+private:
+	void Initialize();
+	void Predict(Time t);
+	bool UpdateSatellites(Observations& obs);
+	bool MeasurementUpdate(Observations& obs);
+
+	int Slot(int sat);
+	void AddAmbiguity(const Observation& o, const Observation& ref);
+	void DropAmbiguity(int slot);
+	void ChangeReference(Observations& obs);
+	int HighestSatellite(Observations& obs, bool phase);
+	double Sigma(double weight) {return UnitSigma / weight;}
+};
+
+#endif // KALMANSOLUTION_INCLUDED
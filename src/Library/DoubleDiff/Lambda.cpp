@@ -0,0 +1,245 @@
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+//
+////////////////////////////////////////////////////////////////////////////
+//
+// The LAMBDA method (Teunissen), following the "modified" LAMBDA of
+//   Chang, Yang and Zhou (2005).
+//
+//   o Factor Q = L'DL.
+//   o Reduce: integer Gauss transformations make L as small as possible, and
+//     swapping neighbouring ambiguities puts the large conditional variances
+//     first. Together they give Z, with z = Z'a.
+//   o Search the transformed ambiguities depth first, starting with the last,
+//     shrinking the search ellipsoid each time a better pair is found.
+//   o Transform the integers back with a = Z'^-1 z.
+//
+// Z is built from integer operations, so its inverse is kept alongside it
+//   rather than solving for it afterwards.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "Lambda.h"
+
+// Give up on a search which has taken this many steps
+static const int MaxLoops = 10000;
+
+static inline double Sign(double x) {return x <= 0? -1: 1;}
+
+
+Lambda::Lambda()
+{
+	N = 0;
+}
+
+
+bool Lambda::Resolve(int n, const double* a, double Q[][MaxAmbiguities],
+					 double* fixed, double& ratio)
+// Find the best integer ambiguities, and the ratio of the second best
+//   distance to the best.
+{
+	if (n <= 0 || n > MaxAmbiguities) return Error("Lambda::Resolve - bad size %d\n", n);
+	N = n;
+
+	// Decorrelate
+	if (Factor(Q) != OK) return Error();
+	Reduce();
+
+	// Search in the transformed space, z = Z'a
+	double zs[MaxAmbiguities];
+	for (int i=0; i<N; i++) {
+		double sum = 0;
+		for (int k=0; k<N; k++)
+			sum += Z[k][i] * a[k];
+		zs[i] = sum;
+	}
+	double zn[2][MaxAmbiguities], s[2];
+	if (Search(zs, zn, s) != OK) return Error();
+
+	// Back to the original ambiguities,  a = Z'^-1 z
+	for (int i=0; i<N; i++) {
+		double sum = 0;
+		for (int k=0; k<N; k++)
+			sum += Zi[k][i] * zn[0][k];
+		fixed[i] = sum;
+	}
+
+	ratio = (s[0] > 0)? s[1]/s[0]: 999999;
+	debug("Lambda::Resolve  n=%d  s=(%.3g, %.3g)  ratio=%.2f\n", N, s[0], s[1], ratio);
+	return OK;
+}
+
+
+bool Lambda::Factor(double Q[][MaxAmbiguities])
+// Q = L'DL, working up from the last row
+{
+	double A[MaxAmbiguities][MaxAmbiguities];
+	for (int i=0; i<N; i++)
+		for (int j=0; j<N; j++) {
+			A[i][j] = Q[i][j];
+			L[i][j] = 0;
+		}
+
+	for (int i=N-1; i>=0; i--) {
+		D[i] = A[i][i];
+		if (D[i] <= 0) return Error("Lambda::Factor - covariance not positive definite\n");
+		double a = sqrt(D[i]);
+		for (int j=0; j<=i; j++)
+			L[i][j] = A[i][j] / a;
+		for (int j=0; j<i; j++)
+			for (int k=0; k<=j; k++)
+				A[j][k] -= L[i][k] * L[i][j];
+		for (int j=0; j<=i; j++)
+			L[i][j] /= L[i][i];
+	}
+	return OK;
+}
+
+
+void Lambda::Reduce()
+// Decorrelate, building up Z and its inverse
+{
+	for (int i=0; i<N; i++)
+		for (int j=0; j<N; j++)
+			Z[i][j] = Zi[i][j] = (i == j);
+
+	int j = N-2;  int k = N-2;
+	while (j >= 0) {
+		if (j <= k)
+			for (int i=j+1; i<N; i++)
+				Gauss(i, j);
+		double del = D[j] + L[j+1][j]*L[j+1][j]*D[j+1];
+		if (del + 1e-6 < D[j+1]) {
+			Permute(j, del);
+			k = j;  j = N-2;
+		}
+		else
+			j--;
+	}
+}
+
+
+void Lambda::Gauss(int i, int j)
+// Integer Gauss transformation, reducing L[i][j]
+{
+	double mu = round(L[i][j]);
+	if (mu == 0) return;
+	for (int k=i; k<N; k++)
+		L[k][j] -= mu * L[k][i];
+	for (int k=0; k<N; k++) {
+		Z[k][j] -= mu * Z[k][i];
+		Zi[i][k] += mu * Zi[j][k];
+	}
+}
+
+
+void Lambda::Permute(int j, double del)
+// Swap ambiguities j and j+1
+{
+	double eta = D[j] / del;
+	double lam = D[j+1] * L[j+1][j] / del;
+	D[j] = eta * D[j+1];
+	D[j+1] = del;
+	for (int k=0; k<j; k++) {
+		double a0 = L[j][k];  double a1 = L[j+1][k];
+		L[j][k] = -L[j+1][j]*a0 + a1;
+		L[j+1][k] = eta*a0 + lam*a1;
+	}
+	L[j+1][j] = lam;
+	for (int k=j+2; k<N; k++)
+		Swap(L[k][j], L[k][j+1]);
+	for (int k=0; k<N; k++) {
+		Swap(Z[k][j], Z[k][j+1]);
+		Swap(Zi[j][k], Zi[j+1][k]);
+	}
+}
+
+
+bool Lambda::Search(const double* zs, double zn[2][MaxAmbiguities], double* s)
+// Depth first search for the two closest integer vectors.
+//    s holds their squared distances, best first.
+{
+	double S[MaxAmbiguities][MaxAmbiguities];
+	double dist[MaxAmbiguities], zb[MaxAmbiguities], z[MaxAmbiguities], step[MaxAmbiguities];
+	for (int i=0; i<N; i++)
+		for (int j=0; j<N; j++)
+			S[i][j] = 0;
+
+	int found = 0;  int imax = 0;  double maxdist = 1e99;
+	int k = N-1;
+	dist[k] = 0;
+	zb[k] = zs[k];
+	z[k] = round(zb[k]);  double y = zb[k] - z[k];  step[k] = Sign(y);
+
+	int loop;
+	for (loop=0; loop<MaxLoops; loop++) {
+		double newdist = dist[k] + y*y/D[k];
+		if (newdist < maxdist) {
+
+			// Move down a level
+			if (k != 0) {
+				dist[--k] = newdist;
+				for (int i=0; i<=k; i++)
+					S[k][i] = S[k+1][i] + (z[k+1] - zb[k+1]) * L[k+1][i];
+				zb[k] = zs[k] + S[k][k];
+				z[k] = round(zb[k]);  y = zb[k] - z[k];  step[k] = Sign(y);
+			}
+
+			// At the bottom, we have a candidate. Keep it if one of the best two.
+			else {
+				if (found < 2) {
+					if (found == 0 || newdist > s[imax]) imax = found;
+					for (int i=0; i<N; i++) zn[found][i] = z[i];
+					s[found++] = newdist;
+					if (found == 2) maxdist = s[imax];
+				}
+				else if (newdist < s[imax]) {
+					for (int i=0; i<N; i++) zn[imax][i] = z[i];
+					s[imax] = newdist;
+					imax = (s[0] < s[1])? 1: 0;
+					maxdist = s[imax];
+				}
+				z[0] += step[0];  y = zb[0] - z[0];  step[0] = -step[0] - Sign(step[0]);
+			}
+		}
+
+		// Outside the ellipsoid. Move up a level, or done.
+		else {
+			if (k == N-1) break;
+			k++;
+			z[k] += step[k];  y = zb[k] - z[k];  step[k] = -step[k] - Sign(step[k]);
+		}
+	}
+
+	if (loop >= MaxLoops) return Error("Lambda::Search - search took too long\n");
+	if (found < 2) return Error("Lambda::Search - found only %d candidates\n", found);
+
+	// Best first
+	if (s[1] < s[0]) {
+		Swap(s[0], s[1]);
+		for (int i=0; i<N; i++)
+			Swap(zn[0][i], zn[1][i]);
+	}
+	return OK;
+}
+
+
+Lambda::~Lambda()
+{
+}
@@ -0,0 +1,67 @@
+#ifndef LAMBDA_INCLUDED
+#define LAMBDA_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Util.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// Lambda - finds the integer ambiguities closest to a float solution.
+//
+//   "Closest" is measured by the float solution's covariance Q, so the
+//   answer is the integer vector z minimizing  (a-z)' Q^-1 (a-z).
+//   Float ambiguities are highly correlated, which makes a direct search
+//   hopeless. The LAMBDA method first applies an integer transformation
+//   (decorrelation) which keeps the integers integer but makes Q nearly
+//   diagonal, then searches the transformed space.
+//
+//   The best two candidates are found. The ratio of their distances tells
+//   how much better the best one is than its nearest competitor.
+//
+///////////////////////////////////////////////////////////////////
+
+class Lambda
+{
+public:
+	static const int MaxAmbiguities = MaxChannels;
+
+protected:
+	int N;
+	double L[MaxAmbiguities][MaxAmbiguities];   // Q = L'DL,  L unit lower triangular
+	double D[MaxAmbiguities];
+	double Z[MaxAmbiguities][MaxAmbiguities];   // the integer transformation
+	double Zi[MaxAmbiguities][MaxAmbiguities];  // and its inverse
+
+public:
+	Lambda();
+	bool Resolve(int n, const double* a, double Q[][MaxAmbiguities],
+		         double* fixed, double& ratio);
+	virtual ~Lambda();
+
+private:
+	bool Factor(double Q[][MaxAmbiguities]);
+	void Reduce();
+	void Gauss(int i, int j);
+	void Permute(int j, double del);
+	bool Search(const double* zs, double zn[2][MaxAmbiguities], double* s);
+};
+
+#endif // LAMBDA_INCLUDED
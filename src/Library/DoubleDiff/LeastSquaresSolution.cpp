@@ -0,0 +1,384 @@
+#include "LeastSquaresSolution.h"
+bool FixIntegers = false;
+
+// An integer fix must be this much better than the next best
+static const double RatioThreshhold = 3;
+
+// Weight given to a fixed ambiguity. Much stronger than any measurement.
+static const double FixWeight = 1000;
+
+
+
+LeastSquaresSolution::LeastSquaresSolution(Position& basepos, Position& roverpos)
+: Solution(basepos, roverpos)
+{
+	Fixing = FixIntegers;
+	FixFit = -1;
+}
+
+
+bool LeastSquaresSolution::Update(Observations& obs, Position& pos, double& cep, double& fit)
+{
+	debug("LeastSquaresSolution::Update BasePos=(%.3f, %.3f, %.3f)  RoverPos=(%.3f, %.3f, %.3f)\n",
+		BasePos.x, BasePos.y, BasePos.z, RoverPos.x, RoverPos.y, RoverPos.z);
+
+	// We are starting a new epoch and need new clock error variables
+	eqn.NewEpoch();
+	FixFit = -1;
+
+	// Figure which satellies we are now tracking
+	if (UpdateSatellites(obs) != OK) return Error();
+
+    // Append the current epoch to the equations
+	AppendDoubleDifference(obs);
+
+	// Get the solution if any 
+	if (Solve(pos, cep, fit) != OK)
+		return Error();
+
+	// See if the ambiguities can be fixed as integers
+	if (Fixing && cep != -1 && ResolveAmbiguities(pos, cep, fit) != OK)
+		return Error();
+
+	return OK;
+}
+
+
+bool LeastSquaresSolution::UpdateSatellites(Observations& obs)
+{
+	debug("UpdateSatellites: ReferenceSat=%d\n", ReferenceSat);
+	// Drop lost or slipped satellite
+	//  Only satellites in the equations can be lost. (Copied, since dropping changes the set.)
+	SatSet phases = eqn.PhaseSatellites();
+	for (int i=0; i<phases.Count(); i++) {
+		int s = phases[i];
+		if ((!obs[s].ValidPhase || obs[s].Slip) && s != ReferenceSat)
+			eqn.DropPhase(s);
+	}
+
+	// Switch reference satellites if it was lost
+	if (ReferenceSat != -1 && (!obs[ReferenceSat].ValidPhase || obs[ReferenceSat].Slip))
+	    DropReference(obs);
+
+	// Gain the new and slipped satellites
+	//   If we are already tracking, gaining it again is a NOP
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		if (obs[s].ValidPhase && s != ReferenceSat)
+			eqn.AddPhase(s);
+	}
+
+	// If we are starting fresh, need to pick a new reference
+	if (ReferenceSat == -1)
+		PickNewReference(obs);
+
+	return OK;
+}
+
+
+bool LeastSquaresSolution::AppendDoubleDifference(Observations& obs)
+{
+	// See if we have enough satellite with valid measurements
+	int MCode = 0; int MPhase = 0;
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		if (obs[s].ValidCode) MCode++;
+		if (obs[s].ValidPhase) MPhase++;
+	}
+	if (MCode < 4 && MPhase < 4)
+	    {Reset(); return OK;}
+
+	// Do for each satellite with data
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		const Observation& o = obs[s];
+		if (!o.ValidCode && !o.ValidPhase) continue;
+
+		// Calculate the single difference code and phase equations
+		//    tcode + x*e[s] = bcode, 
+		//    tphase + x*e[s] + L1WaveLength*ambig = bphase
+		// Remember them for later so we can calculate residuals
+		Log(s);
+		SingleDifference(o, e[s], CodeB[s], PhaseB[s]);
+
+		// Add in the code and phase equations
+		if (o.ValidCode)
+			eqn.AppendCode(e[s], CodeB[s], o.CodeWeight);
+		if (o.ValidPhase)
+			eqn.AppendPhase(e[s], PhaseB[s], s, L1WaveLength, 0, o.PhaseWeight);
+	}
+
+	// Append dummy equations if there are no code or phase equations
+	//   These assign zero to the clock variables and keeps the equations solvable
+	//   Alternatively, we could delete and renumber the columns.
+	// if (MCode == 0)   eqn.AppendCode(Triple(0), 0, 1);
+	// if (MPhase == 0)  eqn.AppendPhase(Triple(0), 0, 0, 0, 0, 1);
+	Triple GnuTemp(0);
+	if (MCode == 0)   eqn.AppendCode(GnuTemp, 0, 1);
+	if (MPhase == 0)  eqn.AppendPhase(GnuTemp, 0, 0, 0, 0, 1);
+
+
+	// debug - show the double difference phase values
+	debug("LeastSquaresSolution::Append  - Double Difference phase. ReferenceSat=%d\n", ReferenceSat);
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		if (obs[s].ValidPhase && s != ReferenceSat && ReferenceSat != -1)
+			debug("   s=%d  PhaseDiff=%.3f  Phase=%.3f\n", 
+			s, obs[s].Phase-obs[ReferenceSat].Phase, 
+			(obs[s].Phase-obs[ReferenceSat].Phase)-round(obs[s].Phase-obs[ReferenceSat].Phase)  );
+	}
+	return OK;
+}
+
+
+bool LeastSquaresSolution::Solve(Position& pos, double& cep, double& fit)
+{
+    // If not enough satellites being tracked, then the equations were reset earlier
+	if (eqn.LastRow < 0) {
+		pos = RoverPos;
+		cep = -1;
+		fit = -1;
+		return OK;
+	}
+
+    // Calculate the new position
+	Position offset;
+	if (eqn.SolvePosition(offset, cep, fit) != OK) return Error();
+	pos = RoverPos + offset;
+
+	return OK;
+}
+
+
+bool LeastSquaresSolution::ResolveAmbiguities(Position& pos, double& cep, double& fit)
+// Search for integer values of the float ambiguities. If the best is clearly
+//   better than the rest, constrain the ambiguities to it and solve again.
+//   The constraints go on a copy, so the float equations carry on untouched.
+//   A later reference change, slip or rejected trial can't leave them behind.
+{
+	int sats[MaxChannels]; int n = 0;
+	SatSet& phases = eqn.PhaseSatellites();
+	for (int i=0; i<phases.Count(); i++)
+		sats[n++] = phases[i];
+	if (n == 0) return OK;
+
+	double a[MaxChannels], Q[MaxChannels][MaxChannels];
+	if (eqn.AmbiguityCovariance(n, sats, a, Q) != OK) return Error();
+
+	// If the search fails, stay with the float solution
+	Lambda lambda;
+	double fixed[MaxChannels], ratio;
+	if (lambda.Resolve(n, a, Q, fixed, ratio) != OK) {
+		debug("LeastSquaresSolution::ResolveAmbiguities - no integer solution\n");
+		ClearError();
+		return OK;
+	}
+	debug("LeastSquaresSolution::ResolveAmbiguities  n=%d  ratio=%.2f\n", n, ratio);
+	if (ratio < RatioThreshhold) return OK;
+
+	Position offset;
+	GpsEquations constrained(eqn);
+	if (constrained.FixAmbiguities(n, sats, fixed, FixWeight) != OK) return Error();
+	if (constrained.GetSolution(offset, cep, fit) != OK) return Error();
+	pos = RoverPos + offset;
+	FixFit = fit;
+	return OK;
+}
+
+
+bool LeastSquaresSolution::DropReference(Observations& obs)
+{
+	debug("DropReference:  ReferenceSat=%d\n", ReferenceSat);
+	int OldRef = ReferenceSat;
+
+	// Pick a new reference satellite.
+	ReferenceSat = BestReference(obs);
+	if (ReferenceSat == -1) return OK;
+
+	// Switch to the new reference satellite.
+	if (eqn.ChangeReference(OldRef, ReferenceSat) != OK) return Error();
+
+	// Drop the old reference satellite
+	if (eqn.DropPhase(OldRef) != OK) return Error();
+
+	return OK;
+}
+
+
+bool LeastSquaresSolution::PickNewReference(Observations& obs)
+{
+	// Pick any satellite. Use the one in the last column since it is easiest to delete.
+	ReferenceSat = BestReference(obs);
+	debug("PickNewReference: ReferenceSat=%d\n", ReferenceSat);
+	if (ReferenceSat == -1) return OK;
+
+	// Simply get rid of this satellite's phase column. (TODO: review)
+	return eqn.DeletePhase(ReferenceSat);
+}
+
+
+int LeastSquaresSolution::BestReference(Observations& obs)
+{
+	int Best = -1;
+	double BestValue = 0;
+
+	// Do for each satellite with valid phase
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+
+		// A reference satellite must be tracked now and be part of previous solution
+		if (!obs[s].ValidPhase) continue;
+		if (!eqn.PhaseDefined(s)) continue;
+
+		// Pick the one with the highest elevation
+		Position& pos = obs.BasePos;
+		Position satpos = obs[s].SatPos - pos;
+		double SinElev = (pos * satpos) / ( Range(pos) * Range(satpos));
+		if (SinElev > BestValue)
+			Best = s;
+	}
+
+	return Best;
+}
+
+
+bool LeastSquaresSolution::NewPosition(Position& pos)
+{
+	// We are introducing 3 new position variables.
+	//    The matrix should be upper diagonal, so we
+	//    eliminate the old position variables by
+	//    simply removing the top 3 equations.
+	debug("LeastSquaresSolution::NewPosition: pos=(%.3f, %.3f, %.3f)\n", pos.x, pos.y, pos.z);
+	RoverPos = pos;
+	return eqn.NewPosition();
+}
+
+
+Position LeastSquaresSolution::GetPosition()
+{
+	return RoverPos + eqn.GetOffset();
+}
+
+
+double LeastSquaresSolution::GetCep()
+{
+	return 0;
+}
+
+
+double LeastSquaresSolution::GetCodeResidual(int sat)
+{
+	return eqn.GetTc() + e[sat]*eqn.GetOffset() - CodeB[sat];
+}
+
+
+double LeastSquaresSolution::GetPhaseResidual(int sat)
+{
+	return eqn.GetTp() + e[sat]*eqn.GetOffset() + eqn.GetAmbiguity(sat)*L1WaveLength
+		     - PhaseB[sat];
+}
+
+
+bool LeastSquaresSolution::GetInfluence(Observations& obs, Influence& inf)
+// Rebuild the current epoch's equations and measure their influence on the solution.
+//   Must be called right after Update(), before the equations change.
+{
+	inf.Begin(eqn);
+	if (!inf.Valid()) return OK;
+
+	double row[MaxCols];
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		const Observation& o = obs[s];
+		if (o.ValidCode) {
+			eqn.CodeRow(e[s], o.CodeWeight, row);
+			if (inf.AddRow(eqn, s, false, o.CodeWeight, 
+				           GetCodeResidual(s)*o.CodeWeight, row) != OK) return Error();
+		}
+		if (o.ValidPhase) {
+			eqn.PhaseRow(e[s], s, L1WaveLength, 0, o.PhaseWeight, row);
+			if (inf.AddRow(eqn, s, true, o.PhaseWeight, 
+				           GetPhaseResidual(s)*o.PhaseWeight, row) != OK) return Error();
+		}
+	}
+
+	return OK;
+}
+
+
+bool LeastSquaresSolution::Checkpoint()
+// Save the solution so a trial can be undone
+{
+	if (eqn.Checkpoint() != OK) return Error();
+	SavedRoverPos = RoverPos;
+	SavedReferenceSat = ReferenceSat;
+	ClearLog();
+	Saved = true;
+	return OK;
+}
+
+
+bool LeastSquaresSolution::Rollback()
+// Restore the solution to the checkpoint. The checkpoint remains for the next trial.
+{
+	if (!Saved) return Error("LeastSquaresSolution::Rollback - no checkpoint\n");
+	if (eqn.Rollback() != OK) return Error();
+	RoverPos = SavedRoverPos;
+	ReferenceSat = SavedReferenceSat;
+	UndoLog();
+	return OK;
+}
+
+
+bool LeastSquaresSolution::Commit()
+// Keep the trial solution
+{
+	ClearLog();
+	Saved = false;
+	return eqn.Commit();
+}
+
+
+Solution* LeastSquaresSolution::Clone()
+{
+	return new LeastSquaresSolution(*this);
+}
+
+
+bool LeastSquaresSolution::CopyFrom(Solution& src)
+{
+	LeastSquaresSolution* lsq = dynamic_cast<LeastSquaresSolution*>(&src);
+	if (lsq == NULL) return false;
+	*this = *lsq;
+	return true;
+}
+
+
+bool LeastSquaresSolution::Record(Smoother* store)
+{
+	return eqn.Record(store);
+}
+
+
+bool LeastSquaresSolution::SaveEpoch(Time t, Position& pos, double cep, double fit)
+{
+	return eqn.SaveEpoch(t, RoverPos, pos, cep, fit);
+}
+
+
+bool LeastSquaresSolution::EndRecording()
+{
+	return eqn.EndRecording();
+}
+
+
+bool LeastSquaresSolution::Reset()
+{
+	eqn.Reset(); 
+	ReferenceSat = -1;
+	FixFit = -1;
+	return OK;
+}
+
+
+LeastSquaresSolution::~LeastSquaresSolution(){}
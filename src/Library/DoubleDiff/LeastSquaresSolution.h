@@ -0,0 +1,69 @@
+#ifndef LEASTSQUARESSOLUTION_INCLUDED
+#define LEASTSQUARESSOLUTION_INCLUDED
+
+#include "Solution.h"
+#include "GpsEquations.h"
+#include "Lambda.h"
+
+//////////////////////////////////////////////////////////////////
+//
+// LeastSquaresSolution - a solution from the accumulated least squares
+//   equations, with the ambiguities optionally fixed as integers.
+//
+///////////////////////////////////////////////////////////////////
+
+class LeastSquaresSolution: public Solution
+{
+protected:
+	double CodeClock;
+	double PhaseClock;
+
+	// Whether to search for integer ambiguities
+	bool Fixing;
+
+	// The resulting linear gps equations
+	GpsEquations eqn;
+
+	// Fit of this epoch's integer fix, or -1 if the ambiguities weren't fixed
+	double FixFit;
+
+public:
+	LeastSquaresSolution(Position& basepos, Position& roverpos);
+	virtual bool NewPosition(Position& pos);
+	virtual bool Update(Observations& obs, Position& pos, double& cep, double& fit);
+	virtual bool Reset();
+
+	virtual Position GetPosition();
+	virtual double GetCep();
+	virtual double GetFit() {return (FixFit != -1)? FixFit: eqn.GetFit();}
+	virtual double GetCodeResidual(int sat);
+	virtual double GetPhaseResidual(int sat);
+	virtual bool GetInfluence(Observations& obs, Influence& inf);
+
+	virtual bool Checkpoint();
+	virtual bool Rollback();
+	virtual bool Commit();
+	virtual Solution* Clone();
+	virtual bool CopyFrom(Solution& src);
+
+	virtual bool Record(Smoother* store);
+	virtual bool SaveEpoch(Time t, Position& pos, double cep, double fit);
+	virtual bool EndRecording();
+
+	virtual ~LeastSquaresSolution();
+
+private:
+	bool AppendDoubleDifference(Observations& obs);
+	bool AppendDoublePhase(Observations& obs);
+	bool AppendDoubleCode(Observations& obs);
+	bool UpdateSatellites(Observations& obs);
+	bool Solve(Position& pos, double& cep, double& fit);
+	bool ResolveAmbiguities(Position& pos, double& cep, double& fit);
+
+	bool DropReference(Observations& obs);
+	bool PickNewReference(Observations& obs);
+	int  BestReference(Observations& obs);
+};
+
+
+#endif // LEASTSQUARESSOLUTION_INCLUDED
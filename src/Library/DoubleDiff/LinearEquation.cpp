@@ -19,116 +19,272 @@
 
 #include "LinearEquation.h"
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
 
-LinearEquations::LinearEquations(void)
+
+// Vector kernels for working on rows of A. Rows may start anywhere within
+//   a vector, so unaligned loads are used. Each kernel finishes with a scalar loop.
+
+static inline void RotateRows(double* x, double* y, int n, double cs, double sn)
+// x,y = cs*x + sn*y, cs*y - sn*x
+{
+	int c = 0;
+#if defined(__AVX__)
+	__m256d vc = _mm256_set1_pd(cs), vs = _mm256_set1_pd(sn);
+	for (; c+4 <= n; c+=4) {
+		__m256d vx = _mm256_loadu_pd(x+c), vy = _mm256_loadu_pd(y+c);
+		_mm256_storeu_pd(x+c, _mm256_add_pd(_mm256_mul_pd(vc,vx), _mm256_mul_pd(vs,vy)));
+		_mm256_storeu_pd(y+c, _mm256_sub_pd(_mm256_mul_pd(vc,vy), _mm256_mul_pd(vs,vx)));
+	}
+#elif defined(USE_SSE2)
+	__m128d vc = _mm_set1_pd(cs), vs = _mm_set1_pd(sn);
+	for (; c+2 <= n; c+=2) {
+		__m128d vx = _mm_loadu_pd(x+c), vy = _mm_loadu_pd(y+c);
+		_mm_storeu_pd(x+c, _mm_add_pd(_mm_mul_pd(vc,vx), _mm_mul_pd(vs,vy)));
+		_mm_storeu_pd(y+c, _mm_sub_pd(_mm_mul_pd(vc,vy), _mm_mul_pd(vs,vx)));
+	}
+#endif
+	for (; c < n; c++) {
+		double vx = x[c], vy = y[c];
+		x[c] = cs*vx + sn*vy;
+		y[c] = cs*vy - sn*vx;
+	}
+}
+
+
+static inline double DotRows(const double* x, const double* y, int n)
 {
+	double sum = 0;
+	int c = 0;
+#if defined(__AVX__)
+	__m256d vsum = _mm256_setzero_pd();
+	for (; c+4 <= n; c+=4)
+		vsum = _mm256_add_pd(vsum, _mm256_mul_pd(_mm256_loadu_pd(x+c), _mm256_loadu_pd(y+c)));
+	double part[4];
+	_mm256_storeu_pd(part, vsum);
+	sum = (part[0] + part[1]) + (part[2] + part[3]);
+#elif defined(USE_SSE2)
+	__m128d vsum = _mm_setzero_pd();
+	for (; c+2 <= n; c+=2)
+		vsum = _mm_add_pd(vsum, _mm_mul_pd(_mm_loadu_pd(x+c), _mm_loadu_pd(y+c)));
+	double part[2];
+	_mm_storeu_pd(part, vsum);
+	sum = part[0] + part[1];
+#endif
+	for (; c < n; c++)
+		sum += x[c] * y[c];
+	return sum;
+}
+
+
+
+template <int NRows, int NCols>
+LinearEquations<NRows,NCols>::LinearEquations(void)
+{
+	Saved = false;
 	Reset();
 }
 
-LinearEquations::~LinearEquations(void)
+template <int NRows, int NCols>
+LinearEquations<NRows,NCols>::~LinearEquations(void)
 {
 }
 
 
-void LinearEquations::Reset()
+template <int NRows, int NCols>
+void LinearEquations<NRows,NCols>::Reset()
 {
 	debug(3,"LinearEquations:: Reset\n");
 	LastCol = -1;
 	LastRow = -1;
+	Rows = 0;
 	TotalR2 = R2 = 0;
 	TotalCount = Count = 0;
 }
 
-int LinearEquations::AddRow()
+
+template <int NRows, int NCols>
+void LinearEquations<NRows,NCols>::Begin()
+// Set aside empty rows of R for the current variables when the first equation arrives
+{
+	if (LastRow != -1) return;
+	for (int r=0; r<=LastCol; r++) {
+		for (int c=0; c<=LastCol; c++)
+			A[r][c] = 0;
+		B[r] = 0;
+	}
+	LastRow = LastCol;
+}
+
+
+template <int NRows, int NCols>
+int LinearEquations<NRows,NCols>::AddRow()
 {
 	debug(2, "LinearEquations::Addrow  LastRow=%d\n", LastRow);
+	Begin();
 	LastRow++;
-	assert(LastRow < MaxRows);
+	assert(LastRow < NRows);
 
 	for (int c=0; c<=LastCol; c++)
 		A[LastRow][c] = 0;
+	Rows++;
 
 	return LastRow;
 }
 
-int LinearEquations::AddCol()
+template <int NRows, int NCols>
+int LinearEquations<NRows,NCols>::AddCol()
 {
 	debug(2, "LinearEquations::AddCol  LastCol=%d\n", LastCol);
 	LastCol++;
-	assert(LastCol < MaxCols);
+	assert(LastCol < NCols);
+	X[LastCol] = 0;
+	if (LastRow == -1) return LastCol;
+
+	// Move any pending equation out of the way of the new row of R
+	if (LastRow >= LastCol) {
+		LastRow++;
+		assert(LastRow < NRows);
+		for (int c=0; c<LastCol; c++)
+			A[LastRow][c] = A[LastCol][c];
+		B[LastRow] = B[LastCol];
+	}
+	else
+		LastRow = LastCol;
 
+	// The new row of R is empty, and the new column is zero everywhere
+	for (int c=0; c<LastCol; c++)
+		A[LastCol][c] = 0;
+	B[LastCol] = 0;
 	for (int r=0; r<=LastRow; r++)
 		A[r][LastCol] = 0;
 
 	return LastCol;
 }
 
-int LinearEquations::DeleteRow(int row)
+template <int NRows, int NCols>
+int LinearEquations<NRows,NCols>::DeleteRow(int row)
+// Drop an equation. For a row of R, this leaves the row empty.
 {
 	debug(2, "LinearEquations::DeleteRow  row=%d  LastRow=%d\n", row, LastRow);
 	assert(row >= 0 && row <= LastRow);
+
+	// A row of R. Dropping it frees the row's variable from whatever was known about it.
+	if (row <= LastCol) {
+		if (!EmptyRow(row)) Rows--;
+		for (int c=0; c<=LastCol; c++)
+			A[row][c] = 0;
+		B[row] = 0;
+		return LastRow;
+	}
+
+	// A pending equation. 
 	if (row < LastRow) {
 		for (int c=0; c<=LastCol; c++)
 			A[row][c] = A[LastRow][c];
 		B[row] = B[LastRow];
 	}
-
+	Rows--;
 	LastRow--;
 	return LastRow;
 }
 
 
-int LinearEquations::DeleteCol(int col)
+template <int NRows, int NCols>
+int LinearEquations<NRows,NCols>::DeleteCol(int col)
+// Remove a variable by setting it to zero. Later columns move down by one.
 {
 	debug(2, "LinearEquations::DeleteCol  col=%d  LastCol=%d\n", col, LastCol);
 	assert (col >= 0 && col <= LastCol);
-	if (col < LastCol)
-		for (int r=0; r<=LastRow; r++)
-			A[r][col] = A[r][LastCol];
-
+	MoveColToEnd(col);
 	LastCol--;
+
+	// The last row of R no longer has a variable. It becomes a residual.
+	int row = LastCol+1;
+	if (LastRow != -1 && A[row][row] == 0 && EmptyRow(row)) {
+		Rows++;   // (DeleteRow will take it back off)
+		DeleteRow(row);
+	}
+
 	return LastCol;
 }
 
 
-bool LinearEquations::Eliminate(int row, int col)
+template <int NRows, int NCols>
+bool LinearEquations<NRows,NCols>::Eliminate(int col)
+// Remove a variable along with everything known about it. Later columns move down by one.
+//   The remaining equations give the same solution as if the variable were still present.
 {
-	debug(2, "LinearEquations::Eliminate row=%d  col=%d LastRow=%d  LastCol=%d\n",
-		                                 row,    col,   LastRow,    LastCol);
-	if (LastRow < 0) return OK;
+	debug(2, "LinearEquations::Eliminate col=%d  LastRow=%d  LastCol=%d\n",
+		                                 col,   LastRow,    LastCol);
+	assert (col >= 0 && col <= LastCol);
+
+	if (LastRow != -1) {
+
+		// Fold in pending equations so the variable appears only in R
+		Update();
+
+		// Rotate the variable out of the rows above, gathering it into its own row
+		for (int r=col-1; r>=0; r--)
+			Rotate(col, r, col, r);
 
-	return ApplyHouseholder(A, 0, LastRow, 0, LastCol, B, row, col);
+		// That row is now the only equation containing the variable. Drop it.
+		if (!EmptyRow(col)) Rows--;
+		for (int r=col; r<LastRow; r++) {
+			for (int c=0; c<=LastCol; c++)
+				A[r][c] = A[r+1][c];
+			B[r] = B[r+1];
+		}
+		LastRow--;
+	}
+
+	// Drop the column. The last solution stays lined up with the columns.
+	for (int r=0; r<=LastRow; r++)
+		for (int c=col; c<LastCol; c++)
+			A[r][c] = A[r][c+1];
+	for (int c=col; c<LastCol; c++)
+		X[c] = X[c+1];
+	LastCol--;
+
+	return OK;
 }
 
 
 
 
-bool LinearEquations::Solve()
+template <int NRows, int NCols>
+bool LinearEquations<NRows,NCols>::Solve()
 {
 	Debug("LinearEquations::Solve\n");
-	if (LastRow < LastCol) 
+	if (LastRow == -1 || Rows <= LastCol) 
 		return Error("Can't solve underdetermined linear equation\n");
 
 	// Add the last solutions residuals to the totals
 	TotalCount += Count;  TotalR2 += R2;
 
-	// Do a QR factorization, putting the matrix into upper diagonal form
+	// Fold the new equations into R, leaving their residuals behind
+	Update();
 	for (int c=0; c<=LastCol; c++)
-		if (ApplyHouseholder(A, c, LastRow, c, LastCol, B, c, c) != OK)
+		if (abs(A[c][c]) < eps)
 			return Error("Can't solve equations");
 
 	// use backsubstitution to solve
-	if (BackSubstitute(A, LastCol, LastCol, B, X) != OK)
-		return Error("Can't solve equations");
+	BackSubstitute();
 
 	// Calculate the residuals from the current equations
-	Count = LastRow-LastCol;
+	Count = Rows-LastCol-1;
 	R2 = 0;
 	for (int r=LastCol+1; r<=LastRow; r++)
 		R2 += B[r]*B[r];
 
 	// Drop the residuals from the matrix
 	LastRow = LastCol;
+	Rows = LastCol+1;
 
 	debug(2, "LinearEquation::Solve LastCol=%d resid**2=%.3f\n", LastCol,R2);
 	debug(3,"   ");
@@ -139,7 +295,96 @@ bool LinearEquations::Solve()
 	return OK;
 }
 
-double LinearEquations::GetFit()
+
+template <int NRows, int NCols>
+void LinearEquations<NRows,NCols>::Update()
+// Fold the pending equations into R with Givens rotations.
+//   Each one is left holding only its residual.
+{
+	for (int r=LastCol+1; r<=LastRow; r++)
+		for (int c=0; c<=LastCol; c++)
+			Rotate(c, r, c, c);
+}
+
+
+template <int NRows, int NCols>
+bool LinearEquations<NRows,NCols>::MoveColToEnd(int col)
+// Move a column to the end, shifting the later columns down by one.
+//   The shifted part of R is left upper Hessenberg, and is made triangular again.
+{
+	if (col == LastCol) return OK;
+
+	double save = X[col];
+	for (int c=col; c<LastCol; c++)
+		X[c] = X[c+1];
+	X[LastCol] = save;
+	if (LastRow == -1) return OK;
+
+	for (int r=0; r<=LastRow; r++) {
+		double save = A[r][col];
+		for (int c=col; c<LastCol; c++)
+			A[r][c] = A[r][c+1];
+		A[r][LastCol] = save;
+	}
+
+	for (int r=col+1; r<=LastCol; r++)
+		Rotate(r-1, r, r-1, r-1);
+
+	return OK;
+}
+
+
+template <int NRows, int NCols>
+void LinearEquations<NRows,NCols>::Rotate(int row, int r, int col, int from)
+// Apply a Givens rotation to rows "row" and "r", zeroing A[r][col].
+//   Both rows must be zero to the left of column "from".
+{
+	double a = A[row][col];
+	double b = A[r][col];
+	if (b == 0) return;
+
+	// An empty row simply trades places with the equation
+	if (a == 0) {
+		for (int c=from; c<=LastCol; c++)
+			Swap(A[row][c], A[r][c]);
+		Swap(B[row], B[r]);
+		return;
+	}
+
+	double h = sqrt(a*a + b*b);
+	double cs = a / h;
+	double sn = b / h;
+	RotateRows(&A[row][from], &A[r][from], LastCol-from+1, cs, sn);
+	double x = B[row], y = B[r];
+	B[row] = cs*x + sn*y;
+	B[r] = cs*y - sn*x;
+
+	// Column "col" is set exactly rather than left to rounding
+	A[row][col] = h;
+	A[r][col] = 0;
+}
+
+
+template <int NRows, int NCols>
+void LinearEquations<NRows,NCols>::BackSubstitute()
+// Solve R x = B. Each row of R is contiguous, so each variable is one dot product.
+{
+	for (int r=LastCol; r>=0; r--)
+		X[r] = (B[r] - DotRows(&A[r][r+1], &X[r+1], LastCol-r)) / A[r][r];
+}
+
+
+template <int NRows, int NCols>
+bool LinearEquations<NRows,NCols>::EmptyRow(int row)
+{
+	for (int c=0; c<=LastCol; c++)
+		if (A[row][c] != 0) return false;
+	return B[row] == 0;
+}
+
+
+template <int NRows, int NCols>
+double LinearEquations<NRows,NCols>::GetFit()
 {
 	// See how the current residuals compare against the previous ones
 	//   This ratio is useful for detecting errors in the data.
@@ -149,7 +394,90 @@ double LinearEquations::GetFit()
 	return (R2/Count) / (TotalR2/TotalCount);
 	}
 
-double LinearEquations::Trace2()
+template <int NRows, int NCols>
+bool LinearEquations<NRows,NCols>::TransposeSolve(const double* row, double* w)
+// Solves R'w = row, where R is the upper triangular matrix left by Solve().
+//   |w|**2 is the leverage the equation "row" has on the least squares solution,
+//   and w.w' for two equations is the corresponding entry of the hat matrix.
+{
+	if (LastRow != LastCol)
+		return Error("TransposeSolve - equations haven't been solved\n");
+
+	for (int c=0; c<=LastCol; c++) {
+		double sum = row[c];
+		for (int r=0; r<c; r++)
+			sum -= A[r][c] * w[r];
+		w[c] = sum / A[c][c];
+	}
+
+	return OK;
+}
+
+
+template <int NRows, int NCols>
+bool LinearEquations<NRows,NCols>::Checkpoint()
+// Save the equations so they can be restored later.
+//   Pending equations are folded in first, leaving only R and the residuals to save.
+{
+	debug(2, "LinearEquations::Checkpoint  LastRow=%d  LastCol=%d\n", LastRow, LastCol);
+	Update();
+
+	double* p = SavedR;
+	for (int r=0; r<=LastCol && r<=LastRow; r++)
+		for (int c=r; c<=LastCol; c++)
+			*p++ = A[r][c];
+	for (int r=0; r<=LastRow; r++)
+		SavedB[r] = B[r];
+	for (int c=0; c<=LastCol; c++)
+		SavedX[c] = X[c];
+
+	SavedLastRow = LastRow;  SavedLastCol = LastCol;  SavedRows = Rows;
+	SavedR2 = R2;  SavedTotalR2 = TotalR2;
+	SavedCount = Count;  SavedTotalCount = TotalCount;
+	Saved = true;
+	return OK;
+}
+
+
+template <int NRows, int NCols>
+bool LinearEquations<NRows,NCols>::Rollback()
+// Restore the equations to the last checkpoint. The checkpoint remains.
+{
+	debug(2, "LinearEquations::Rollback  LastRow=%d-->%d  LastCol=%d-->%d\n",
+		LastRow, SavedLastRow, LastCol, SavedLastCol);
+	if (!Saved) return Error("LinearEquations::Rollback - no checkpoint\n");
+
+	LastRow = SavedLastRow;  LastCol = SavedLastCol;  Rows = SavedRows;
+	R2 = SavedR2;  TotalR2 = SavedTotalR2;
+	Count = SavedCount;  TotalCount = SavedTotalCount;
+
+	// R is zero below the diagonal, and the residual rows are zero except for B
+	double* p = SavedR;
+	for (int r=0; r<=LastRow; r++) {
+		int c = 0;
+		for (; c<r && c<=LastCol; c++)
+			A[r][c] = 0;
+		for (; c<=LastCol; c++)
+			A[r][c] = *p++;
+		B[r] = SavedB[r];
+	}
+	for (int c=0; c<=LastCol; c++)
+		X[c] = SavedX[c];
+
+	return OK;
+}
+
+
+template <int NRows, int NCols>
+void LinearEquations<NRows,NCols>::Commit()
+// Keep the changes made since the checkpoint
+{
+	Saved = false;
+}
+
+
+template <int NRows, int NCols>
+double LinearEquations<NRows,NCols>::Trace2()
 // Takes the trace of the covariance matrix.
 {
 	if (LastRow < LastCol)
@@ -162,16 +490,19 @@ double LinearEquations::Trace2()
 }
 
 
-void LinearEquations::Debug(const char* s)
+template <int NRows, int NCols>
+void LinearEquations<NRows,NCols>::Debug(const char* s)
 {
 	debug(2,"Linear Equations%s\n", s);
 	DebugArray(A, 0, LastRow, 0, LastCol, B, s);
 }
 
-LinearEquations& LinearEquations::operator=(LinearEquations& src)
+template <int NRows, int NCols>
+LinearEquations<NRows,NCols>& LinearEquations<NRows,NCols>::operator=(LinearEquations& src)
 {
 	LastRow = src.LastRow;
 	LastCol = src.LastCol;
+	Rows = src.Rows;
 	for (int r=0; r<=LastRow; r++) {
 		B[r] = src.B[r];
 		for (int c=0; c<=LastCol; c++)
@@ -185,9 +516,13 @@ LinearEquations& LinearEquations::operator=(LinearEquations& src)
 	return *this;
 }
 
-LinearEquations::LinearEquations(LinearEquations& src)
+template <int NRows, int NCols>
+LinearEquations<NRows,NCols>::LinearEquations(LinearEquations& src)
 {
+	Saved = false;
 	*this = src;
 }
 
 
+// The sizes in use
+template class LinearEquations<MaxRows, MaxCols>;
@@ -24,18 +24,54 @@
 #include "Householder.h"
 
 
-static const int MaxRows = 3*MaxChannels;
 static const int MaxCols = 3+MaxChannels;
+static const int MaxRows = MaxCols + 2*MaxChannels;  // R, plus code and phase for each channel
 
-class LinearEquations  // probably should be a template
+// Rows of A are aligned so the rotation kernels can work on them a vector at a time.
+//   16 bytes is as much as operator new promises.
+#ifdef _MSC_VER
+#define ALIGNED(n) __declspec(align(n))
+#else
+#define ALIGNED(n) __attribute__((aligned(n)))
+#endif
+
+//////////////////////////////////////////////////////////////////
+//
+// LinearEquations - least squares equations kept in square root information form.
+//
+//   Rows 0..LastCol hold an upper triangular matrix R, one row per variable.
+//   A row of R may be empty (all zero) when nothing is known about its variable.
+//   Rows LastCol+1..LastRow are equations which haven't been folded into R yet.
+//
+//   New equations are folded in with Givens rotations, so the cost of an update
+//   depends on the number of equations added, not on the size of the system.
+//   Eliminate() rotates a variable into a single row of R and discards that row.
+//   DeleteCol() sets a variable to zero, leaving one equation behind as a residual.
+//   X, the last solution, moves along with its columns.
+//
+//   Checkpoint() saves the equations so a trial solution can be undone with
+//   Rollback(). Only R is saved, packed as a triangle, along with the right
+//   hand side. The checkpoint stays in place until Commit().
+//
+//   The size is fixed at compile time. Every rotation combines two rows, so A
+//   is stored by rows, each padded out to a whole number of vectors.
+//   The sizes in use are instantiated in LinearEquation.cpp.
+//
+///////////////////////////////////////////////////////////////////
+
+template <int NRows, int NCols>
+class LinearEquations
 {
 public:
-	double A[MaxRows][MaxCols], B[MaxRows], X[MaxCols];
+	static const int Stride = (NCols + 3) & ~3;   // doubles per row of A
+	ALIGNED(16) double A[NRows][Stride];
+	double B[NRows], X[NCols];
 	double R2, TotalR2;
 	int Count, TotalCount;
 
 	int LastRow;
 	int LastCol;
+	int Rows;     // number of equations, whether folded into R or not
 
 public:
 	LinearEquations(void);
@@ -49,13 +85,36 @@ public:
 	double Trace2();
 	void Debug(const char* s);
 
-	bool Eliminate(int col, int row);
+	bool Eliminate(int col);
 	bool Solve();
 	double GetFit();
+	bool TransposeSolve(const double* row, double* w);
+
+	bool Checkpoint();
+	bool Rollback();
+	void Commit();
 
 	LinearEquations& operator=(LinearEquations& src);
 	LinearEquations(LinearEquations& src);
+
+protected:
+	// The checkpoint, if any
+	bool Saved;
+	double SavedR[NCols*(NCols+1)/2], SavedB[NRows], SavedX[NCols];
+	double SavedR2, SavedTotalR2;
+	int SavedCount, SavedTotalCount;
+	int SavedLastRow, SavedLastCol, SavedRows;
+
+	void Update();
+	bool MoveColToEnd(int col);
+
+private:
+	void Rotate(int row, int r, int col, int from);
+	void BackSubstitute();
+	bool EmptyRow(int row);
+	void Begin();
 };
 
 #endif
 
+
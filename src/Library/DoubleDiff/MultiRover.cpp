@@ -0,0 +1,185 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "MultiRover.h"
+
+
+MultiRover::MultiRover(Ephemerides& eph, RawReceiver& base)
+: Base(base, eph)
+{
+	NrRovers = 0;
+	NrWorkers = 0;
+	Started = false;
+	Threaded = false;
+	Quit = false;
+}
+
+
+bool MultiRover::Add(RawReceiver& rover)
+// Add a rover. All the rovers are added before the first epoch.
+{
+	if (Started) return Error("MultiRover::Add - rovers must be added before starting\n");
+	if (NrRovers >= MaxRovers) return Error("MultiRover::Add - no more than %d rovers\n", MaxRovers);
+
+	int i = NrRovers++;
+	Rover[i] = new DoubleDiff(Base, rover);
+	Common[i] = false;
+	Finished[i] = false;
+	Failed[i] = false;
+	GpsTime[i] = -1;
+	Cep[i] = -1;
+	Fit[i] = 0;
+	return OK;
+}
+
+
+void MultiRover::Start()
+// Start the worker threads. If we can't, do the rovers ourselves.
+{
+	Started = true;
+	NrWorkers = max(1, min(Thread::Processors(), NrRovers));
+	if (NrWorkers == 1) return;
+
+	for (int w=0; w<NrWorkers; w++)
+		Worker[w] = new RoverWorker(*this);
+
+	int started;
+	for (started=0; started<NrWorkers; started++)
+		if (Worker[started]->Start() != OK) break;
+	Threaded = (started == NrWorkers);
+	if (!Threaded) {
+		Quit = true;
+		for (int w=0; w<started; w++) {
+			Worker[w]->Wake();
+			Worker[w]->Join();
+		}
+		for (int w=0; w<NrWorkers; w++)
+			delete Worker[w];
+		NrWorkers = 1;
+	}
+	debug("MultiRover: rovers=%d  workers=%d  Threaded=%d\n", NrRovers, NrWorkers, Threaded);
+}
+
+
+bool MultiRover::NextEpoch()
+// Read the next base epoch and find each rover's position at it
+{
+	if (!Started) Start();
+
+	// Done when every rover is finished
+	int active = 0;
+	for (int i=0; i<NrRovers; i++)
+		if (!Finished[i]) active++;
+	if (active == 0) return Error("MultiRover::NextEpoch - no rovers left\n");
+
+	if (Base.Next() != OK) return Error();
+	Next = 0;
+
+	if (!Threaded) {
+		for (int i = NextRover(); i != -1; i = NextRover())
+			Step(i);
+	}
+
+	else {
+		for (int w=0; w<NrWorkers; w++)
+			Worker[w]->Wake();
+		for (int w=0; w<NrWorkers; w++)
+			Done.Wait();
+	}
+
+	for (int i=0; i<NrRovers; i++)
+		if (Failed[i]) return Error("MultiRover::NextEpoch - rover %d failed\n", i);
+	return OK;
+}
+
+
+int MultiRover::NextRover()
+{
+	Lock.Lock();
+	int i = Next;
+	if (i < NrRovers) Next++;
+	else              i = -1;
+	Lock.Unlock();
+	return i;
+}
+
+
+void MultiRover::Step(int i)
+// Bring a rover up to the base's epoch
+{
+	Common[i] = false;
+	Failed[i] = false;
+	if (Finished[i]) return;
+
+	bool ended;
+	if (Rover[i]->NextSharedPosition(Common[i], ended, GpsTime[i], Pos[i], Cep[i], Fit[i]) != OK) {
+		if (ended) Event("Rover %d has finished\n", i);
+		else       Error("Rover %d failed\n", i);
+		ShowErrors();
+		ClearError();
+		Finished[i] = ended;
+		Failed[i] = !ended;
+		Common[i] = false;
+	}
+}
+
+
+MultiRover::~MultiRover()
+{
+	if (Threaded) {
+		Quit = true;
+		for (int w=0; w<NrWorkers; w++)
+			Worker[w]->Wake();
+		for (int w=0; w<NrWorkers; w++) {
+			Worker[w]->Join();
+			delete Worker[w];
+		}
+	}
+	for (int i=0; i<NrRovers; i++)
+		delete Rover[i];
+}
+
+
+
+
+RoverWorker::RoverWorker(MultiRover& fleet)
+: Fleet(fleet)
+{
+}
+
+
+void RoverWorker::Run()
+{
+	for (;;) {
+
+		// Wait for the next base epoch
+		Go.Wait();
+		if (Fleet.Quit) return;
+
+		// Work on rovers until there are none left
+		for (int i = Fleet.NextRover(); i != -1; i = Fleet.NextRover())
+			Fleet.Step(i);
+		Fleet.Done.Wake();
+	}
+}
+
+
+RoverWorker::~RoverWorker()
+{
+}
@@ -0,0 +1,109 @@
+#ifndef MULTIROVER_INCLUDED
+#define MULTIROVER_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+
+#include "DoubleDiff.h"
+#include "BaseEpoch.h"
+#include "Thread.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// MultiRover - processes many rovers against the same base.
+//
+//   The base is read once per epoch, and the satellite positions and
+//   base ranges are worked out once (see BaseEpoch). Each rover then finds
+//   its position at that epoch with its own DoubleDiff engine. The rovers
+//   are spread over a set of worker threads, one rover per thread at a time.
+//
+//   A rover without an observation at the base's epoch has no result for
+//   that epoch. A rover which runs out of data is finished, and the others
+//   carry on without it. A rover whose solution fails is an error, and
+//   NextEpoch() fails once the epoch is done. Errors are kept per thread,
+//   so each rover's errors are shown by the thread which ran it.
+//
+//   If the threads can't be started, the rovers are done in the caller's thread.
+//
+///////////////////////////////////////////////////////////////////
+
+static const int MaxRovers = 64;
+
+class MultiRover;
+
+class RoverWorker: public Thread
+{
+protected:
+	MultiRover& Fleet;
+	Semaphore Go;
+
+public:
+	RoverWorker(MultiRover& fleet);
+	void Wake() {Go.Wake();}
+	virtual ~RoverWorker();
+
+protected:
+	virtual void Run();
+};
+
+
+class MultiRover
+{
+public:
+	BaseEpoch Base;
+	int NrRovers;
+
+	// What each rover found at the current epoch
+	bool Common[MaxRovers];         // the rover has an observation at this epoch
+	bool Finished[MaxRovers];       // the rover has no more data
+	bool Failed[MaxRovers];         // the rover's solution failed at this epoch
+	Time GpsTime[MaxRovers];
+	Position Pos[MaxRovers];
+	double Cep[MaxRovers];
+	double Fit[MaxRovers];
+
+protected:
+	DoubleDiff* Rover[MaxRovers];
+	int NrWorkers;
+	RoverWorker* Worker[MaxRovers];
+	bool Started;
+	bool Threaded;
+	bool Quit;
+
+	// Handing out rovers to the workers
+	Mutex Lock;
+	int Next;
+	Semaphore Done;
+
+public:
+	MultiRover(Ephemerides& eph, RawReceiver& base);
+	bool Add(RawReceiver& rover);
+	inline DoubleDiff& operator[](int i) {return *Rover[i];}
+	bool NextEpoch();
+	virtual ~MultiRover();
+
+protected:
+	friend class RoverWorker;
+	void Start();
+	int NextRover();
+	void Step(int i);
+};
+
+#endif // MULTIROVER_INCLUDED
@@ -22,21 +22,22 @@
 #include "Observations.h"
 
 Observations::Observations()
+{
+	Empty();
+}
+
+void Observations::Empty()
 {
 	GpsTime = -1;
 	RoverPos = 0;
 	BasePos = 0;
-	for (int s=0; s<MaxSats; s++) {
-		obs[s].ValidCode = false;
-		obs[s].ValidPhase = false;
-		obs[s].Slip = true;
-		obs[s].SatPos = 0;
-	}
-
+	obs.Clear();
+	Active.Clear();
 }
 
 Observations::Observations(RawReceiver& base, RawReceiver& rover, Ephemerides& eph)
 {
+	Empty();
 	Init(base, rover, eph);
 }
 
@@ -45,62 +46,123 @@ void Observations::Init(RawReceiver& base, RawReceiver& rover, Ephemerides& eph)
 	GpsTime = base.GpsTime;
 	RoverPos = rover.Pos;   // These are approximations and are not used in the solution
 	BasePos = base.Pos;
+	ErrCode = OK;
 
-	// Do for each satellite
-	for (int s=0; s<MaxSats; s++) {
+	// Forget the satellites from the last time around
+	obs.Clear();
+	Active.Clear();
 
-		// Assume the observation is invalid until shown otherwise
-		Observation& o = obs[s];
-		o.Sat = s;
-		o.ValidCode = false;
-		o.ValidPhase = false;
-		o.Slip = true;
+	// Do for each satellite the base is tracking
+	int sat[MaxInView]; Time t[MaxInView]; int n = 0;
+	for (int i=0; i<base.Active.Count(); i++) {
+		int s = base.Active[i];
 
-		// If either of the receivers aren't tracking, then we are done with this sat
+		// The differences assume a common L1 frequency and GPS time
+		if (SatSystem(s) != GPS && SatSystem(s) != SBAS)
+			continue;
+
+		// If the rover isn't tracking too, then we are done with this sat
 		if (!base.obs[s].Valid || !rover.obs[s].Valid || !eph[s].Valid(GpsTime)) 
 			continue;
+		sat[n] = s;  t[n] = GpsTime;  n++;
+	}
 
-		// Get the satellite's position
-		double Adjust;
-		ErrCode = eph[s].SatPos(GpsTime, o.SatPos, Adjust);
-		if (ErrCode != OK) return;
-		debug(2, "Observations  s=%d  SatPos=(%.3f, %.3f, %.3f)\n",s, o.SatPos.x, o.SatPos.y, o.SatPos.z);
+	// Get the satellites' positions all at once, compensating for the earth's
+	//  rotation during the signal's transit
+	Position pos[MaxInView]; double adjust[MaxInView]; bool ok[MaxInView];
+	ErrCode = eph.SatPos(n, sat, t, RoverPos, pos, adjust, ok);
+	if (ErrCode != OK) return;
 
-		// Adjust the satellite's position to compensate for the earth's rotation
-		//  during the signal's transit
-		double TransitTime = Range(o.SatPos-RoverPos) / C;
-		o.SatPos = RotateEarth(o.SatPos, -TransitTime);
-		
-		// Make sure we have valid measurements.
-		o.ValidCode   = base.obs[s].PR != 0    && rover.obs[s].PR != 0;
-		o.ValidPhase  = base.obs[s].Phase != 0 && rover.obs[s].Phase != 0;
-		o.Slip        = base.obs[s].Slip       || rover.obs[s].Slip;
+	for (int k=0; k<n; k++) {
+		int s = sat[k];
+		Observation* o = obs.Add(s);
+		if (o == NULL) {ErrCode = Error(); return;}
+		o->SatPos = pos[k];
+		debug(2, "Observations  s=%d  SatPos=(%.3f, %.3f, %.3f)\n",s, o->SatPos.x, o->SatPos.y, o->SatPos.z);
 
+		o->BaseOffset = BasePos - o->SatPos;
+		o->BaseRange = Range(o->BaseOffset);
 
 #ifdef NotNow
             // solve integer mseconds, but we seem to know if it is 0-8.
-            double range = Range(BasePos - o.SatPos);
+            double range = Range(BasePos - o->SatPos);
             double adjust = round((range - base.obs[s].PR), C/1000);
             base.obs[s].PR += adjust;
             debug("  s=%d  range=%.3f  adjust=%.3f  PR=%.3f\n", s, range, adjust, base.obs[s].PR);
 #endif
-		// Keep track of pseudorange and phase differences for generating equations
-		o.PR = rover.obs[s].PR - base.obs[s].PR;
-		o.Phase = rover.obs[s].Phase - base.obs[s].Phase;
-		debug("Observations: s=%d  b.PR=%.3f  b.range=%.3f  r.PR=%.3f  r.range=%.3f\n",
-                s, base.obs[s].PR, Range(o.SatPos-BasePos), 
-                   rover.obs[s].PR, Range(o.SatPos-RoverPos));
-
-		// Calculate the default weights to use.
-		o.CodeWeight = .01;
-		o.PhaseWeight = 1;
+		Difference(s, base.obs[s], rover.obs[s]);
+	}
+
+	DebugCode(base, rover);
+}
+
+
+void Observations::Init(BaseEpoch& base, RawReceiver& rover)
+// Same as above, but the satellite positions and base ranges were worked out
+//   once for all the rovers.
+{
+	GpsTime = base.GpsTime;
+	RoverPos = rover.Pos;
+	BasePos = base.Base.Pos;
+	ErrCode = OK;
+
+	obs.Clear();
+	Active.Clear();
+
+	// Do for each satellite with a position
+	for (int i=0; i<base.Sats.Count(); i++) {
+		int s = base.Sats.Sat(i);
+		if (!rover.obs[s].Valid)
+			continue;
+
+		const BaseSatellite& b = base[s];
+		Observation* o = obs.Add(s);
+		if (o == NULL) {ErrCode = Error(); return;}
+		o->SatPos = b.SatPos;
+		o->BaseOffset = b.Offset;
+		o->BaseRange = b.Range;
+
+		Difference(s, base.Base.obs[s], rover.obs[s]);
 	}
 
+	DebugCode(base.Base, rover);
+}
+
+
+void Observations::Difference(int s, const RawObservation& base, const RawObservation& rover)
+// Difference the base and rover measurements of a satellite which was just added
+{
+	Observation& o = obs.Entry(s);
+
+	// Make sure we have valid measurements.
+	o.ValidCode   = base.PR != 0    && rover.PR != 0;
+	o.ValidPhase  = base.Phase != 0 && rover.Phase != 0;
+	o.Slip        = base.Slip       || rover.Slip;
+
+	// Keep track of pseudorange and phase differences for generating equations
+	o.PR = rover.PR - base.PR;
+	o.Phase = rover.Phase - base.Phase;
+	debug("Observations: s=%d  b.PR=%.3f  b.range=%.3f  r.PR=%.3f  r.range=%.3f\n",
+            s, base.PR, o.BaseRange, rover.PR, Range(o.SatPos-RoverPos));
+
+	// Calculate the default weights to use.
+	o.CodeWeight = .01;
+	o.PhaseWeight = 1;
+	if (o.ValidCode || o.ValidPhase)
+		Active.Add(s);
+	else
+		obs.Remove(s);
+}
+
+
+void Observations::DebugCode(RawReceiver& base, RawReceiver& rover)
+{
 #ifndef TESTING
 	double bsum = 0;
 	double rsum = 0;
 	int count = 0;
-	for (int s=0; s<MaxSats; s++) {
+	for (int i=0; i<Active.Count(); i++) {
+		int s = Active[i];
 		if (!obs[s].ValidCode) continue;
 		bsum += base.obs[s].PR;
 		rsum += rover.obs[s].PR;
@@ -109,7 +171,8 @@ void Observations::Init(RawReceiver& base, RawReceiver& rover, Ephemerides& eph)
 	double bavg = bsum / count;
 	double ravg = rsum / count;
 
-	for (int s=0; s<MaxSats; s++) {
+	for (int i=0; i<Active.Count(); i++) {
+		int s = Active[i];
 		if (!obs[s].ValidCode) continue;
 
 	    debug("Observations s=%d  base=%.3f  rover=%.3f  dPR=%.3f\n",
@@ -117,7 +180,29 @@ void Observations::Init(RawReceiver& base, RawReceiver& rover, Ephemerides& eph)
 			   (base.obs[s].PR-bavg) - (rover.obs[s].PR-ravg) );
 	}
 #endif
+}
 
+
+void Observations::FindActive()
+// Rebuild the list of satellites from the Valid flags.
+//   Needed only when the observations are filled in by hand rather than by Init().
+{
+	Active.Clear();
+	for (int i=0; i<obs.Count(); i++)
+		if (obs[obs.Sat(i)].ValidCode || obs[obs.Sat(i)].ValidPhase)
+			Active.Add(obs.Sat(i));
+}
+
+
+Observations& Observations::operator=(Observations& src)
+{
+	ErrCode = src.ErrCode;
+	obs = src.obs;
+	Active = src.Active;
+	BasePos = src.BasePos;
+	RoverPos = src.RoverPos;
+	GpsTime = src.GpsTime;
+	return *this;
 }
 
 		
@@ -21,11 +21,14 @@
 
 #include "RawReceiver.h"
 #include "Ephemeris.h"
+#include "BaseEpoch.h"
 
 struct Observation
 {
 	// Satellite info
 	Position SatPos;
+	Position BaseOffset;   // base position - satellite position
+	double BaseRange;
 	bool ValidCode;
 	bool ValidPhase;
 	bool Slip;
@@ -39,13 +42,18 @@ struct Observation
 	double PR;
 
 	int Sat;  // more for debugging than any computational need
+
+	Observation()
+		: SatPos(0), BaseOffset(0), BaseRange(0), ValidCode(false), ValidPhase(false), Slip(true), Sat(-1)
+	{}
 };
 
 class Observations
 {
 public:
 	bool ErrCode;
-	Observation obs[MaxSats];
+	SatArray<Observation, MaxInView> obs;
+	SatSet Active;     // satellites which may have valid code or phase
 	Position BasePos;
 	Position RoverPos;
 	Time GpsTime;
@@ -54,10 +62,18 @@ public:
 	Observations();
 	Observations(RawReceiver& base, RawReceiver& rover, Ephemerides& eph);
 	void Init(RawReceiver&  base, RawReceiver& rover, Ephemerides& eph);
-	inline Observation& operator[](int sat) {return obs[sat];}
+	void Init(BaseEpoch& base, RawReceiver& rover);
+	void FindActive();
+	inline const Observation& operator[](int sat) const {return obs[sat];}
+	inline Observation& Entry(int sat) {return obs.Entry(sat);}
 	inline bool GetError(){return ErrCode;}
 	Observations& operator=(Observations& obs);
 	virtual ~Observations();
+
+private:
+	void Empty();
+	void Difference(int s, const RawObservation& base, const RawObservation& rover);
+	void DebugCode(RawReceiver& base, RawReceiver& rover);
 };
 
 
@@ -25,9 +25,10 @@ bool Policy::SelectSatellites(Observations& obs, Observations& prev)
 	GpsTime = obs.GpsTime;
 
 	// do for each satellite
-	for (int s=0; s<MaxSats; s++) {
-		Observation& o = obs[s];
-		Observation& p = prev[s];
+	double Elev[MaxSats];
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		Observation& o = obs.Entry(s);
 
 		// Ignore satellites with no data
 		if (!o.ValidCode && !o.ValidPhase) continue;
@@ -37,6 +38,7 @@ bool Policy::SelectSatellites(Observations& obs, Observations& prev)
 		Position& pos = obs.BasePos;
 		Position satpos = o.SatPos - pos;
 		double SinElev = (pos * satpos) / ( Range(pos) * Range(satpos));
+		Elev[s] = SinElev;
 	        debug("Select: s=%d SinElev=%.3f  SinMinElev=%.3f  ValidCode=%d ValidPhase=%d\n", 
 			s,SinElev, SinMinElev, o.ValidCode, o.ValidPhase);
 		if (SinElev < SinMinElev)
@@ -47,25 +49,41 @@ bool Policy::SelectSatellites(Observations& obs, Observations& prev)
 			o.ValidPhase = false;
 	}
 
+	// A solution has room for MaxChannels satellites. Keep the highest.
+	for (;;) {
+		int count = 0; int lowest = -1;
+		for (int i=0; i<obs.Active.Count(); i++) {
+			int s = obs.Active[i];
+			if (!obs[s].ValidCode && !obs[s].ValidPhase) continue;
+			count++;
+			if (lowest == -1 || Elev[s] < Elev[lowest]) lowest = s;
+		}
+		if (count <= MaxChannels) break;
+		obs.Entry(lowest).ValidCode = obs.Entry(lowest).ValidPhase = false;
+	}
+
 	// Make sure the satellites have consistent code and phase
 	CheckCodePhase(obs, prev);
 
 	// Don't use any satellites that have been marked as bad
-	for (int s=0; s<MaxSats; s++) {
-		Observation&o = obs[s];
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		Observation&o = obs.Entry(s);
 		if (SelectTime[s] >= obs.GpsTime)
 			o.ValidCode = o.ValidPhase = false;
 	}
 
       // We want at least 4 satellites
       int PhaseCount = 0; int CodeCount = 0;
-      for (int s=0; s<MaxSats; s++) {
+      for (int i=0; i<obs.Active.Count(); i++) {
+          int s = obs.Active[i];
           if (obs[s].ValidPhase) PhaseCount++;
           if (obs[s].ValidCode)  CodeCount++;
       }
-      for (int s=0; s<MaxSats; s++) {
-          if (PhaseCount < 4 || CodeCount < 4)  obs[s].ValidPhase = false;
-          if (CodeCount < 4)                    obs[s].ValidCode = false;
+      for (int i=0; i<obs.Active.Count(); i++) {
+          int s = obs.Active[i];
+          if (PhaseCount < 4 || CodeCount < 4)  obs.Entry(s).ValidPhase = false;
+          if (CodeCount < 4)                    obs.Entry(s).ValidCode = false;
       }
 
 	return OK;
@@ -77,15 +95,29 @@ bool Policy::Acceptable(Observations& obs, Solution& sol)
 	// If we didn't find any solution, then done.
 	if (sol.GetCep() == -1)  return false;
 
+	return Fits(obs, sol);
+}
+
+bool Policy::Acceptable(Observations& obs, Influence& inf)
+// Same as above, but using the solution predicted after Influence::Predict()
+{
+	return Fits(obs, inf);
+}
+
+template <class Residuals>
+bool Policy::Fits(Observations& obs, Residuals& r)
+// Check the fit and residuals from either a solution or a prediction
+{
     // If overall residuals jumped significantly, then not acceptable
-	if (sol.GetFit() > FitThreshhold) return false;
+	if (r.GetFit() > FitThreshhold) return false;
 
 	// If individual residuals are out of bounds, then not acceptable.
-	for (int s=0; s<MaxSats; s++) {
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
 		if (obs[s].ValidCode)
-			if (sol.GetCodeResidual(s) > CodeResidualThreshhold) return false;
+			if (r.GetCodeResidual(s) > CodeResidualThreshhold) return false;
 		if (obs[s].ValidPhase)
-			if (sol.GetPhaseResidual(s) > PhaseResidualThreshhold) return false;
+			if (r.GetPhaseResidual(s) > PhaseResidualThreshhold) return false;
 	}
 
 	return true;
@@ -106,7 +138,7 @@ void Policy::MarkBad(Observations& obs, int sat)
 	// TODO: we want to use current time, not previous time.
 	debug("Checker::MarkBad: sat=%d  Delay=%.1f\n", sat, S(Delay));
 	//SelectTime[sat] = GpsTime + Delay;
-	obs[sat].ValidCode = obs[sat].ValidPhase = false;
+	obs.Entry(sat).ValidCode = obs.Entry(sat).ValidPhase = false;
 }
 
 
@@ -128,7 +160,7 @@ void Policy::CheckCodePhase(Observations& obs, Observations& prev)
 
 		// Remove the worst satellite
 		//MarkBad(obs, WorstSat);
-            obs[WorstSat].ValidPhase = false;
+            obs.Entry(WorstSat).ValidPhase = false;
 		Event("Inconsistent code/phase on s=%d  delta=%.3f\n", WorstSat, WorstDelta);
 	}
 }
@@ -146,9 +178,10 @@ void Policy::FindWorst(Observations& obs, Observations& prev,
 	int count=0; double TotalDelta=0;
 
     // Do for each selected satellite
-	for (int s=0; s<MaxSats; s++) {
-		Observation& p = prev[s];
-		Observation& o = obs[s];
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		const Observation& p = prev[s];
+		const Observation& o = obs[s];
 
 		// Skip satellites which aren't candidates
 		if (!o.ValidCode || !o.ValidPhase || !p.ValidCode || !p.ValidPhase || o.Slip)
@@ -26,6 +26,7 @@ public:
 	Policy();
 	bool SelectSatellites(Observations& obs, Observations& previous);
 	bool Acceptable(Observations& obs, Solution& sol);
+	bool Acceptable(Observations& obs, Influence& inf);
 	bool EliminateWorst(Observations& obs, Solution& sol);
 	void MarkBad(Observations& obs, int sat);
 	virtual ~Policy();
@@ -34,6 +35,8 @@ private:
 	void CheckCodePhase(Observations& obs, Observations& prev);
 	void FindWorst(Observations& obs, Observations& prev, 
 			   int& WorstSat, double& WorstDelta);
+	template <class Residuals>
+	bool Fits(Observations& obs, Residuals& r);
 };
 
 
@@ -0,0 +1,236 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+//
+////////////////////////////////////////////////////////////////////////////
+//
+// The records are laid out as follows.
+//
+//   Epoch:      header, time, positions, cep, fit, number of phase columns,
+//               the arc in each phase column, the rows of R for X, Y and Z
+//               (packed as a triangle, starting at X), and their right hand side.
+//               An epoch without a solution has -1 phase columns and no rows.
+//   Drop:       header, arc, the arc's ambiguity as it ends.
+//   Reference:  header, the new reference's arc, its ambiguity relative
+//               to the old reference.
+//
+// Working backward, the ambiguities are kept relative to the reference of
+//   the record being looked at. Changing the reference adds the same amount
+//   to every ambiguity, so they are stored less an offset which is updated
+//   once per reference change.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "Smoother.h"
+
+// The file grows at least this much at a time
+static const uint64 MinGrowth = 1024*1024;
+
+struct Smoother::EpochData
+{
+	Header Head;
+	Time T;
+	Position Base;         // the position the equations are relative to
+	Position Smoothed;     // forward position, replaced by the backward pass
+	double Cep, Fit;
+	int32 NrPhases;
+	int32 Unused;
+	// followed by int32 arcs[NrPhases], padded to a double
+	//   then double R[6+3*NrPhases], B[3]
+};
+
+static inline size_t Round8(size_t size) {return (size + 7) & ~(size_t)7;}
+static inline size_t ArcsSize(int n) {return Round8(max(n,0)*sizeof(int32));}
+static inline size_t RowsSize(int n) {return n < 0? 0: (6+3*n + 3)*sizeof(double);}
+
+
+Smoother::Smoother(const char* name)
+{
+	End = 0;  Last = NoRecord;
+	NrArcs = 0;  NrEpochs = 0;
+	Cursor = 0;
+	ErrCode = File.Create(name);
+}
+
+
+byte* Smoother::Append(int type, size_t size)
+// Make room for a new record at the end, and fill in its header
+{
+	size = Round8(size);
+	if (End + size > File.Size) {
+		uint64 grow = max(End+size, max((uint64)File.Size*2, MinGrowth));
+		if (File.Resize(grow) != OK) return NULL;
+	}
+
+	Header* h = Record(End);
+	h->Type = type;  h->Size = size;  h->Prev = Last;
+	Last = End;
+	End += size;
+	return (byte*)h;
+}
+
+
+bool Smoother::Epoch(Time t, Position& base, Position& pos, double cep, double fit,
+					 int n, int* arcs, double* r, double* b)
+// Save an epoch's position equations. n is -1 if there is no solution.
+{
+	byte* p = Append(EpochRecord, sizeof(EpochData) + ArcsSize(n) + RowsSize(n));
+	if (p == NULL) return Error();
+
+	EpochData* e = (EpochData*)p;
+	e->T = t;  e->Base = base;  e->Smoothed = pos;  e->Cep = cep;  e->Fit = fit;
+	e->NrPhases = n;
+	NrEpochs++;
+	if (n < 0) return OK;
+
+	int32* a = (int32*)(p + sizeof(EpochData));
+	for (int i=0; i<n; i++)
+		a[i] = arcs[i];
+
+	double* d = (double*)(p + sizeof(EpochData) + ArcsSize(n));
+	for (int i=0; i<6+3*n; i++)
+		*d++ = r[i];
+	for (int i=0; i<3; i++)
+		*d++ = b[i];
+
+	return OK;
+}
+
+
+bool Smoother::Drop(int arc, double value)
+{
+	byte* p = Append(DropRecord, sizeof(Header) + sizeof(int32) + sizeof(double));
+	if (p == NULL) return Error();
+	*(int32*)(p + sizeof(Header)) = arc;
+	*(double*)(p + sizeof(Header) + 8) = value;
+	return OK;
+}
+
+
+bool Smoother::Reference(int arc, double value)
+{
+	byte* p = Append(ReferenceRecord, sizeof(Header) + sizeof(int32) + sizeof(double));
+	if (p == NULL) return Error();
+	*(int32*)(p + sizeof(Header)) = arc;
+	*(double*)(p + sizeof(Header) + 8) = value;
+	return OK;
+}
+
+
+bool Smoother::Smooth()
+// Working backward, back substitute each epoch's position using the final ambiguities
+{
+	debug("Smoother::Smooth  NrEpochs=%d  NrArcs=%d  Size=%llu\n",
+		NrEpochs, NrArcs, (unsigned long long)End);
+	double* value = new double[NrArcs+1];
+	bool* known = new bool[NrArcs+1];
+	for (int i=0; i<=NrArcs; i++) {
+		value[i] = 0;  known[i] = false;
+	}
+	double offset = 0;
+
+	for (uint64 p = Last; p != NoRecord; p = Record(p)->Prev) {
+		byte* rec = (byte*)Record(p);
+		int type = Record(p)->Type;
+
+		// An arc ends. Its ambiguity is relative to the current reference.
+		if (type == DropRecord) {
+			int arc = *(int32*)(rec + sizeof(Header));
+			value[arc] = *(double*)(rec + sizeof(Header) + 8) - offset;
+			known[arc] = true;
+			continue;
+		}
+
+		// The reference changes. Going back, every ambiguity gains the new
+		//   reference's ambiguity relative to the old, and the new reference becomes one.
+		if (type == ReferenceRecord) {
+			int arc = *(int32*)(rec + sizeof(Header));
+			double v = *(double*)(rec + sizeof(Header) + 8);
+			offset += v;
+			value[arc] = v - offset;
+			known[arc] = true;
+			continue;
+		}
+
+		EpochData* e = (EpochData*)rec;
+		int n = e->NrPhases;
+		if (n < 0) continue;
+		int32* arcs = (int32*)(rec + sizeof(EpochData));
+		double* r = (double*)(rec + sizeof(EpochData) + ArcsSize(n));
+		double* b = r + 6+3*n;
+
+		// Move the ambiguities to the right hand side. Keep the forward position if any are missing.
+		double rx = r[0],        rxy = r[1],      rxz = r[2];
+		double ry = r[3+n],      ryz = r[4+n];
+		double rz = r[5+2*n];
+		double* ra[3] = {r+3, r+5+n, r+6+2*n};
+		double rhs[3] = {b[0], b[1], b[2]};
+		bool ok = (rx != 0 && ry != 0 && rz != 0);
+		for (int i=0; i<n && ok; i++) {
+			if (!known[arcs[i]]) {ok = false; break;}
+			double a = value[arcs[i]] + offset;
+			for (int k=0; k<3; k++)
+				rhs[k] -= ra[k][i] * a;
+		}
+		if (!ok) continue;
+
+		double z = rhs[2] / rz;
+		double y = (rhs[1] - ryz*z) / ry;
+		double x = (rhs[0] - rxy*y - rxz*z) / rx;
+		e->Smoothed = Position(e->Base.x + x, e->Base.y + y, e->Base.z + z);
+	}
+
+	delete[] value;
+	delete[] known;
+	return OK;
+}
+
+
+void Smoother::Rewind()
+{
+	Cursor = 0;
+	Skip();
+}
+
+
+bool Smoother::NextEpoch(Time& t, Position& pos, double& cep, double& fit)
+// Get the next epoch's smoothed position. cep is -1 if the epoch had no solution.
+{
+	if (Done()) return Error("Smoother::NextEpoch - no more epochs\n");
+	EpochData* e = (EpochData*)Record(Cursor);
+	t = e->T;  pos = e->Smoothed;  cep = e->Cep;  fit = e->Fit;
+	Cursor += e->Head.Size;
+	Skip();
+	return OK;
+}
+
+
+void Smoother::Skip()
+// Move the cursor to the next epoch
+{
+	while (Cursor < End && Record(Cursor)->Type != EpochRecord)
+		Cursor += Record(Cursor)->Size;
+}
+
+
+Smoother::~Smoother()
+{
+	// Trim the unused space off the end
+	if (File.Size > End)
+		File.Resize(End);
+}
@@ -0,0 +1,100 @@
+#ifndef SMOOTHER_INCLUDED
+#define SMOOTHER_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Util.h"
+#include "MappedFile.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// Smoother - improves earlier positions using the final ambiguities.
+//
+//   On the way forward, each epoch stores the rows of R belonging to
+//   X, Y and Z, which are all that is needed to back substitute the
+//   position once the ambiguities are known. The ambiguity columns are
+//   labelled by "arc", a satellite tracked without a slip.
+//
+//   Ambiguities are relative to the reference satellite, so the store also
+//   records the value of each arc as it ends, and the new reference's value
+//   whenever the reference changes. The backward pass replays these in
+//   reverse, keeping every arc's best value relative to the reference
+//   of the epoch being smoothed.
+//
+//   The records go to a memory mapped file, so a long session is limited
+//   by disk rather than by memory. Trial solutions never write here;
+//   GpsEquations holds back its records until a solution is kept.
+//
+///////////////////////////////////////////////////////////////////
+
+class Smoother
+{
+protected:
+	// Each record starts with a header and links back to the one before it
+	enum {EpochRecord, DropRecord, ReferenceRecord};
+	struct Header {
+		int32 Type;
+		int32 Size;
+		uint64 Prev;
+	};
+
+	MappedFile File;
+	uint64 End;          // where the next record goes
+	uint64 Last;         // the most recent record, or NoRecord
+	int NrArcs;          // arcs numbered so far
+	int NrEpochs;
+
+	// Position while reading the smoothed epochs
+	uint64 Cursor;
+	bool ErrCode;
+
+	static const uint64 NoRecord = ~(uint64)0;
+
+public:
+	Smoother(const char* name);
+
+	// The forward pass
+	int NewArc() {return NrArcs++;}
+	bool Epoch(Time t, Position& base, Position& pos, double cep, double fit,
+		       int nphases, int* arcs, double* r, double* b);
+	bool Drop(int arc, double value);
+	bool Reference(int arc, double value);
+
+	// The backward pass
+	bool Smooth();
+
+	// Read the smoothed positions in order
+	void Rewind();
+	bool Done() {return Cursor >= End;}
+	bool NextEpoch(Time& t, Position& pos, double& cep, double& fit);
+
+	int GetNrEpochs() {return NrEpochs;}
+	uint64 GetSize() {return End;}
+	bool GetError() {return ErrCode;}
+	virtual ~Smoother();
+
+protected:
+	struct EpochData;
+	byte* Append(int type, size_t size);
+	Header* Record(uint64 offset) {return (Header*)(File.Data + offset);}
+	void Skip();
+};
+
+#endif // SMOOTHER_INCLUDED
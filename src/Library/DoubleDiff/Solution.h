@@ -1,8 +1,22 @@
 #ifndef SOLUTION_INCLUDED
 #define SOLUTION_INCLUDED
 
-#include "GpsEquations.h"
 #include "Observations.h"
+#include "Influence.h"
+#include "Smoother.h"
+
+//////////////////////////////////////////////////////////////////
+//
+// Solution - what DoubleDiff, the trials and the checks need from a way
+//   of solving for the rover's position.
+//
+//   Both ways work from the single differences at the current rover position,
+//   so those are kept here, along with the log which lets a trial roll them back.
+//   The equations themselves belong to the subclass:
+//      LeastSquaresSolution - the accumulated least squares equations
+//      KalmanSolution       - an extended Kalman filter
+//
+///////////////////////////////////////////////////////////////////
 
 class Solution
 {
@@ -10,8 +24,6 @@ protected:
 	// Basic geometry
 	Position RoverPos;
 	Position BasePos;
-	double CodeClock;
-	double PhaseClock;
 
 	// Single difference equations
 	Triple e[MaxSats];
@@ -21,37 +33,55 @@ protected:
 	// Reference satellite used for double differencing
 	int ReferenceSat;
 
-	// The resulting linear gps equations
-	GpsEquations eqn;
+	// Checkpoint for trial solutions. The single differences are logged
+	//   as they are overwritten, so rolling back only restores what changed.
+	bool Saved;
+	Position SavedRoverPos;
+	int SavedReferenceSat;
+	int NrLogged;
+	int LogSat[MaxSats];
+	Triple LogE[MaxSats];
+	double LogCodeB[MaxSats], LogPhaseB[MaxSats];
+	bool Logged[MaxSats];
 
 
 public:
 	Solution(Position& basepos, Position& roverpos);
-	bool NewPosition(Position& pos);
-	bool Update(Observations& obs, Position& pos, double& cep, double& fit);
-	bool Reset();
+	virtual bool NewPosition(Position& pos) = 0;
+	virtual bool Update(Observations& obs, Position& pos, double& cep, double& fit) = 0;
+	virtual bool Reset() = 0;
+
+	virtual Position GetPosition() = 0;
+	virtual double GetCep() = 0;
+	virtual double GetFit() = 0;
+	virtual double GetCodeResidual(int sat) = 0;
+	virtual double GetPhaseResidual(int sat) = 0;
+	virtual bool GetInfluence(Observations& obs, Influence& inf) = 0;
+
+	// Trial solutions
+	virtual bool Checkpoint() = 0;
+	virtual bool Rollback() = 0;
+	virtual bool Commit() = 0;
+
+	// A copy for working on trial solutions elsewhere
+	virtual Solution* Clone() = 0;
 
-	Position GetPosition();
-	double GetCep();
-	double GetFit() {return eqn.GetFit();}
-	double GetCodeResidual(int sat);
-	double GetPhaseResidual(int sat);
+	// Become a copy of src, reusing our own storage. False if src is a different kind.
+	virtual bool CopyFrom(Solution& src) = 0;
+
+	// Save each epoch so the positions can be smoothed afterward
+	virtual bool Record(Smoother* store);
+	virtual bool SaveEpoch(Time t, Position& pos, double cep, double fit);
+	virtual bool EndRecording();
 
 	virtual ~Solution();
 
-private:
-	bool AppendDoubleDifference(Observations& obs);
-	bool AppendDoublePhase(Observations& obs);
-	bool AppendDoubleCode(Observations& obs);
-	bool UpdateSatellites(Observations& obs);
-	bool Solve(Position& pos, double& cep, double& fit);
-	bool SingleDifference(Observation& o, Triple& e, double& CodeB, double& PhaseB);
-
-	bool DropReference(Observations& obs);
-	bool PickNewReference(Observations& obs);
-	int  BestReference(Observations& obs);
+protected:
+	bool SingleDifference(const Observation& o, Triple& e, double& CodeB, double& PhaseB);
+	void Log(int sat);
+	void UndoLog();
+	void ClearLog();
 };
 
 
 #endif // SOLUTION_INCLUDED
-
@@ -0,0 +1,202 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "TrialPool.h"
+
+
+TrialPool::TrialPool(Policy& check, int workers)
+: Check(check)
+{
+	NrWorkers = max(1, min(workers, (int)MaxChannels));
+	Launched = false;
+	Threaded = false;
+	Quit = false;
+	Reset();
+}
+
+
+void TrialPool::Launch()
+// Create the workers the first time there are trials to do.
+//   Most solutions never need an exhaustive search, so they never pay for threads.
+{
+	Launched = true;
+	for (int w=0; w<NrWorkers; w++)
+		Worker[w] = new TrialWorker(*this);
+
+	// Start the worker threads. If we can't, do the trials ourselves.
+	if (NrWorkers == 1) return;
+	int started;
+	for (started=0; started<NrWorkers; started++)
+		if (Worker[started]->Start() != OK) break;
+	Threaded = (started == NrWorkers);
+	if (!Threaded) {
+		Quit = true;
+		for (int w=0; w<started; w++) {
+			Worker[w]->Wake();
+			Worker[w]->Join();
+		}
+	}
+	debug("TrialPool: workers=%d  Threaded=%d\n", NrWorkers, Threaded);
+}
+
+
+void TrialPool::Reset()
+{
+	NrCandidates = 0;
+}
+
+
+void TrialPool::Add(int sat1, int sat2)
+{
+	assert(NrCandidates < MaxCandidates);
+	Sat1[NrCandidates] = sat1;
+	Sat2[NrCandidates] = sat2;
+	NrCandidates++;
+}
+
+
+bool TrialPool::Run(Solution& sol, Observations& obs)
+// Solve with each candidate left out, starting from the given solution.
+{
+	debug("TrialPool::Run  candidates=%d  Threaded=%d\n", NrCandidates, Threaded);
+	if (!Launched) Launch();
+	Start = &sol;  StartObs = &obs;
+	Next = 0;
+
+	if (!Threaded) {
+		Worker[0]->Begin();
+		for (int i = NextCandidate(); i != -1; i = NextCandidate())
+			Worker[0]->Try(i);
+	}
+
+	else {
+		for (int w=0; w<NrWorkers; w++)
+			Worker[w]->Wake();
+		for (int w=0; w<NrWorkers; w++)
+			Done.Wait();
+	}
+
+	for (int i=0; i<NrCandidates; i++)
+		if (Failed[i])
+			return Error("TrialPool::Run - unable to solve without %d and %d\n", Sat1[i], Sat2[i]);
+	return OK;
+}
+
+
+int TrialPool::NextCandidate()
+{
+	Lock.Lock();
+	int i = Next;
+	if (i < NrCandidates) Next++;
+	else                  i = -1;
+	Lock.Unlock();
+	return i;
+}
+
+
+TrialPool::~TrialPool()
+{
+	if (Threaded) {
+		Quit = true;
+		for (int w=0; w<NrWorkers; w++)
+			Worker[w]->Wake();
+		for (int w=0; w<NrWorkers; w++)
+			Worker[w]->Join();
+	}
+	if (Launched)
+		for (int w=0; w<NrWorkers; w++)
+			delete Worker[w];
+}
+
+
+
+
+TrialWorker::TrialWorker(TrialPool& pool)
+: Pool(pool)
+{
+	Sol = NULL;
+}
+
+
+void TrialWorker::Run()
+{
+	for (;;) {
+
+		// Wait for a batch of candidates
+		Go.Wait();
+		if (Pool.Quit) return;
+
+		// Work on candidates until there are none left
+		Begin();
+		for (int i = Pool.NextCandidate(); i != -1; i = Pool.NextCandidate())
+			Try(i);
+		Pool.Done.Wake();
+	}
+}
+
+
+void TrialWorker::Begin()
+// Make our own copy of the starting point, reusing the last one if it is the same kind
+{
+	if (Sol == NULL || !Sol->CopyFrom(*Pool.Start)) {
+		delete Sol;
+		Sol = Pool.Start->Clone();
+	}
+	Obs = *Pool.StartObs;
+	Sol->Checkpoint();
+}
+
+
+void TrialWorker::Try(int i)
+// Solve without the candidate's satellites, then roll back
+{
+	int s = Pool.Sat1[i];  int t = Pool.Sat2[i];
+	debug("TrialWorker::Try - experimentally dropping %d and %d\n", s, t);
+
+	// do a temporary reconfiguration without the satellites
+	bool oldphases = Obs[s].ValidPhase; Obs.Entry(s).ValidPhase = false;
+	bool oldcodes  = Obs[s].ValidCode;  Obs.Entry(s).ValidCode = false;
+	bool oldphaset, oldcodet;
+	if (t != -1) {
+		oldphaset = Obs[t].ValidPhase; Obs.Entry(t).ValidPhase = false;
+		oldcodet  = Obs[t].ValidCode;  Obs.Entry(t).ValidCode = false;
+	}
+
+	Position pos; double cep; double fit = 0;
+	Pool.Failed[i] = Sol->Update(Obs, pos, cep, fit) != OK;
+	Pool.Acceptable[i] = !Pool.Failed[i] && Pool.Check.Acceptable(Obs, *Sol);
+	Pool.Fit[i] = fit;
+
+	// Undo the temporary reconfiguration
+	if (Sol->Rollback() != OK) Pool.Failed[i] = true;
+	Obs.Entry(s).ValidPhase = oldphases;
+	Obs.Entry(s).ValidCode = oldcodes;
+	if (t != -1) {
+		Obs.Entry(t).ValidPhase = oldphaset;
+		Obs.Entry(t).ValidCode = oldcodet;
+	}
+
+	// Only the failure is reported, so drop this thread's messages
+	if (Pool.Failed[i]) ClearError();
+}
+
+
+TrialWorker::~TrialWorker()
+{
+	delete Sol;
+}
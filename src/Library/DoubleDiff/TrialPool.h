@@ -0,0 +1,105 @@
+#ifndef TRIALPOOL_INCLUDED
+#define TRIALPOOL_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Thread.h"
+#include "Solution.h"
+#include "Policy.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// TrialPool - solves with each candidate satellite (or pair) left out,
+//   spreading the candidates over a set of worker threads.
+//
+//   Each worker starts from its own copy (clone) of the solution and observations,
+//   so the trials don't interfere with each other or with the caller.
+//   Results are stored by candidate, so the caller can pick the best one
+//   in the same order as a serial search would.
+//
+//   The workers are created the first time there are trials to run.
+//   With a single worker, or if the threads can't be started, the
+//   candidates are tried in the caller's thread.
+//
+///////////////////////////////////////////////////////////////////
+
+static const int MaxCandidates = MaxChannels*(MaxChannels-1)/2;
+
+class TrialPool;
+
+class TrialWorker: public Thread
+{
+protected:
+	TrialPool& Pool;
+	Solution* Sol;
+	Observations Obs;
+	Semaphore Go;
+
+public:
+	TrialWorker(TrialPool& pool);
+	void Begin();
+	void Try(int i);
+	void Wake() {Go.Wake();}
+	virtual ~TrialWorker();
+
+protected:
+	virtual void Run();
+};
+
+
+class TrialPool
+{
+public:
+	// The candidates, and what happened when each was left out
+	int NrCandidates;
+	int Sat1[MaxCandidates], Sat2[MaxCandidates];
+	bool Acceptable[MaxCandidates];
+	double Fit[MaxCandidates];
+	bool Failed[MaxCandidates];
+
+protected:
+	Policy& Check;
+	Solution* Start;
+	Observations* StartObs;
+	int NrWorkers;
+	TrialWorker* Worker[MaxChannels];
+	bool Launched;
+	bool Threaded;
+	bool Quit;
+
+	// Handing out candidates to the workers
+	Mutex Lock;
+	int Next;
+	Semaphore Done;
+
+public:
+	TrialPool(Policy& check, int workers);
+	void Reset();
+	void Add(int sat1, int sat2=-1);
+	bool Run(Solution& sol, Observations& obs);
+	virtual ~TrialPool();
+
+protected:
+	friend class TrialWorker;
+	void Launch();
+	int NextCandidate();
+};
+
+#endif // TRIALPOOL_INCLUDED
@@ -0,0 +1,127 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "BestEphemerides.h"
+
+// Provides the orbit when no source is valid
+static EphemerisDummy None(-1, "No Ephemeris");
+
+
+BestEphemerides::BestEphemerides()
+{
+	NrSources = 0;
+}
+
+
+bool BestEphemerides::Add(Ephemerides& source)
+{
+	if (NrSources >= MaxSources) return Error("BestEphemerides: too many sources\n");
+	Sources[NrSources++] = &source;
+
+	// Every satellite the source knows about gets a composite ephemeris
+	for (int s=0; s<MaxSats; s++)
+		if (source.eph[s] != NULL && eph[s] == NULL)
+			eph[s] = new EphemerisBest(s, *this);
+
+	return OK;
+}
+
+
+BestEphemerides::~BestEphemerides()
+{
+}
+
+
+
+EphemerisBest::EphemerisBest(int sat, BestEphemerides& owner)
+: Ephemeris(sat, "Best Available"), Owner(owner)
+{
+	Chosen = NULL;
+	ChosenAt = 0;
+	Signature = 0;
+}
+
+
+uint32 EphemerisBest::Sign()
+// Changes whenever a source is added or one of them has a new orbit
+{
+	uint32 sig = Owner.NrSources;
+	for (int i=0; i<Owner.NrSources; i++) {
+		Ephemeris* e = Owner.Sources[i]->eph[SatIndex];
+		if (e != NULL)
+			sig = sig*31 + e->Issue;
+	}
+	return sig;
+}
+
+
+void EphemerisBest::Choose(Time t)
+// Pick the valid source with the best accuracy
+{
+	Chosen = NULL;
+	double best = INFINITY;
+	for (int i=0; i<Owner.NrSources; i++) {
+		Ephemeris* e = Owner.Sources[i]->eph[SatIndex];
+		if (e == NULL || !e->Valid(t)) continue;
+		double acc = e->Accuracy(t);
+		if (Chosen == NULL || acc < best) {
+			Chosen = e;
+			best = acc;
+		}
+	}
+
+	ChosenAt = t;
+	Signature = Sign();
+	debug(2, "EphemerisBest::Choose  s=%d  t=%.0f  chose %s\n", SatIndex, S(t),
+		Chosen == NULL? "nothing": Chosen->Description);
+}
+
+
+Ephemeris& EphemerisBest::Provider(Time t)
+{
+	// Keep the previous choice if nothing has changed
+	if (abs(t - ChosenAt) > Recheck || Signature != Sign()
+		|| (Chosen != NULL && !Chosen->Valid(t)))
+		Choose(t);
+
+	if (Chosen == NULL) return None;
+	return *Chosen;
+}
+
+
+bool EphemerisBest::SatPos(Time t, Position& XmitPos, double& Adjust)
+{
+	return Provider(t).SatPos(t, XmitPos, Adjust);
+}
+
+
+double EphemerisBest::Accuracy(Time t)
+{
+	return Provider(t).Accuracy(t);
+}
+
+
+bool EphemerisBest::Valid(Time t)
+{
+	return Provider(t).Valid(t);
+}
+
+
+EphemerisBest::~EphemerisBest()
+{
+}
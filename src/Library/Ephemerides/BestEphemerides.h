@@ -0,0 +1,80 @@
+#ifndef BESTEPHEMERIDES_INCLUDED
+#define BESTEPHEMERIDES_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Ephemeris.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// BestEphemerides - the best of several ephemeris sources.
+//
+//   Sources are added in order of preference, typically precise orbits
+//   followed by the broadcast orbits from the base and the rover.
+//   For each satellite and time, the source which is valid and claims
+//   the best accuracy provides the orbit. Ties go to the earlier source.
+//
+//   Each satellite remembers its choice. The sources are only compared
+//   again when the time moves on by Recheck, when the choice stops
+//   being valid, or when one of the sources has a new orbit.
+//
+//   Only one thread at a time may use it.
+//
+///////////////////////////////////////////////////////////////////
+
+class BestEphemerides : public Ephemerides
+{
+public:
+	static const int MaxSources = 8;
+	int NrSources;
+	Ephemerides* Sources[MaxSources];
+
+public:
+	BestEphemerides();
+	bool Add(Ephemerides& source);
+	virtual ~BestEphemerides();
+};
+
+
+class EphemerisBest : public Ephemeris
+{
+protected:
+	BestEphemerides& Owner;
+	Ephemeris* Chosen;      // the current choice, NULL if none
+	Time ChosenAt;          // when it was chosen
+	uint32 Signature;       // the sources' Issues when it was chosen
+
+	static const Time Recheck = NsecPerMinute;
+
+public:
+	EphemerisBest(int sat, BestEphemerides& owner);
+	virtual ~EphemerisBest();
+
+	virtual Ephemeris& Provider(Time t);
+	virtual bool SatPos(Time t, Position& XmitPos, double& Adjust);
+	virtual double Accuracy(Time t);
+	virtual bool Valid(Time t);
+
+protected:
+	uint32 Sign();
+	void Choose(Time t);
+};
+
+#endif // BESTEPHEMERIDES_INCLUDED
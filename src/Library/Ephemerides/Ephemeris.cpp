@@ -39,6 +39,7 @@ Ephemeris::Ephemeris(int Sat, const char* description)
     ErrCode = Error();
     SatIndex = Sat;
     Description = description;
+    Issue = 0;
 }
 
 Ephemeris::~Ephemeris()
@@ -53,6 +54,46 @@ Ephemerides::Ephemerides()
         eph[s] = NULL;
 }
 
+Ephemeris& Ephemerides::operator[](int s)
+// Only the satellites a source can provide have ephemerides.
+//   The rest share a dummy which is never valid.
+{
+	static EphemerisDummy None(-1, "No Ephemeris");
+	if (eph[s] == NULL) return None;
+	return *eph[s];
+}
+
+bool Ephemerides::SatPos(int s, Time t, Position& pos, double& adjust)
+{
+	return Cache.SatPos((*this)[s], s, t, pos, adjust);
+}
+
+
+bool Ephemerides::SatPos(int s, Time t, Position& receiver, Position& pos, double& adjust)
+{
+	if (Cache.SatPos((*this)[s], s, t, pos, adjust) != OK) return Error();
+
+	// Adjust for the earth's rotation while the signal travels to the receiver
+	double TransitTime = Range(pos-receiver) / C;
+	pos = RotateEarth(pos, -TransitTime);
+	return OK;
+}
+
+
+bool Ephemerides::SatPos(int n, const int* sat, const Time* t, Position& receiver,
+						 Position* pos, double* adjust, bool* ok)
+{
+	bool err = Cache.SatPos(*this, n, sat, t, pos, adjust, ok);
+
+	for (int k=0; k<n; k++) {
+		if (!ok[k]) continue;
+		double TransitTime = Range(pos[k]-receiver) / C;
+		pos[k] = RotateEarth(pos[k], -TransitTime);
+	}
+	return err;
+}
+
+
 Ephemerides::~Ephemerides()
 {
     for (int s=0; s<MaxSats; s++) {
@@ -22,6 +22,7 @@
 
 
 #include "Util.h"
+#include "SatPosCache.h"
 
 Position RotateEarth(Position p, double secs);
 
@@ -37,6 +38,12 @@ public:
 	
 	bool GetError() {return ErrCode;}
 
+	// Call whenever the orbit changes, so cached positions are discarded
+	void Changed() {Issue++;}
+
+	// The ephemeris which actually provides the orbit at time t
+	virtual Ephemeris& Provider(Time t) {return *this;}
+
 	virtual void Display(const char* str) 
 	    {debug("Generic Ephemeris [%d] %s  %w\n", SatIndex, str, Description);}
 
@@ -48,6 +55,7 @@ public:
 public:
 	int32 SatIndex;
 	const char* Description;
+	uint32 Issue;          // counts changes to the orbit. See SatPosCache.
 };
 
 class EphemerisDummy: public Ephemeris
@@ -72,10 +80,25 @@ class Ephemerides
 {
 public:
 	Ephemerides();
-	Ephemeris& operator[](int s) {return *eph[s];}
+	Ephemeris& operator[](int s);   // a dummy if the satellite has none
+
+	// The satellite's position, remembered for repeated lookups.
+	//   Given a receiver, the position is corrected for the earth's rotation
+	//   during the signal's transit to it.
+	bool SatPos(int s, Time t, Position& pos, double& adjust);
+	bool SatPos(int s, Time t, Position& receiver, Position& pos, double& adjust);
+
+	// The same for n satellites at once, each at its own time. ok[k] is false
+	//   for a satellite with no position, and then the result is an error.
+	bool SatPos(int n, const int* sat, const Time* t, Position& receiver,
+		        Position* pos, double* adjust, bool* ok);
+
 	virtual ~Ephemerides();
 //protected: needed for simulation. Maybe make it a friend?
 	Ephemeris* eph[MaxSats];
+
+protected:
+	SatPosCache Cache;
 };
 
 
@@ -28,6 +28,10 @@ EphemerisXmit::EphemerisXmit(int Sat, const char* description)
 {
       iode = -1;
       iodc = -1;
+      MinTime = 0;
+      MaxTime = -1;
+      Latest = 0;
+      PreparedToe = -1;  PreparedIode = iode;  PreparedSqrtA = -1;
 }
 
 
@@ -37,82 +41,243 @@ EphemerisXmit::~EphemerisXmit()
 
 bool EphemerisXmit::SatPos(Time xmitTime, Position& XmitPos, double& adjust)
 {
-	if (!Valid(xmitTime))
+	XmitOrbit* orbit = Orbit(xmitTime);
+	if (orbit == NULL)
 		return Error("Ephemeris is not valid\n");
+	XmitOrbit& o = *orbit;
+	Prepare(o);
+	Latest = max(Latest, xmitTime);
 
 	// Calculate the satellite position, as described in ICD200.
-	
-	// Semi-major axis
-	double a = sqrt_a * sqrt_a;
-
-	// Computed mean motion (rad/sec)
-	double n_0 = sqrt(mu)/(a*sqrt_a);
 
 	// time from ephemeris reference epoch
-	double t = S(xmitTime - t_oe);
-
-	// corrected mean motion
-	double n = n_0 + delta_n;
+	double t = S(xmitTime - o.t_oe);
 
 	// mean anomaly
-	double M = m_0 + n*t;
+	double M = o.m_0 + N*t;
 
-	// Calculate E, Ecentric anomaly, using fix point of Kepler's equation
-	double E = M;
-	for (int i=0; i<20; i++) 
-		E = M + e*sin(E);
+	// Ecentric anomaly
+	double E = SolveKepler(M, o.e);
+	double sinE = sin(E), cosE = cos(E);
 
 	// True anomaly
-	double S_nu = sqrt(1-e*e) * sin(E) / (1 - e * cos(E));
-	double c_nu = (cos(E) - e) / (1 - e *cos(E));
+	double S_nu = SqrtOneMinusE2 * sinE / (1 - o.e * cosE);
+	double c_nu = (cosE - o.e) / (1 - o.e * cosE);
 	double nu = atan2(S_nu, c_nu);
-	debug("  S_nu=%.6f  c_nu=%.6f  nu=%.6f\n", S_nu, c_nu, nu);
 
 	// argument of latitude
-	double phi = nu + omega;
+	double phi = nu + o.omega;
+	double sin2phi = sin(2*phi), cos2phi = cos(2*phi);
 
 	// Second harmonic perturbations (latitude, radius, inclination)
-	double du = c_uc*cos(2*phi) + c_us*sin(2*phi);
-	double dr = c_rc*cos(2*phi) + c_rs*sin(2*phi);
-	double di = c_ic*cos(2*phi) + c_is*sin(2*phi);
-	debug("  du=%.6f  dr=%.6f  di=%.6f\n", du, dr, di);
+	double du = o.c_uc*cos2phi + o.c_us*sin2phi;
+	double dr = o.c_rc*cos2phi + o.c_rs*sin2phi;
+	double di = o.c_ic*cos2phi + o.c_is*sin2phi;
 
 	// Corrected latitude, radius, inclination
 	double u = phi + du;
-	double r = a * (1 - e*cos(E)) + dr;
-	double i = i_0 + idot*t + di;
-	debug("  u=%.6f  r=%.6f  i=%.6f\n", u, r, i);
+	double r = A * (1 - o.e*cosE) + dr;
+	double i = o.i_0 + o.idot*t + di;
 
 	// Positions in orbital plane
 	double xdash = r * cos(u);
 	double ydash = r * sin(u);
-	debug("  xdash = %.3f  ydash=%.3f\n", xdash, ydash); 
 
 	// Corrected longitude of ascending node, including transit time
-	double omega_c = omega_0 - GpsTow(t_oe)*OmegaEDot 
-		           + (omegadot - OmegaEDot)*t;
-	debug("omega_c=%g  omega_0=%g  omegadot=%g  OmegaEDot=%g  t=%g Tow=%g\n",
-		omega_c, omega_0, omegadot, OmegaEDot, t, GpsTow(t));
+	double omega_c = OmegaRef + OmegaRate*t;
+	double sinO = sin(omega_c), cosO = cos(omega_c), cosi = cos(i);
 
-	debug("  ToW*OmegaEDot=%.3f  (O-Oe)*t=%.3f\n", GpsTow(t_oe)*OmegaEDot, (omegadot-OmegaEDot)*t);
-	
 	// Earth fixed coordinates
-	XmitPos.x = xdash*cos(omega_c) - ydash*cos(i)*sin(omega_c);
-	XmitPos.y = xdash*sin(omega_c) + ydash*cos(i)*cos(omega_c);
+	XmitPos.x = xdash*cosO - ydash*cosi*sinO;
+	XmitPos.y = xdash*sinO + ydash*cosi*cosO;
 	XmitPos.z = ydash*sin(i);
 
 	// Clock adjustment
-	double tc = S(xmitTime - t_oc);
-     double adjustClock = (  (a_f2 * tc) + a_f1 ) * tc + a_f0;
-	double adjustRelativity = RelativisticConstant * e * sqrt_a * sin(E);
-	adjust = adjustClock + adjustRelativity - t_gd;
-	debug("adjustclock=%g  adjustRelativity=%g t_gd=%g adjust=%g\n",
-		adjustClock,adjustRelativity,t_gd, adjust);
+	double tc = S(xmitTime - o.t_oc);
+	double adjustClock = (  (o.a_f2 * tc) + o.a_f1 ) * tc + o.a_f0;
+	adjust = adjustClock + RelativityE * sinE - o.t_gd;
+	debug(3, "EphemerisXmit::SatPos s=%d  t=%.0f  E=%.9f  pos=(%.3f, %.3f, %.3f)  adjust=%g\n",
+		SatIndex, t, E, XmitPos.x, XmitPos.y, XmitPos.z, adjust);
 	
 	return OK;
 }
 
 
+bool EphemerisXmit::Valid(Time t)
+{
+	return (MinTime <= t && t <= MaxTime) || Find(t) >= 0;
+}
+
+
+void EphemerisXmit::Keep()
+{
+	Add(*this);
+}
+
+
+void EphemerisXmit::Add(XmitOrbit& orbit)
+// Store the orbit in order of t_oe, replacing one we already have
+{
+	int lo = 0, hi = Records.size();
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (Records[mid].t_oe < orbit.t_oe) lo = mid + 1;
+		else                                 hi = mid;
+	}
+
+	if (lo < (int)Records.size() && Records[lo].t_oe == orbit.t_oe)
+		Records[lo] = orbit;
+	else
+		Records.insert(Records.begin() + lo, orbit);
+	Prune();
+
+	// The best orbit for some times may have changed
+	Changed();
+}
+
+
+int EphemerisXmit::Find(Time t)
+// The record whose t_oe is nearest, provided it is within its two hour fit
+{
+	int lo = 0, hi = Records.size();
+	while (lo < hi) {
+		int mid = (lo + hi) / 2;
+		if (Records[mid].t_oe < t) lo = mid + 1;
+		else                        hi = mid;
+	}
+
+	// Records[lo] is the first at or after t. Choose it or the one before.
+	int best = -1;
+	if (lo < (int)Records.size())
+		best = lo;
+	if (lo > 0 && (best == -1 || t - Records[lo-1].t_oe < Records[lo].t_oe - t))
+		best = lo - 1;
+
+	if (best == -1 || abs(t - Records[best].t_oe) > 2*NsecPerHour)
+		return -1;
+	return best;
+}
+
+
+XmitOrbit* EphemerisXmit::Orbit(Time t)
+// The best record for t, or the working orbit if there is none
+{
+	int k = Find(t);
+	if (k >= 0)                      return &Records[k];
+	if (MinTime <= t && t <= MaxTime) return this;
+	return NULL;
+}
+
+
+void EphemerisXmit::Prune()
+// Drop the records whose fit ended more than two hours before the latest time used
+{
+	int old = 0;
+	while (old < (int)Records.size() && Records[old].t_oe + 4*NsecPerHour < Latest)
+		old++;
+	if (old > 0)
+		Records.erase(Records.begin(), Records.begin() + old);
+}
+
+
+void EphemerisXmit::PrepareTerms(XmitOrbit& o)
+{
+	A = o.sqrt_a * o.sqrt_a;
+	N = sqrt(mu)/(A*o.sqrt_a) + o.delta_n;
+	SqrtOneMinusE2 = sqrt(1 - o.e*o.e);
+	OmegaRef = o.omega_0 - GpsTow(o.t_oe)*OmegaEDot;
+	OmegaRate = o.omegadot - OmegaEDot;
+	RelativityE = RelativisticConstant * o.e * o.sqrt_a;
+	PreparedToe = o.t_oe;  PreparedIode = o.iode;  PreparedSqrtA = o.sqrt_a;
+}
+
+
+double SolveKepler(double M, double e)
+{
+	double E = M + e*sin(M);
+	for (int i=0; i<10; i++) {
+		double dE = (E - e*sin(E) - M) / (1 - e*cos(E));
+		E -= dE;
+		if (abs(dE) < 1e-14) break;
+	}
+	return E;
+}
+
+
+
+int XmitBatch::Add(EphemerisXmit& eph, Time t)
+{
+	if (Count >= MaxBatch) return -1;
+	XmitOrbit* orbit = eph.Orbit(t);
+	if (orbit == NULL) return -1;
+	XmitOrbit& o = *orbit;
+	eph.Prepare(o);
+	eph.Latest = max(eph.Latest, t);
+
+	int k = Count++;
+	T[k] = t;  Toe[k] = o.t_oe;  Toc[k] = o.t_oc;
+	M0[k] = o.m_0;  N[k] = eph.N;  E[k] = o.e;  A[k] = eph.A;
+	SqrtOneMinusE2[k] = eph.SqrtOneMinusE2;
+	Omega[k] = o.omega;  I0[k] = o.i_0;  Idot[k] = o.idot;
+	OmegaRef[k] = eph.OmegaRef;  OmegaRate[k] = eph.OmegaRate;
+	Cuc[k] = o.c_uc;  Cus[k] = o.c_us;  Crc[k] = o.c_rc;
+	Crs[k] = o.c_rs;  Cic[k] = o.c_ic;  Cis[k] = o.c_is;
+	Af0[k] = o.a_f0;  Af1[k] = o.a_f1;  Af2[k] = o.a_f2;
+	Tgd[k] = o.t_gd;  RelativityE[k] = eph.RelativityE;
+	return k;
+}
+
+
+void XmitBatch::SatPos()
+// The same calculation as EphemerisXmit::SatPos, a step at a time for the whole batch
+{
+	int n = Count;
+
+	// Mean anomaly
+	for (int k=0; k<n; k++) {
+		Tk[k] = S(T[k] - Toe[k]);
+		Mk[k] = M0[k] + N[k]*Tk[k];
+		Ek[k] = Mk[k] + E[k]*sin(Mk[k]);
+	}
+
+	// Eccentric anomaly, until the whole batch converges
+	for (int iter=0; iter<10; iter++) {
+		double largest = 0;
+		for (int k=0; k<n; k++) {
+			double dE = (Ek[k] - E[k]*sin(Ek[k]) - Mk[k]) / (1 - E[k]*cos(Ek[k]));
+			Ek[k] -= dE;
+			largest = max(largest, abs(dE));
+		}
+		if (largest < 1e-14) break;
+	}
+
+	// Position and clock
+	for (int k=0; k<n; k++) {
+		SinE[k] = sin(Ek[k]);
+		CosE[k] = cos(Ek[k]);
+		double e = E[k];
+		double denom = 1 - e*CosE[k];
+		double nu = atan2(SqrtOneMinusE2[k]*SinE[k]/denom, (CosE[k] - e)/denom);
+		double phi = nu + Omega[k];
+		double sin2phi = sin(2*phi), cos2phi = cos(2*phi);
+
+		double u = phi + Cuc[k]*cos2phi + Cus[k]*sin2phi;
+		double r = A[k]*denom + Crc[k]*cos2phi + Crs[k]*sin2phi;
+		double i = I0[k] + Idot[k]*Tk[k] + Cic[k]*cos2phi + Cis[k]*sin2phi;
+
+		double xdash = r*cos(u), ydash = r*sin(u);
+		double omega_c = OmegaRef[k] + OmegaRate[k]*Tk[k];
+		double sinO = sin(omega_c), cosO = cos(omega_c), cosi = cos(i);
+		X[k] = xdash*cosO - ydash*cosi*sinO;
+		Y[k] = xdash*sinO + ydash*cosi*cosO;
+		Z[k] = ydash*sin(i);
+
+		double tc = S(T[k] - Toc[k]);
+		Adjust[k] = (Af2[k]*tc + Af1[k])*tc + Af0[k] + RelativityE[k]*SinE[k] - Tgd[k];
+	}
+}
+
+
 
 
 bool EphemerisXmit::FromRaw(EphemerisXmitRaw& r)
@@ -149,6 +314,7 @@ bool EphemerisXmit::FromRaw(EphemerisXmitRaw& r)
 
     MinTime = t_oe - 2*NsecPerHour;
     MaxTime = t_oe + 2*NsecPerHour;
+    Keep();
 
     debug("  r.omegadot=%d\n", r.omegadot);
     Display("From Raw");
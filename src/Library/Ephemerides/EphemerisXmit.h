@@ -4,10 +4,11 @@
 #include "EphemerisXmitRaw.h"
 #include "Ephemeris.h"
 #include "NavFrame.h"
+#include <vector>
 
-class EphemerisXmit : public Ephemeris 
+// The orbit and clock as broadcast by the satellite
+struct XmitOrbit
 {
-public:
     double m_0;      // Mean Anomaly at reference time
     double delta_n;  // Mean Motion Difference from Computed Value
     double e;        // Eccentricity
@@ -35,6 +36,29 @@ public:
 
     uint8  health;
     double acc;
+};
+
+
+//////////////////////////////////////////////////////////////////
+//
+// EphemerisXmit - the ephemeris transmitted by a satellite.
+//
+//   Every orbit received is kept in Records, in order of t_oe, so a long
+//   session still has an orbit for each end when newer ones arrive.
+//   SatPos() works from the record nearest the requested time, found by
+//   binary search. The working fields hold the orbit most recently decoded,
+//   and are only used when there is no record for the time.
+//
+//   Positions are asked for in time order, so a record whose fit ended
+//   well before the latest time asked for is no longer needed. Such
+//   records are pruned whenever a new orbit is stored.
+//
+///////////////////////////////////////////////////////////////////
+
+class EphemerisXmit : public Ephemeris, public XmitOrbit
+{
+public:
+    vector<XmitOrbit> Records;   // every orbit received, sorted by t_oe
 
     bool FromRaw(EphemerisXmitRaw& r);
     bool ToRaw(EphemerisXmitRaw& r);
@@ -47,16 +71,86 @@ public:
     EphemerisXmit(int sat, const char* desription);
     ~EphemerisXmit();
 
-    bool Valid(Time t) {return (MinTime <= t && t <= MaxTime);}
+    bool Valid(Time t);
     double Accuracy(Time t) {return acc;}
 
+    // The stored orbits
+    void Keep();                  // store the working orbit
+    void Add(XmitOrbit& orbit);   // store an orbit received elsewhere
+    int Find(Time t);             // index of the best record for t, -1 if none
+    XmitOrbit* Orbit(Time t);     // the orbit to use at t, NULL if none
+
 
 protected:
     double SvaccToAcc(int svacc);
     int AccToSvacc(double acc);
 
+    Time Latest;           // the latest time a position was asked for
+    void Prune();
+
+    // Terms which only change with the orbit, worked out by Prepare()
+    Time PreparedToe;      // the orbit they belong to
+    uint8 PreparedIode;
+    double PreparedSqrtA;
+    double A;              // semi-major axis
+    double N;              // corrected mean motion
+    double SqrtOneMinusE2;
+    double OmegaRef;       // longitude of the ascending node at t_oe, earth fixed
+    double OmegaRate;      // its rate in the earth fixed frame
+    double RelativityE;    // relativistic clock correction per sin(E)
+    inline void Prepare(XmitOrbit& o) 
+        {if (o.t_oe != PreparedToe || o.iode != PreparedIode || o.sqrt_a != PreparedSqrtA) PrepareTerms(o);}
+    void PrepareTerms(XmitOrbit& o);
+    friend class XmitBatch;
 };
 
+
+// Eccentric anomaly from the mean anomaly, by Newton's method
+double SolveKepler(double M, double e);
+
+
+//////////////////////////////////////////////////////////////////
+//
+// XmitBatch - evaluates many broadcast orbits in one pass.
+//
+//   Each orbit is added with the time it is wanted for, so every
+//   satellite can have its own transmit time. The orbit is the one
+//   EphemerisXmit::SatPos would use, and each term is kept in its own
+//   array. SatPos() then works down the arrays one step at a time, which
+//   keeps each loop short and free of branches, so the compiler can
+//   vectorize them. Kepler's equation is solved for the whole batch,
+//   iterating until every orbit has converged.
+//
+//   The results are left in X, Y, Z and Adjust, at the index Add() returned.
+//
+///////////////////////////////////////////////////////////////////
+
+class XmitBatch
+{
+public:
+	static const int MaxBatch = MaxInView;
+	int Count;
+	double X[MaxBatch], Y[MaxBatch], Z[MaxBatch], Adjust[MaxBatch];
+
+protected:
+	// The orbits and times, one array per term
+	Time T[MaxBatch], Toe[MaxBatch], Toc[MaxBatch];
+	double M0[MaxBatch], N[MaxBatch], E[MaxBatch], A[MaxBatch], SqrtOneMinusE2[MaxBatch];
+	double Omega[MaxBatch], I0[MaxBatch], Idot[MaxBatch], OmegaRef[MaxBatch], OmegaRate[MaxBatch];
+	double Cuc[MaxBatch], Cus[MaxBatch], Crc[MaxBatch], Crs[MaxBatch], Cic[MaxBatch], Cis[MaxBatch];
+	double Af0[MaxBatch], Af1[MaxBatch], Af2[MaxBatch], Tgd[MaxBatch], RelativityE[MaxBatch];
+
+	// Intermediate values, one per orbit
+	double Tk[MaxBatch], Mk[MaxBatch], Ek[MaxBatch], SinE[MaxBatch], CosE[MaxBatch];
+
+public:
+	XmitBatch() {Clear();}
+	void Clear() {Count = 0;}
+	int Add(EphemerisXmit& eph, Time t);   // index of the result, -1 if no orbit or full
+	void SatPos();
+};
+
+
     static const double AccuracyIndex[16] = {2.4, 3.4, 4.85, 6.85, 9.65, 
 	  13.65, 24, 48, 96, 192, 384, 768, 1536, 3072, 6144, INFINITY};
 
@@ -33,6 +33,8 @@
 template<typename Xt, typename Yt>
 Interpolator<Xt,Yt>::Interpolator()
 {
+	NrPoints = 0;
+	Built = false;
 }
 
 template<typename Xt, typename Yt>
@@ -42,59 +44,25 @@ Interpolator<Xt,Yt>::~Interpolator()
 
 
 
-/////////////////////////////////////////////////////////////////
-// Interpolate using a polynomial of degree n-1
-//
-// This code is based on Neville's algorithm as described in
-//    "Numerical Recipes in C: The Art of Scientific Computing".
-//    The code has been rearranged so it computes a succession
-//    of interpolated values based on increasing degrees
-//    of polynomials, adding one datapoint at a time. If the data values 
-//    are sorted by their proximity to X,
-//    then the c[0]'s at each step should give an indication of the error.
-//
-
-template<typename Tx, typename Ty>
-void Interpolator<Tx,Ty>::Interpolate(int32 n, Tx* x, Ty* y, Tx X, Ty& Y)
-{
-    Ty c[50], d[50];   // n must be <= 50, or dynamically allocate.
-
-	// Make an initial guess for the interpolated value (zero)
-	Y = Ty(0);
-
-	// do for increasing order of polynomials
-	for (int order = 0; order < n; order++){
-
-		// Add the next data point to interpolation
-		d[order] = c[order] = y[order];
-
-		// update the diagonal row of polynomial calculations
-		for (int i = order-1; i>=0; i--) {
-
-			Ty m = (c[i+1] - d[i]) / (x[i] - x[order]);
-			c[i] = (x[i]     - X) * m;
-			d[i] = (x[order] - X) * m;
-		}
-
-		// update the interpolated value 
-		Y = Y + c[0];
-	}
-}
-
-
-
-
-
 template<typename Xt, typename Yt>
 bool Interpolator<Xt,Yt>::GetY(Xt x, Yt& y)
 {
-	// Choose points
-	int32 i, n;
-	if (Choose(x, i, n))
+	int32 size = Xv.size();
+	if (size < 2 || x < Xv[0] || x > Xv[size-1])
 		return Error("Interpolator::GetY - X value out of range");
+	if (!Built) Build();
+
+	// Find the interval (direct lookup since intervals are equal)
+	Xt h = Xv[1] - Xv[0];
+	int32 j = (x - Xv[0]) / h;
+	if (j > size-2) j = size-2;
 
-	// Do the interpolation
-	Interpolate(n, &Xv[i], &Yv[i], x, y);
+	// Evaluate its polynomial
+	double t = (x - Xv[j]) / (double)h;
+	Yt* c = &Coef[j*NrPoints];
+	y = c[NrPoints-1];
+	for (int k = NrPoints-2; k >= 0; k--)
+		y = y*t + c[k];
 
 	return OK;
 }
@@ -102,27 +70,66 @@ bool Interpolator<Xt,Yt>::GetY(Xt x, Yt& y)
 
 
 template<typename Xt, typename Yt>
-bool Interpolator<Xt,Yt>::Choose(Xt x, int32& i, int32& n)
+int32 Interpolator<Xt,Yt>::Window(int32 j)
+// The first of the points used for interval j: the ones around it, kept in bounds
 {
-	size_t size = Xv.size();
+	int32 size = Xv.size();
+	int32 i = j - MaxPoints/2;
+	if (i < 0)                i = 0;
+	if (i+NrPoints > size)    i = size - NrPoints;
+	return i;
+}
 
-	// Find closest points -- Good enough for now, but may want to fix.
-	// (direct lookup since intervals are equal)
-	i = (x - Xv[0]) / (Xv[1] - Xv[0]);
 
-    // Choose points around the nearest point
-	n = 10;
-	i = i-n/2;
 
-    // Adjust if any points are out of bounds
-	if (i < 0)       i = 0;
-	if (n > size)    n = size;
-	if (i+n > size)  i = size - n;
+/////////////////////////////////////////////////////////////////
+// Work out each interval's polynomial.
+//
+// The divided differences give the Newton form of the polynomial through
+//   the interval's points, which is then multiplied out into powers of t,
+//   the distance from the start of the interval. The points are at whole
+//   numbers of t, so the differences need no division by the spacing.
+//
+
+template<typename Xt, typename Yt>
+void Interpolator<Xt,Yt>::Build()
+{
+	int32 size = Xv.size();
+	NrPoints = min(MaxPoints, size);
+	Coef.resize((size-1) * NrPoints);
+
+	for (int32 j=0; j<size-1; j++) {
+		int32 first = Window(j);
+
+		// Points as distances from the start of the interval
+		double z[MaxPoints];
+		Yt d[MaxPoints];
+		for (int k=0; k<NrPoints; k++) {
+			z[k] = first + k - j;
+			d[k] = Yv[first+k];
+		}
 
-	debug(4, "Interpolator::Choose: x=%g Xv[%d]=%g Xv[%d]=%g  size=%d  \n", 
-		(double)x, i, (double)Xv[i], i+n-1, (double)Xv[i+n-1], size);
+		// Divided differences. d[k] becomes the coefficient of (t-z[0])...(t-z[k-1])
+		for (int order=1; order<NrPoints; order++)
+			for (int k=NrPoints-1; k>=order; k--)
+				d[k] = (d[k] - d[k-1]) / (z[k] - z[k-order]);
+
+		// Multiply out the Newton form, innermost first
+		Yt* c = &Coef[j*NrPoints];
+		for (int k=0; k<NrPoints; k++)
+			c[k] = Yt(0);
+		c[0] = d[NrPoints-1];
+		for (int k=NrPoints-2; k>=0; k--) {
+
+			// c = c * (t - z[k]) + d[k]
+			for (int m=NrPoints-1; m>0; m--)
+				c[m] = c[m-1] - c[m]*z[k];
+			c[0] = d[k] - c[0]*z[k];
+		}
+	}
 
-	return n == 0 || Xv[0] > x || Xv[size-1] < x;
+	Built = true;
+	debug(4, "Interpolator::Build  points=%d  NrPoints=%d\n", size, NrPoints);
 }
     
 
@@ -140,6 +147,7 @@ bool Interpolator<Xt,Yt>::SetY(Xt x, Yt y)
 
     // Add the new point to the vectors
 	Xv.push_back(x); Yv.push_back(y);
+	Built = false;
 
 	return false;
 }
@@ -147,6 +155,5 @@ bool Interpolator<Xt,Yt>::SetY(Xt x, Yt y)
 
 // Instantiate for the cases we know we're going to use
 template class Interpolator<Time, Position>;
-template class Interpolator<Time, Time>;
 template class Interpolator<Time, double>;
 
@@ -21,10 +21,22 @@
 
 
 
+#include "Util.h"
 #include <vector>
 using namespace std;
 
 
+//////////////////////////////////////////////////////////////////
+//
+// Interpolator - interpolates between equally spaced points using
+//   a polynomial through the (up to) 10 points nearest each interval.
+//
+//   The polynomial only depends on which interval x falls in, so the
+//   first GetY() after the points change works out the coefficients for
+//   every interval. After that, GetY() is a lookup and a Horner step.
+//
+///////////////////////////////////////////////////////////////////
+
 template<typename Tx, typename Ty>
 class Interpolator
 {
@@ -34,12 +46,25 @@ public:
 	bool GetY(Tx x, Ty& y);
 	bool SetY(Tx x, Ty y);
 
+	// The points themselves
+	int32 Size() {return Xv.size();}
+	Tx X(int32 i) {return Xv[i];}
+	Ty Y(int32 i) {return Yv[i];}
+	void Reserve(int32 n) {Xv.reserve(n); Yv.reserve(n);}
+
 private:
+	static const int32 MaxPoints = 10;
 	vector<Tx> Xv;
 	vector<Ty> Yv;
 
-	bool Choose(Tx x, int32& i, int32& n);
-    void Interpolate(int32 n, Tx* x, Ty* y, Tx X, Ty& Y);
+	// Polynomial coefficients, NrPoints for each interval, in increasing powers
+	//   of the distance into the interval (in intervals)
+	vector<Ty> Coef;
+	int32 NrPoints;
+	bool Built;
+
+	int32 Window(int32 interval);
+	void Build();
 };
 
 
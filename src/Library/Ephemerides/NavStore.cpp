@@ -0,0 +1,176 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+//
+//
+////////////////////////////////////////////////////////////////////////////
+//
+// The file is a header followed by one record per orbit.
+//   The record size is in the header, so a file written by a build
+//   with a different layout is ignored rather than misread.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "NavStore.h"
+#include "MappedFile.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char Magic[8] = {'K','N','A','V','S','T','R','1'};
+
+struct NavHeader
+{
+	char Magic[8];
+	int32 RecordSize;
+	int32 Count;
+};
+
+struct NavRecord
+{
+	int32 Sat;
+	int32 Unused;
+	XmitOrbit Orbit;
+};
+
+
+NavStore::NavStore(const char* name)
+{
+	Name = name;
+	for (int s=0; s<MaxSats; s++)
+		Saved[s] = 0;
+}
+
+
+static EphemerisXmit* Broadcast(Ephemerides& eph, int s)
+{
+	return dynamic_cast<EphemerisXmit*>(eph.eph[s]);
+}
+
+
+bool NavStore::Load(Ephemerides& eph)
+// Add the saved orbits. A missing file just means there are none yet.
+{
+	FILE* f = fopen(Name, "rb");
+	if (f == NULL) {
+		debug("NavStore::Load - no saved orbits in %s\n", Name);
+		return OK;
+	}
+	fclose(f);
+
+	MappedFile file;
+	if (file.Open(Name) != OK) return Error("Can't open navigation store %s\n", Name);
+
+	NavHeader* h = (NavHeader*)file.Data;
+	if (file.Size < sizeof(NavHeader) || memcmp(h->Magic, Magic, sizeof(Magic)) != 0
+		|| h->RecordSize != sizeof(NavRecord)
+		|| file.Size < sizeof(NavHeader) + h->Count*sizeof(NavRecord)) {
+		debug("NavStore::Load - ignoring %s, not a navigation store for this build\n", Name);
+		return OK;
+	}
+
+	NavRecord* r = (NavRecord*)(file.Data + sizeof(NavHeader));
+	for (int i=0; i<h->Count; i++) {
+		if (r[i].Sat < 0 || r[i].Sat >= MaxSats) continue;
+		EphemerisXmit* e = Broadcast(eph, r[i].Sat);
+		if (e != NULL)
+			e->Add(r[i].Orbit);
+	}
+
+	Remember(eph);
+	debug("NavStore::Load - %d orbits from %s\n", Count(eph), Name);
+	return OK;
+}
+
+
+bool NavStore::Save(Ephemerides& eph)
+{
+	int count = Count(eph);
+	char temp[1024];
+	snprintf(temp, sizeof(temp), "%s.tmp", Name);
+
+	// Write the orbits under a temporary name
+	{
+		MappedFile file;
+		if (file.Create(temp) != OK || file.Resize(sizeof(NavHeader) + count*sizeof(NavRecord)) != OK)
+			return Error("Can't write navigation store %s\n", temp);
+
+		NavHeader* h = (NavHeader*)file.Data;
+		memcpy(h->Magic, Magic, sizeof(Magic));
+		h->RecordSize = sizeof(NavRecord);
+		h->Count = count;
+
+		NavRecord* r = (NavRecord*)(file.Data + sizeof(NavHeader));
+		for (int s=0; s<MaxSats; s++) {
+			EphemerisXmit* e = Broadcast(eph, s);
+			if (e == NULL) continue;
+			for (int i=0; i<(int)e->Records.size(); i++, r++) {
+				memset(r, 0, sizeof(*r));
+				r->Sat = s;
+				r->Orbit = e->Records[i];
+			}
+		}
+		if (file.Close() != OK) return Error("Can't write navigation store %s\n", temp);
+	}
+
+	// Then replace the old file
+	remove(Name);
+	if (rename(temp, Name) != 0)
+		return Error("Can't rename %s to %s\n", temp, Name);
+
+	Remember(eph);
+	debug("NavStore::Save - %d orbits to %s\n", count, Name);
+	return OK;
+}
+
+
+bool NavStore::Update(Ephemerides& eph)
+// Save the orbits if any have changed
+{
+	for (int s=0; s<MaxSats; s++) {
+		EphemerisXmit* e = Broadcast(eph, s);
+		if (e != NULL && e->Issue != Saved[s])
+			return Save(eph);
+	}
+	return OK;
+}
+
+
+void NavStore::Remember(Ephemerides& eph)
+// Note which orbits are in the file
+{
+	for (int s=0; s<MaxSats; s++) {
+		EphemerisXmit* e = Broadcast(eph, s);
+		Saved[s] = (e == NULL)? 0: e->Issue;
+	}
+}
+
+
+int NavStore::Count(Ephemerides& eph)
+{
+	int count = 0;
+	for (int s=0; s<MaxSats; s++) {
+		EphemerisXmit* e = Broadcast(eph, s);
+		if (e != NULL)
+			count += e->Records.size();
+	}
+	return count;
+}
+
+
+NavStore::~NavStore()
+{
+}
@@ -0,0 +1,59 @@
+#ifndef NAVSTORE_INCLUDED
+#define NAVSTORE_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "EphemerisXmit.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// NavStore - keeps the broadcast orbits on disk between sessions.
+//
+//   Load() gives each satellite with a broadcast ephemeris the orbits
+//   saved by an earlier session, so positions are available before the
+//   receiver has collected any nav frames. Update() saves them again
+//   whenever a satellite's orbits have changed, going by its Issue. Since
+//   stale orbits are pruned from the ephemerides, they leave the file too.
+//
+//   The orbits are stored at full precision, not as raw broadcast words.
+//   The file is written under a temporary name and then renamed, so an
+//   interrupted session leaves the previous file intact.
+//
+///////////////////////////////////////////////////////////////////
+
+class NavStore
+{
+protected:
+	const char* Name;
+	uint32 Saved[MaxSats];   // each satellite's Issue when its orbits were saved
+
+public:
+	NavStore(const char* name);
+	bool Load(Ephemerides& eph);
+	bool Save(Ephemerides& eph);
+	bool Update(Ephemerides& eph);
+	static int Count(Ephemerides& eph);
+	virtual ~NavStore();
+
+protected:
+	void Remember(Ephemerides& eph);
+};
+
+#endif // NAVSTORE_INCLUDED
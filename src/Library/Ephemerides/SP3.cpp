@@ -20,6 +20,7 @@
 #include "util.h"
 #include "SP3.h"
 #include "RinexParse.h"
+#include "Crc.h"
 
 bool SkipLine(FILE* f);
 
@@ -31,16 +32,71 @@ bool SkipLine(FILE* f);
 //
 // Note: This code reads the entire ephemeris file and stores it in memory
 //   In practice, the data is used in time order, so it would make sense
-//   to read the sp3 data only as needed. Get rid on the unnecesary array.
+//   to read the sp3 data only as needed.
+//
+// The cache file holds a header, the signature of the sp3 files it
+//   came from, then a CacheRecord for each point, by satellite and time.
+//   The signature gives each file's name, size and time, and a crc of its
+//   header and last epoch, so an edited or replaced file isn't mistaken
+//   for the one the cache was made from.
 //////////////////////////////////////////////////////////////////////
 
+static const char CacheMagic[8] = {'K','S','P','3','C','A','C','1'};
 
+struct CacheHeader
+{
+	char Magic[8];
+	int32 SignatureSize;     // including the terminating null, padded to 8
+	int32 NrRecords;
+};
 
-SP3::SP3(const char* name)
+struct CacheRecord
+{
+	int32 Sat;
+	int32 Unused;
+	Time T;
+	Position Pos;
+	double Adjust;
+};
+
+
+static bool NextName(const char*& names, char* name, size_t size)
+// Take the next name from a comma separated list
+{
+	const char* comma = strchr(names, ',');
+	size_t len = (comma == NULL)? strlen(names): comma - names;
+	if (len >= size) return Error("SP3: name is too long\n");
+	memcpy(name, names, len);  name[len] = '\0';
+	names += len;  if (*names == ',') names++;
+	return OK;
+}
+
+
+SP3::SP3(const char* names, const char* cache)
 {
 	for (int s=0; s<MaxSats; s++)
 		eph[s] = new EphemerisInterpolated(s);
-	ErrCode = Open(name);
+
+	// Use the cache if it matches the files
+	char signature[4096];
+	ErrCode = Signature(names, signature, sizeof(signature));
+	if (ErrCode != OK) return;
+	if (cache != NULL && ReadCache(cache, signature) == OK)
+		return;
+	ClearError();
+
+	// Do for each of the comma separated file names
+	char name[1024];
+	for (const char* p = names; *p != '\0'; ) {
+		ErrCode = NextName(p, name, sizeof(name)) || Open(name);
+		if (ErrCode != OK) return;
+	}
+
+	// Save a copy for next time
+	if (cache != NULL && WriteCache(cache, signature) != OK) {
+		debug("SP3: couldn't write the cache %s\n", cache);
+		ClearError();
+	}
 }
 
 
@@ -49,14 +105,18 @@ SP3::~SP3()
 }
 
 bool SP3::Open(const char* name)
+// Add the points from an sp3 file. If the files are opened in order,
+//   each one carries on from the last.
 {
-	InputFile in(name);
-	if (in.GetError())
+	MappedFile in;
+	if (in.Open(name) != OK)
 		return Error("Can't open Sp3 Ephemeris file %s", name);
+	const char* next = (const char*)in.Data;
+	const char* end = next + in.Size;
 
 	// Do for each satellite position record
 	Time time; double Adjust;  Position pos; int32 s;
-	while (ReadPos(in, time, s, pos, Adjust) == OK) {
+	while (ReadPos(next, end, time, s, pos, Adjust) == OK) {
 		//debug("sp3;  sat=%d  time=%.0f\n", s, S(time));
 
 		// Add information to interpolator
@@ -69,13 +129,31 @@ bool SP3::Open(const char* name)
 	return OK;
 }
 
-bool SP3::ReadPos(InputFile& in, Time& t, int32& sat, Position& p, double &Adjust)
+
+static bool NextLine(const char*& next, const char* end, char* line, size_t size)
+// Copy the next line out of the mapped file, padded with blanks so the
+//   fixed columns can be read even if the line is short.
 {
-	// Repeat until a position record was read
-	char line[256];
-	while (!in.ReadLine(line)) {
+	if (next >= end) return Error();
+	const char* eol = (const char*)memchr(next, '\n', end - next);
+	if (eol == NULL) eol = end;
 
+	size_t len = min((size_t)(eol - next), size-1);
+	memcpy(line, next, len);
+	if (len > 0 && line[len-1] == '\r') len--;
+	if (len < 80) {memset(line+len, ' ', 80-len); len = 80;}
+	line[len] = '\0';
+
+	next = eol + 1;
+	return OK;
+}
 
+
+bool SP3::ReadPos(const char*& next, const char* end, Time& t, int32& sat, Position& p, double &Adjust)
+{
+	// Repeat until a position record was read
+	char line[256];
+	while (NextLine(next, end, line, sizeof(line)) == OK) {
 		// Case: Position. Return position data.
 		if (match(line, 0, "P")) {
 
@@ -84,11 +162,12 @@ bool SP3::ReadPos(InputFile& in, Time& t, int32& sat, Position& p, double &Adjus
 			p.y = GetDouble(line, 18, 14) * 1000;
 			p.z = GetDouble(line, 32, 14) * 1000;
 			Adjust = GetDouble(line, 46, 14) / 1000000;
-			int svid = ParseSvid(line, 1);
-			sat = SvidToSat(svid);
-			debug(5, "svid=%d s=%d  p=(%.3f, %.3f, %.3f)  a=%.9f\n",svid,sat,p.x,p.y,p.z,Adjust);
-			if (sat == -1)
-				return Error("Invalid satellite id in SP3 file\n");
+			sat = ParseSat(line, 1);
+			debug(5, "s=%d  p=(%.3f, %.3f, %.3f)  a=%.9f\n",sat,p.x,p.y,p.z,Adjust);
+			if (sat == -1) {
+				debug("SP3: skipping satellite from unknown constellation: %s\n", line);
+				continue;
+			}
 
 			
 			// Set the time and return
@@ -128,6 +207,109 @@ bool SP3::ReadPos(InputFile& in, Time& t, int32& sat, Position& p, double &Adjus
 }
 
 
+static uint32 Fingerprint(MappedFile& f)
+// A crc of the header and the last epoch. Epochs start with a '*' line.
+{
+	const char* data = (const char*)f.Data;
+	size_t header = 0;
+	while (header < f.Size && !(data[header] == '*' && (header == 0 || data[header-1] == '\n')))
+		header++;
+	size_t last = f.Size;
+	for (size_t p = f.Size; p > header+1; p--)
+		if (data[p-1] == '*' && data[p-2] == '\n') {last = p-1; break;}
+
+	Crc24 crc;
+	crc.Add(f.Data, header);
+	crc.Add(f.Data+last, f.Size-last);
+	return crc.AsInt();
+}
+
+
+bool SP3::Signature(const char* names, char* signature, size_t size)
+// Describe the sp3 files, so we can tell if a cache came from them
+{
+	char name[1024];
+	size_t used = 0;
+	signature[0] = '\0';
+	for (const char* p = names; *p != '\0'; ) {
+		if (NextName(p, name, sizeof(name)) != OK) return Error();
+		MappedFile f;
+		if (f.Open(name) != OK) return Error("Can't open Sp3 Ephemeris file %s", name);
+		int n = snprintf(signature+used, size-used, "%s:%llu:%llu:%06x;", name, 
+			(unsigned long long)f.Size, (unsigned long long)f.Modified, (unsigned)Fingerprint(f));
+		if (n < 0 || used + n >= size) return Error("SP3: too many files\n");
+		used += n;
+	}
+	return OK;
+}
+
+
+bool SP3::ReadCache(const char* cache, const char* signature)
+{
+	MappedFile f;
+	if (f.Open(cache) != OK) return Error();
+	if (f.Size < sizeof(CacheHeader)) return Error("SP3: cache %s is too small\n", cache);
+
+	// Make sure the cache belongs to these files
+	CacheHeader* h = (CacheHeader*)f.Data;
+	size_t start = sizeof(CacheHeader) + h->SignatureSize;
+	if (memcmp(h->Magic, CacheMagic, sizeof(CacheMagic)) != 0
+		|| h->SignatureSize < 1 || start > f.Size
+		|| f.Size != start + h->NrRecords*sizeof(CacheRecord)
+		|| strncmp((char*)f.Data + sizeof(CacheHeader), signature, h->SignatureSize) != 0)
+		return Error("SP3: cache %s doesn't match the sp3 files\n", cache);
+
+	// Add the points, making room for each satellite's run at once
+	CacheRecord* r = (CacheRecord*)(f.Data + start);
+	for (int i=0; i<h->NrRecords; i++) {
+		if (r[i].Sat < 0 || r[i].Sat >= MaxSats) return Error("SP3: cache %s is damaged\n", cache);
+		EphemerisInterpolated* e = (EphemerisInterpolated*)eph[r[i].Sat];
+		if (i == 0 || r[i].Sat != r[i-1].Sat) {
+			int n;
+			for (n=i; n<h->NrRecords && r[n].Sat == r[i].Sat; n++)
+				;
+			e->Reserve(n-i);
+		}
+		if (e->AddSatPos(r[i].T, r[i].Pos, r[i].Adjust) != OK) return Error();
+	}
+
+	debug("SP3: read %d points from cache %s\n", h->NrRecords, cache);
+	return OK;
+}
+
+
+bool SP3::WriteCache(const char* cache, const char* signature)
+{
+	int32 nrecords = 0;
+	for (int s=0; s<MaxSats; s++)
+		nrecords += ((EphemerisInterpolated*)eph[s])->NrPoints();
+	int32 sigsize = (strlen(signature) + 1 + 7) & ~7;
+
+	MappedFile f;
+	if (f.Create(cache) != OK) return Error();
+	size_t start = sizeof(CacheHeader) + sigsize;
+	if (f.Resize(start + nrecords*sizeof(CacheRecord)) != OK) return Error();
+
+	CacheHeader* h = (CacheHeader*)f.Data;
+	memcpy(h->Magic, CacheMagic, sizeof(CacheMagic));
+	h->SignatureSize = sigsize;
+	h->NrRecords = nrecords;
+	memset(f.Data + sizeof(CacheHeader), 0, sigsize);
+	strcpy((char*)f.Data + sizeof(CacheHeader), signature);
+
+	CacheRecord* r = (CacheRecord*)(f.Data + start);
+	for (int s=0; s<MaxSats; s++) {
+		EphemerisInterpolated* e = (EphemerisInterpolated*)eph[s];
+		for (int i=0; i<e->NrPoints(); i++, r++) {
+			r->Sat = s;  r->Unused = 0;
+			e->GetPoint(i, r->T, r->Pos, r->Adjust);
+		}
+	}
+
+	return OK;
+}
+
+
 
 
 
@@ -171,6 +353,10 @@ bool EphemerisInterpolated::SatPos(Time t, Position &XmitPos, double& Adjust)
 
 bool EphemerisInterpolated::AddSatPos(Time t, Position &XmitPos, double Adjust)
 {
+	// Consecutive files may both have the point at midnight
+	if (MaxTime > 0 && t == MaxTime)
+		return OK;
+
 	if (xTime.SetY(t, Adjust))
 		return Error("Ephemeris Interpolated - couldn't set clock adjustment\n");
 	if (xPos.SetY(t, XmitPos))
@@ -178,6 +364,7 @@ bool EphemerisInterpolated::AddSatPos(Time t, Position &XmitPos, double Adjust)
 
 	if (MaxTime <= 0 || t > MaxTime)  MaxTime = t;
 	if (MinTime <= 0 || t < MinTime)  MinTime = t;
+	Changed();
 	debug(4, "AddSatPos:  t=%.0f  MinTime=%.0f  MaxTime=%.0f\n",S(t),S(MinTime),S(MaxTime));
 
 	return OK;
@@ -25,7 +25,7 @@
 #include "Interpolator.h"
 #include "util.h"
 #include "Parse.h"  // GetLine
-#include "InputFile.h"
+#include "MappedFile.h"
 
 
 
@@ -40,6 +40,12 @@ public:
 	bool AddSatPos(Time t, Position& XmitPos, double Adjust);
 	virtual ~EphemerisInterpolated();
 
+	// The points, for saving in a cache
+	int32 NrPoints() {return xPos.Size();}
+	void GetPoint(int32 i, Time& t, Position& pos, double& adjust)
+		{t = xPos.X(i);  pos = xPos.Y(i);  adjust = xTime.Y(i);}
+	void Reserve(int32 n) {xPos.Reserve(n); xTime.Reserve(n);}
+
 private:
 	Interpolator<Time,double>   xTime;
 	Interpolator<Time,Position> xPos;
@@ -48,16 +54,34 @@ private:
 };
 
 
+//////////////////////////////////////////////////////////////////
+//
+// SP3 - precise ephemerides from one or more sp3 files.
+//
+//   Several consecutive files (eg. a file per day) may be given, separated
+//   by commas, and are stitched together into one set of ephemerides.
+//   The files are mapped into memory and parsed a line at a time.
+//
+//   If a cache file is given, the points are saved there in binary form
+//   and reloaded from it next time, as long as the sp3 files haven't changed
+//   in name or size.
+//
+///////////////////////////////////////////////////////////////////
+
 class SP3: public Ephemerides
 {
 public:
-	SP3(const char* name);
+	SP3(const char* names, const char* cache = NULL);
 	virtual ~SP3();
 	bool Open(const char* name);
 	bool GetError() { return ErrCode;}
 
+	bool ReadCache(const char* cache, const char* signature);
+	bool WriteCache(const char* cache, const char* signature);
+
 private:
-	bool ReadPos(InputFile& in, Time& t, int32& sat, Position& p, double& Adjust);
+	bool ReadPos(const char*& next, const char* end, Time& t, int32& sat, Position& p, double& Adjust);
+	bool Signature(const char* names, char* signature, size_t size);
 	Time GpsTime;
 	bool ErrCode;
 };
@@ -0,0 +1,137 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "SatPosCache.h"
+#include "Ephemeris.h"
+#include "EphemerisXmit.h"
+
+
+SatPosCache::SatPosCache()
+{
+	Batch = new XmitBatch;
+	Clear();
+}
+
+
+void SatPosCache::Clear()
+{
+	for (int s=0; s<MaxSats; s++)
+		for (int w=0; w<Ways; w++) {
+			Entries[s][w].Eph = NULL;
+			Entries[s][w].Used = 0;
+		}
+	Clock = 0;
+	Hits = Misses = 0;
+}
+
+
+bool SatPosCache::SatPos(Ephemeris& e, int s, Time t, Position& pos, double& adjust)
+// Get the satellite's position, from the cache if we have it
+{
+	Ephemeris& eph = e.Provider(t);
+	if (Lookup(eph, s, t, pos, adjust)) return OK;
+
+	// Not found. Calculate it and remember it. (Failures aren't cached.)
+	if (eph.SatPos(t, pos, adjust) != OK) return Error();
+	Store(eph, s, t, pos, adjust);
+	return OK;
+}
+
+
+bool SatPosCache::SatPos(Ephemerides& eph, int n, const int* sat, const Time* t,
+						 Position* pos, double* adjust, bool* ok)
+// Get the positions of n satellites, each at its own time.
+//   ok[k] is false if satellite k has no position, and then the result is an error.
+{
+	assert(n <= MaxInView);
+	Ephemeris* provider[MaxInView];
+	int slot[MaxInView];
+	bool all = true;
+
+	// Take what we can from the cache, and batch up the broadcast orbits
+	Batch->Clear();
+	for (int k=0; k<n; k++) {
+		provider[k] = &eph[sat[k]].Provider(t[k]);
+		slot[k] = -1;
+		ok[k] = true;
+		if (Lookup(*provider[k], sat[k], t[k], pos[k], adjust[k])) continue;
+
+		EphemerisXmit* xmit = dynamic_cast<EphemerisXmit*>(provider[k]);
+		if (xmit != NULL)
+			slot[k] = Batch->Add(*xmit, t[k]);
+		if (slot[k] != -1) continue;
+
+		// Anything else, one at a time
+		ok[k] = provider[k]->SatPos(t[k], pos[k], adjust[k]) == OK;
+		if (ok[k]) Store(*provider[k], sat[k], t[k], pos[k], adjust[k]);
+		all = all && ok[k];
+	}
+
+	// Work out the batch and remember the results
+	Batch->SatPos();
+	for (int k=0; k<n; k++) {
+		int b = slot[k];
+		if (b == -1) continue;
+		pos[k] = Position(Batch->X[b], Batch->Y[b], Batch->Z[b]);
+		adjust[k] = Batch->Adjust[b];
+		Store(*provider[k], sat[k], t[k], pos[k], adjust[k]);
+	}
+
+	if (!all) return Error();
+	return OK;
+}
+
+
+bool SatPosCache::Lookup(Ephemeris& eph, int s, Time t, Position& pos, double& adjust)
+// True if the cache has the position. Counts a miss otherwise.
+{
+	Entry* set = Entries[s];
+	Clock++;
+	for (int w=0; w<Ways; w++) {
+		Entry& e = set[w];
+		if (e.Eph == &eph && e.T == t && e.Issue == eph.Issue) {
+			e.Used = Clock;
+			pos = e.Pos;  adjust = e.Adjust;
+			Hits++;
+			return true;
+		}
+	}
+	Misses++;
+	return false;
+}
+
+
+void SatPosCache::Store(Ephemeris& eph, int s, Time t, Position& pos, double adjust)
+// Remember a position, replacing the least recently used entry
+{
+	Entry* set = Entries[s];
+	Entry* oldest = &set[0];
+	for (int w=1; w<Ways; w++)
+		if (set[w].Used < oldest->Used)
+			oldest = &set[w];
+
+	oldest->T = t;  oldest->Eph = &eph;  oldest->Issue = eph.Issue;
+	oldest->Used = Clock;
+	oldest->Pos = pos;  oldest->Adjust = adjust;
+}
+
+
+SatPosCache::~SatPosCache()
+{
+	delete Batch;
+}
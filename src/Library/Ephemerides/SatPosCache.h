@@ -0,0 +1,81 @@
+#ifndef SATPOSCACHE_INCLUDED
+#define SATPOSCACHE_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Util.h"
+
+class Ephemeris;
+class Ephemerides;
+class XmitBatch;
+
+
+//////////////////////////////////////////////////////////////////
+//
+// SatPosCache - remembers recent satellite positions.
+//
+//   Within an epoch, the same satellite position is wanted by the
+//   observations, the loggers and the simulator. Each satellite keeps
+//   its last few positions, keyed by time, and a lookup which misses
+//   replaces the least recently used one.
+//
+//   An entry also records which ephemeris it came from and the ephemeris'
+//   Issue, so a new orbit (or a replaced ephemeris) is never served stale.
+//   For a composite ephemeris, it is the one which provided the orbit.
+//
+//   Many satellites can be looked up at once, each at its own time. The
+//   broadcast orbits which miss are then worked out together by an
+//   XmitBatch, and the rest one at a time.
+//
+//   Only one thread at a time may use a cache.
+//
+///////////////////////////////////////////////////////////////////
+
+class SatPosCache
+{
+protected:
+	static const int Ways = 4;      // positions remembered per satellite
+	struct Entry {
+		Time T;
+		Ephemeris* Eph;
+		uint32 Issue;
+		uint32 Used;                // when last used, for finding the oldest
+		Position Pos;
+		double Adjust;
+	};
+	Entry Entries[MaxSats][Ways];
+	uint32 Clock;
+	uint32 Hits, Misses;
+	XmitBatch* Batch;
+
+	bool Lookup(Ephemeris& eph, int s, Time t, Position& pos, double& adjust);
+	void Store(Ephemeris& eph, int s, Time t, Position& pos, double adjust);
+
+public:
+	SatPosCache();
+	bool SatPos(Ephemeris& eph, int s, Time t, Position& pos, double& adjust);
+	bool SatPos(Ephemerides& eph, int n, const int* sat, const Time* t,
+		        Position* pos, double* adjust, bool* ok);
+	void Clear();
+	uint32 GetHits() {return Hits;}
+	uint32 GetMisses() {return Misses;}
+	~SatPosCache();
+};
+
+#endif // SATPOSCACHE_INCLUDED
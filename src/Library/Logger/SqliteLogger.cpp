@@ -18,12 +18,14 @@ bool SqliteLogger::OutputEpoch()
     debug("SqliteLogger::OutputEpoch\n");
 
     // Calculate the satellite positions, but outside the transaction
-    Position pos[MaxSats];
-    double adjust[MaxSats];
-    for (int s=0; s<MaxSats; s++) {
-        adjust[s] = 0;  pos[s] = Position(0);
+    //   (one entry for each satellite in view)
+    Position pos[MaxInView];
+    double adjust[MaxInView];
+    for (int i=0; i<gps.obs.Count(); i++) {
+        int s = gps.obs.Sat(i);
+        adjust[i] = 0;  pos[i] = Position(0);
         if (gps.obs[s].Valid && gps[s].Valid(gps.GpsTime)) 
-           gps[s].SatPos(gps.GpsTime, pos[s], adjust[s]);
+           gps.SatPos(s, gps.GpsTime, pos[i], adjust[i]);
     }
 
     // Make it a transaction to improve performance
@@ -32,8 +34,9 @@ bool SqliteLogger::OutputEpoch()
         return Error("Can't cleanup for 'begin':%s\n", sqlite3_errmsg(db));
 
     // for each valid observation
-    for (int s=0; s<MaxSats; s++) {
-        if (!gps.obs[s].Valid) continue;
+    for (int i=0; i<gps.obs.Count(); i++) {
+        int s = gps.obs.Sat(i);
+        if (!gps.obs[s].Valid || SatToSvid(s) == -1) continue;
 
         // Insert observation into the database
         sqlite3_bind_int(insert, 1, station_id);
@@ -46,10 +49,10 @@ bool SqliteLogger::OutputEpoch()
         sqlite3_bind_int(insert, 8, gps.obs[s].Slip);
 
         // Include the satellite information as well
-        sqlite3_bind_double(insert, 9, pos[s].x);
-        sqlite3_bind_double(insert, 10, pos[s].y);
-        sqlite3_bind_double(insert, 11, pos[s].z);
-        sqlite3_bind_double(insert, 12, adjust[s]);
+        sqlite3_bind_double(insert, 9, pos[i].x);
+        sqlite3_bind_double(insert, 10, pos[i].y);
+        sqlite3_bind_double(insert, 11, pos[i].z);
+        sqlite3_bind_double(insert, 12, adjust[i]);
 
         // Insert the new row into the table
         debug("About to insert row: svid=%d\n", SatToSvid(s));
@@ -30,7 +30,8 @@ RawAC12::RawAC12(Stream& s)
     
     // Set up the ephemerides
     for (int s=0; s<MaxSats; s++)
-        eph[s] = new EphemerisXmit(s, "AC12 Broadcast Ephemeris");
+        if (SatToSvid(s) != -1)
+            eph[s] = new EphemerisXmit(s, "AC12 Broadcast Ephemeris");
     
     // We don't have a valid GPS time until we read the first Ephemeris record
     //  (it is the only record with Gps Week)
@@ -66,8 +67,7 @@ MeasurementTag = -1;
 PositionTag = -2;
 
     // Assume no valid measurements until proven otherwise
-    for (int s=0; s<MaxSats; s++)
-        obs[s].Valid = false;
+    obs.Clear();
 
     // Repeat until we have a complete epoch
     //  An epoch is when we receive some raw measurements followed by
@@ -175,19 +175,20 @@ bool RawAC12::ProcessMeasurement(Block& block)
     
     // If the beginning of a new epoch, then clear the observations
     if (MeasurementTag != Tag)
-    for (int s=0; s<MaxSats; s++)
-    obs[s].Valid = false;
+        obs.Clear();
     MeasurementTag = Tag;
     
     // Add in the current observation
     int s = SvidToSat(svid);
-    obs[s].Valid = true;
-    obs[s].PR = range - SmoothCorrection;
-    obs[s].Phase = phase;
-    obs[s].Doppler = doppler;
-    obs[s].SNR = SNR;
-    obs[s].Sat = s;
-    obs[s].Slip = (GoodBad&0xc0) != 0;
+    RawObservation* o = obs.Add(s);
+    if (o == NULL) return Error();
+    o->Valid = true;
+    o->PR = range - SmoothCorrection;
+    o->Phase = phase;
+    o->Doppler = doppler;
+    o->SNR = SNR;
+    o->Sat = s;
+    o->Slip = (GoodBad&0xc0) != 0;
     
     return OK;
 }
@@ -256,6 +257,7 @@ bool RawAC12::ProcessEphemeris(Block& blk)
     byte prnnum = b.Get();         // svid - 1
     e.MinTime = e.t_oe - 2*NsecPerHour;  // TODO: should be based on fit
     e.MaxTime = e.t_oe + 2*NsecPerHour;
+    e.Keep();
     
     e.Display("AC12 Ephemeris Processed");
     
@@ -144,8 +144,7 @@ bool RawAllstar::ProcessEphemeris(Block& block)
 bool RawAllstar::ProcessRawMeasurement(Block& block)
 {
 	// Assume nothing is valid to start
-	for (int s=0; s<MaxSats; s++)
-		obs[s].Valid = false;
+	obs.Clear();
 
 	// Parse the header
 	LittleEndian b(block);
@@ -181,15 +180,17 @@ bool RawAllstar::ProcessRawMeasurement(Block& block)
 			else                                    Adjust[Sat] -= 1024*1024;
 
 		// Save the information
-		obs[Sat].PR = (Tow-floor(Tow)) - CodePhase/(102300*2048);
-		if ( (CarrierPhase&2) != 0) obs[Sat].Phase = 0;
-		else                        obs[Sat].Phase = (CarrierPhase&~3) / 4096.0;
-		obs[Sat].Slip = SlipCount != OldSlipCount[Sat] || (CarrierPhase&3) != 0;
-		obs[Sat].SNR = SNR / 6.0;
-		obs[Sat].Valid = true;
-		obs[Sat].Doppler = 0;
+		RawObservation* o = obs.Add(Sat);
+		if (o == NULL) return Error();
+		o->PR = (Tow-floor(Tow)) - CodePhase/(102300*2048);
+		if ( (CarrierPhase&2) != 0) o->Phase = 0;
+		else                        o->Phase = (CarrierPhase&~3) / 4096.0;
+		o->Slip = SlipCount != OldSlipCount[Sat] || (CarrierPhase&3) != 0;
+		o->SNR = SNR / 6.0;
+		o->Valid = true;
+		o->Doppler = 0;
 		debug("      Sat=%d  PR=%.3f  Phase=%.3f  Slip=%d snr=%.1f \n",
-			Sat, obs[Sat].PR, obs[Sat].Phase, obs[Sat].Slip, obs[Sat].SNR);
+			Sat, o->PR, o->Phase, o->Slip, o->SNR);
 
 		OldSlipCount[Sat] = SlipCount;
 		OldRawPhase[Sat] = RawPhase;
@@ -209,7 +210,8 @@ bool RawAllstar::Initialize()
 
 	// Set up the ephemerides
 	for (int s=0; s<MaxSats; s++)
-		eph[s] = new EphemerisXmit(s, "Allstar");
+		if (SatToSvid(s) != -1)
+			eph[s] = new EphemerisXmit(s, "Allstar");
 
 	for (int s=0; s<MaxSats; s++)
 		OldSlipCount[s] = -1;
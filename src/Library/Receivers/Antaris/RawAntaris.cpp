@@ -184,8 +184,7 @@ bool RawAntaris::ProcessSolution(Block& block)
 bool RawAntaris::ProcessRawMeasurement(Block& block)
 {
     // Assume no satellite has valid observations to start
-    for (int s=0; s<MaxSats; s++)
-        obs[s].Valid = false;
+    obs.Clear();
 
     // Parse the raw observation header
     LittleEndian b(block);
@@ -209,12 +208,14 @@ bool RawAntaris::ProcessRawMeasurement(Block& block)
     
     // Save the information
     int Sat = SvidToSat(SV);
-    obs[Sat].PR = PRMes;
-    obs[Sat].Phase = CPMes;
-    obs[Sat].Doppler = DOMes;
-    obs[Sat].Slip = (LLI&1) != 0;
-    obs[Sat].SNR = CNO;
-    obs[Sat].Valid = true;
+    RawObservation* o = obs.Add(Sat);
+    if (o == NULL) return Error();
+    o->PR = PRMes;
+    o->Phase = CPMes;
+    o->Doppler = DOMes;
+    o->Slip = (LLI&1) != 0;
+    o->SNR = CNO;
+    o->Valid = true;
     debug("      Sat=%d  PR(m)=%.3f  Phase(m)=%.3f Doppler(m)=%3f Slip=%d CNO=%d \n",
     	Sat, PRMes, CPMes*L1WaveLength, DOMes*L1WaveLength, LLI, CNO);
     }
@@ -299,7 +300,8 @@ bool RawAntaris::Initialize()
     
     // Set up the ephemerides
     for (int s=0; s<MaxSats; s++)
-        eph[s] = new EphemerisXmit(s, "Antaris");
+        if (SatToSvid(s) != -1)
+            eph[s] = new EphemerisXmit(s, "Antaris");
     
     if (comm.ReadOnly()) return OK;
     
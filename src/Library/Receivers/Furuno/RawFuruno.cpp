@@ -75,8 +75,7 @@ bool RawFuruno::ProcessPosition(Block& block)
 ///////////////////////////////////////////////////////////////////
 {
     // Clear out the raw measurements
-    for (int s=0; s<MaxSats; s++)
-        obs[s].Valid = false;
+    obs.Clear();
 	
 	// Read in the header
 	BigEndian b(block);
@@ -132,14 +131,16 @@ bool RawFuruno::ProcessPosition(Block& block)
     	if (s == -1) return Error("Furuno - Bad satellite number\n");
     		
     	// Get the raw measurements
-    	obs[s].Valid = true;
-    	obs[s].PR = PR / 32.0;
-    	obs[s].Doppler = Doppler / 32768.0;
-    	obs[s].Phase = ADR / 256.0;
-    	obs[s].SNR = SNR;
+    	RawObservation* o = obs.Add(s);
+    	if (o == NULL) return Error();
+    	o->Valid = true;
+    	o->PR = PR / 32.0;
+    	o->Doppler = Doppler / 32768.0;
+    	o->Phase = ADR / 256.0;
+    	o->SNR = SNR;
     	
     	// if slip count changed, then slipped.
-    	obs[s].Slip = (SlipCnt != PrevSlip[s]);
+    	o->Slip = (SlipCnt != PrevSlip[s]);
     	PrevSlip[s] = SlipCnt;
     }
     
@@ -201,7 +202,8 @@ bool RawFuruno::Initialize()
 
 	// Set up the ephemerides
 	for (int s=0; s<MaxSats; s++)
-		eph[s] = new EphemerisXmit(s, "Furuno");
+		if (SatToSvid(s) != -1)
+			eph[s] = new EphemerisXmit(s, "Furuno");
 		
 	// Clear the slip counts
 	for (int s=0; s<MaxSats; s++)
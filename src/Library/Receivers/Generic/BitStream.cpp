@@ -0,0 +1,70 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "BitStream.h"
+
+
+void BitReader::RefillSlowly()
+// Near the end, a byte at a time. Past the end, zeros.
+{
+	for (; Count <= 56; Count += 8) {
+		uint64 b = (Next < End)? *Next++: 0;
+		Cache |= b << (56 - Count);
+	}
+}
+
+
+void BitReader::Get(const BitField* fields, int nr, void* record)
+// Fill in a struct from a record, according to its table of fields
+{
+	byte* r = (byte*)record;
+	for (int i=0; i<nr; i++) {
+		const BitField& f = fields[i];
+		uint64 value = f.Signed? (uint64)GetSigned(f.Bits): Get(f.Bits);
+		if (f.Offset < 0) continue;
+
+		byte* p = r + f.Offset;
+		switch (f.Size) {
+		case 1: *(unsigned char*)p = value; break;
+		case 2: *(unsigned short*)p = value; break;
+		case 4: *(unsigned int*)p = value; break;
+		case 8: *(unsigned long long*)p = value; break;
+		}
+	}
+}
+
+
+
+void BitWriter::Store()
+// Store the whole bytes, leaving fewer than 8 bits pending
+{
+	for (; Count >= 8; Count -= 8)
+		if (b.Length < Block::Max)
+			b.Data[b.Length++] = Pending >> (Count - 8);
+}
+
+
+void BitWriter::Flush()
+// Store everything, padding the last byte with zeros
+{
+	Store();
+	if (Count > 0 && b.Length < Block::Max)
+		b.Data[b.Length++] = Pending << (8 - Count);
+	Count = 0;
+}
@@ -0,0 +1,134 @@
+#ifndef BITSTREAM_INCLUDED
+#define BITSTREAM_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Comm.h"
+#include <stddef.h>
+
+
+//////////////////////////////////////////////////////////////////
+//
+// BitReader and BitWriter - bit fields packed MSB first, as in RTCM 3.
+//
+//   The reader keeps the next unread bits in a 64 bit register, left
+//   aligned, and refills it with a big endian load of 8 bytes at a time.
+//   A field is then a shift and a mask. Reading past the end gives zeros.
+//
+//   The writer collects bits at the bottom of a 64 bit register and only
+//   stores them in the block when the register is nearly full. Call
+//   Flush() before sending the block.
+//
+//   A field can be up to 56 bits.
+//
+//   A whole record can be described by a table of BitFields, giving the
+//   width of each field and which member of a struct it belongs in.
+//   The tables are built with the macros below, so the layout is worked
+//   out by the compiler, and Get() fills in the struct in a single pass.
+//
+///////////////////////////////////////////////////////////////////
+
+
+struct BitField {
+	int16 Bits;        // width in the record
+	int16 Offset;      // where the value goes in the struct, -1 if it is skipped
+	int8 Size;         // size of the member, in bytes
+	bool Signed;       // two's complement in the record
+};
+
+#define UnsignedField(type, member, bits) {bits, offsetof(type, member), sizeof(((type*)0)->member), false}
+#define SignedField(type, member, bits)   {bits, offsetof(type, member), sizeof(((type*)0)->member), true}
+#define SkipField(bits)                   {bits, -1, 0, false}
+#define NrFields(table) (sizeof(table)/sizeof(table[0]))
+
+
+inline uint64 LoadBigEndian64(const byte* p)
+// Compilers recognize this as a single (byte swapped) load where the hardware allows it
+{
+	return (uint64)p[0]<<56 | (uint64)p[1]<<48 | (uint64)p[2]<<40 | (uint64)p[3]<<32
+	     | (uint64)p[4]<<24 | (uint64)p[5]<<16 | (uint64)p[6]<<8  | (uint64)p[7];
+}
+
+
+class BitReader
+{
+protected:
+	const byte* Next;    // the next byte not yet in the cache
+	const byte* End;
+	uint64 Cache;        // unread bits, starting from the top. The rest are zero
+	int Count;           //   or copies of the bytes at Next.
+
+public:
+	BitReader(const byte* data, size_t len) : Next(data), End(data+len), Cache(0), Count(0) {}
+	BitReader(Block& b) : Next(b.Data), End(b.Data+b.Length), Cache(0), Count(0) {}
+
+	inline uint64 Get(int n)
+	{
+		if (Count < n) Refill();
+		uint64 value = Cache >> (64 - n);
+		Cache <<= n;
+		Count -= n;
+		return value;
+	}
+
+	inline int64 GetSigned(int n) {return (int64)(Get(n) << (64 - n)) >> (64 - n);}
+	inline void Skip(int n) {Get(n);}
+
+	void Get(const BitField* fields, int nr, void* record);
+
+protected:
+	inline void Refill()
+	{
+		// Load as many whole bytes as fit behind the unread bits
+		if (End - Next >= 8) {
+			Cache |= LoadBigEndian64(Next) >> Count;
+			Next += (63 - Count) >> 3;
+			Count |= 56;
+		} else
+			RefillSlowly();
+	}
+	void RefillSlowly();
+};
+
+
+class BitWriter
+{
+protected:
+	Block& b;
+	uint64 Pending;      // bits not yet stored, at the bottom
+	int Count;
+
+public:
+	BitWriter(Block& blk) : b(blk), Pending(0), Count(0) {}
+
+	inline void Put(int64 value, int n)
+	{
+		if (Count + n > 64) Store();
+		Pending = (Pending << n) | ((uint64)value & (~(uint64)0 >> (64 - n)));
+		Count += n;
+	}
+
+	void Flush();
+
+protected:
+	void Store();
+};
+
+
+#endif // BITSTREAM_INCLUDED
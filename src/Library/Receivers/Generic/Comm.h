@@ -30,7 +30,7 @@ class LittleEndian;
 struct Block
 {
 public: // Muddled. Some code looks at Id and length directly
-	static const int Max = 512;
+	static const int Max = 1024;  // room for the longest RTCM 3 message
 	int Length;
 	int Id;
 	byte Data[Max];	
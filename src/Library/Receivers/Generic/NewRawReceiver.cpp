@@ -12,8 +12,11 @@
 
 #include "NewRawReceiver.h"
 #include "InputFile.h"
+#include "MappedInputFile.h"
+#include "StreamReader.h"
 #include "OutputFile.h"
 #include "StreamCopy.h"
+#include "BufferIn.h"
 #include "Rs232.h"
 
 #include "RawTrimble.h"
@@ -41,7 +44,8 @@ RawReceiver* NewRawReceiver(const char* model, const char* port, const char* raw
 
 	//if (Same(model, "GPS18")) return NewRawGarmin(port, raw);
 
-	Stream* s = NewInputStream(port, raw);
+	StreamReader* reader;
+	Stream* s = NewInputStream(port, raw, &reader);
 	if (s == NULL) return NULL;
 
 	// process according to the model of receiver
@@ -66,6 +70,12 @@ RawReceiver* NewRawReceiver(const char* model, const char* port, const char* raw
 		return NULL;
 	}
 
+	// Once set up, a live port is read by a thread of its own
+	if (reader != NULL && reader->Start() != OK) {
+		Error("Unable to start reading port %s\n", port);
+		return NULL;
+	}
+
 	return gps;
 }
 
@@ -92,22 +102,39 @@ Stream* NewOutputStream(const char* PortName)
 }
 	
 
-Stream* NewInputStream(const char* PortName, const char* RawFileName)
+Stream* NewInputStream(const char* PortName, const char* RawFileName, StreamReader** reader)
 {
 	// TODO: fix leaks on error exit.
-	// Open the input, either a com port or a raw input file
-	Stream* port = new Rs232(PortName);
-	ClearError();
-	if ( port == NULL || port->GetError() != OK)
-		port = new InputFile(PortName);
+	// Open the input. An existing file is mapped into memory, 
+	//   otherwise it is a com port or some other kind of raw input file.
+	//   A com port gets a StreamReader, which the caller starts once the
+	//   receiver is set up.
+	Stream* port;
+	StreamReader* live = NULL;
+	bool mapped = MappedFile::IsFile(PortName);
+	if (mapped)
+		port = new MappedInputFile(PortName);
+	else {
+		port = new Rs232(PortName);
+		ClearError();
+		if (port != NULL && port->GetError() == OK)
+			port = live = new StreamReader(*port);
+		else
+			port = new InputFile(PortName);
+	}
 	if (port == NULL || port->GetError() != OK) {
 		Error("Unable to open the GPS raw file %s\n", PortName);
 		return NULL;
 	}
+	if (reader != NULL)
+		*reader = live;
 
-	// If we don't have a raw file, then done.
-	if (RawFileName == NULL)
+	// If we don't have a raw file, then done if the input is mapped
+	//   or has a reader. Otherwise read it a block at a time.
+	if (RawFileName == NULL && (mapped || live != NULL))
 		return port;
+	if (RawFileName == NULL)
+		return NewBufferedStream(*port);
 
 	// Open the raw file for output
 	Stream* raw = new OutputFile(RawFileName);
@@ -124,7 +151,19 @@ Stream* NewInputStream(const char* PortName, const char* RawFileName)
 	}
 
 	ClearError();
-	return copy;
+	return NewBufferedStream(*copy);
+}
+
+
+Stream* NewBufferedStream(Stream& in)
+// Read the stream a block at a time, so decoders don't call it for each byte
+{
+	Stream* buffered = new BufferIn(in);
+	if (buffered == NULL || buffered->GetError() != OK) {
+		Error("Unable to buffer the input stream\n");
+		return NULL;
+	}
+	return buffered;
 }
 
 
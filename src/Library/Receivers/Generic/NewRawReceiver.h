@@ -3,10 +3,12 @@
 
 #include "Stream.h"
 #include "RawReceiver.h"
+#include "StreamReader.h"
 
 RawReceiver* NewRawReceiver(const char* model, const char* port, const char* log = NULL);
-Stream* NewInputStream(const char* port, const char* log = NULL);
+Stream* NewInputStream(const char* port, const char* log = NULL, StreamReader** reader = NULL);
 Stream* NewOutputStream(const char* port);
+Stream* NewBufferedStream(Stream& in);
 
 #endif
 
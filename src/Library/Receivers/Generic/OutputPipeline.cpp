@@ -0,0 +1,292 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "OutputPipeline.h"
+
+
+Mutex EpochCopy::UsersLock;
+
+
+EpochCopy::EpochCopy(RawReceiver& gps, int users)
+: GpsTime(gps.GpsTime), RawTime(gps.RawTime), LeapSec(gps.LeapSec),
+  Pos(gps.Pos), Vel(gps.Vel), Cep(gps.Cep),
+  AntennaHeight(gps.AntennaHeight), obs(gps.obs), Users(users)
+{
+	memcpy(Description, gps.Description, sizeof(Description));
+}
+
+
+void EpochCopy::Release()
+// Done with the epoch. The last sink to finish with it deletes it.
+{
+	UsersLock.Lock();
+	int users = --Users;
+	UsersLock.Unlock();
+	if (users == 0)
+		delete this;
+}
+
+
+
+ReplayReceiver::ReplayReceiver(RawReceiver& gps)
+{
+	memcpy(Description, gps.Description, sizeof(Description));
+	AntennaHeight = gps.AntennaHeight;
+	ErrCode = OK;
+}
+
+
+void ReplayReceiver::Load(EpochCopy& e)
+// Make the copied epoch our current one
+{
+	GpsTime = e.GpsTime;  RawTime = e.RawTime;  LeapSec = e.LeapSec;
+	Pos = e.Pos;  Vel = e.Vel;  Cep = e.Cep;
+	memcpy(Description, e.Description, sizeof(Description));
+	AntennaHeight = e.AntennaHeight;
+	obs = e.obs;
+	FindActive();
+	Load(e.Orbits);
+}
+
+
+void ReplayReceiver::Load(vector<OrbitCopy>& orbits)
+// Bring our copies of the broadcast orbits up to date
+{
+	for (int i=0; i<(int)orbits.size(); i++) {
+		OrbitCopy& o = orbits[i];
+		if (eph[o.Sat] == NULL)
+			eph[o.Sat] = new EphemerisXmit(o.Sat, "Replayed Broadcast Ephemeris");
+		EphemerisXmit& x = *(EphemerisXmit*)eph[o.Sat];
+		*(XmitOrbit*)&x = o.Orbit;
+		x.MinTime = o.MinTime;  x.MaxTime = o.MaxTime;
+		x.Records = o.Records;
+		x.Changed();
+	}
+}
+
+
+
+OutputSink::OutputSink(const char* name, RawReceiver& gps, Policy mode, int depth)
+: Name(name), Gps(gps), Mode(mode), Depth(depth)
+{
+	Queue = new EpochCopy*[Depth];
+	Missed = new vector<OrbitCopy>[Depth];
+	Head = Count = 0;
+	Written = Dropped = Stalls = 0;
+	MostQueued = 0;
+	Failed = Stopping = false;
+}
+
+
+void OutputSink::Put(EpochCopy* e)
+// Queue an epoch, following the policy if the queue is full
+{
+	Lock.Lock();
+	if (Failed || Stopping) {
+		Lock.Unlock();
+		e->Release();
+		return;
+	}
+
+	if (Count == Depth && Mode == DropNewest) {
+		debug("OutputSink(%s): queue full, dropped the new epoch\n", Name);
+		Drop(e, Pending);
+		Lock.Unlock();
+		return;
+	}
+
+	if (Count == Depth && Mode == DropOldest) {
+		debug("OutputSink(%s): queue full, dropped the oldest epoch\n", Name);
+		vector<OrbitCopy>& carried = Missed[Head];
+		Drop(Queue[Head], carried);
+		vector<OrbitCopy>& next = (Count > 1)? Missed[(Head + 1) % Depth]: Pending;
+		carried.insert(carried.end(), next.begin(), next.end());
+		next.swap(carried);
+		carried.clear();
+		Head = (Head + 1) % Depth;
+		Count--;
+	}
+
+	if (Count == Depth) {
+		Stalls++;
+		debug("OutputSink(%s): queue full, waiting\n", Name);
+		while (Count == Depth && !Failed)
+			NotFull.Wait(Lock);
+	}
+
+	// A writer which failed while we waited isn't taking any more
+	if (Failed) {
+		Lock.Unlock();
+		e->Release();
+		return;
+	}
+
+	int slot = (Head + Count) % Depth;
+	Queue[slot] = e;
+	Missed[slot].swap(Pending);
+	Count++;
+	if (Count > MostQueued) MostQueued = Count;
+	NotEmpty.Wake();
+	Lock.Unlock();
+}
+
+
+void OutputSink::Drop(EpochCopy* e, vector<OrbitCopy>& carried)
+// Discard an epoch, adding its orbits to those carried forward. Called with the lock held.
+{
+	carried.insert(carried.end(), e->Orbits.begin(), e->Orbits.end());
+	Dropped++;
+	e->Release();
+}
+
+
+void OutputSink::Run()
+// The sink's thread. Write each epoch as it arrives.
+{
+	for (;;) {
+		Lock.Lock();
+		while (Count == 0 && !Stopping)
+			NotEmpty.Wait(Lock);
+
+		// Once asked to stop, finish what is queued
+		if (Count == 0) {
+			Lock.Unlock();
+			return;
+		}
+		EpochCopy* e = Queue[Head];
+		vector<OrbitCopy> missed;
+		missed.swap(Missed[Head]);
+		Head = (Head + 1) % Depth;
+		Count--;
+		NotFull.Wake();
+		Lock.Unlock();
+
+		// Errors are kept per thread, so show them here
+		bool failed = false;
+		if (!Failed) {
+			Gps.Load(missed);
+			Gps.Load(*e);
+			failed = (Output() != OK);
+			if (failed) {
+				Error("Unable to write the %s output\n", Name);
+				ShowErrors();
+				ClearError();
+			}
+		}
+		e->Release();
+
+		Lock.Lock();
+		if (failed) {Failed = true; NotFull.Wake();}
+		else if (!Failed) Written++;
+		Lock.Unlock();
+	}
+}
+
+
+void OutputSink::Finish()
+// Write out whatever is queued, then stop the thread
+{
+	Lock.Lock();
+	Stopping = true;
+	NotEmpty.Wake();
+	Lock.Unlock();
+	Join();
+
+	// Anything left was never going to be written
+	for (; Count > 0; Count--, Head = (Head + 1) % Depth)
+		Queue[Head]->Release();
+}
+
+
+OutputSink::~OutputSink()
+{
+	Finish();
+	delete[] Queue;
+	delete[] Missed;
+}
+
+
+
+OutputPipeline::OutputPipeline(RawReceiver& gps)
+: Gps(gps)
+{
+	NrSinks = 0;
+	for (int s=0; s<MaxSats; s++) {
+		SeenEph[s] = NULL;
+		SeenIssue[s] = 0;
+	}
+}
+
+
+bool OutputPipeline::Add(OutputSink* sink)
+// Start the sink's thread. The pipeline deletes it when done.
+{
+	if (NrSinks == MaxSinks) return Error("OutputPipeline: too many sinks\n");
+	if (sink->Start() != OK) return Error("Unable to start the %s output\n", sink->Name);
+	Sinks[NrSinks++] = sink;
+	return OK;
+}
+
+
+bool OutputPipeline::OutputEpoch()
+// Hand a copy of the current epoch to each of the sinks
+{
+	if (NrSinks == 0) return OK;
+	EpochCopy* e = new EpochCopy(Gps, NrSinks);
+
+	// Include any broadcast orbits which changed
+	for (int s=0; s<MaxSats; s++) {
+		Ephemeris* eph = Gps.eph[s];
+		if (eph == NULL || (eph == SeenEph[s] && eph->Issue == SeenIssue[s]))
+			continue;
+		SeenEph[s] = eph;
+		SeenIssue[s] = eph->Issue;
+
+		EphemerisXmit* x = dynamic_cast<EphemerisXmit*>(eph);
+		if (x == NULL) continue;
+		e->Orbits.push_back(OrbitCopy());
+		OrbitCopy& o = e->Orbits.back();
+		o.Sat = s;
+		o.Orbit = *x;
+		o.MinTime = x->MinTime;  o.MaxTime = x->MaxTime;
+		o.Records = x->Records;
+	}
+
+	for (int i=0; i<NrSinks; i++)
+		Sinks[i]->Put(e);
+
+	return OK;
+}
+
+
+bool OutputPipeline::GetError()
+// Whether any of the sinks has failed
+{
+	for (int i=0; i<NrSinks; i++)
+		if (Sinks[i]->Failed)
+			return Error("The %s output has failed\n", Sinks[i]->Name);
+	return OK;
+}
+
+
+OutputPipeline::~OutputPipeline()
+{
+	for (int i=0; i<NrSinks; i++)
+		delete Sinks[i];
+}
@@ -0,0 +1,177 @@
+#ifndef OUTPUTPIPELINE_INCLUDED
+#define OUTPUTPIPELINE_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "RawReceiver.h"
+#include "EphemerisXmit.h"
+#include "Thread.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// OutputPipeline - writes each epoch out on threads of its own.
+//
+//   The receiver's epoch is copied once, and the copy is handed by
+//   pointer to every sink. Each sink has a thread and a bounded queue,
+//   so a stalled NTRIP caster or a slow SD card holds up only its own
+//   output, never the thread reading the receiver.
+//
+//   The writers (Rinex, Rtcm3Station, SqliteLogger, ...) are unchanged.
+//   Each one is given a ReplayReceiver which the sink thread loads with
+//   the copied epoch before calling the writer's OutputEpoch().
+//
+//   Only broadcast orbits are carried along with the epochs. They are
+//   copied when a satellite's orbit changes, so an epoch is usually
+//   just the observations. A sink which drops an epoch still keeps
+//   its orbits. They are loaded just ahead of the next epoch queued
+//   after the one dropped, so orbits always arrive in the order sent.
+//
+///////////////////////////////////////////////////////////////////
+
+
+// A broadcast orbit which changed, along with the ones kept from earlier
+struct OrbitCopy
+{
+	int Sat;
+	XmitOrbit Orbit;
+	Time MinTime, MaxTime;
+	vector<XmitOrbit> Records;
+};
+
+
+// One epoch, shared by the sinks until the last one releases it
+class EpochCopy
+{
+public:
+	Time GpsTime;
+	Time RawTime;
+	int LeapSec;
+	Position Pos;
+	Position Vel;
+	double Cep;
+	char Description[21];
+	double AntennaHeight;
+	SatArray<RawObservation, MaxInView> obs;
+	vector<OrbitCopy> Orbits;   // orbits which changed since the previous epoch
+
+	EpochCopy(RawReceiver& gps, int users);
+	void Release();
+
+protected:
+	int Users;
+	static Mutex UsersLock;
+	~EpochCopy() {}
+};
+
+
+// A receiver whose epochs come from copies
+class ReplayReceiver : public RawReceiver
+{
+public:
+	ReplayReceiver(RawReceiver& gps);
+	void Load(EpochCopy& e);
+	void Load(vector<OrbitCopy>& orbits);
+	bool NextEpoch() {return Error("ReplayReceiver: epochs are loaded, not read\n");}
+	virtual ~ReplayReceiver() {}
+};
+
+
+// A thread which writes the epochs queued for it
+class OutputSink : public Thread
+{
+public:
+	// What to do when the queue is full
+	enum Policy {
+		Block,          // wait for room. The output lags, but nothing is lost.
+		DropOldest,     // discard the oldest epoch, keeping the output current
+		DropNewest      // discard the new epoch
+	};
+
+	const char* Name;
+	ReplayReceiver Gps;        // what the writer reads
+
+	// Monitoring, written under the lock
+	volatile uint32 Written;
+	volatile uint32 Dropped;   // epochs discarded because the queue was full
+	volatile uint32 Stalls;    // times a blocking sink held up the caller
+	volatile int MostQueued;   // the furthest the output has lagged, in epochs
+	volatile bool Failed;      // the writer gave an error. Its messages were shown.
+
+protected:
+	Policy Mode;
+	EpochCopy** Queue;
+	int Depth, Head, Count;
+	vector<OrbitCopy>* Missed; // for each queued epoch, orbits from dropped epochs to load first
+	vector<OrbitCopy> Pending; // orbits from dropped epochs, for the next epoch queued
+	bool Stopping;
+	Mutex Lock;
+	Condition NotEmpty, NotFull;
+
+public:
+	OutputSink(const char* name, RawReceiver& gps, Policy mode, int depth);
+	void Put(EpochCopy* e);
+	void Finish();
+	virtual ~OutputSink();
+
+protected:
+	void Drop(EpochCopy* e, vector<OrbitCopy>& carried);
+	virtual bool Output() = 0;
+	virtual void Run();
+};
+
+
+// Adapts a writer to a sink. The writer is created reading from Gps, then attached.
+template <class Writer>
+class WriterSink : public OutputSink
+{
+public:
+	Writer* Out;
+
+	WriterSink(const char* name, RawReceiver& gps, Policy mode, int depth)
+		: OutputSink(name, gps, mode, depth), Out(NULL) {}
+	virtual ~WriterSink() {Finish(); delete Out;}
+
+protected:
+	bool Output() {return Out->OutputEpoch();}
+};
+
+
+class OutputPipeline
+{
+public:
+	static const int MaxSinks = 8;
+	int NrSinks;
+	OutputSink* Sinks[MaxSinks];
+
+protected:
+	RawReceiver& Gps;
+	Ephemeris* SeenEph[MaxSats];    // the orbits as they were last copied
+	uint32 SeenIssue[MaxSats];
+
+public:
+	OutputPipeline(RawReceiver& gps);
+	bool Add(OutputSink* sink);
+	bool OutputEpoch();
+	bool GetError();
+	virtual ~OutputPipeline();
+};
+
+
+#endif // OUTPUTPIPELINE_INCLUDED
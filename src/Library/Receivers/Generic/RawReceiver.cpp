@@ -29,11 +29,21 @@ RawReceiver::RawReceiver()
 	Adjust=0;
 	PreviousTow=0;
 	GpsTime=0;
-	for (int s=0; s<MaxSats; s++) {
-		obs[s].Sat = s;
-		obs[s].Valid = false;
+	for (int s=0; s<MaxSats; s++)
 		PreviousPhase[s] = 0;
-	}
+}
+
+
+
+void RawReceiver::FindActive()
+// Make a list of the valid observations. 
+//   Call after the receiver fills in an epoch, so the rest of the epoch's
+//   processing can skip the satellites which aren't being tracked.
+{
+	Active.Clear();
+	for (int i=0; i<obs.Count(); i++)
+		if (obs[obs.Sat(i)].Valid)
+			Active.Add(obs.Sat(i));
 }
 
 
@@ -58,9 +68,10 @@ bool RawReceiver::AdjustToTime(Time t, bool IncludeDoppler)
 
 
 	// Do for each satellite
-	for (int s=0; s<MaxSats; s++) {
-		RawObservation& o=obs[s];
-		if (!o.Valid) continue;
+	FindActive();
+	for (int i=0; i<Active.Count(); i++) {
+		int s = Active[i];
+		RawObservation& o=obs.Entry(s);
 
             double Doppler = (o.Phase - PreviousPhase[s]) / S(GpsTime - PreviousTime);
             double Doppler2 = (o.Phase - PreviousPhase[s]) / S(RawTime - PreviousRaw);
@@ -108,10 +119,12 @@ bool RawReceiver::AdjustToTime(Time t, bool IncludeDoppler)
 Time RawReceiver::AdjustToHz(Time t, double tow)
 { 
     // Find a valid satellite. 
-	int s;
-	for (s=0; s<MaxSats; s++)
+	int i, s = -1;
+	for (i=0; i<obs.Count(); i++) {
+		s = obs.Sat(i);
 		if (obs[s].Valid && obs[s].PR != 0) break;
-	if (s == MaxSats) return NearestSecond(UpdateGpsTime(t,tow));
+	}
+	if (i == obs.Count()) return NearestSecond(UpdateGpsTime(t,tow));
 
 	// Adjust drifting clock so the pseudorange is 
 	//   within the interval [0..C/4]. Some units, Garmin in particular,
@@ -149,8 +162,9 @@ void RawReceiver::AdjustToTime(Time t, double tow)
 		Week, tow, PreviousTow, DeltaTime, Adjust);
 
 	// Do for each satellite
-	for (int s=0; s<MaxSats; s++) {
-		RawObservation& o=obs[s];
+	for (int i=0; i<obs.Count(); i++) {
+		int s = obs.Sat(i);
+		RawObservation& o=obs.Entry(s);
 		if (!o.Valid) continue;
 
 		// Calculate Doppler as -DeltaPhase/DeltaTime
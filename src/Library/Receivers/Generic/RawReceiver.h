@@ -24,6 +24,8 @@
 #include "GpsReceiver.h"
 #include "Ephemeris.h"
 #include "RawObservation.h"
+#include "SatSet.h"
+#include "SatArray.h"
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -38,6 +40,10 @@
 //     I'm choosing 2) reserving an entry for each satellite.
 //     Although it appears wasteful, in the long run it reduces
 //     complexity and eliminates copying of data.
+//     With several constellations there are too many satellites to
+//     reserve storage for each, so obs is a SatArray: it is still indexed
+//     by satellite, but only satellites in view take up space.
+//     Drivers Add() a satellite before filling in its observation.
 //
 // What is an observation?
 //   - For now, it is a psuedorange and carrier phase measurement
@@ -63,7 +69,8 @@ class RawReceiver : public Ephemerides, public GpsReceiver
 public:
 	// Related to Epoch
 	static int HZ;
-	RawObservation obs[MaxSats];
+	SatArray<RawObservation, MaxInView> obs;
+	SatSet Active;   // satellites with valid observations. See FindActive().
 	Time RawTime;
 
 	double Adjust;  // defunct
@@ -80,6 +87,7 @@ public:
 public:
 	RawReceiver();
 	virtual bool NextEpoch() = 0;
+	void FindActive();
 	virtual ~RawReceiver();
 protected:
 	bool AdjustToHz(bool IncludeDoppler=true);
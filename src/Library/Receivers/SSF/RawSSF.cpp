@@ -30,7 +30,8 @@ RawSSF::RawSSF(Stream& s)
 
 	// Set up the ephemerides
 	for (int s=0; s<MaxSats; s++)
-		eph[s] = new EphemerisXmit(s, "SSF Broadcast Ephemeris");
+		if (SatToSvid(s) != -1)
+			eph[s] = new EphemerisXmit(s, "SSF Broadcast Ephemeris");
 
       // Clear the clock until we find out the week
       GpsTime = -1;
@@ -142,8 +143,7 @@ bool RawSSF::ProcessStartEpoch(Block& blk)
     if (GpsTime == -1) return OK;
 
     // We are starting a new epoch
-    for (int s=0; s<MaxSats; s++)
-        obs[s].Valid = false;
+    obs.Clear();
     
     // Update the time
     GpsTime = UpdateGpsTime(GpsTime, tow/1000);
@@ -204,12 +204,14 @@ bool RawSSF::ProcessRaw(Block& blk)
     if (Sat < 0) return Error("RawSSF::ProcessRaw - Invalid svid (%d)\n", svid);
 
     // Copy the values into the data for the current epoch
-    obs[Sat].PR = pr;
-    obs[Sat].SNR = x2;
-    if ( (status&0xd0) == 0xd0)  obs[Sat].Doppler = -doppler/L1WaveLength;
-    else                         obs[Sat].Doppler = 0;
-    obs[Sat].Phase = -phase - PhaseAdjust;
-    obs[Sat].Valid = true;
+    RawObservation* o = obs.Add(Sat);
+    if (o == NULL) return Error();
+    o->PR = pr;
+    o->SNR = x2;
+    if ( (status&0xd0) == 0xd0)  o->Doppler = -doppler/L1WaveLength;
+    else                         o->Doppler = 0;
+    o->Phase = -phase - PhaseAdjust;
+    o->Valid = true;
 
     // We have processed a measurement. Decrement the remaining count.
     Count--;
@@ -268,16 +270,18 @@ bool RawSSF::ProcessRoverRaw(Block& blk)
     if (Count <= 0) return OK;
 
     // Save the data
-    obs[Sat].PR = 20000000.0 - pr * (C / 1000);
-    obs[Sat].Phase = 0;
-    obs[Sat].SNR = 0;
-    obs[Sat].Doppler = 0;
-    obs[Sat].Valid = true;
+    RawObservation* o = obs.Add(Sat);
+    if (o == NULL) return Error();
+    o->PR = 20000000.0 - pr * (C / 1000);
+    o->Phase = 0;
+    o->SNR = 0;
+    o->Doppler = 0;
+    o->Valid = true;
   
     // Make note we have a new satellite
     Count--;
     
-    debug("ProcessRoverRaw: Sat=%d  PR=%.3f\n", Sat, obs[Sat].PR);
+    debug("ProcessRoverRaw: Sat=%d  PR=%.3f\n", Sat, o->PR);
 
     return OK;
 }
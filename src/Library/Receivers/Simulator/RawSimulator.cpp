@@ -42,23 +42,23 @@ bool RawSimulator::NextEpoch()
 		GpsTime, PhaseError, RangeError);
 
 	// repeat for each valid measurement
-	for (int s=0; s<MaxSats; s++) {
-		obs[s] = gps.obs[s];
+	obs = gps.obs;
+	for (int i=0; i<obs.Count(); i++) {
+		int s = obs.Sat(i);
 		if (!obs[s].Valid || !ephemerides[s].Valid(GpsTime)) continue;
 		
 		// Calculate the actual range to the satellite
 		Position SatPos; double Clock;
-		ephemerides[s].SatPos(GpsTime, SatPos, Clock);
+		ephemerides.SatPos(s, GpsTime, SatPos, Clock);
 		double range = Range(SatPos - Pos);
 		debug("Simulator: Pos=(%.3f, %.3f, %.3f)  SatPos=(%.3f, %.3f, %.3f)\n",
 			Pos.x,Pos.y,Pos.z,  SatPos.x,SatPos.y,SatPos.z);
 
 		// Generate new measurement values
-		obs[s] = gps.obs[s];
 		if (obs[s].PR != 0)
-			obs[s].PR = range; //Normal(range, 1);
+			obs.Entry(s).PR = range; //Normal(range, 1);
 		if (obs[s].Phase != 0)
-			obs[s].Phase = range / L1WaveLength; //Normal(range, .01) / L1WaveLength + PhaseError;
+			obs.Entry(s).Phase = range / L1WaveLength; //Normal(range, .01) / L1WaveLength + PhaseError;
 		debug("RawSimulator: s=%d range=%.3f PR=%.3f Phase=%.3f\n", 
 			                 s, range,      obs[s].PR,  obs[s].Phase);
 	}
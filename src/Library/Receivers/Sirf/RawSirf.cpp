@@ -198,9 +198,9 @@ bool RawSirf::ProcessClock(Block& block)
 	// Adjust Doppler to account for clock drift.
 	// Clock drift is to the nearest nsec, so we may want to calculate
 	//  clock drift ourselves using the Tow from the Navlib message.
-	for (int s=0; s<MaxSats; s++)
-		if (obs[s].Valid)
-			obs[s].Doppler += ClockDrift;
+	for (int i=0; i<obs.Count(); i++)
+		if (obs[obs.Sat(i)].Valid)
+			obs.Entry(obs.Sat(i)).Doppler += ClockDrift;
 
 	// Adjust the measurements to the GpsTime
 	AdjustToHz(GpsTime, Tow);
@@ -290,18 +290,19 @@ bool RawSirf::ProcessNavlibMeasurement(Block& block)
 
 	// If the measurement time has changed, then clear out the old measurements
 	if (Tow != MeasurementTow)
-		for (int s=0; s<MaxSats; s++)
-			obs[s].Valid = false;
+		obs.Clear();
 	PreviousTow = Tow;
 	MeasurementTow = Tow;
 
 	// Keep the observation
-	obs[Sat].PR = PR;
-	obs[Sat].Phase = Phase;
-	obs[Sat].Doppler = -freq / L1WaveLength;  // convert to delta Hz
-	obs[Sat].SNR = SNR;
-	obs[Sat].Valid = true;
-	obs[Sat].Slip = PhaseErrorCount != PreviousPhaseErrorCount[Sat];
+	RawObservation* o = obs.Add(Sat);
+	if (o == NULL) return Error();
+	o->PR = PR;
+	o->Phase = Phase;
+	o->Doppler = -freq / L1WaveLength;  // convert to delta Hz
+	o->SNR = SNR;
+	o->Valid = true;
+	o->Slip = PhaseErrorCount != PreviousPhaseErrorCount[Sat];
 
 	PreviousPhaseErrorCount[Sat] = PhaseErrorCount;
 
@@ -316,7 +317,8 @@ bool RawSirf::Initialize()
 
 	// Create an ephemeris for each satellite
 	for (int s=0; s<MaxSats; s++)
-		eph[s] = new EphemerisXmit(s, "Sirf Star III");
+		if (SatToSvid(s) != -1)
+			eph[s] = new EphemerisXmit(s, "Sirf Star III");
 
 	// Make sure communications are OK;
 	if (comm.GetError() != OK) return Error();
@@ -45,7 +45,8 @@ bool RawTrimble::Initialize()
 	for (int32 s=0; s<MaxSats; s++) {
 
 		// Create a transmitted ephemeris
-		eph[s] = new EphemerisXmit(s, "Trimble Lassen IQ");
+		if (SatToSvid(s) != -1)
+			eph[s] = new EphemerisXmit(s, "Trimble Lassen IQ");
 
 	    // In the beginning, the integrated doppler is zero.
 		//  (zero means "invalid phase", so make it very close to zero)
@@ -167,8 +168,7 @@ bool RawTrimble::ProcessRawData(Block& blk)
 
 	// If we are in a different epoch, then start with clean observations
 	if (CurrentTime != MeasurementTime)
-		for (int s = 0; s<MaxSats; s++)
-			obs[s].Valid = false;
+		obs.Clear();
 	MeasurementTime = CurrentTime;
 	if (MeasurementTime % NsecPerSec != 0) debug("measurement time not on epoch\n");
 
@@ -196,15 +196,17 @@ bool RawTrimble::ProcessRawData(Block& blk)
 	// TODO: On pseudo range calculation, check for clock adjustments
 	//   which might mean adding or subtracting a msec.
 	//   (maybe clock bias should be part of it?)
-	obs[Sat].PR = PR;
-	obs[Sat].Valid = true;
-	obs[Sat].Phase = -IntegratedDoppler[Sat];  // set to zero instead?
-	obs[Sat].Doppler = Doppler;
-	obs[Sat].Slip = false;
-	obs[Sat].SNR = SignalLevel * 6;
+	RawObservation* o = obs.Add(Sat);
+	if (o == NULL) return Error();
+	o->PR = PR;
+	o->Valid = true;
+	o->Phase = -IntegratedDoppler[Sat];  // set to zero instead?
+	o->Doppler = Doppler;
+	o->Slip = false;
+	o->SNR = SignalLevel * 6;
 
 	debug("  Sat=%d  PR=%.3f  CaInt=%.0f  CaPhase=%.6f Phase=%.3f  SNR=%g\n",
-		     Sat, obs[Sat].PR, CaInt, CaPhase, obs[Sat].Phase, obs[Sat].SNR);
+		     Sat, o->PR, CaInt, CaPhase, o->Phase, o->SNR);
 
 	return OK;
 }
@@ -311,6 +313,7 @@ bool RawTrimble::ProcessSatData(Block& blk)
 	// LATER. For now, assume valid for two hours
 	e.MinTime = e.t_oe - 2*NsecPerHour;
 	e.MaxTime = e.t_oe + 2*NsecPerHour;
+	e.Changed();
 	e.Display();
 
 	// Check for validity. Trimble may not have data yet.
@@ -319,6 +322,7 @@ bool RawTrimble::ProcessSatData(Block& blk)
 		e.MaxTime = -2;
 		return OK;
 	}
+	e.Keep();
 
 	// Schedule a later update
 	GotEphemeris(s);
@@ -38,9 +38,7 @@ bool RawRinex::Initialize(int baud)
 	if (In.GetError() != OK)
 		return Error("Unable to open Rinex input file\n");
 
-	// Create dummy ephemerides
-	for (int s=0; s<MaxSats; s++)
-		eph[s] = new EphemerisDummy(s, "Rinex Dummy Ephemeris");
+	// No ephemerides in an observation file. Ephemerides[] gives out a dummy.
 
 	return ReadHeader();
 }
@@ -112,8 +110,7 @@ bool RawRinex::ReadHeader()
 
 bool RawRinex::NextEpoch()
 {
-    for (int s=0; s<MaxSats; s++)
-		obs[s].Valid = false;
+    obs.Clear();
 
 	// Repeat until we get an epoch flag indicating data
 	int EpochFlag;
@@ -152,13 +149,10 @@ bool RawRinex::ProcessObservations(char* line)
 	int NrSats = GetInt(line, 30, 3);
 
 	// Get the id of the first 12 satellites
-	byte sats[MaxSats];
-	for (int i=0; i<NrSats && i<MaxSatsPerLine; i++) {
-		int svid = ParseSvid(line, 32+3*i);
-		if (svid == -1) 
-			return Error("Bad Rinex SVID: i=%d line=%s\n", i, line);
-		sats[i] = (byte)SvidToSat(svid);
-	}
+	//   Satellites from unregistered constellations are -1, and are skipped.
+	int sats[MaxSats];
+	for (int i=0; i<NrSats && i<MaxSatsPerLine; i++)
+		sats[i] = ParseSat(line, 32+3*i);
 
 	// Get the remaining ids, reading continuation lines as needed
 	//  Note: merge this with previous block of code
@@ -166,20 +160,22 @@ bool RawRinex::ProcessObservations(char* line)
 		char line[128];
 		if ( (i%MaxSatsPerLine) == 0)
 		    if (ReadLine(line, sizeof(line)) != OK) return Error();
-		int svid = ParseSvid(line, 32+3*(i%MaxSatsPerLine));
-		if (svid == -1)
-		    return Error("Bad Rinex SVID: i=$d line=%s\n", i, line);
-		sats[i] = SvidToSat(svid);
+		sats[i] = ParseSat(line, 32+3*(i%MaxSatsPerLine));
 	}
 
 	// Do for each satellite in view
 	for (int i=0; i<NrSats; i++) {
 		int Sat = sats[i];
-		RawObservation& o=obs[Sat];
+
+		// A satellite we can't number is read into a scratch entry and forgotten
+		RawObservation skipped;
+		RawObservation* o = &skipped;
+		if (Sat == -1) debug("Rinex: skipping satellite from unknown constellation\n");
+		else if ((o = obs.Add(Sat)) == NULL) return Error();
 
 		// Set defaults in case we don't have measurement
-		o.PR = o.Phase = o.SNR = o.Doppler = 0;
-		o.Valid = true;
+		o->PR = o->Phase = o->SNR = o->Doppler = 0;
+		o->Valid = true;
 
 		// Do for each observation in the RINEX file
 		for (int j=0; j<NrMeasurements; j++) {
@@ -192,13 +188,13 @@ bool RawRinex::ProcessObservations(char* line)
 
 			// Process according to the measurement type
 			if (j == L1Index) 
-				ParsePhaseObservation(line, col, o.Phase, o.Slip, o.SNR);
+				ParsePhaseObservation(line, col, o->Phase, o->Slip, o->SNR);
             else if (j == C1Index)
-				ParseObservation(line, col, o.PR, o.SNR);
+				ParseObservation(line, col, o->PR, o->SNR);
 			else if (j == S1Index)
-				ParseObservation(line, col, o.SNR, o.SNR);
+				ParseObservation(line, col, o->SNR, o->SNR);
 			else if (j == D1Index)
-				ParseObservation(line, col, o.Doppler, o.SNR);
+				ParseObservation(line, col, o->Doppler, o->SNR);
 		}
 	}
 
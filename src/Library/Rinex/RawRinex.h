@@ -62,8 +62,8 @@ public:
 	bool NextEpoch()
 	{
 		bool ret = RawRinex::NextEpoch();
-		for (int s=0; s<MaxSats; s++)
-			obs[s].Phase = -obs[s].Phase;
+		for (int i=0; i<obs.Count(); i++)
+			obs.Entry(obs.Sat(i)).Phase = -obs[obs.Sat(i)].Phase;
 		return ret;
 	}
 };
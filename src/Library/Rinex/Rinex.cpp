@@ -47,8 +47,7 @@ bool Rinex::Initialize()
 	// Make sure the gps is OK;
 	if (Gps.GetError() != OK || Out.GetError() != OK) return Error();
 
-	for (int s=0; s<MaxSats; s++)
-		PreviouslyValid[s] = false;
+	PreviouslyValid.Clear();
 
 	return OK;
 }
@@ -117,12 +116,14 @@ bool Rinex::WriteObservation()
 	// print the EPOCH flag
 	Out.Printf("  0");  // Assume OK for now
 
-	// Get a list of satellites in current epoch
-	int sats[MaxChannels];
+	// Get a list of satellites in current epoch. (GPS and SBAS only)
+	int sats[MaxInView];
     int count = 0;
-	for (int s=0; s<MaxSats; s++)
-		if (Gps.obs[s].Valid)
+	for (int i=0; i<Gps.obs.Count(); i++) {
+		int s = Gps.obs.Sat(i);
+		if (Gps.obs[s].Valid && SatToSvid(s) != -1)
 			sats[count++] = s;
+	}
 
 	 // Print the first 12 satellites
      Out.Printf("%3d", count);
@@ -149,11 +150,11 @@ bool Rinex::WriteObservation()
 	 //////////////////////////////////////////////////////
 
 	 // Do for each satellite
-	 for (int s=0; s<MaxSats; s++) {
-         RawObservation& o = Gps.obs[s];
-		 if (!o.Valid) continue;
+	 for (i=0; i<count; i++) {
+		 int s = sats[i];
+         const RawObservation& o = Gps.obs[s];
 
-		 bool Slip = o.Slip || !PreviouslyValid[s];
+		 bool Slip = o.Slip || !PreviouslyValid.Contains(s);
 
 		 // if we are going to overflow, then reset
 		 if (o.Phase+PhaseAdjust[s] > 999999999.999 || 
@@ -193,8 +194,9 @@ bool Rinex::WriteObservation()
 	 }
 
 	 // Remember which satellites were valid
-	 for (int s=0; s<MaxSats; s++)
-		 PreviouslyValid[s] = Gps.obs[s].Valid;
+	 PreviouslyValid.Clear();
+	 for (i=0; i<count; i++)
+		 PreviouslyValid.Add(sats[i]);
 
 	return OK;
 }
@@ -29,7 +29,7 @@ protected:
 	RawReceiver& Gps;
 	bool ErrCode;
 
-	bool PreviouslyValid[MaxSats];
+	SatSet PreviouslyValid;
 	double PhaseAdjust[MaxSats];
 	bool FirstEpoch;
 
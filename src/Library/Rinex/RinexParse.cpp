@@ -92,3 +92,21 @@ int32 ParseSvid(char* line, int col)
 		return -1;
 }
 
+
+int32 ParseSat(char* line, int col)
+/////////////////////////////////////////////////////////
+// Convert a Satellite Id string to a satellite index
+//     Gnn GPS, Snn SBAS, Rnn GLONASS, Enn Galileo, Cnn BeiDou
+//     -1 if the constellation isn't registered.
+/////////////////////////////////////////////////////////
+{
+	char letter = line[col];
+	if (letter == ' ') letter = 'G';
+	int system = LetterToSystem(letter);
+
+	int prn = GetInt(line, col+1, 2);
+	if (system == SBAS) prn += 100;
+
+	return SatIndex(system, prn);
+}
+
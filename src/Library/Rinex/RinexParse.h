@@ -26,6 +26,7 @@ bool match(char* line, int column, char* pattern);
 double GetDouble(char* line, int column, int width);
 int32 GetInt(char* line, int column, int width);
 int32 ParseSvid(char* line, int column);
+int32 ParseSat(char* line, int column);
 
 #endif // !defined(AFX_PARSE_H__AEF62A65_4376_435C_936E_E8BAF2464707__INCLUDED_)
 
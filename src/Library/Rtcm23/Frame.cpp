@@ -27,7 +27,7 @@ inline uint32 ExtractBits(uint32 word, int32 BitNr, int32 NrBits)
 // ExtractBits extracts a bit field where bit 0 is MSB
 //////////////////////////////////////////////////////////////
 {
-	return (word<<BitNr)>>(32-NrBits);
+	return ((word<<BitNr) & 0xffffffff) >> (32-NrBits);
 }
 
 inline int32 ExtractSigned(uint32 word, int bitnr, int nrbits)
@@ -35,13 +35,13 @@ inline int32 ExtractSigned(uint32 word, int bitnr, int nrbits)
 // ExtractSigned extracts a signed bit field where bit 0 is MSB
 ////////////////////////////////////////////////////////////////////
 {
-	return ((int32)word<<bitnr)>>(32-nrbits);
+	return (int32)((int)(word<<bitnr) >> (32-nrbits));
 }
 
 inline uint32 InsertBits(uint32 value, uint32 word, int bitnr, int nrbits)
 {
 	uint32 mask = (~0u << (32-nrbits)) >> bitnr;
-	value =       (value << (32-nrbits)) >> bitnr;
+	value =       ((value << (32-nrbits)) & 0xffffffff) >> bitnr;
 	debug("InsertBits value=0x%x mask=0x%08x word=0x%08x bitnr=%d nrbits=%d\n",
 		value, mask, word, bitnr, nrbits);
 	return (word & ~mask) | value;	
@@ -49,6 +49,18 @@ inline uint32 InsertBits(uint32 value, uint32 word, int bitnr, int nrbits)
 
 
 
+/////////////////////////////////////////////////////////////////
+// The six parity bits are each the parity of some of the 24 data bits,
+//   so they can be worked out a byte at a time. ParityTable[i][b] holds
+//   the parity bits (D25 at the top) for byte i of the data being b.
+//   The bytes' contributions are xor'ed together, along with D29* and
+//   D30* from the previous word.
+/////////////////////////////////////////////////////////////////
+
+static const uint32 ParityMask[6] = {0xec7cd2, 0x763e69, 0xbb1f34, 0x5d8f9a, 0xaec7cd, 0x2dea27};
+
+byte ParityTable[3][256];
+
 inline uint32 Parity(uint32 w)
 /////////////////////////////////////////////////////////////////
 // Parity calculates the parity (0 or 1) of a word
@@ -62,28 +74,30 @@ inline uint32 Parity(uint32 w)
 	return (w&1);
 }
 
+static void MakeParityTables()
+{
+	for (int i=0; i<3; i++)
+		for (int b=0; b<256; b++) {
+			uint32 data = (uint32)b << (16 - 8*i);
+			byte p = 0;
+			for (int k=0; k<6; k++)
+				p = (p<<1) | Parity(data & ParityMask[k]);
+			ParityTable[i][b] = p;
+		}
+}
+
+// Build the tables before anyone needs them
+static struct ParityTables {ParityTables() {MakeParityTables();}} Tables;
+
 
 uint32 CalculateParity(uint32 word, uint32 PrevD29, uint32 PrevD30)
 /////////////////////////////////////////////////////////////////
 // CalculateParity calculates the 6 bit parity for a word
 /////////////////////////////////////////////////////////////////
 {   
-	// Extract the 24 data bits, complementing if necessary
-	//  (can adjust the bit masks and avoid the extract - later)
-	uint32 data;
-	if (PrevD30) data = ExtractBits(~word, 2, 24);
-	else         data = ExtractBits( word, 2, 24);
-
-	// compute the desired parity bits
-	uint32 D25 = PrevD29 ^ Parity(data & 0xec7cd2);
-	uint32 D26 = PrevD30 ^ Parity(data & 0x763e69);
-	uint32 D27 = PrevD29 ^ Parity(data & 0xbb1f34);
-	uint32 D28 = PrevD30 ^ Parity(data & 0x5d8f9a);
-	uint32 D29 = PrevD30 ^ Parity(data & 0xaec7cd);
-	uint32 D30 = PrevD29 ^ Parity(data & 0x2dea27);
-	uint32 parity = (D25<<5) + (D26<<4) + (D27<<3) + (D28<<2) + (D29<<1) + D30;
-
-	return parity;
+	// The data bits, complementing if necessary
+	if (PrevD30) word = ~word;
+	return TransmittedParity(word, PrevD29, PrevD30);
 }
 
 
@@ -97,19 +111,14 @@ uint32 AddParity(uint32 data, uint32 PrevD29, uint32 PrevD30)
 	return word;
 }
 
-bool CheckParity(uint32 word)
-{
-	return CheckParity(word, (word>>31)&1, (word>>30)&1);
-}
-
 bool CheckParity(uint32 word, uint32 PrevD29, uint32 PrevD30)
 {
+	// Complementing the data to remove it, then again to calculate parity, 
+	//   leaves the bits as they were.
 	uint32 parity = word & 0x3f;
-	uint32 data = (PrevD30)? ~word: word;
-	data = data & 0x3fffffc0;
-	bool ret = (parity != CalculateParity(data, PrevD29, PrevD30));
-	//debug("CheckParity: data=%08x  PrevD29=%d  PrevD30=%d  word=%08x  %s\n",
-	//		            data,     PrevD29,     PrevD30,   word,   (ret)?"BAD":"");
+	bool ret = (parity != TransmittedParity(word, PrevD29, PrevD30));
+	//debug("CheckParity: PrevD29=%d  PrevD30=%d  word=%08x  %s\n",
+	//		      PrevD29,     PrevD30,   word,   (ret)?"BAD":"");
     return ret;
 }
 
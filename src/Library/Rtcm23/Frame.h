@@ -47,10 +47,30 @@ public:
 };
 
 uint32 AddParity(uint32 w, uint32 PrevD29, uint32 PrevD30);
-bool CheckParity(uint32 w);
 bool CheckParity(uint32 w, uint32 PrevD29, uint32 PrevD30);
 uint32 RemoveParity(uint32 w);
 uint32 RemoveParity(uint32 w, uint32 PrevD29, uint32 PrevD30);
 
+
+// Parity a byte at a time (see Frame.cpp). CheckParity is inline since
+//   synchronizing checks the word at every bit position.
+extern byte ParityTable[3][256];
+
+inline uint32 TransmittedParity(uint32 word, uint32 PrevD29, uint32 PrevD30)
+// The parity of the 24 data bits of a word, exactly as they appear in it
+{
+	uint32 parity = ParityTable[0][(word>>22)&0xff] ^ ParityTable[1][(word>>14)&0xff]
+	              ^ ParityTable[2][(word>>6)&0xff];
+	if (PrevD29) parity ^= 0x29;   // D25, D27 and D30
+	if (PrevD30) parity ^= 0x16;   // D26, D28 and D29
+	return parity;
+}
+
+inline bool CheckParity(uint32 word)
+// Checks a word which has D29 and D30 of the previous word above it
+{
+	return (word & 0x3f) != TransmittedParity(word, (word>>31)&1, (word>>30)&1);
+}
+
 #endif // FRAME_INCLUDED
 
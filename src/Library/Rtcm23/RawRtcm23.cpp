@@ -29,7 +29,9 @@ RawRtcm23::RawRtcm23(Stream& in)
     for (int s=0; s<MaxSats; s++) {
         CarrierLossCount[s] = -1;
         PreviousPhase[s] = 0;
-        eph[s] = new EphemerisXmit(s, "Rtcm23 3.1");
+        HasPhase[s] = false;
+        if (SatToSvid(s) != -1)
+            eph[s] = new EphemerisXmit(s, "Rtcm23 3.1");
     }
 
     PreviousReceiverTime = -1;
@@ -41,8 +43,9 @@ RawRtcm23::RawRtcm23(Stream& in)
 bool RawRtcm23::NextEpoch()
 {
 	// Clear out our observations
-	for (int s=0; s<MaxSats; s++)
-		obs[s].Valid = HasPhase[s] = false;
+	for (int i=0; i<obs.Count(); i++)
+		HasPhase[obs.Sat(i)] = false;
+	obs.Clear();
 	MoreToCome = true;
 	EpochTow = -1;
 
@@ -90,8 +93,8 @@ bool RawRtcm23::NextEpoch()
 	}
 
 	// valid observations have both code and phase. (NOTE: CHANGE!!!)
-	for (int s=0; s<MaxSats; s++)
-		obs[s].Valid &= HasPhase[s];
+	for (int i=0; i<obs.Count(); i++)
+		obs.Entry(obs.Sat(i)).Valid &= HasPhase[obs.Sat(i)];
 
 	// Normalize the results
 	GpsTime = ConvertGpsTime(Week, EpochTow);
@@ -155,13 +158,15 @@ bool RawRtcm23::ProcessCarrierPhase(Frame& f)
 		int svid = f.GetField(4+2*i, 4, 8);
 		int Sat = SvidToSat(svid);
 		if (Sat == -1) return Error("RawRtcm23: didn't recognize svid=%d\n", svid);
+		RawObservation* o = obs.Add(Sat);
+		if (o == NULL) return Error();
 		HasPhase[Sat] = true;
 
 		// Phase
 		int64 phase = (f.GetSigned(4+2*i, 17, 24)<<24) | f.GetField(5+2*i, 1, 24);
-		obs[Sat].Phase = phase / -256.0;
+		o->Phase = phase / -256.0;
 
-		obs[Sat].Doppler = 0;
+		o->Doppler = 0;
 
 		// TODO: Handle phase rollover.
 		//  for now, it will be caught as an outlier
@@ -171,13 +176,13 @@ bool RawRtcm23::ProcessCarrierPhase(Frame& f)
 
 		// Slipped?
 		int32 LossCount = f.GetField(4+2*i, 12, 16);
-		obs[Sat].Slip = (LossCount == CarrierLossCount[Sat]);
-		if (obs[Sat].Slip)
+		o->Slip = (LossCount == CarrierLossCount[Sat]);
+		if (o->Slip)
 			CarrierLossCount[Sat] = LossCount;
 
 		// More?
 		MoreToCome = (f.GetField(4+2*i, 1, 1) != 0);
-		debug("RawRtcm23: Sat=%d  Phase=%.3f  MoreToComm=%d\n", Sat,obs[Sat].Phase, MoreToCome);
+		debug("RawRtcm23: Sat=%d  Phase=%.3f  MoreToComm=%d\n", Sat,o->Phase, MoreToCome);
 	}
 
 	return OK;
@@ -206,22 +211,24 @@ bool RawRtcm23::ProcessPseudorange(Frame& f)
 		int svid = f.GetField(4+2*i, 4, 8);
 		if (svid == 0) svid = 32;
 		int Sat = SvidToSat(svid);
-		obs[Sat].Valid = true;
+		RawObservation* o = obs.Add(Sat);
+		if (o == NULL) return Error();
+		o->Valid = true;
 
 		// Pseudorange
 		uint32 pr = (f.GetField(4+2*i, 17, 24)<<24) | f.GetField(5+2*i, 1, 24);
-		obs[Sat].PR = pr / 50.0;
+		o->PR = pr / 50.0;
 		debug("RawRtcm23::ProcessPseudorange  s=%d  PR=%.3f  pr=0x%08x\n",
-			                                Sat, obs[Sat].PR, pr);
+			                                Sat, o->PR, pr);
 
 		// Quality
 		int DataQual = f.GetField(4+2*i, 9, 12);
 		int Multipath = f.GetField(4+2*i, 13, 16);
-		obs[Sat].SNR = DataQual;  // For now. We need to do better.
+		o->SNR = DataQual;  // For now. We need to do better.
 
 		// More?
 		MoreToCome = (f.GetField(4+2*i, 1, 1) != 0);
-		debug("RawRtcm23: Sat=%d  PR=%.3f  MoreToComm=%d\n", Sat,obs[Sat].PR, MoreToCome);
+		debug("RawRtcm23: Sat=%d  PR=%.3f  MoreToComm=%d\n", Sat,o->PR, MoreToCome);
 	}
 
 	return OK;
@@ -38,14 +38,16 @@ Rtcm23In::Rtcm23In(Stream& s)
 {
 	RawWord = 0;
 	BitShift = 0;
+	Next = End = 0;
 	ErrCode = In.GetError();
 }
 
 
 bool Rtcm23In::ReadFrame(Frame& f, bool& slip)
 {
-	// Start with an empty frame and expect just the header
-	f.Init();
+	// Start with an empty frame and expect just the header.
+	//   The words are stored as they arrive; nothing needs clearing.
+	f.NrWords = 0;
 	int Length = 2;
 	slip = false;
 
@@ -55,23 +57,23 @@ bool Rtcm23In::ReadFrame(Frame& f, bool& slip)
 		if (ReadWord(word, wordslip) != OK) 
 			return Error();
 
-		// if any problems, reset the frame
+		// if any problems, start the frame over with this word
 		slip |= wordslip;
 		if (wordslip)
-			f.Init();
+			f.NrWords = 0;
 
 		// Add the word to the frame
-		f.AddWord(word);
+		f.Data[f.NrWords++] = word;
 
 		// CASE: word 1, make sure there is a preamble.
-		if (f.NrWords == 1 && f.GetField(1, 1, 8) != 0x66){
-			f.Init();  
+		if (f.NrWords == 1 && (word>>22) != 0x66) {
+			f.NrWords = 0;
 			slip=true;
 		}
 
 		// CASE: word 2, get the length
 		else if (f.NrWords == 2)
-			Length = f.GetField(2, 17, 21);
+			Length = (word>>9) & 0x1f;
 	}
 
 	if (slip) debug("Frame slipped!\n");
@@ -81,14 +83,33 @@ bool Rtcm23In::ReadFrame(Frame& f, bool& slip)
 }
 
 
+bool Rtcm23In::Fill()
+// Read whatever the stream has for us
+{
+	size_t actual;
+	if (In.Read(Buf, sizeof(Buf), actual) != OK) return Error();
+	if (actual == 0) return Error("Rtcm23In: read timed out\n");
+	Next = 0;
+	End = actual;
+	return OK;
+}
+
+
+inline bool Rtcm23In::ReadByte(byte& b)
+// The next 6 bit byte, with its bits in the right order
+{
+	if (Next == End && Fill() != OK) return Error();
+	b = Reverse[Buf[Next++]&0x3f];
+	return OK;
+}
+
 
 bool Rtcm23In::ReadWord(uint32& word, bool& slip)
 {
 	// read 5 bytes and shift them into the raw data 
 	for (int i=0; i<5; i++) {
 		byte b;
-		if (In.Read(b) != OK) return Error();
-		b = Reverse[b&0x3f];
+		if (ReadByte(b) != OK) return Error();
 		RawWord = (RawWord<<6) | b;
 	}
 
@@ -116,14 +137,11 @@ bool Rtcm23In::Synchronize(uint32& word)
 		// If the high order 6-bit byte ran out of bits, ...
 		if (BitShift < 0) {
 
-            // ... Read a new 6 bit byte
+            // ... shift a new 6 bit byte onto the word
 	        byte b;
-	        if (In.Read(b) != OK) return Error();
-	        b = Reverse[b&0x3f];
-
-	       // ... shift the new byte onto the word
-	       RawWord = (RawWord << 6) | b;
-		   BitShift = 5;
+	        if (ReadByte(b) != OK) return Error();
+	        RawWord = (RawWord << 6) | b;
+		    BitShift = 5;
 		}
 
 		// Extract the word from the bit stream
@@ -25,10 +25,14 @@ class Rtcm23In  // Later, make this CommRtcm23
 {
 protected:
 	Stream& In;
-	uint64 RawWord;
-	int BitShift;
+	uint64 RawWord;      // the most recent 6 bit bytes, the newest at the bottom
+	int BitShift;        // where the current word sits in RawWord
 	bool ErrCode;
 
+	// Bytes read ahead from the stream
+	byte Buf[512];
+	int Next, End;
+
 public:
 	Rtcm23In(Stream& in);
 	bool ReadFrame(Frame& f, bool& slip);
@@ -37,6 +41,8 @@ public:
 private:
 	bool ReadWord(uint32& word, bool& slip);
 	bool Synchronize(uint32& word);
+	inline bool ReadByte(byte& b);
+	bool Fill();
 };
 
 #endif // Rtcm23IN_INCLUDED
@@ -42,10 +42,9 @@ Rtcm23Station::Rtcm23Station(Stream& out, RawReceiver& gps, int id, int health)
 		EphemerisTime[s] = -1;
 
 	// We also need to keep track of slips
-	for (int s=0; s<MaxSats; s++) {
-		PreviouslyValid[s] = false;
+	PreviouslyValid.Clear();
+	for (int s=0; s<MaxSats; s++)
 		CumulativeLossOfLock[s] = 0;
-	}
 }
 
 
@@ -154,7 +153,8 @@ bool Rtcm23Station::OutputPseudorange(Time& NextTime)
 	Frame Rtcm23(3);
 
 	// Do for each valid satellite
-	for (int s=0; s<MaxSats; s++) {
+	for (int i=0; i<Gps.obs.Count(); i++) {
+		int s = Gps.obs.Sat(i);
 		if (!Gps.obs[s].Valid) continue;
 
 		// get the satid
@@ -204,11 +204,12 @@ bool Rtcm23Station::OutputCarrierPhase(Time& NextTime)
 	Frame Rtcm23(3);
 
 	// Do for each satellite
-	for (int s=0; s<MaxSats; s++) {
+	for (int i=0; i<Gps.obs.Count(); i++) {
+		int s = Gps.obs.Sat(i);
 		if (!Gps.obs[s].Valid) continue;
 
 		// Check for loss of lock or gain of new satellite
-		bool Slip = Gps.obs[s].Slip || !PreviouslyValid[s];
+		bool Slip = Gps.obs[s].Slip || !PreviouslyValid.Contains(s);
 
 		// If slipped, keep track of the cumulative and reset the close to zero
 		if (Slip) {
@@ -236,8 +237,10 @@ bool Rtcm23Station::OutputCarrierPhase(Time& NextTime)
 	}
 
 	// Keep track of which sats were valid
-	for (int s=0; s<MaxSats; s++)
-		PreviouslyValid[s] = Gps.obs[s].Valid;
+	PreviouslyValid.Clear();
+	for (int i=0; i<Gps.obs.Count(); i++)
+		if (Gps.obs[Gps.obs.Sat(i)].Valid)
+			PreviouslyValid.Add(Gps.obs.Sat(i));
 	
 	// create Rtcm23 header
 	Header(Rtcm23, Gps.GpsTime, 18);
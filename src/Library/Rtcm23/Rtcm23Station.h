@@ -48,7 +48,7 @@ protected:
 
 	// Some information to keep track of whether we are locked to each satellite
     uint32 CumulativeLossOfLock[MaxSats];
-    bool PreviouslyValid[MaxSats];
+    SatSet PreviouslyValid;
 	double PhaseAdjust[MaxSats];
 
 public:	
@@ -20,14 +20,22 @@
 
 
 #include "Comm.h"
+#include "Rtcm3Framer.h"
 
 
 class CommRtcm3 : public Comm
 {
+protected:
+	Rtcm3Framer Framer;
+
 public:
 	CommRtcm3(Stream& out);
 	virtual bool PutBlock(Block& blk);
         virtual bool GetBlock(Block& blk);
+
+	// The next message, without copying it. Valid until the next one is read.
+	bool GetFrame(Rtcm3Frame& f);
+	Rtcm3Framer& GetFramer() {return Framer;}
 	virtual ~CommRtcm3(void);
 };
 
@@ -20,6 +20,71 @@
 
 #include "RawRtcm3.h"
 #include "EphemerisXmit.h"
+#include "BitStream.h"
+
+
+// The layout of the records, in the order the fields are sent
+
+struct ObservationHeader {
+    int MessageId, StationId, Tow, Synch, NrSats, Smoothing, Interval;
+};
+static const BitField ObservationHeaderFields[] = {
+    UnsignedField(ObservationHeader, MessageId, 12),
+    UnsignedField(ObservationHeader, StationId, 12),
+    UnsignedField(ObservationHeader, Tow, 30),
+    UnsignedField(ObservationHeader, Synch, 1),
+    UnsignedField(ObservationHeader, NrSats, 5),
+    UnsignedField(ObservationHeader, Smoothing, 1),
+    UnsignedField(ObservationHeader, Interval, 3)
+};
+
+struct L1Observation {
+    int Svid, Code, iPR, iDelta, Modulus, LockTime, Snr;
+};
+static const BitField L1ObservationFields[] = {
+    UnsignedField(L1Observation, Svid, 6),
+    UnsignedField(L1Observation, Code, 1),
+    UnsignedField(L1Observation, iPR, 24),
+    SignedField(L1Observation, iDelta, 20),
+    UnsignedField(L1Observation, Modulus, 8),
+    UnsignedField(L1Observation, LockTime, 7),
+    UnsignedField(L1Observation, Snr, 8)
+};
+
+static const BitField EphemerisFields[] = {
+    SkipField(12),                                  // message id
+    UnsignedField(EphemerisXmitRaw, svid, 6),
+    UnsignedField(EphemerisXmitRaw, wn, 10),
+    UnsignedField(EphemerisXmitRaw, acc, 4),
+    SkipField(2),                                   // code on L2
+    SignedField(EphemerisXmitRaw, idot, 14),
+    UnsignedField(EphemerisXmitRaw, iode, 8),
+    UnsignedField(EphemerisXmitRaw, t_oc, 16),
+    SkipField(8),                                   // replaced by the 22 bit term
+    SignedField(EphemerisXmitRaw, a_f1, 16),
+    SignedField(EphemerisXmitRaw, a_f2, 22),
+    UnsignedField(EphemerisXmitRaw, iodc, 10),
+    SignedField(EphemerisXmitRaw, c_rs, 16),
+    SignedField(EphemerisXmitRaw, delta_n, 16),
+    SignedField(EphemerisXmitRaw, m_0, 32),
+    SignedField(EphemerisXmitRaw, c_uc, 16),
+    UnsignedField(EphemerisXmitRaw, e, 32),
+    SignedField(EphemerisXmitRaw, c_us, 16),
+    UnsignedField(EphemerisXmitRaw, sqrt_a, 32),
+    UnsignedField(EphemerisXmitRaw, t_oe, 16),
+    SignedField(EphemerisXmitRaw, c_ic, 16),
+    SignedField(EphemerisXmitRaw, omega_0, 32),
+    SignedField(EphemerisXmitRaw, c_is, 16),
+    SignedField(EphemerisXmitRaw, i_0, 32),
+    SignedField(EphemerisXmitRaw, c_rc, 16),
+    SignedField(EphemerisXmitRaw, omega, 32),
+    SignedField(EphemerisXmitRaw, omegadot, 24),
+    SignedField(EphemerisXmitRaw, t_gd, 8),
+    UnsignedField(EphemerisXmitRaw, health, 6),
+    SkipField(1),                                   // L2 P data flag
+    SkipField(1)                                    // fit interval
+};
+
 
 RawRtcm3::RawRtcm3(Stream& in)
 : In(in)
@@ -29,7 +94,8 @@ RawRtcm3::RawRtcm3(Stream& in)
     for (int s=0; s<MaxSats; s++) {
         PreviousPhase[s] = 0;
         PhaseAdjust[s] = 0;
-        eph[s] = new EphemerisXmit(s, "RTCM 3.1");
+        if (SatToSvid(s) != -1)
+            eph[s] = new EphemerisXmit(s, "RTCM 3.1");
     }
 
     // We don't know the time until we receive an ephemeris message
@@ -44,47 +110,43 @@ bool RawRtcm3::NextEpoch()
 {
     // repeat until we get an observation record or an error
     bool errcode;
-    Block b;
+    Rtcm3Frame f;
     do {
 
-        // Read a frame
-        if (In.GetBlock(b) != OK) return Error();
+        // Read a frame. It is decoded where it sits in the framer's buffer.
+        if (In.GetFrame(f) != OK) return Error();
 
         // Process according to type of frame
-        if      (b.Id == 1002)   errcode = ProcessObservations(b);
-        else if (b.Id == 1005)   errcode = ProcessStationRef(b);
-        else if (b.Id == 1019)   errcode = ProcessEphemeris(b);
+        if      (f.Id == 1002)   errcode = ProcessObservations(f);
+        else if (f.Id == 1005)   errcode = ProcessStationRef(f);
+        else if (f.Id == 1019)   errcode = ProcessEphemeris(f);
         else                     errcode = OK;
 
-    } until ( (b.Id == 1002 && GpsTime != -1) || errcode != OK);
+    } until ( (f.Id == 1002 && GpsTime != -1) || errcode != OK);
 
     return errcode;
 }
 
 
 
-bool RawRtcm3::ProcessObservations(Block& blk)
+bool RawRtcm3::ProcessObservations(const Rtcm3Frame& f)
 {
 
     static const double MaxDelta = 0x7ffff;
     static const double BigDelta = MaxDelta - 800*L1WaveLength/.0005;
 
     // Assume no observations until shown otherwise
-    for (int s=0; s<MaxSats; s++)
-        obs[s].Valid = false;
+    obs.Clear();
 
     // Get the header info from the record
-    Bits b(blk);
-    int MessageId = b.GetBits(12);
-    int StationId = b.GetBits(12);
-    double Tow = b.GetBits(30) / 1000.0;
-    int Synch = b.GetBits(1);
-    int NrSats = b.GetBits(5);
-    int Smoothing = b.GetBits(1);
-    int Interval = b.GetBits(3);
+    BitReader b(f.Data, f.Length);
+    ObservationHeader h;
+    b.Get(ObservationHeaderFields, NrFields(ObservationHeaderFields), &h);
+    double Tow = h.Tow / 1000.0;
+    int NrSats = h.NrSats;
     debug("RawRtcm3::ProcessObservations \n");
     debug(" Tow=%.3f Synch=%d NrSats=%d Smoothing=%d Interval=%d\n",
-            Tow,   Synch,   NrSats,   Smoothing,   Interval);
+            Tow,   h.Synch,   NrSats,   h.Smoothing,   h.Interval);
 
     // Upate the time. 
     GpsTime = UpdateGpsTime(GpsTime, Tow);
@@ -94,19 +156,23 @@ bool RawRtcm3::ProcessObservations(Block& blk)
     for (int i=0; i<NrSats; i++) {
 
         // Extract the measurement's fields
-        int Svid = b.GetBits(6);
-        int Code = b.GetBits(1);
-        int32 iPR  = b.GetBits(24);
-        int32 iDelta = b.GetSignedBits(20);
-        int32 Modulus = b.GetBits(8);
-        int32 LockTime = b.GetBits(7);
-        int32 Snr = b.GetBits(8);
+        L1Observation m;
+        b.Get(L1ObservationFields, NrFields(L1ObservationFields), &m);
+        int Svid = m.Svid;
+        int Code = m.Code;
+        int32 iPR  = m.iPR;
+        int32 iDelta = m.iDelta;
+        int32 Modulus = m.Modulus;
+        int32 LockTime = m.LockTime;
+        int32 Snr = m.Snr;
         debug("   %2d %d %8d %8d %3d %3d %3d\n",
                Svid,Code,iPR,iDelta,Modulus,LockTime,Snr);
 
         // Figure out which satellite
         int s = SvidToSat(Svid);
-        RawObservation& o = obs[s];
+        if (s == -1) continue;
+        RawObservation* o = obs.Add(s);
+        if (o == NULL) return Error();
 
         double PseudoRange = Modulus*(C/1000) + iPR*.02;
         double PhaseRange = PseudoRange + iDelta*.0005 
@@ -120,22 +186,22 @@ bool RawRtcm3::ProcessObservations(Block& blk)
        else if (Doppler > 0 && iDelta < -BigDelta)  PhaseAdjust[s] += 1500;
            {PhaseAdjust[s] -= 1500; PhaseRange -= 1500*L1WaveLength;}
 
-        o.PR = PseudoRange;
-        o.Phase = PhaseRange / L1WaveLength;
-        o.SNR = LevelToSnr(Snr);
-        o.Slip = (LockTime < PreviousLockTime[s] || PreviousPhaseRange[s] == 0);
-        o.Doppler = -(PhaseRange - PreviousPhaseRange[s]) / L1WaveLength;
-        o.Valid = true;
+        o->PR = PseudoRange;
+        o->Phase = PhaseRange / L1WaveLength;
+        o->SNR = LevelToSnr(Snr);
+        o->Slip = (LockTime < PreviousLockTime[s] || PreviousPhaseRange[s] == 0);
+        o->Doppler = -(PhaseRange - PreviousPhaseRange[s]) / L1WaveLength;
+        o->Valid = true;
 
         if (iDelta == 0x80000) 
-            PhaseRange = o.Doppler = o.Phase = 0;
+            PhaseRange = o->Doppler = o->Phase = 0;
  
         if (PreviousPhaseRange[s] == 0)
-            o.Doppler = 0;
+            o->Doppler = 0;
 
         PreviousPhaseRange[s] = PhaseRange;
         PreviousLockTime[s] = LockTime;
-        if (o.Slip)
+        if (o->Slip)
             PhaseAdjust[s] = 0;
 
      }
@@ -143,19 +209,19 @@ bool RawRtcm3::ProcessObservations(Block& blk)
     return OK;
 }
 
-bool RawRtcm3::ProcessStationRef(Block& blk)
+bool RawRtcm3::ProcessStationRef(const Rtcm3Frame& f)
 {
-    Bits b(blk);
-    int MessageId = b.GetBits(12);
-    int StationId = b.GetBits(12);
-    int rsvd1 = b.GetBits(6);
-    int gps = b.GetBits(1);
-    int rdvd2 = b.GetBits(3);
-    double x = b.GetSignedBits(38) * .0005;
-    int rsvd3 = b.GetBits(2);
-    double y = b.GetSignedBits(38) * .0005;
-    int rsvd4 = b.GetBits(2);
-    double z = b.GetSignedBits(38) * .0005;
+    BitReader b(f.Data, f.Length);
+    int MessageId = b.Get(12);
+    int StationId = b.Get(12);
+    int rsvd1 = b.Get(6);
+    int gps = b.Get(1);
+    int rdvd2 = b.Get(3);
+    double x = b.GetSigned(38) * .0005;
+    int rsvd3 = b.Get(2);
+    double y = b.GetSigned(38) * .0005;
+    int rsvd4 = b.Get(2);
+    double z = b.GetSigned(38) * .0005;
 
     Pos = Position(x, y, z);
 
@@ -164,43 +230,13 @@ bool RawRtcm3::ProcessStationRef(Block& blk)
 }
 
 
-bool RawRtcm3::ProcessEphemeris(Block& blk)
+bool RawRtcm3::ProcessEphemeris(const Rtcm3Frame& f)
 {
     // Extract the raw ephemeris parameters
     EphemerisXmitRaw r;
-    Bits b(blk);
-    int msgid = b.GetBits(12);
-    r.svid = b.GetBits(6);
+    BitReader b(f.Data, f.Length);
+    b.Get(EphemerisFields, NrFields(EphemerisFields), &r);
     if (r.svid == 0) r.svid = 32;
-    r.wn = b.GetBits(10);
-    r.acc = b.GetBits(4);
-    int code_on_l2 = b.GetBits(2);
-    r.idot = b.GetSignedBits(14);
-    r.iode = b.GetBits(8);
-    r.t_oc = b.GetBits(16);
-    r.a_f2 = b.GetSignedBits(8);
-    r.a_f1 = b.GetSignedBits(16);
-    r.a_f2 = b.GetSignedBits(22);
-    r.iodc = b.GetBits(10);
-    r.c_rs = b.GetSignedBits(16);
-    r.delta_n = b.GetSignedBits(16);
-    r.m_0 = b.GetSignedBits(32);
-    r.c_uc = b.GetSignedBits(16);
-    r.e = b.GetBits(32);
-    r.c_us = b.GetSignedBits(16);
-    r.sqrt_a = b.GetBits(32);
-    r.t_oe = b.GetBits(16);
-    r.c_ic = b.GetSignedBits(16);
-    r.omega_0 = b.GetSignedBits(32);
-    r.c_is = b.GetSignedBits(16);
-    r.i_0 = b.GetSignedBits(32);
-    r.c_rc = b.GetSignedBits(16);
-    r.omega = b.GetSignedBits(32);
-    r.omegadot = b.GetSignedBits(24);
-    r.t_gd = b.GetSignedBits(8);
-    r.health = b.GetBits(6);
-    int l2pflag = b.GetBits(1);
-    int fit_interval = b.GetBits(1);
     debug("RawRtcm3::ProcessEphemeris  svid=%d iode=%d wn=%d\n",
                                        r.svid, r.iode, r.wn);
 
@@ -40,10 +40,10 @@ public:
 	virtual ~RawRtcm3(void);
 
 private:
-	bool ProcessStationRef(Block& b);
+	bool ProcessStationRef(const Rtcm3Frame& f);
 	bool ProcessAntennaRef(Block& b);
-	bool ProcessObservations(Block& b);
-        bool ProcessEphemeris(Block& b);
+	bool ProcessObservations(const Rtcm3Frame& f);
+        bool ProcessEphemeris(const Rtcm3Frame& f);
 
         double PreviousPhaseRange[MaxSats];
         int PreviousLockTime[MaxSats];
@@ -0,0 +1,103 @@
+//    Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Rtcm3Framer.h"
+#include "Crc.h"
+
+static const byte preamble = 0xd3;
+
+
+Rtcm3Framer::Rtcm3Framer(Stream& in, size_t size)
+: In(in), Buf(NULL), Size(size), Pos(0), End(0),
+  Frames(0), BadLength(0), BadCrc(0), Skipped(0)
+{
+}
+
+
+bool Rtcm3Framer::Fill(size_t len)
+// Make sure at least len bytes are waiting at Pos, reading more if needed
+{
+    if (End - Pos >= len) return OK;
+    if (Buf == NULL) Buf = new byte[Size];
+
+    // Slide what is left to the front if there isn't room behind it
+    if (Pos + len > Size) {
+        memmove(Buf, Buf+Pos, End-Pos);
+        End -= Pos;
+        Pos = 0;
+    }
+
+    // Read whatever is available, until we have enough
+    while (End - Pos < len) {
+        size_t actual;
+        if (In.Read(Buf+End, Size-End, actual) != OK) return Error();
+        if (actual == 0) return Error("Rtcm3Framer: read timed out\n");
+        End += actual;
+    }
+
+    return OK;
+}
+
+
+bool Rtcm3Framer::Next(Rtcm3Frame& f)
+{
+    for (;;) {
+
+        // skip to the preamble byte
+        if (Fill(1) != OK) return Error();
+        const byte* p = (const byte*)memchr(Buf+Pos, preamble, End-Pos);
+        size_t next = (p == NULL)? End: p - Buf;
+        Skipped += next - Pos;
+        Pos = next;
+        if (p == NULL) continue;
+
+        // Check the length. The six bits above it are reserved and must be zero.
+        if (Fill(3) != OK) return Error();
+        if ((Buf[Pos+1] & 0xfc) != 0) {
+            BadLength++; Skipped++; Pos++;
+            continue;
+        }
+        size_t len = (Buf[Pos+1] & 0x3) << 8 | Buf[Pos+2];
+
+        // Check the crc where the frame sits
+        if (Fill(len+6) != OK) return Error();
+        const byte* h = Buf + Pos;
+        Crc24 crc;
+        crc.Add(h, len+3);
+        const byte* c = crc.AsBytes();
+        if (c[0] != h[len+3] || c[1] != h[len+4] || c[2] != h[len+5]) {
+            BadCrc++; Skipped++; Pos++;
+            continue;
+        }
+
+        // Hand out the message where it is
+        f.Data = h + 3;
+        f.Length = len;
+        f.Id = (len < 2)? 0: (h[3]<<4) | (h[4]>>4);
+        Pos += len+6;
+        Frames++;
+        return OK;
+    }
+}
+
+
+Rtcm3Framer::~Rtcm3Framer()
+{
+    delete[] Buf;
+}
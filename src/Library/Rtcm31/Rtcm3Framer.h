@@ -0,0 +1,78 @@
+#ifndef RTCM3FRAMER_INCLUDED
+#define RTCM3FRAMER_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Comm.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// Rtcm3Framer - finds RTCM 3 frames in a stream of bytes.
+//
+//   The bytes are read in bulk into a window of our own. A frame is
+//   found, checked and handed out where it sits in the window, so
+//   the message is never copied.
+//
+//   A frame whose length or crc is bad is not thrown away along
+//   with everything after it. Only its preamble is skipped, and the
+//   search for the next preamble starts with the byte after it. Any
+//   good frame which was hidden behind a false preamble is still found.
+//
+//   The framer owns whatever it has read ahead, so once it is in use,
+//   nothing else should read from the stream.
+//
+///////////////////////////////////////////////////////////////////
+
+
+// A message, pointing into the framer's window. Valid until the next frame is read.
+struct Rtcm3Frame
+{
+    const byte* Data;    // the message, without header or crc
+    int Length;
+    int Id;
+};
+
+
+class Rtcm3Framer
+{
+protected:
+    Stream& In;
+    byte* Buf;           // the window, allocated when first needed
+    size_t Size;
+    size_t Pos;          // the next byte to look at
+    size_t End;          // the end of what has been read
+
+public:
+    // What has been seen, for the curious
+    uint32 Frames;       // good frames
+    uint32 BadLength;    // preambles followed by reserved bits which weren't zero
+    uint32 BadCrc;       // preambles followed by a frame with the wrong crc
+    uint32 Skipped;      // bytes which weren't part of a good frame
+
+    Rtcm3Framer(Stream& in, size_t size = 65536);
+    bool Next(Rtcm3Frame& f);
+    ~Rtcm3Framer();
+
+protected:
+    bool Fill(size_t len);
+};
+
+
+#endif // RTCM3FRAMER_INCLUDED
@@ -21,6 +21,7 @@
 #include "Rtcm3Station.h"
 #include "Util.h"
 #include "EphemerisXmit.h"
+#include "BitStream.h"
 
 
 
@@ -48,7 +49,6 @@ Rtcm3Station::Rtcm3Station(Stream& com, RawReceiver& gps, Attributes& attr)
     // We need to keep track of slips
     for (int s=0; s<MaxSats; s++) {
         TrackingTime[s] = 0;
-        PreviouslyValid[s] = false;
         PhaseAdjust[s] = 0;
     }		
 }
@@ -69,7 +69,8 @@ bool Rtcm3Station::OutputEpoch()
         if (OutputAuxiliary(AuxiliaryTime) != OK) return Error();
 
     // Send the epemerides if appropriate
-    for (int s=0; s<MaxSats; s++) {
+    for (int i=0; i<Gps.obs.Count(); i++) {
+       int s = Gps.obs.Sat(i);
        if (EphemerisTime[s] <= Gps.GpsTime 
                && Gps.obs[s].Valid 
                && Gps[s].Valid(Gps.GpsTime))
@@ -94,27 +95,30 @@ static const double ExtremeDelta = MaxDelta + 700*L1WaveLength/.02;
 bool Rtcm3Station::OutputObservations()
 {
 
-    // Find how many valid satellites
-    int nrsats = 0;
-    for (int s=0; s<MaxSats; s++)
-        if (Gps.obs[s].Valid)
-            nrsats++;
+    // Find which satellites can be sent
+    SatSet sats;
+    for (int i=0; i<Gps.obs.Count(); i++) {
+        int s = Gps.obs.Sat(i);
+        if (Gps.obs[s].Valid && SatToSvid(s) != -1)
+            sats.Add(s);
+    }
+    int nrsats = sats.Count();
 
     // Create the RTCM Observation header
     Block blk(1002);
-    Bits b(blk);
-    b.PutBits(1002, 12);         // Message Number 1002
-    b.PutBits(Station.Id, 12);   // Station Id
-    b.PutBits(round(GpsTow(Gps.GpsTime)*1000), 30); 
-    b.PutBits(0, 1);             // Synchronous GNSS flag
-    b.PutBits(nrsats, 5);        // No. of GPS Satellites Processed
-    b.PutBits(0, 1);             // Smoothing (none)
-    b.PutBits(0, 3);             // Smoothing interval (none)
+    BitWriter b(blk);
+    b.Put(1002, 12);         // Message Number 1002
+    b.Put(Station.Id, 12);   // Station Id
+    b.Put(round(GpsTow(Gps.GpsTime)*1000), 30); 
+    b.Put(0, 1);             // Synchronous GNSS flag
+    b.Put(nrsats, 5);        // No. of GPS Satellites Processed
+    b.Put(0, 1);             // Smoothing (none)
+    b.Put(0, 3);             // Smoothing interval (none)
 
     // Do for each valid satellite observation
-    for (int s=0; s<MaxSats; s++) {
-        RawObservation& o = Gps.obs[s];
-        if (!o.Valid) {PreviouslyValid[s] = false;  continue;}
+    for (int i=0; i<sats.Count(); i++) {
+        int s = sats[i];
+        const RawObservation& o = Gps.obs[s];
 
         // Calculate PR value
         uint32 Modulus = floor(o.PR / (C/1000));
@@ -127,7 +131,7 @@ bool Rtcm3Station::OutputObservations()
         double iDelta = round( (phaserange-pseudorange)/0.0005  );
 
         // Case: there was a slip. Create a new phase adjustment
-        if (o.Slip || !PreviouslyValid[s] || abs(iDelta) > ExtremeDelta) {
+        if (o.Slip || !PreviouslyValid.Contains(s) || abs(iDelta) > ExtremeDelta) {
             PhaseAdjust[s] = round(o.Phase - o.PR/L1WaveLength);
             TrackingTime[s] = 0;
         } 
@@ -150,19 +154,20 @@ bool Rtcm3Station::OutputObservations()
         if (o.Phase == 0) iDelta = 0x40000;
 
         // Add the satellite's data to the observation record
-        b.PutBits(SatToSvid(s), 6);     // GPS Satellite ID
-        b.PutBits(0, 1);               // GPS L1 Code Indicater (C/A)
-        b.PutBits(iPR, 24);             // GPS L1 Pseudorange
-        b.PutBits((uint32)iDelta, 20);   // GPS L1 PhaseRange - L1 Pseudorange
-        b.PutBits(Modulus, 8);         // GPS L1 Pseudorange Modulus Ambiguity
-        b.PutBits(LockTime(TrackingTime[s]), 7);  // GPS L1 Lock time indicator;
-        b.PutBits(SnrToLevel(o.SNR), 8); // GPS L1 CNR
+        b.Put(SatToSvid(s), 6);     // GPS Satellite ID
+        b.Put(0, 1);               // GPS L1 Code Indicater (C/A)
+        b.Put(iPR, 24);             // GPS L1 Pseudorange
+        b.Put((uint32)iDelta, 20);   // GPS L1 PhaseRange - L1 Pseudorange
+        b.Put(Modulus, 8);         // GPS L1 Pseudorange Modulus Ambiguity
+        b.Put(LockTime(TrackingTime[s]), 7);  // GPS L1 Lock time indicator;
+        b.Put(SnrToLevel(o.SNR), 8); // GPS L1 CNR
     
         TrackingTime[s]++;
-        PreviouslyValid[s] = o.Valid;
     }
+    PreviouslyValid = sats;
 
     // Output the observations record
+    b.Flush();
     return comm.PutBlock(blk);
     } 
 
@@ -172,24 +177,25 @@ bool Rtcm3Station::OutputObservations()
 bool Rtcm3Station::OutputStationRef(Time& time)
 {
     Block  blk(1005);
-    Bits   b(blk);
+    BitWriter b(blk);
 
     // Assemble the Station Reference record
-    b.PutBits(1005, 12);  
-    b.PutBits(Station.Id, 12);
-    b.PutBits(0,6);
-    b.PutBits(1,1);   // GPS measurements
-    b.PutBits(0, 3);
-    b.PutBits(round(Station.ARP.x/.0005), 38);
-    b.PutBits(0,2);
-    b.PutBits(round(Station.ARP.y/.0005), 38);
-    b.PutBits(0,2);
-    b.PutBits(round(Station.ARP.z/.0005), 38);
+    b.Put(1005, 12);  
+    b.Put(Station.Id, 12);
+    b.Put(0,6);
+    b.Put(1,1);   // GPS measurements
+    b.Put(0, 3);
+    b.Put(round(Station.ARP.x/.0005), 38);
+    b.Put(0,2);
+    b.Put(round(Station.ARP.y/.0005), 38);
+    b.Put(0,2);
+    b.Put(round(Station.ARP.z/.0005), 38);
 
     // Reschedule in a minute
     time = Gps.GpsTime + 60*NsecPerSec;
 
     // Output it
+    b.Flush();
     return  comm.PutBlock(blk);
 }
 
@@ -234,41 +240,42 @@ bool Rtcm3Station::OutputEphemeris(int s, Time& NextTime)
 
     // Build up the RTCM message
     Block  blk(1019);
-    Bits   b(blk);
+    BitWriter b(blk);
 
     // Assemble the Ephemeris record
-    b.PutBits(1019, 12);                   // Message id 1019
-    b.PutBits(SatToSvid(s), 6);            // Satelite number
-    b.PutBits(GpsWeek(Gps.GpsTime), 10);   // Week number
-    b.PutBits(r.acc, 4);                   // Accuracy
-    b.PutBits(2, 2);                       // C/A on L2  TODO: is this right?
-    b.PutBits(r.idot, 14);
-    b.PutBits(r.iode, 8);
-    b.PutBits(r.t_oc, 16);
-    b.PutBits(r.a_f2, 8);
-    b.PutBits(r.a_f2, 16);
-    b.PutBits(r.a_f0, 22);
-    b.PutBits(r.iodc, 10);
-    b.PutBits(r.c_rs, 16);
-    b.PutBits(r.delta_n, 16);
-    b.PutBits(r.m_0, 32);
-    b.PutBits(r.c_uc, 16);
-    b.PutBits(r.e, 32);
-    b.PutBits(r.c_us, 16);
-    b.PutBits(r.sqrt_a, 32);
-    b.PutBits(r.t_oe, 16);
-    b.PutBits(r.c_ic, 16);
-    b.PutBits(r.omega_0, 32);
-    b.PutBits(r.c_is, 16);
-    b.PutBits(r.i_0, 32);
-    b.PutBits(r.c_rc, 16);
-    b.PutBits(r.omega, 32);
-    b.PutBits(r.omegadot, 24);
-    b.PutBits(r.t_gd, 8);
-    b.PutBits(r.health, 6);
-    b.PutBits(1, 1);   // L2 P data is OFF
-    b.PutBits(0, 1);   // Fit interval is OFF  TODO: Is this right?
-
+    b.Put(1019, 12);                   // Message id 1019
+    b.Put(SatToSvid(s), 6);            // Satelite number
+    b.Put(GpsWeek(Gps.GpsTime), 10);   // Week number
+    b.Put(r.acc, 4);                   // Accuracy
+    b.Put(2, 2);                       // C/A on L2  TODO: is this right?
+    b.Put(r.idot, 14);
+    b.Put(r.iode, 8);
+    b.Put(r.t_oc, 16);
+    b.Put(r.a_f2, 8);
+    b.Put(r.a_f2, 16);
+    b.Put(r.a_f0, 22);
+    b.Put(r.iodc, 10);
+    b.Put(r.c_rs, 16);
+    b.Put(r.delta_n, 16);
+    b.Put(r.m_0, 32);
+    b.Put(r.c_uc, 16);
+    b.Put(r.e, 32);
+    b.Put(r.c_us, 16);
+    b.Put(r.sqrt_a, 32);
+    b.Put(r.t_oe, 16);
+    b.Put(r.c_ic, 16);
+    b.Put(r.omega_0, 32);
+    b.Put(r.c_is, 16);
+    b.Put(r.i_0, 32);
+    b.Put(r.c_rc, 16);
+    b.Put(r.omega, 32);
+    b.Put(r.omegadot, 24);
+    b.Put(r.t_gd, 8);
+    b.Put(r.health, 6);
+    b.Put(1, 1);   // L2 P data is OFF
+    b.Put(0, 1);   // Fit interval is OFF  TODO: Is this right?
+
+    b.Flush();
     return comm.PutBlock(blk);
 }
 
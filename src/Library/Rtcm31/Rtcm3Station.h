@@ -58,7 +58,7 @@ protected:
 	// keep track of whether we are locked to each satellite
         uint32 TrackingTime[MaxSats];
 	int32 PhaseAdjust[MaxSats];
-        bool PreviouslyValid[MaxSats];
+        SatSet PreviouslyValid;
 
 public:	
 	Rtcm3Station(Stream& com, RawReceiver& gps, Attributes& attr);
@@ -1,50 +1,70 @@
-#ifdef NOTYET
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
 
 #include "BufferIn.h"
 
+
 BufferIn::BufferIn(Stream& in, size_t size)
-    in(str), circ(size)
+: In(in)
 {
-    ErrCode = Open(in, size);
+	Size = size;
+	Buf = new byte[Size];
+	Discard();
+	ErrCode = In.GetError();
 }
 
 
-
-BufferIn::Open(Stream& in, size_t size)
+bool BufferIn::Fill()
+// Refill the buffer if it is empty. It is not an error if nothing arrives.
 {
-    ErrCode = in.GetError();
-    if (ErrCode != OK) return Error();
-
-    (// Initialize the input buffer
-    buf = malloc(size);
-    if (buf == 0) 
-        return Error("malloc: Can't allocate %d bytes for buffer\n", size);
-
-    // Spawn a child to read the actual stream
-    Thread t(Child);
-    if (t.GetError() != OK) return Error("Can't spawn reader thread\n");
+	if (InNext < InEnd) return OK;
 
-    return OK;
+	size_t actual;
+	Discard();
+	if (In.Read(Buf, Size, actual) != OK) return Error();
+	InEnd = Buf + actual;
+	return OK;
 }
 
 
-void BufferIn::Child(void *param)
+bool BufferIn::Read(byte* buf, size_t len, size_t& actual)
+// Read what we have, refilling the buffer once if it is empty
 {
+	if (Fill() != OK) return Error();
 
-    // Repeat forever
-    forever {
+	actual = min(len, Buffered());
+	memcpy(buf, InNext, actual);
+	InNext += actual;
+	return OK;
+}
 
-        // Read some data 
-        byte buf[512];
-        size_t actual;
-        if (in.Read(buf, sizeof(buf), actual) != OK)
-            return Error("Child failed to read\n"); // And notify parent
 
-        for (size_t i=0; i<actual; i++)
-            circ.Push(buf[i]);
-    }
+bool BufferIn::Peek(byte& b)
+{
+	if (Fill() != OK) return Error();
+	if (InNext == InEnd) return Error("BufferIn::Peek - no data\n");
+	b = *InNext;
+	return OK;
 }
 
 
-
-#endif
+BufferIn::~BufferIn()
+{
+	delete[] Buf;
+}
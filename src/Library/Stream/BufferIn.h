@@ -22,23 +22,59 @@
 
 #include "Stream.h"
 
+
+//////////////////////////////////////////////////////////////////
+//
+// BufferIn - reads another stream a block at a time.
+//
+//   Each refill asks the underlying stream for as much as will fit,
+//   taking whatever it has. The unread data is left in the Stream's
+//   InNext..InEnd window, so Read(byte&), ReadLine() and Scan() take
+//   bytes straight from the buffer and only call the underlying
+//   stream when it runs dry.
+//
+//   Peek() looks at the next byte without consuming it.
+//   Everything other than reading is passed through to the original stream.
+//
+///////////////////////////////////////////////////////////////////
+
 class BufferIn : public Stream
-{h
+{
 protected:
-	Stream& s;
-        Thread t;
-        CircularSem sem;
-        byte *buf;
+	Stream& In;
+	byte* Buf;
+	size_t Size;
 
 public:
-	BufferIn(Stream s);
+	static const size_t DefaultSize = 64*1024;
+	BufferIn(Stream& in, size_t size=DefaultSize);
 	virtual ~BufferIn();
 
-	virtual bool Read(byte* buf, size_t len, size_t& actual);
+	// The essentials for a stream
+	bool Read(byte* buf, size_t len, size_t& actual);
+	bool Write(const byte* buf, size_t len) {return In.Write(buf, len);}
+	bool ReadOnly() {return In.ReadOnly();}
+	using Stream::Read;
+	using Stream::Write;
 
-	virtual bool Write(const byte* buf, size_t len) {return OK;}
-	virtual bool ReadOnly() {return true;}
-};
+	// Working with the buffered data
+	bool Fill();
+	bool Peek(byte& b);
+	size_t Buffered() {return InEnd - InNext;}
+
+	// All other operations get passed to the original stream.
+	//   Anything which resynchronizes it discards what we have buffered.
+	virtual bool SetBaud(int baud) {Discard(); return In.SetBaud(baud);}
+	virtual bool GetBaud(int& baud) {return In.GetBaud(baud);}
+	virtual int FindBaudRate(const char* query, const char* response, int* BaudRates)
+	    {Discard(); return In.FindBaudRate(query, response, BaudRates);}
+	virtual bool SetFraming(int32 DataBits, int32 Parity, int32 StopBits)
+	    {Discard(); return In.SetFraming(DataBits, Parity, StopBits);}
+	virtual bool SetTimeout(int msec) {return In.SetTimeout(msec);}
+	virtual bool Purge() {Discard(); return In.Purge();}
 
-#endif // !defined(AFX_BufferIn_H__EED899C4_235C_4C0C_A584_4F6F7704A7ED__INCLUDED_)
+protected:
+	void Discard() {InNext = InEnd = Buf;}
+};
 
+#endif // BufferIn__INCLUDED
@@ -48,11 +48,12 @@ InputFile::~InputFile()
 }
 
 bool InputFile::Read(byte* buf, size_t len, size_t& actual)
+// Read up to len bytes. Only an error if there are none at all.
 {
 	if (file == NULL)
 		return Error();
 	actual = fread(buf, 1, len, file);
-	if (actual != len)
+	if (actual == 0 && len != 0)
 		if (Eof())      return Error("(EOF) Reached end of InputFile\n");
 		else            return Error("Problems reading Input file\n");
 
@@ -0,0 +1,53 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "MappedInputFile.h"
+
+
+MappedInputFile::MappedInputFile(const char* name)
+{
+	ErrCode = File.Open(name);
+	if (ErrCode != OK) {
+		Error("Unable to open input file %s\n", name);
+		return;
+	}
+
+	File.Sequential();
+	InNext = File.Data;
+	InEnd = File.Data + File.Size;
+}
+
+
+bool MappedInputFile::Read(byte* buf, size_t len, size_t& actual)
+// Read up to len bytes. Only an error if there are none at all.
+{
+	actual = min(len, (size_t)(InEnd - InNext));
+	if (actual == 0 && len != 0)
+		return Error("(EOF) Reached end of InputFile\n");
+
+	memcpy(buf, InNext, actual);
+	InNext += actual;
+	debug_buf(7, buf, actual);
+	return OK;
+}
+
+
+MappedInputFile::~MappedInputFile()
+{
+}
@@ -0,0 +1,54 @@
+#ifndef MAPPEDINPUTFILE_INCLUDED
+#define MAPPEDINPUTFILE_INCLUDED
+
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Stream.h"
+#include "MappedFile.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// MappedInputFile - an input file mapped into memory.
+//
+//   The whole file is the Stream's read-ahead window, so Read(byte&),
+//   ReadLine() and Span() work straight from the mapping without copying
+//   or calling the file. Reaching the end is reported the same as InputFile.
+//
+///////////////////////////////////////////////////////////////////
+
+class MappedInputFile : public Stream
+{
+protected:
+	MappedFile File;
+
+public:
+	MappedInputFile(const char* name);
+	virtual ~MappedInputFile();
+	bool Read(byte* buf, size_t len, size_t& actual);
+	bool Write(const byte* buf, size_t len) {return OK;}
+	bool ReadOnly() {return true;}
+	using Stream::Read;
+	using Stream::Write;
+
+	bool Eof() {return InNext >= InEnd;}
+};
+
+#endif // MAPPEDINPUTFILE_INCLUDED
@@ -27,6 +27,10 @@ int StreamValidBaud[] = {38400, 19200, 9600, 4800, 56000,
 // Fixed length read
 bool Stream::Read(byte* buf, size_t len)
 {
+    // If buffered, the bytes are probably waiting
+    const byte* p = Span(len);
+    if (p != NULL) {memcpy(buf, p, len); return OK;}
+
     size_t actual;
     for (size_t remaining=len; remaining > 0; remaining-=actual, buf+=actual) {
         if (Read(buf, remaining, actual) != OK) return Error();
@@ -45,6 +49,17 @@ bool Stream::ReadLine(char *buf, size_t len)
 	// Repeat until buffer is full or C/R received
 	for (actual = 0;  actual < len-1; )
 	{
+		// If buffered, copy up to the newline without going byte by byte
+		if (InNext < InEnd) {
+			byte* nl = (byte*)memchr(InNext, '\n', InEnd-InNext);
+			byte* end = (nl == NULL)? InEnd: nl;
+			for (; InNext < end && actual < len-1; InNext++)
+				if (*InNext != '\r')
+					buf[actual++] = *InNext;
+			if (InNext == nl) {InNext++; break;}
+			continue;
+		}
+
         // Read a byte; if Newline, done
 		byte c;
 		if (Read(c) != OK) return Error();
@@ -131,7 +146,27 @@ bool Stream::QueryResponse(const char *query, const char* response, int TooMany)
 
 bool Stream::SkipLine()
 {
-	return AwaitString("\n");
+	return Scan('\n');
+}
+
+
+bool Stream::Scan(byte delim)
+// Discard input up to and including the delimiter
+{
+	for (;;) {
+
+		// If buffered, look for it in the buffer
+		if (InNext < InEnd) {
+			byte* p = (byte*)memchr(InNext, delim, InEnd-InNext);
+			if (p != NULL) {InNext = p+1; return OK;}
+			InNext = InEnd;
+		}
+
+		// Otherwise read a byte
+		byte c;
+		if (Read(c) != OK) return Error();
+		if (c == delim) return OK;
+	}
 }
 
 bool Stream::AwaitString(const char* response, int TooMany)
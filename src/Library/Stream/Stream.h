@@ -20,8 +20,13 @@ class Stream
 protected:
 	bool ErrCode;
 
+	// Input which has been read ahead but not consumed yet.
+	//   Only buffered streams have any. The rest leave both NULL.
+	byte* InNext;
+	byte* InEnd;
+
 public:
-    Stream() {ErrCode = Error();}
+    Stream() {ErrCode = Error(); InNext = InEnd = NULL;}
 	virtual ~Stream(){}
 
     // every subclass must implement these
@@ -32,8 +37,12 @@ public:
     // Common routines for all streams
     bool GetError() {return ErrCode;}
     bool Read(byte& b)
-	    {return Read(&b, 1);}
+	    {if (InNext < InEnd) {b = *InNext++; return OK;} return Read(&b, 1);}
     bool Read(byte* buf, size_t len);
+
+	// The next len bytes, without copying, if they are already buffered. NULL otherwise.
+	const byte* Span(size_t len)
+	    {if ((size_t)(InEnd-InNext) < len) return NULL; InNext += len; return InNext-len;}
     bool Write(byte b)
 	    {byte buf=b; return this->Write(&buf, 1);}	
 	bool Write(const char* buf)
@@ -45,6 +54,7 @@ public:
     bool ReadNmea(char* line);
     bool WriteNmea(const char* line);
 	bool SkipLine();
+	bool Scan(byte delim);
 	bool Printf(const char* format, ...);
 	bool VPrintf(const char* format, va_list args);
 	bool PrintSvid(int s);
@@ -18,7 +18,7 @@ public:
     
 	// Read copies the data to the copy stream
 	bool Read(byte* buf, size_t len, size_t& actual)
-	    {return In.Read(buf, len, actual) || Copy.Write(buf, len);}
+	    {return In.Read(buf, len, actual) || Copy.Write(buf, actual);}
 
 	// All other operations get passed to the original stream
 	bool Write(const byte* buf, size_t len) {return In.Write(buf, len);};
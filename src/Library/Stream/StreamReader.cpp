@@ -0,0 +1,221 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "StreamReader.h"
+#include "GpsTime.h"
+
+
+class ReaderThread: public Thread
+{
+protected:
+	StreamReader& Owner;
+public:
+	ReaderThread(StreamReader& owner) : Owner(owner) {}
+	virtual ~ReaderThread() {}
+protected:
+	virtual void Run() {Owner.Produce();}
+};
+
+
+
+StreamReader::StreamReader(Stream& in, size_t size)
+: In(in)
+{
+	Size = size;
+	Ring = new byte[Size];
+	Head = Tail = 0;
+	StampHead = StampTail = 0;
+	Written = Consumed = 0;
+	LastReceived = 0;
+	BytesReceived = BytesDropped = 0;
+	Overruns = 0;
+	MostUsed = 0;
+	Failed = Stopping = false;
+	Reader = NULL;
+	ErrCode = In.GetError();
+}
+
+
+bool StreamReader::Start()
+{
+	if (Reader != NULL) return OK;
+
+	// Don't block forever, so we can notice when to stop
+	if (In.SetTimeout(ReadTimeout) != OK) return Error();
+
+	Reader = new ReaderThread(*this);
+	if (Reader->Start() != OK) {
+		delete Reader;
+		Reader = NULL;
+		return Error("StreamReader: Can't start the reader thread\n");
+	}
+	return OK;
+}
+
+
+void StreamReader::Produce()
+// The reader thread. Keep the port drained into the ring.
+{
+	byte scratch[MaxChunk];
+	while (!Stopping) {
+
+		// Find the free space following the head. One byte is always left
+		//   empty so a full ring can be told from an empty one.
+		size_t head = Head, tail = Tail;
+		MemoryFence();
+		size_t space = (tail > head)? tail - head - 1: Size - head - (tail == 0);
+
+		// If full, the data still has to be read. It is dropped.
+		byte* dest = (space == 0)? scratch: Ring + head;
+		size_t want = (space == 0)? MaxChunk: min(space, MaxChunk);
+
+		size_t actual;
+		if (In.Read(dest, want, actual) != OK) {
+			Failed = true;
+			DataReady.Wake();
+			return;
+		}
+		if (actual == 0) continue;
+		BytesReceived += actual;
+
+		if (space == 0) {
+			Overruns++;
+			BytesDropped += actual;
+			debug("StreamReader: ring full, dropped %u bytes\n", (unsigned)actual);
+			continue;
+		}
+
+		// Note when the chunk arrived, unless too many are waiting
+		Written += actual;
+		if (StampHead - StampTail < (uint32)MaxStamps) {
+			Stamp& s = Stamps[StampHead % MaxStamps];
+			s.End = Written;
+			s.Received = GetCurrentTime();
+			MemoryFence();
+			StampHead++;
+		}
+
+		// Publish the data
+		MemoryFence();
+		Head = (head + actual) % Size;
+		size_t used = (Head + Size - tail) % Size;
+		if (used > MostUsed) MostUsed = used;
+		DataReady.Wake();
+	}
+}
+
+
+bool StreamReader::Read(byte* buf, size_t len, size_t& actual)
+{
+	// Before starting, read the port directly
+	if (Reader == NULL) return In.Read(buf, len, actual);
+
+	// Give back the space already consumed, then wait for more
+	Release();
+	size_t head;
+	for (;;) {
+		head = Head;
+		MemoryFence();
+		if (head != Tail) break;
+		if (Failed) return Error("StreamReader: the input failed\n");
+		DataReady.Wait();
+	}
+
+	// Hand out the next piece as the read-ahead window
+	size_t tail = Tail;
+	size_t avail = (head > tail)? head - tail: Size - tail;
+	InNext = Ring + tail;
+	InEnd = InNext + min(avail, MaxWindow);
+
+	actual = min(len, (size_t)(InEnd - InNext));
+	memcpy(buf, InNext, actual);
+	InNext += actual;
+	return OK;
+}
+
+
+void StreamReader::Release()
+// Let the reader thread reuse what the window has consumed
+{
+	if (InNext == NULL) return;
+	Consumed += InNext - (Ring + Tail);
+	DiscardStamps(Consumed);
+	MemoryFence();
+	Tail = (InNext - Ring) % Size;
+	InNext = InEnd = NULL;
+}
+
+
+void StreamReader::DiscardStamps(uint64 pos)
+// Give back the stamps of the chunks consumed up to pos
+{
+	for (;;) {
+		uint32 head = StampHead;
+		MemoryFence();
+		if (StampTail == head) break;
+		Stamp& s = Stamps[StampTail % MaxStamps];
+		LastReceived = s.Received;
+		if (s.End >= pos) break;
+		StampTail++;
+	}
+}
+
+
+Time StreamReader::Received()
+// When the most recently consumed byte arrived
+{
+	uint64 pos = Consumed;
+	if (InNext != NULL)
+		pos += InNext - (Ring + Tail);
+	DiscardStamps(pos);
+	return LastReceived;
+}
+
+
+bool StreamReader::Purge()
+{
+	if (Reader == NULL) return In.Purge();
+
+	// Discard everything received so far
+	Release();
+	size_t head = Head;
+	MemoryFence();
+	Consumed += (head + Size - Tail) % Size;
+	MemoryFence();
+	Tail = head;
+	return OK;
+}
+
+
+bool StreamReader::Started(const char* op)
+{
+	if (Reader == NULL) return OK;
+	return Error("StreamReader: Can't %s after the reader has started\n", op);
+}
+
+
+StreamReader::~StreamReader()
+{
+	Stopping = true;
+	if (Reader != NULL) {
+		Reader->Join();
+		delete Reader;
+	}
+	delete[] Ring;
+}
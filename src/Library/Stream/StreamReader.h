@@ -0,0 +1,123 @@
+#ifndef STREAMREADER_INCLUDED
+#define STREAMREADER_INCLUDED
+
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Stream.h"
+#include "Thread.h"
+
+
+//////////////////////////////////////////////////////////////////
+//
+// StreamReader - reads a live port on a thread of its own.
+//
+//   Until Start() is called, everything passes straight through to the
+//   port, so the receiver can be set up (baud rates, queries) as usual.
+//   After that, a reader thread keeps the port drained into a ring
+//   buffer, and a slow write elsewhere can no longer overflow the port.
+//
+//   The ring has one writer (the reader thread) and one reader (whoever
+//   reads the stream), so it needs no lock. Each side owns its own index
+//   and a memory fence orders the data before the index that publishes it.
+//   The unread part of the ring is handed out as the Stream's read-ahead
+//   window, a piece at a time so the space is given back promptly.
+//
+//   If the ring is full, the data read from the port is dropped and
+//   counted as an overrun. Received() gives the time the most recently
+//   consumed byte arrived. Each chunk read from the port is stamped, and
+//   the stamps are given back along with the space, whether or not anyone
+//   asks for the time. If more chunks are waiting than there are stamps,
+//   a chunk goes unstamped and its bytes take the time of a later chunk.
+//
+//   Start() sets a timeout on the port so the reader thread can notice
+//   when it should stop.
+//
+///////////////////////////////////////////////////////////////////
+
+class StreamReader : public Stream
+{
+public:
+	// Monitoring, written by the reader thread
+	volatile uint64 BytesReceived;
+	volatile uint64 BytesDropped;
+	volatile uint32 Overruns;      // reads dropped because the ring was full
+	volatile size_t MostUsed;      // the fullest the ring has been
+
+protected:
+	Stream& In;
+	byte* Ring;
+	size_t Size;
+	volatile size_t Head;          // where the reader thread writes next
+	volatile size_t Tail;          // where the consumer reads next
+	volatile bool Failed;          // the port gave an error
+	volatile bool Stopping;
+	Semaphore DataReady;
+	class ReaderThread* Reader;    // NULL until started
+
+	// When each chunk arrived, in the same order as the data
+	struct Stamp {
+		uint64 End;                // total bytes written, up to the end of the chunk
+		Time Received;
+	};
+	static const int MaxStamps = 1024;
+	Stamp Stamps[MaxStamps];
+	volatile uint32 StampHead, StampTail;
+	uint64 Written;                // owned by the reader thread
+	uint64 Consumed;               // owned by the consumer
+	Time LastReceived;
+
+	static const size_t MaxChunk = 4096;      // most read from the port at once
+	static const size_t MaxWindow = 4096;     // most handed out before giving space back
+	static const int ReadTimeout = 500;       // msec
+
+public:
+	StreamReader(Stream& in, size_t size=1024*1024);
+	bool Start();
+	virtual ~StreamReader();
+
+	// The essentials for a stream
+	bool Read(byte* buf, size_t len, size_t& actual);
+	bool Write(const byte* buf, size_t len) {return In.Write(buf, len);}
+	bool ReadOnly() {return In.ReadOnly();}
+	using Stream::Read;
+	using Stream::Write;
+
+	Time Received();
+	size_t Headroom() {return Size - 1 - MostUsed;}
+
+	// Configuring the port only makes sense before starting
+	virtual bool SetBaud(int baud) {return Started("SetBaud") || In.SetBaud(baud);}
+	virtual bool GetBaud(int& baud) {return In.GetBaud(baud);}
+	virtual int FindBaudRate(const char* query, const char* response, int* BaudRates)
+	    {if (Started("FindBaudRate")) return 0; return In.FindBaudRate(query, response, BaudRates);}
+	virtual bool SetFraming(int32 DataBits, int32 Parity, int32 StopBits)
+	    {return Started("SetFraming") || In.SetFraming(DataBits, Parity, StopBits);}
+	virtual bool SetTimeout(int msec) {return Started("SetTimeout") || In.SetTimeout(msec);}
+	virtual bool Purge();
+
+protected:
+	friend class ReaderThread;
+	void Produce();
+	void Release();
+	void DiscardStamps(uint64 pos);
+	bool Started(const char* op);
+};
+
+#endif // STREAMREADER_INCLUDED
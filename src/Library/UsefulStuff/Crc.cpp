@@ -1,34 +1,51 @@
 
-
 #include "Crc.h"
 
 
-// Note: can be done a byte at time instead of a bit at a time.
-//   Question: is this little-endian specific?
-//   Rewrite this if it impacts performance
-//   Algorithm from GnuPG rfc2440
+// Polynomial and starting value from GnuPG rfc2440
+
+static const uint32 Poly = 0x864cfb << 8;
+
+uint32 Crc24::Table[8][256];
+
+// Build the tables before anyone needs them
+static struct CrcTables {CrcTables() {Crc24::MakeTables();}} Tables;
 
-Crc24::Crc24()
-{
-    crc = 0xb704ce;
-}
 
-void Crc24::Add(byte b)
+void Crc24::MakeTables()
 {
-    crc ^= ((uint32)b<<16);
-    for (int i=0; i<8; i++) {
-        crc <<= 1;
-        if ((crc & 0x1000000) != 0)
-            crc ^= 0x1864cfb;
+    // A single byte, the bit at a time way
+    for (int i=0; i<256; i++) {
+        uint32 c = (uint32)i << 24;
+        for (int k=0; k<8; k++)
+            c = (c & 0x80000000)? (c << 1) ^ Poly: c << 1;
+        Table[0][i] = c & 0xffffffff;
     }
-}
 
+    // The same byte followed by 1..7 zero bytes
+    for (int t=1; t<8; t++)
+        for (int i=0; i<256; i++) {
+            uint32 c = Table[t-1][i];
+            Table[t][i] = ((c << 8) ^ Table[0][c >> 24]) & 0xffffffff;
+        }
+}
 
 
-void Crc24::Add(byte* buf, size_t len)
+void Crc24::Add(const byte* buf, size_t len)
 {
-    for (size_t i=0; i<len; i++)
-        Add(buf[i]);
+    // Eight bytes at a time. The first four are combined with the crc,
+    //   the rest stand on their own. The bytes are gathered one at a time,
+    //   so alignment and byte order don't matter.
+    uint32 c = crc;
+    for (; len >= 8; len -= 8, buf += 8) {
+        uint32 x = c ^ ((uint32)buf[0]<<24 | (uint32)buf[1]<<16 | (uint32)buf[2]<<8 | buf[3]);
+        c = Table[7][(x>>24)&0xff] ^ Table[6][(x>>16)&0xff] ^ Table[5][(x>>8)&0xff] ^ Table[4][x&0xff]
+          ^ Table[3][buf[4]] ^ Table[2][buf[5]] ^ Table[1][buf[6]] ^ Table[0][buf[7]];
+    }
+
+    // The rest a byte at a time
+    for (; len > 0; len--, buf++)
+        c = (c << 8) ^ Table[0][((c >> 24) ^ *buf) & 0xff];
+    crc = c & 0xffffffff;
 }
     
-
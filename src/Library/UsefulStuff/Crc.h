@@ -3,27 +3,36 @@
 
 #include "Util.h"
 
+// CRC-24Q, as used by RTCM 3.
+//   The crc is kept in the upper 24 bits of a word, so a byte can be
+//   added with a single table lookup. Add(buf, len) goes 8 bytes at a time
+//   using 8 tables, each one the effect of a byte followed by some zeros.
+//   (uint32 may be wider than 32 bits, so anything above is masked off.)
 class Crc24 {
 protected:
-    uint64 crc;
+    uint32 crc;
     byte bytes[3];
+    static uint32 Table[8][256];
 
 public:
-    Crc24();
-    void Add(byte b);
-    void Add(byte *b, size_t length);
+    Crc24() : crc(0xb704ce << 8) {}
+    inline void Add(byte b) {crc = (crc << 8) ^ Table[0][((crc >> 24) ^ b) & 0xff];}
+    void Add(const byte *b, size_t length);
 
     byte* AsBytes()
     {
-        bytes[0] = crc>>16;
-        bytes[1] = crc>>8;
-        bytes[2] = crc;
+        bytes[0] = crc>>24;
+        bytes[1] = crc>>16;
+        bytes[2] = crc>>8;
         return bytes;
     }
 
-    uint32 AsInt() {return crc;}
+    uint32 AsInt() {return (crc>>8) & 0xffffff;}
+
+    static void MakeTables();
 };
     
 
 
 #endif
+
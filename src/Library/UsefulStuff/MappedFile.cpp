@@ -0,0 +1,6 @@
+#if defined(WINDOWS)
+#include "MappedFile.cpp.windows"
+
+#else
+#include "MappedFile.cpp.posix"
+#endif
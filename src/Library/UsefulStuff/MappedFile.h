@@ -0,0 +1,76 @@
+#ifndef MAPPEDFILE_INCLUDED
+#define MAPPEDFILE_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Util.h"
+#if defined(WINDOWS)
+#include <windows.h>
+#endif
+
+
+//////////////////////////////////////////////////////////////////
+//
+// MappedFile - a file mapped into memory.
+//
+//   Open() maps an existing file for reading. Create() starts a new file
+//   which can be written through Data, and Resize() changes its length.
+//   The pages belong to the file rather than to the process, so a file
+//   much larger than memory can be worked on a piece at a time.
+//
+//   Resize() may move the mapping, so pointers into Data must be
+//   recalculated afterwards.
+//
+///////////////////////////////////////////////////////////////////
+
+class MappedFile
+{
+public:
+	byte* Data;        // the file's contents, NULL if empty
+	size_t Size;       // the file's length
+	uint64 Modified;   // when an opened file was last written, in the system's own units
+
+protected:
+	bool ErrCode;
+	bool Writable;
+#if defined(WINDOWS)
+	HANDLE File;
+	HANDLE Mapping;
+#else
+	int File;
+#endif
+
+public:
+	MappedFile();
+	MappedFile(const char* name);
+	bool Open(const char* name);
+	bool Create(const char* name);
+	bool Resize(size_t size);
+	bool Close();
+	void Sequential();          // hint the file will be read from start to end
+	static bool IsFile(const char* name);   // an existing, ordinary file
+	bool GetError() {return ErrCode;}
+	virtual ~MappedFile();
+
+private:
+	bool Map();
+	void Unmap();
+};
+
+#endif // MAPPEDFILE_INCLUDED
@@ -44,6 +44,7 @@ public:
 
     // Conversions with Triple to enable math operators
 	inline operator Triple&() {return *(Triple*)this;}
+	inline operator const Triple&() const {return *(const Triple*)this;}
 	inline Position(const Triple& t): x(t[0]), y(t[1]), z(t[2]) {}
 };
 
@@ -0,0 +1,127 @@
+#ifndef SATARRAY_INCLUDED
+#define SATARRAY_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+
+#include "Util.h"
+#include "SatSet.h"
+
+//////////////////////////////////////////////////////////////////
+//
+// SatArray - an entry for each satellite, stored sparsely.
+//
+//   Code still indexes by satellite, a[s], but storage is only
+//   reserved for the satellites in view. With every constellation
+//   registered there are far more satellites than any receiver tracks.
+//
+//   An entry must be created with Add() before it is filled in. Add()
+//   fails, returning NULL, if the satellite is invalid or the array is full.
+//   Reading a satellite which has no entry gives a blank item, so a[s].Valid
+//   is false. Indexing is read only; an existing entry is changed through
+//   Entry(s), which insists the satellite is there.
+//   Clear() releases all the entries, usually at the start of an epoch.
+//
+//   The entries are visited in satellite order with
+//      for (int i=0; i<a.Count(); i++) {
+//          int s = a.Sat(i);
+//          ...
+//
+//   T must have a "Sat" member, which is set when the entry is added.
+//
+///////////////////////////////////////////////////////////////////
+
+template <typename T, int Capacity>
+class SatArray
+{
+protected:
+	int16 Slot[MaxSats];      // where each satellite is stored, -1 if nowhere
+	T Item[Capacity];
+	SatSet Present;           // the satellites which have entries
+	int16 Free[Capacity];     // unused slots
+	int NrFree;
+	T Blank;                  // what a new entry looks like
+
+public:
+	SatArray()
+	{
+		for (int s=0; s<MaxSats; s++)
+			Slot[s] = -1;
+		for (int i=0; i<Capacity; i++)
+			Free[i] = Capacity-1-i;
+		NrFree = Capacity;
+	}
+
+	inline const T& operator[](int sat) const
+	{
+		static const T blank = T();
+		if (Contains(sat)) return Item[Slot[sat]];
+		return blank;
+	}
+
+	inline T& Entry(int sat)
+	{
+		assert(Contains(sat));
+		return Item[Slot[sat]];
+	}
+
+	T* Add(int sat)
+	// The satellite's entry, creating it if needed. NULL if there is no room.
+	{
+		if (Contains(sat)) return &Item[Slot[sat]];
+		if (sat < 0 || sat >= MaxSats) {
+			Error("SatArray::Add - invalid satellite %d\n", sat);
+			return NULL;
+		}
+		if (NrFree == 0) {
+			Error("SatArray::Add - no room for satellite %d, %d already in use\n", sat, Capacity);
+			return NULL;
+		}
+
+		int slot = Free[--NrFree];
+		Slot[sat] = slot;
+		Present.Add(sat);
+		Item[slot] = Blank;
+		Item[slot].Sat = sat;
+		return &Item[slot];
+	}
+
+	void Remove(int sat)
+	{
+		if (!Contains(sat)) return;
+		Free[NrFree++] = Slot[sat];
+		Slot[sat] = -1;
+		Present.Remove(sat);
+	}
+
+	void Clear()
+	{
+		for (int i=0; i<Present.Count(); i++) {
+			int s = Present[i];
+			Free[NrFree++] = Slot[s];
+			Slot[s] = -1;
+		}
+		Present.Clear();
+	}
+
+	inline bool Contains(int sat) const {return sat >= 0 && sat < MaxSats && Slot[sat] >= 0;}
+	inline int Count() const {return Present.Count();}
+	inline int Sat(int i) const {return Present[i];}
+};
+
+#endif // SATARRAY_INCLUDED
@@ -0,0 +1,68 @@
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "SatSet.h"
+
+
+void SatSet::Clear()
+{
+	for (int w=0; w<Words; w++)
+		Mask[w] = 0;
+	Size = 0;
+}
+
+
+void SatSet::Add(int sat)
+{
+	assert(sat >= 0 && sat < MaxSats);
+	if (Contains(sat)) return;
+	Mask[sat>>5] |= 1ul << (sat&31);
+
+	// Keep the list in order. It is usually built in order, so look from the end.
+	int i;
+	for (i=Size; i>0 && Sat[i-1] > sat; i--)
+		Sat[i] = Sat[i-1];
+	Sat[i] = sat;
+	Size++;
+}
+
+
+void SatSet::Remove(int sat)
+{
+	if (!Contains(sat)) return;
+	Mask[sat>>5] &= ~(1ul << (sat&31));
+
+	int i;
+	for (i=0; Sat[i] != sat; i++)
+		;
+	for (; i<Size-1; i++)
+		Sat[i] = Sat[i+1];
+	Size--;
+}
+
+
+void SatSet::Intersect(SatSet& other)
+{
+	int n = 0;
+	for (int i=0; i<Size; i++)
+		if (other.Contains(Sat[i]))
+			Sat[n++] = Sat[i];
+		else
+			Mask[Sat[i]>>5] &= ~(1ul << (Sat[i]&31));
+	Size = n;
+}
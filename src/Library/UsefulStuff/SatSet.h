@@ -0,0 +1,59 @@
+#ifndef SATSET_INCLUDED
+#define SATSET_INCLUDED
+// Part of Kinematic, a utility for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "Util.h"
+
+//////////////////////////////////////////////////////////////////
+//
+// SatSet - a set of satellites, kept both as a bit mask and as a list.
+//
+//   Observations reserve an entry for every satellite, but only a handful
+//   are tracked at any time. Loops go through the list rather than
+//   scanning every entry, and membership is checked with the mask.
+//   The list is kept in increasing order, so a loop over the list
+//   visits satellites in the same order as a scan would.
+//
+//      for (int i=0; i<set.Count(); i++) {
+//          int s = set[i];
+//          ...
+//
+///////////////////////////////////////////////////////////////////
+
+class SatSet
+{
+protected:
+	static const int Words = (MaxSats+31)/32;
+	uint32 Mask[Words];
+	int Sat[MaxSats];
+	int Size;
+
+public:
+	SatSet() {Clear();}
+	void Clear();
+	void Add(int sat);
+	void Remove(int sat);
+	void Intersect(SatSet& other);
+
+	inline bool Contains(int sat) const {return (Mask[sat>>5] & (1ul << (sat&31))) != 0;}
+	inline int Count() const {return Size;}
+	inline int operator[](int i) const {return Sat[i];}
+};
+
+#endif // SATSET_INCLUDED
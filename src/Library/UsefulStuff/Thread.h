@@ -20,7 +20,21 @@
 
 
 #include "util.h"
-#include <windows.h>  // MOVE ELSEWHERE!
+#if defined(WINDOWS)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <semaphore.h>
+#endif
+
+
+// Memory written before the fence is seen by other threads before memory written after it.
+//   Lets one thread hand data to another without a lock.
+#if defined(WINDOWS)
+inline void MemoryFence() {MemoryBarrier();}
+#else
+inline void MemoryFence() {__sync_synchronize();}
+#endif
 
 
 class Mutex
@@ -31,7 +45,12 @@ public:
 	void Unlock();
 	~Mutex();
 private:
+	friend class Condition;
+#if defined(WINDOWS)
 	CRITICAL_SECTION cs[1];
+#else
+	pthread_mutex_t mutex;
+#endif
 };
 
 
@@ -43,7 +62,11 @@ public:
 	void Wake();
 	~Semaphore();
 private:
+#if defined(WINDOWS)
 	HANDLE sem;
+#else
+	sem_t sem;
+#endif
 };
 
 
@@ -57,9 +80,13 @@ public:
 	~Condition();
 
 private:
+#if defined(WINDOWS)
 	Semaphore sem;
 	Mutex SleepLock;
 	int32 Sleepers;
+#else
+	pthread_cond_t cond;
+#endif
 };
 
 
@@ -70,17 +97,25 @@ class Thread
 public:
 	Thread();
 	bool Start();
+	bool Join();
 	virtual ~Thread(void);
 
 	bool SetPriority(int32 priority);
+	static int Processors();
 
 protected:
 	// Each thread type redefines this method.
 	virtual void Run();
 
 private:
+#if defined(WINDOWS)
 	HANDLE Handle;
 	static void Startup(Thread*);
+#else
+	pthread_t Handle;
+	bool Started;
+	static void* Startup(void*);
+#endif
 	int32 Priority;
 };
 
@@ -44,22 +44,96 @@ void Sleep(int msec)
 #endif
 
 
+//////////////////////////////////////////////////////////////////////
+//
+// The satellite registry.
+//   Each constellation has a block of satellite indices, in this order.
+//   Storage indexed by satellite is kept sparse (see SatArray.h), so
+//   adding a constellation only costs a few bytes per satellite.
+//
+/////////////////////////////////////////////////////////////////////////
+
+static const struct {
+	char Letter;    // as used in Rinex and SP3 files
+	int FirstPrn;
+	int NrPrns;
+} Registry[NrSystems] = {
+	{'G',   1, NrGpsSats},      // GPS
+	{'S', 120, NrSbasSats},     // SBAS (WAAS, EGNOS, ...)
+	{'R',   1, NrGlonassSats},  // GLONASS
+	{'E',   1, NrGalileoSats},  // Galileo
+	{'C',   1, NrBeidouSats}    // BeiDou
+};
+
+
+static int FirstSat(int system)
+{
+	int s = 1;
+	for (int i=0; i<system; i++)
+		s += Registry[i].NrPrns;
+	return s;
+}
+
+
+int SatIndex(int system, int prn)
+{
+	if (system < 0 || system >= NrSystems) return -1;
+	int offset = prn - Registry[system].FirstPrn;
+	if (offset < 0 || offset >= Registry[system].NrPrns) return -1;
+	return FirstSat(system) + offset;
+}
+
+
+int SatSystem(int s)
+{
+	if (s < 1) return -1;
+	int first = 1;
+	for (int system=0; system<NrSystems; system++) {
+		if (s < first + Registry[system].NrPrns)
+			return system;
+		first += Registry[system].NrPrns;
+	}
+	return -1;
+}
+
+
+int SatPrn(int s)
+{
+	int system = SatSystem(s);
+	if (system == -1) return -1;
+	return s - FirstSat(system) + Registry[system].FirstPrn;
+}
+
+
+int LetterToSystem(char letter)
+{
+	for (int system=0; system<NrSystems; system++)
+		if (Registry[system].Letter == letter)
+			return system;
+	return -1;
+}
+
+
+char SystemLetter(int system)
+{
+	if (system < 0 || system >= NrSystems) return '?';
+	return Registry[system].Letter;
+}
+
+
 int SvidToSat(int svid)
 {
-	if (svid >= 1 && svid <=32)
-		return svid;
-	else if (svid >= 120 && svid < 152)
-		return svid - 87;
+	if (svid >= 1 && svid <= 32)
+		return SatIndex(GPS, svid);
 	else
-		return -1;
+		return SatIndex(SBAS, svid);
 }
 
 int SatToSvid(int s)
 {
-	if (s >= 1 && s <= 32)
-		return s;
-	else if (s >= 33 && s < 65)
-		return s+87;
+	int system = SatSystem(s);
+	if (system == GPS || system == SBAS)
+		return SatPrn(s);
 	else
 		return -1;
 }
@@ -203,10 +277,18 @@ void debug_write(const char* buf, size_t len)
 ////////////////////////////////////////////////////////////////
 
 
-int ErrCount = 0;
+// Each thread has its own messages, so one thread's ClearError()
+//   doesn't discard another's.
+#if defined(_MSC_VER)
+#define ThreadLocal __declspec(thread)
+#else
+#define ThreadLocal __thread
+#endif
+
+static ThreadLocal int ErrCount = 0;
 static const int ErrMax = 15;
 static const int ErrMaxStr = 256;
-char   ErrSlot[ErrMax][ErrMaxStr];  // Make this thread specific later
+static ThreadLocal char ErrSlot[ErrMax][ErrMaxStr];
 
 
 bool SysError(const char* fmt, ...)
@@ -236,9 +318,10 @@ bool Verror(const char *fmt, va_list arglist)
 {
 	debug("ERROR: "); vdebug(1, fmt, arglist);
 
-	// Format into the slot
-	vsnprintf(ErrSlot[ErrCount], ErrMaxStr-1, fmt, arglist);
-	ErrSlot[ErrCount][ErrMaxStr-1] = '\0';
+	// Format into the slot. Once full, the last slot is reused.
+	int slot = min(ErrCount, ErrMax-1);
+	vsnprintf(ErrSlot[slot], ErrMaxStr-1, fmt, arglist);
+	ErrSlot[slot][ErrMaxStr-1] = '\0';
 
 	// if we have more room in the error list, then allocate a slot
 	if (ErrCount < ErrMax)
@@ -93,8 +93,22 @@ static const double EPS = 1.0e-20;
 static const double C = 2.99792458e+08; // speed of light in m/sec
 static const double L1Freq = 1575420000;
 static const double L1WaveLength = C / L1Freq;
-static const int32 MaxSats = 66; // SV 1-32 GPS, SV 120-152 EGNOS, 0 unused
-static const int32 MaxChannels = 24;
+
+// Satellites from all the constellations share one set of indices.
+//   Each constellation gets a consecutive block, starting at 1 (0 is unused).
+//   GPS and SBAS come first so they keep the numbers they always had.
+//   See the registry in Util.cpp.
+enum GnssSystem {GPS, SBAS, GLONASS, GALILEO, BEIDOU, NrSystems};
+static const int32 NrGpsSats = 32;      // G01-G32
+static const int32 NrSbasSats = 32;     // PRN 120-151
+static const int32 NrGlonassSats = 32;  // R01-R32
+static const int32 NrGalileoSats = 36;  // E01-E36
+static const int32 NrBeidouSats = 63;   // C01-C63
+static const int32 MaxSats = 1 + NrGpsSats + NrSbasSats + NrGlonassSats 
+                               + NrGalileoSats + NrBeidouSats;
+
+static const int32 MaxChannels = 24;  // satellites in a single solution
+static const int32 MaxInView = 64;    // satellites reported by a receiver in one epoch
 
 static const double wgs84_f = 1.0/298.2572235630;  // flattening of earth
 static const double wgs84_a = 6378137.0;  // major axis of earth
@@ -114,8 +128,14 @@ T abs(T val)
 inline double p2(int32 n) {return ((uint64)1) << n;}
 
 
+// Satellite numbering. Receivers number GPS and SBAS satellites by svid.
 int SvidToSat(int svid);
 int SatToSvid(int s);
+int SatIndex(int system, int prn);
+int SatSystem(int s);
+int SatPrn(int s);
+int LetterToSystem(char letter);
+char SystemLetter(int system);
 
 // Convert between rinex signal level and snr
 double LevelToSnr(int level);
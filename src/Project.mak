@@ -34,7 +34,7 @@ LDOPT := -g
 
 CPPFLAGS:= -I $(CROSS)/usr/include -I $(CROSS)/include $(CPPOPT)
 CFLAGS:=$(CPPFLAGS) -DSQLITE_OMIT_LOAD_EXTENSION  -DSQLITE_THREADSAFE=0
-LDFLAGS:= -L $(CROSS)/usr/lib -L $(CROSS)/lib  #-lpthread
+LDFLAGS:= -L $(CROSS)/usr/lib -L $(CROSS)/lib -lpthread
 
 .SUFFIXES : .cpp .c .o .lib .exe .h .dll .a
 
@@ -0,0 +1,215 @@
+// BitBench - times packing and unpacking RTCM 3 bit fields
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Random fields of random widths are packed with Bits and with BitWriter,
+//   which must give the same bytes, then unpacked with Bits and BitReader,
+//   which must give back the same values.
+//
+// Then 1002 observation records with 12 satellites are timed, unpacked
+//   a field at a time with Bits and a record at a time with BitReader,
+//   and packed with each.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "BitStream.h"
+#include "GpsTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+
+static uint64 Random(int bits)
+{
+	uint64 v = (uint64)rand() << 42 ^ (uint64)rand() << 21 ^ rand();
+	return v & (~(uint64)0 >> (64 - bits));
+}
+
+
+static bool Compare(int trials)
+{
+	for (int t=0; t<trials; t++) {
+		int width[100];  uint64 value[100];
+		int n = 0, total = 0;
+		for (; n<100 && total < 8*Block::Max - 64; n++) {
+			width[n] = 1 + rand()%56;
+			value[n] = Random(width[n]);
+			total += width[n];
+		}
+
+		Block old, fast;
+		Bits ob(old);
+		BitWriter fb(fast);
+		for (int i=0; i<n; i++) {
+			ob.PutBits(value[i], width[i]);
+			fb.Put(value[i], width[i]);
+		}
+		fb.Flush();
+		if (old.Length != fast.Length || memcmp(old.Data, fast.Data, old.Length) != 0) {
+			printf("Packing differs on trial %d\n", t);
+			return false;
+		}
+
+		Bits og(old);
+		BitReader fg(fast);
+		for (int i=0; i<n; i++) {
+			uint64 o = og.GetBits(width[i]);
+			uint64 f = fg.Get(width[i]);
+			if (o != value[i] || f != value[i]) {
+				printf("Unpacking differs on trial %d field %d\n", t, i);
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+
+// A 1002 record, the way RawRtcm3 reads it
+struct Header {int Id, Station, Tow, Synch, NrSats, Smoothing, Interval;};
+static const BitField HeaderFields[] = {
+	UnsignedField(Header, Id, 12), UnsignedField(Header, Station, 12),
+	UnsignedField(Header, Tow, 30), UnsignedField(Header, Synch, 1),
+	UnsignedField(Header, NrSats, 5), UnsignedField(Header, Smoothing, 1),
+	UnsignedField(Header, Interval, 3)
+};
+struct Sat {int Svid, Code, PR, Delta, Modulus, LockTime, Snr;};
+static const BitField SatFields[] = {
+	UnsignedField(Sat, Svid, 6), UnsignedField(Sat, Code, 1),
+	UnsignedField(Sat, PR, 24), SignedField(Sat, Delta, 20),
+	UnsignedField(Sat, Modulus, 8), UnsignedField(Sat, LockTime, 7),
+	UnsignedField(Sat, Snr, 8)
+};
+
+static const int NrSats = 12;
+static uint64 PR[NrSats];
+
+
+static void MakeRecord(Block& blk)
+{
+	BitWriter b(blk);
+	b.Put(1002, 12);  b.Put(1234, 12);  b.Put(345678000, 30);
+	b.Put(0, 1);  b.Put(NrSats, 5);  b.Put(0, 1);  b.Put(0, 3);
+	for (int i=0; i<NrSats; i++) {
+		b.Put(i+1, 6);  b.Put(0, 1);  b.Put(PR[i], 24);  b.Put(-1000*i, 20);
+		b.Put(70+i, 8);  b.Put(127, 7);  b.Put(45*4, 8);
+	}
+	b.Flush();
+}
+
+
+static void MakeRecordOldWay(Block& blk)
+{
+	Bits b(blk);
+	b.PutBits(1002, 12);  b.PutBits(1234, 12);  b.PutBits(345678000, 30);
+	b.PutBits(0, 1);  b.PutBits(NrSats, 5);  b.PutBits(0, 1);  b.PutBits(0, 3);
+	for (int i=0; i<NrSats; i++) {
+		b.PutBits(i+1, 6);  b.PutBits(0, 1);  b.PutBits(PR[i], 24);  b.PutBits(-1000*i, 20);
+		b.PutBits(70+i, 8);  b.PutBits(127, 7);  b.PutBits(45*4, 8);
+	}
+}
+
+
+static int64 OldWay(Block& blk)
+{
+	Bits b(blk);
+	int64 sum = b.GetBits(12) + b.GetBits(12) + b.GetBits(30) + b.GetBits(1);
+	int n = b.GetBits(5);
+	sum += b.GetBits(1) + b.GetBits(3);
+	for (int i=0; i<n; i++) {
+		sum += b.GetBits(6) + b.GetBits(1) + b.GetBits(24) + b.GetSignedBits(20);
+		sum += b.GetBits(8) + b.GetBits(7) + b.GetBits(8);
+	}
+	return sum;
+}
+
+
+static int64 NewWay(Block& blk)
+{
+	BitReader b(blk);
+	Header h;
+	b.Get(HeaderFields, NrFields(HeaderFields), &h);
+	int64 sum = h.Id + h.Station + h.Tow + h.Synch + h.Smoothing + h.Interval;
+	for (int i=0; i<h.NrSats; i++) {
+		Sat s;
+		b.Get(SatFields, NrFields(SatFields), &s);
+		sum += s.Svid + s.Code + s.PR + s.Delta + s.Modulus + s.LockTime + s.Snr;
+	}
+	return sum;
+}
+
+
+int main(int argc, const char** argv)
+{
+	int records = 1000000;
+	if (argc > 1) records = atoi(argv[1]);
+
+	srand(1);
+	if (!Compare(10000)) return 1;
+
+	for (int i=0; i<NrSats; i++)
+		PR[i] = Random(24);
+	Block blk, oldblk;
+	MakeRecord(blk);
+	MakeRecordOldWay(oldblk);
+	if (blk.Length != oldblk.Length || memcmp(blk.Data, oldblk.Data, blk.Length) != 0) {
+		printf("Records differ\n");
+		return 1;
+	}
+
+	Time start = GetCurrentTime();
+	int64 oldsum = 0;
+	for (int i=0; i<records; i++)
+		oldsum += OldWay(blk);
+	Time old = GetCurrentTime() - start;
+
+	start = GetCurrentTime();
+	int64 newsum = 0;
+	for (int i=0; i<records; i++)
+		newsum += NewWay(blk);
+	Time fast = GetCurrentTime() - start;
+
+	start = GetCurrentTime();
+	for (int i=0; i<records; i++) {
+		oldblk.Length = 0;
+		MakeRecordOldWay(oldblk);
+	}
+	Time oldpacking = GetCurrentTime() - start;
+
+	start = GetCurrentTime();
+	for (int i=0; i<records; i++) {
+		blk.Length = 0;
+		MakeRecord(blk);
+	}
+	Time packing = GetCurrentTime() - start;
+
+	if (oldsum != newsum) {
+		printf("Sums don't match\n");
+		return 1;
+	}
+
+	printf("1002 records with %d satellites (%d bytes)\n", NrSats, blk.Length);
+	printf("unpack, field at a time (Bits)        %10.0f records/s\n", records / (old / (double)NsecPerSec));
+	printf("unpack, record at a time (BitReader)  %10.0f records/s\n", records / (fast / (double)NsecPerSec));
+	printf("pack, old way (Bits)                  %10.0f records/s\n", records / (oldpacking / (double)NsecPerSec));
+	printf("pack (BitWriter)                      %10.0f records/s\n", records / (packing / (double)NsecPerSec));
+	return 0;
+}
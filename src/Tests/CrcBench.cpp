@@ -0,0 +1,114 @@
+// CrcBench - times the RTCM 3 crc
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// The crc of a buffer of random bytes is worked out three ways: a bit at
+//   a time, the way it used to be done, then a byte at a time with a table,
+//   then in bulk, 8 bytes at a time. All three must agree, for every length
+//   and starting offset. Then the bulk crc is timed on RTCM sized frames.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "Crc.h"
+#include "GpsTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+
+static uint32 BitAtATime(const byte* buf, size_t len)
+{
+	uint32 crc = 0xb704ce;
+	for (size_t i=0; i<len; i++) {
+		crc ^= (uint32)buf[i] << 16;
+		for (int k=0; k<8; k++) {
+			crc <<= 1;
+			if ((crc & 0x1000000) != 0)
+				crc ^= 0x1864cfb;
+		}
+	}
+	return crc;
+}
+
+static uint32 ByteAtATime(const byte* buf, size_t len)
+{
+	Crc24 crc;
+	for (size_t i=0; i<len; i++)
+		crc.Add(buf[i]);
+	return crc.AsInt();
+}
+
+static uint32 Bulk(const byte* buf, size_t len)
+{
+	Crc24 crc;
+	crc.Add(buf, len);
+	return crc.AsInt();
+}
+
+
+static double Throughput(uint32 (*crc)(const byte*, size_t), const byte* buf, size_t total, size_t frame, uint32& sum)
+// Returns MB/s
+{
+	sum = 0;
+	Time start = GetCurrentTime();
+	for (size_t p=0; p+frame <= total; p += frame)
+		sum ^= crc(buf+p, frame);
+	Time elapsed = GetCurrentTime() - start;
+	return (total - total%frame) / (elapsed / (double)NsecPerSec) / 1e6;
+}
+
+
+int main(int argc, const char** argv)
+{
+	size_t megabytes = 64;
+	if (argc > 1) megabytes = atoi(argv[1]);
+	size_t total = megabytes * 1024 * 1024;
+
+	byte* buf = new byte[total];
+	srand(1);
+	for (size_t i=0; i<total; i++)
+		buf[i] = rand();
+
+	// Every length up to a full frame, from every alignment
+	for (size_t off=0; off<8; off++)
+		for (size_t len=0; len<1030; len++) {
+			uint32 expect = BitAtATime(buf+off, len);
+			if (ByteAtATime(buf+off, len) != expect || Bulk(buf+off, len) != expect) {
+				printf("Mismatch at offset %d length %d\n", (int)off, (int)len);
+				return 1;
+			}
+		}
+
+	// Typical RTCM frames, and a long run
+	size_t frames[] = {25, 200, 1029, total};
+	for (int i=0; i<4; i++) {
+		uint32 s1, s2, s3;
+		double bit = Throughput(BitAtATime, buf, total, frames[i], s1);
+		double byt = Throughput(ByteAtATime, buf, total, frames[i], s2);
+		double bulk = Throughput(Bulk, buf, total, frames[i], s3);
+		if (s1 != s2 || s1 != s3) {printf("Sums don't match\n"); return 1;}
+		printf("frame=%8d bytes   bit=%7.1f MB/s   byte=%7.1f MB/s   bulk=%7.1f MB/s\n",
+			(int)frames[i], bit, byt, bulk);
+	}
+
+	delete[] buf;
+	return 0;
+}
@@ -0,0 +1,207 @@
+// FramerBench - times the RTCM 3 framer and checks it resynchronizes after noise
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// A file of numbered RTCM 3 frames is written, the way a noisy radio
+//   link might deliver them: now and then a burst of random bytes lands
+//   between two frames, or a byte inside a frame is hit. Every frame which
+//   arrived intact should come out of the framer.
+//
+// The file is read with the framer, and with the way CommRtcm3 used to
+//   read frames, which started over after a bad crc and lost whatever
+//   it had read. The frames each one recovers are counted, then both
+//   are timed on a clean file.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "OutputFile.h"
+#include "MappedInputFile.h"
+#include "CommRtcm3.h"
+#include "Crc.h"
+#include "GpsTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+
+static bool WriteFrames(const char* name, int frames, int noise, int& intact)
+// Frame i carries i in its first four bytes after the message id
+{
+	OutputFile out(name);
+	if (out.GetError() != OK) return Error();
+	CommRtcm3 com(out);
+
+	srand(1);
+	intact = 0;
+	for (int i=0; i<frames; i++) {
+		Block b;
+		b.Length = 20 + rand()%200;
+		for (int k=0; k<b.Length; k++)
+			b.Data[k] = rand();
+		b.Data[0] = 1004>>4;  b.Data[1] = (1004<<4) | (b.Data[1] & 0xf);
+		for (int k=0; k<4; k++)
+			b.Data[2+k] = i >> (24-8*k);
+
+		// A burst of noise, sprinkled with preambles
+		if (noise > 0 && rand()%noise == 0) {
+			byte junk[64];
+			int len = 1 + rand()%sizeof(junk);
+			for (int k=0; k<len; k++)
+				junk[k] = (rand()%8 == 0)? 0xd3: rand();
+			if (out.Write(junk, len) != OK) return Error();
+		}
+
+		// A damaged frame, written by hand
+		if (noise > 0 && rand()%noise == 0) {
+			byte frame[Block::Max+6];
+			frame[0] = 0xd3;  frame[1] = b.Length>>8;  frame[2] = b.Length;
+			memcpy(frame+3, b.Data, b.Length);
+			Crc24 crc;
+			crc.Add(frame, b.Length+3);
+			memcpy(frame+3+b.Length, crc.AsBytes(), 3);
+			frame[rand()%(b.Length+6)] ^= 1 + rand()%255;
+			if (out.Write(frame, b.Length+6) != OK) return Error();
+			continue;
+		}
+
+		if (com.PutBlock(b) != OK) return Error();
+		intact++;
+	}
+	return OK;
+}
+
+
+static bool OldGetBlock(Stream& com, Block& b)
+// How CommRtcm3::GetBlock used to read a frame
+{
+	static const byte preamble = 0xd3;
+restart:
+	if (com.Scan(preamble) != OK) return Error();
+
+	byte LenHi, LenLo;
+	if (com.Read(LenHi) != OK) return Error();
+	if (com.Read(LenLo) != OK) return Error();
+	b.Length = ((((int)LenHi)<<8)+LenLo);
+	if (b.Length > 1023) goto restart;
+
+	if (com.Read(b.Data, b.Length) != OK) return Error();
+	Crc24 crc;
+	crc.Add(preamble); crc.Add(LenHi); crc.Add(LenLo);
+	crc.Add(b.Data, b.Length);
+	byte *bytes = crc.AsBytes();
+
+	byte c;
+	if (com.Read(c) != OK)  return Error();
+	if (c != bytes[0])      goto restart;
+	if (com.Read(c) != OK)  return Error();
+	if (c != bytes[1])      goto restart;
+	if (com.Read(c) != OK)  return Error();
+	if (c != bytes[2])      goto restart;
+
+	b.Id = (b.Data[0]<<4) | (b.Data[1]>>4);
+	return OK;
+}
+
+
+static int Number(const byte* data)
+{
+	return data[2]<<24 | data[3]<<16 | data[4]<<8 | data[5];
+}
+
+
+static double ReadOldWay(const char* name, int& frames, int& bad)
+// Returns MB per second
+{
+	MappedInputFile in(name);
+	frames = bad = 0;
+	size_t bytes = 0;
+	int last = -1;
+	Block b;
+	Time start = GetCurrentTime();
+	while (OldGetBlock(in, b) == OK) {
+		if (b.Id != 1004 || Number(b.Data) <= last) bad++;
+		last = Number(b.Data);
+		frames++;
+		bytes += b.Length + 6;
+	}
+	Time elapsed = GetCurrentTime() - start;
+	ClearError();
+	return bytes / 1e6 / (elapsed / (double)NsecPerSec);
+}
+
+
+static double ReadNewWay(const char* name, int& frames, int& bad)
+{
+	MappedInputFile in(name);
+	CommRtcm3 com(in);
+	frames = bad = 0;
+	size_t bytes = 0;
+	int last = -1;
+	Rtcm3Frame f;
+	Time start = GetCurrentTime();
+	while (com.GetFrame(f) == OK) {
+		if (f.Id != 1004 || Number(f.Data) <= last) bad++;
+		last = Number(f.Data);
+		frames++;
+		bytes += f.Length + 6;
+	}
+	Time elapsed = GetCurrentTime() - start;
+	ClearError();
+
+	Rtcm3Framer& fr = com.GetFramer();
+	printf("   framer: frames=%u bad length=%u bad crc=%u skipped=%u bytes\n",
+		(unsigned)fr.Frames, (unsigned)fr.BadLength, (unsigned)fr.BadCrc, (unsigned)fr.Skipped);
+	return bytes / 1e6 / (elapsed / (double)NsecPerSec);
+}
+
+
+int main(int argc, const char** argv)
+{
+	int frames = 200000;
+	if (argc > 1) frames = atoi(argv[1]);
+
+	// A noisy link: noise or damage about every 20 frames
+	int intact;
+	if (WriteFrames("FramerBench.rtcm", frames, 20, intact) != OK) return ShowErrors();
+
+	int oldframes, oldbad, newframes, newbad;
+	ReadOldWay("FramerBench.rtcm", oldframes, oldbad);
+	ReadNewWay("FramerBench.rtcm", newframes, newbad);
+	printf("noisy link: %d frames sent, %d intact\n", frames, intact);
+	printf("   old way recovered %d (%d out of order or bad)\n", oldframes, oldbad);
+	printf("   framer recovered  %d (%d out of order or bad)\n", newframes, newbad);
+	bool failed = (newframes != intact || newbad != 0);
+
+	// A clean file, for speed
+	if (WriteFrames("FramerBench.rtcm", frames, 0, intact) != OK) return ShowErrors();
+	double oldrate = ReadOldWay("FramerBench.rtcm", oldframes, oldbad);
+	double newrate = ReadNewWay("FramerBench.rtcm", newframes, newbad);
+	printf("clean file: old way %8.1f MB/s   framer %8.1f MB/s   (%d %d frames)\n",
+		oldrate, newrate, oldframes, newframes);
+	failed = failed || oldframes != frames || newframes != frames || newbad != 0;
+
+	remove("FramerBench.rtcm");
+	if (failed) {
+		printf("Frames were lost\n");
+		return 1;
+	}
+	return 0;
+}
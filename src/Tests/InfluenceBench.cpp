@@ -0,0 +1,217 @@
+// InfluenceBench - checks predicted solutions against solving without the satellites
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// A simulated rover is solved for a while, then one satellite's code
+//   is spoiled. From the spoiled epoch's factorization, Influence predicts
+//   the fit and residuals with each satellite left out, and with each pair.
+//   Every prediction is compared with a real Checkpoint/Update/Rollback
+//   solve, the reference satellite included.
+//
+// Then all but five satellites are left out. Dropping a pair leaves too
+//   few satellites, so the equations are reset. Predict() must say it
+//   can't predict that, which is what sends DoubleDiff back to solving.
+//
+// The largest differences and the time per prediction and per solve are
+//   shown. The test fails if a prediction is off, or if the spoiled
+//   satellite isn't the one predicted to fit best without.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "LeastSquaresSolution.h"
+#include "GpsTime.h"
+#include "SimReceiver.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+static const int Epochs = 30;
+static const int Spoiled = 4;          // index of the satellite with bad code
+static const double Tolerance = 1e-6;
+
+
+class TestSolution: public LeastSquaresSolution
+{
+public:
+	TestSolution(Position& basepos, Position& roverpos): LeastSquaresSolution(basepos, roverpos) {}
+	int Reference() {return ReferenceSat;}
+};
+
+
+// Largest differences seen between predicted and solved
+static double FitDiff, ResidDiff, RefDiff;
+static int Exact, Inexact, References;
+
+
+static void SetValid(Observations& obs, int s, bool valid)
+{
+	obs.Entry(s).ValidCode = obs.Entry(s).ValidPhase = valid;
+}
+
+
+static bool Compare(TestSolution& sol, Observations& obs, Influence& inf, int s, int t, double& cep)
+// Predict, then solve for real without s and t. Returns whether the prediction was exact.
+{
+	bool exact = inf.Predict(s, t) == OK;
+	ClearError();
+	int ref = sol.Reference();
+
+	SetValid(obs, s, false);
+	if (t != -1) SetValid(obs, t, false);
+	Position pos; double fit;
+	if (sol.Update(obs, pos, cep, fit) != OK) {ShowErrors(); exit(1);}
+
+	if (!exact)
+		Inexact++;
+	else {
+		Exact++;
+		double diff = 0;
+		for (int i=0; i<obs.Active.Count(); i++) {
+			int r = obs.Active[i];
+			if (obs[r].ValidCode)
+				diff = max(diff, abs(inf.GetCodeResidual(r) - sol.GetCodeResidual(r)));
+			if (obs[r].ValidPhase)
+				diff = max(diff, abs(inf.GetPhaseResidual(r) - sol.GetPhaseResidual(r)));
+		}
+		FitDiff = max(FitDiff, abs(inf.GetFit() - fit) / max(fit, 1.0));
+		ResidDiff = max(ResidDiff, diff);
+		if (s == ref || t == ref)
+			RefDiff = max(RefDiff, diff);
+		References += (s == ref || t == ref);
+	}
+
+	if (sol.Rollback() != OK) {ShowErrors(); exit(1);}
+	SetValid(obs, s, true);
+	if (t != -1) SetValid(obs, t, true);
+	return exact;
+}
+
+
+static bool NextEpoch(Ephemerides& eph, RawReceiver& base, RawReceiver& rover, Observations& obs)
+{
+	if (base.NextEpoch() != OK || rover.NextEpoch() != OK) return Error();
+	base.FindActive();  rover.FindActive();
+	obs.Init(base, rover, eph);
+	return obs.ErrCode;
+}
+
+
+static bool Diagnose(TestSolution& sol, Observations& obs, Influence& inf)
+// Solve the epoch, keep the influence, and undo the solution
+{
+	Position pos; double cep, fit;
+	if (sol.Checkpoint() != OK) return Error();
+	if (sol.Update(obs, pos, cep, fit) != OK) return Error();
+	if (sol.GetInfluence(obs, inf) != OK) return Error();
+	if (!inf.Valid()) return Error("InfluenceBench: no factorization to predict from\n");
+	return sol.Rollback();
+}
+
+
+int main(int argc, const char** argv)
+{
+	int repeat = 1000;
+	if (argc > 1) repeat = atoi(argv[1]);
+
+	SimEphemerides eph;
+	Position truth = BaseTruth + Position(3000, 1000, 200);
+	SimReceiver base(eph, BaseTruth, Epochs, 1);
+	SimReceiver rover(eph, truth, Epochs, 100);
+	rover.Pos = rover.Pos + Position(3, -2, 4);
+	static TestSolution sol(base.Pos, rover.Pos);
+	static Observations obs;
+	static Influence inf;
+
+	// Settle in with good measurements
+	Position pos; double cep, fit;
+	for (int e=0; e<Epochs-1; e++) {
+		if (NextEpoch(eph, base, rover, obs) != OK) {ShowErrors(); return 1;}
+		if (sol.Update(obs, pos, cep, fit) != OK) {ShowErrors(); return 1;}
+		sol.NewPosition(pos);
+	}
+
+	// Spoil one satellite's code in the next epoch
+	if (NextEpoch(eph, base, rover, obs) != OK) {ShowErrors(); return 1;}
+	int spoiled = obs.Active[Spoiled];
+	obs.Entry(spoiled).PR += 50;
+	if (Diagnose(sol, obs, inf) != OK) {ShowErrors(); return 1;}
+
+	// Each satellite, then each pair. Note which single drop is predicted best.
+	int best = -1; double bestfit = 0;
+	bool failed = false;
+	for (int i=0; i<obs.Active.Count(); i++) {
+		int s = obs.Active[i];
+		if (!Compare(sol, obs, inf, s, -1, cep)) failed = true;
+		if (inf.Predict(s) == OK && (best == -1 || inf.GetFit() < bestfit))
+			{best = s; bestfit = inf.GetFit();}
+	}
+	for (int i=0; i<obs.Active.Count(); i++) for (int j=i+1; j<obs.Active.Count(); j++)
+		if (!Compare(sol, obs, inf, obs.Active[i], obs.Active[j], cep)) failed = true;
+	printf("all satellites: %d exact predictions, %d inexact, %d without the reference\n",
+		Exact, Inexact, References);
+	printf("  largest difference  fit=%.2g  residual=%.2g m  without the reference=%.2g m\n",
+		FitDiff, ResidDiff, RefDiff);
+	printf("  spoiled satellite=%d  predicted worst=%d  fit without it=%.3f\n",
+		spoiled, best, bestfit);
+	if (Inexact > 0 || References == 0 || FitDiff > Tolerance || ResidDiff > Tolerance || best != spoiled)
+		failed = true;
+
+	// Time a prediction against a solve, leaving out each satellite in turn
+	Time start = GetCurrentTime();
+	for (int n=0; n<repeat; n++)
+		inf.Predict(obs.Active[n%obs.Active.Count()]);
+	double predict = S(GetCurrentTime() - start) / repeat;
+	start = GetCurrentTime();
+	for (int n=0; n<repeat; n++) {
+		int s = obs.Active[n%obs.Active.Count()];
+		SetValid(obs, s, false);
+		sol.Update(obs, pos, cep, fit);
+		sol.Rollback();
+		SetValid(obs, s, true);
+	}
+	double solve = S(GetCurrentTime() - start) / repeat;
+	printf("  predict=%.2f us  solve=%.2f us  (%.1fx)\n", predict*1e6, solve*1e6, solve/predict);
+
+	// With only five satellites, a pair can't be predicted: the equations are reset
+	for (int i=5; i<obs.Active.Count(); i++)
+		SetValid(obs, obs.Active[i], false);
+	if (Diagnose(sol, obs, inf) != OK) {ShowErrors(); return 1;}
+	Exact = Inexact = 0;
+	for (int i=0; i<5; i++)
+		if (!Compare(sol, obs, inf, obs.Active[i], -1, cep)) failed = true;
+	int singles = Exact;
+	Exact = Inexact = 0;
+	int resets = 0;
+	for (int i=0; i<5; i++) for (int j=i+1; j<5; j++) {
+		if (Compare(sol, obs, inf, obs.Active[i], obs.Active[j], cep)) failed = true;
+		if (cep == -1) resets++;
+	}
+	printf("five satellites: %d of 5 singles exact, %d of 10 pairs inexact, %d reset\n",
+		singles, Inexact, resets);
+	if (singles != 5 || Inexact != 10 || resets != 10)
+		failed = true;
+
+	if (failed) {
+		printf("Predictions don't match the solutions\n");
+		return 1;
+	}
+	return 0;
+}
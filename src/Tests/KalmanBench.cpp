@@ -0,0 +1,96 @@
+// KalmanBench - compares the Kalman filter with batch least squares
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// A simulated rover sits still a few km from a simulated base. The same
+//   measurements are solved twice, by the accumulated least squares
+//   equations and by the Kalman filter. For a stationary rover both are
+//   estimating the same float solution, so once they have settled the two
+//   positions should agree to well within the error of either one.
+//
+// The difference between the two and the error of each are shown for each
+//   stretch of epochs, and the test fails if they stop agreeing.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "DoubleDiff.h"
+#include "GpsTime.h"
+#include "SimReceiver.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+
+static int Solve(Ephemerides& eph, Position truth, int epochs, bool kalman, Position* pos)
+// Returns the number of epochs solved
+{
+	SimReceiver base(eph, BaseTruth, epochs, 1);
+	SimReceiver rover(eph, truth, epochs, 100);
+	rover.Pos = rover.Pos + Position(3, -2, 4);
+	DoubleDiff dbl(eph, base, rover);
+	if (kalman) dbl.UseKalmanFilter();
+
+	Time t; double cep, fit;
+	int e;
+	for (e=0; e < epochs && dbl.NextPosition(t, pos[e], cep, fit) == OK; e++)
+		;
+	ClearError();
+	return e;
+}
+
+
+int main(int argc, const char** argv)
+{
+	int epochs = 600;
+	if (argc > 1) epochs = min(atoi(argv[1]), 10000);
+	static Position batch[10000], kalman[10000];
+	SimEphemerides eph;
+	Position truth = BaseTruth + Position(3000, 1000, 200);
+
+	int nbatch = Solve(eph, truth, epochs, false, batch);
+	int nkalman = Solve(eph, truth, epochs, true, kalman);
+	printf("epochs=%d  least squares solved %d  Kalman solved %d\n", epochs, nbatch, nkalman);
+	bool failed = nbatch != epochs || nkalman != epochs;
+
+	// Compare a stretch at a time. The first stretch includes settling in.
+	int stretch = max(epochs/6, 1);
+	printf("   epochs      difference   least squares err   Kalman err\n");
+	for (int first=0; first < min(nbatch, nkalman); first += stretch) {
+		int last = min(first+stretch, min(nbatch, nkalman));
+		double diff = 0, errb = 0, errk = 0;
+		for (int e=first; e<last; e++) {
+			diff = max(diff, Range(batch[e] - kalman[e]));
+			errb = max(errb, Range(batch[e] - truth));
+			errk = max(errk, Range(kalman[e] - truth));
+		}
+		printf("  %4d-%-4d   %10.4f m  %14.4f m  %10.4f m\n", first, last-1, diff, errb, errk);
+
+		// After settling, the filter should track least squares closely
+		if (first > 0 && diff > 0.05)
+			failed = true;
+	}
+
+	if (failed) {
+		printf("Kalman filter and least squares disagree\n");
+		return 1;
+	}
+	return 0;
+}
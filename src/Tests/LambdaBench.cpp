@@ -0,0 +1,167 @@
+// LambdaBench - checks the LAMBDA integer ambiguity search against known answers
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// First the three dimensional example from the LAMBDA documentation
+//   (de Jonge and Tiberius, 1996). Its float ambiguities are strongly
+//   correlated, so simply rounding them gives the wrong answer.
+//   The best integers are (5, 3, 4), at a squared distance of 0.2183,
+//   and the runner up is (6, 4, 4) at 0.3073.
+//
+// Then random float solutions with random correlated covariances are
+//   resolved, and compared with an exhaustive search of every integer
+//   vector in a box around them. The covariances are kept well enough
+//   conditioned that the box must hold the best two.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "Lambda.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+int DebugLevel = 0;
+
+static const int Box = 8;
+
+
+static double Distance(int n, const double* a, double Qi[][Lambda::MaxAmbiguities], const double* z)
+// (a-z)' Q^-1 (a-z)
+{
+	double s = 0;
+	for (int i=0; i<n; i++)
+		for (int j=0; j<n; j++)
+			s += (a[i]-z[i]) * Qi[i][j] * (a[j]-z[j]);
+	return s;
+}
+
+
+static void Invert3(double Q[][Lambda::MaxAmbiguities], double Qi[][Lambda::MaxAmbiguities])
+{
+	double det = Q[0][0]*(Q[1][1]*Q[2][2]-Q[1][2]*Q[2][1])
+		       - Q[0][1]*(Q[1][0]*Q[2][2]-Q[1][2]*Q[2][0])
+			   + Q[0][2]*(Q[1][0]*Q[2][1]-Q[1][1]*Q[2][0]);
+	for (int i=0; i<3; i++)
+		for (int j=0; j<3; j++) {
+			int i1 = (j+1)%3, i2 = (j+2)%3, j1 = (i+1)%3, j2 = (i+2)%3;
+			Qi[i][j] = (Q[i1][j1]*Q[i2][j2] - Q[i1][j2]*Q[i2][j1]) / det;
+		}
+}
+
+
+static void BruteForce(const double* a, double Qi[][Lambda::MaxAmbiguities],
+					   double* best, double& s1, double& s2)
+// The best integer vector within Box of the rounded float solution, and the two smallest distances
+{
+	s1 = s2 = 1e99;
+	double z[3];
+	for (int i=-Box; i<=Box; i++)
+		for (int j=-Box; j<=Box; j++)
+			for (int k=-Box; k<=Box; k++) {
+				z[0] = floor(a[0]+.5)+i;  z[1] = floor(a[1]+.5)+j;  z[2] = floor(a[2]+.5)+k;
+				double s = Distance(3, a, Qi, z);
+				if (s < s1) {s2 = s1; s1 = s; best[0] = z[0]; best[1] = z[1]; best[2] = z[2];}
+				else if (s < s2) s2 = s;
+			}
+}
+
+
+static bool KnownAnswer()
+{
+	double a[3] = {5.45, 3.10, 2.97};
+	double Q[Lambda::MaxAmbiguities][Lambda::MaxAmbiguities];
+	Q[0][0] = 6.290;  Q[0][1] = 5.978;  Q[0][2] = 0.544;
+	Q[1][0] = 5.978;  Q[1][1] = 6.292;  Q[1][2] = 2.340;
+	Q[2][0] = 0.544;  Q[2][1] = 2.340;  Q[2][2] = 6.288;
+
+	Lambda lambda;
+	double fixed[3], ratio;
+	if (lambda.Resolve(3, a, Q, fixed, ratio) != OK) return Error();
+	printf("known answer: fixed=(%.0f, %.0f, %.0f)  ratio=%.4f   expected (5, 3, 4)  ratio=%.4f\n",
+		fixed[0], fixed[1], fixed[2], ratio, 0.30727/0.21833);
+
+	if (fixed[0] != 5 || fixed[1] != 3 || fixed[2] != 4 || fabs(ratio - 0.30727/0.21833) > 1e-3)
+		return Error("Lambda gave the wrong answer for the known example\n");
+	return OK;
+}
+
+
+static double Uniform(double lo, double hi)
+{
+	return lo + (hi-lo) * rand() / (double)RAND_MAX;
+}
+
+
+static bool RandomTrials(int trials)
+{
+	for (int t=0; t<trials; t++) {
+
+		// A random rotation, by Gram-Schmidt on random vectors
+		double V[3][3];
+		for (int i=0; i<3; i++) {
+			for (int k=0; k<3; k++) V[i][k] = Uniform(-1, 1);
+			for (int j=0; j<i; j++) {
+				double dot = 0;
+				for (int k=0; k<3; k++) dot += V[i][k]*V[j][k];
+				for (int k=0; k<3; k++) V[i][k] -= dot*V[j][k];
+			}
+			double len = sqrt(V[i][0]*V[i][0] + V[i][1]*V[i][1] + V[i][2]*V[i][2]);
+			for (int k=0; k<3; k++) V[i][k] /= len;
+		}
+
+		// Q = V' diag(e) V, with eigenvalues from .1 to 2
+		double e[3] = {Uniform(.1, 2), Uniform(.1, 2), Uniform(.1, 2)};
+		double Q[Lambda::MaxAmbiguities][Lambda::MaxAmbiguities], Qi[Lambda::MaxAmbiguities][Lambda::MaxAmbiguities];
+		for (int i=0; i<3; i++)
+			for (int j=0; j<3; j++) {
+				Q[i][j] = 0;
+				for (int k=0; k<3; k++) Q[i][j] += V[k][i]*e[k]*V[k][j];
+			}
+		Invert3(Q, Qi);
+
+		double a[3] = {Uniform(-100, 100), Uniform(-100, 100), Uniform(-100, 100)};
+		double best[3] = {0, 0, 0}, s1, s2;
+		BruteForce(a, Qi, best, s1, s2);
+
+		Lambda lambda;
+		double fixed[3], ratio;
+		if (lambda.Resolve(3, a, Q, fixed, ratio) != OK) return Error();
+		if (fixed[0] != best[0] || fixed[1] != best[1] || fixed[2] != best[2]
+		 || fabs(ratio - s2/s1) > 1e-6*(s2/s1)) {
+			printf("trial %d: Lambda (%.0f, %.0f, %.0f) ratio=%.6f  search (%.0f, %.0f, %.0f) ratio=%.6f\n",
+				t, fixed[0], fixed[1], fixed[2], ratio, best[0], best[1], best[2], s2/s1);
+			return Error("Lambda and the exhaustive search disagree\n");
+		}
+	}
+	printf("random trials: %d agreed with the exhaustive search\n", trials);
+	return OK;
+}
+
+
+int main(int argc, const char** argv)
+{
+	int trials = 1000;
+	if (argc > 1) trials = atoi(argv[1]);
+	srand(1);
+
+	if (KnownAnswer() != OK) return ShowErrors();
+	if (RandomTrials(trials) != OK) return ShowErrors();
+	return 0;
+}
@@ -1,4 +1,4 @@
-APPS = NtripServer ZeroBase
+APPS = NtripServer ZeroBase SolveBench SmoothBench RoverBench OrbitBench Sp3Bench StreamBench OutputBench CrcBench BitBench FramerBench Rtcm23Bench KalmanBench LambdaBench InfluenceBench
 
 all: $(APPS)
 
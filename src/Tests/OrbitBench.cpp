@@ -0,0 +1,279 @@
+// OrbitBench - times broadcast orbit evaluation
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// A dozen GPS-like broadcast orbits are evaluated every second for a few
+//   hours, three ways: the original calculation (fixed point Kepler loop,
+//   everything worked out on each call), EphemerisXmit::SatPos one
+//   satellite at a time, and XmitBatch for all of them at once.
+//   The largest difference from the original is shown.
+//
+// The batch is also used through SatPosCache, the way BaseEpoch and
+//   Observations use it, with each satellite at its own transmit time and
+//   one satellite which has no orbit for its time.
+//
+// Then a second orbit is decoded into the same ephemeris, the way a
+//   receiver driver does, and the cached position must move with it
+//   and agree with the original calculation. Last, a day of two hourly
+//   orbits is used in order: each time must get the nearest orbit without
+//   the ephemeris changing, and the stale orbits must be pruned.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "EphemerisXmit.h"
+#include "SatPosCache.h"
+#include "GpsTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+static const int NrSats = 12;
+static const double RelativisticConstant = -4.442807633e-10;
+
+
+static bool Original(EphemerisXmit& eph, Time xmitTime, Position& XmitPos, double& adjust)
+// EphemerisXmit::SatPos as it was
+{
+	if (!eph.Valid(xmitTime))
+		return Error("Ephemeris is not valid\n");
+	double a = eph.sqrt_a * eph.sqrt_a;
+	double n_0 = sqrt(mu)/(a*eph.sqrt_a);
+	double t = S(xmitTime - eph.t_oe);
+	double n = n_0 + eph.delta_n;
+	double M = eph.m_0 + n*t;
+	double E = M;
+	for (int i=0; i<20; i++) 
+		E = M + eph.e*sin(E);
+	double S_nu = sqrt(1-eph.e*eph.e) * sin(E) / (1 - eph.e * cos(E));
+	double c_nu = (cos(E) - eph.e) / (1 - eph.e *cos(E));
+	double nu = atan2(S_nu, c_nu);
+	debug("  S_nu=%.6f  c_nu=%.6f  nu=%.6f\n", S_nu, c_nu, nu);
+	double phi = nu + eph.omega;
+	double du = eph.c_uc*cos(2*phi) + eph.c_us*sin(2*phi);
+	double dr = eph.c_rc*cos(2*phi) + eph.c_rs*sin(2*phi);
+	double di = eph.c_ic*cos(2*phi) + eph.c_is*sin(2*phi);
+	debug("  du=%.6f  dr=%.6f  di=%.6f\n", du, dr, di);
+	double u = phi + du;
+	double r = a * (1 - eph.e*cos(E)) + dr;
+	double i = eph.i_0 + eph.idot*t + di;
+	debug("  u=%.6f  r=%.6f  i=%.6f\n", u, r, i);
+	double xdash = r * cos(u);
+	double ydash = r * sin(u);
+	debug("  xdash = %.3f  ydash=%.3f\n", xdash, ydash); 
+	double omega_c = eph.omega_0 - GpsTow(eph.t_oe)*OmegaEDot + (eph.omegadot - OmegaEDot)*t;
+	debug("omega_c=%g  omega_0=%g  omegadot=%g  OmegaEDot=%g  t=%g Tow=%g\n",
+		omega_c, eph.omega_0, eph.omegadot, OmegaEDot, t, GpsTow(t));
+	debug("  ToW*OmegaEDot=%.3f  (O-Oe)*t=%.3f\n", GpsTow(eph.t_oe)*OmegaEDot, (eph.omegadot-OmegaEDot)*t);
+	XmitPos.x = xdash*cos(omega_c) - ydash*cos(i)*sin(omega_c);
+	XmitPos.y = xdash*sin(omega_c) + ydash*cos(i)*cos(omega_c);
+	XmitPos.z = ydash*sin(i);
+	double tc = S(xmitTime - eph.t_oc);
+	double adjustClock = (  (eph.a_f2 * tc) + eph.a_f1 ) * tc + eph.a_f0;
+	double adjustRelativity = RelativisticConstant * eph.e * eph.sqrt_a * sin(E);
+	adjust = adjustClock + adjustRelativity - eph.t_gd;
+	debug("adjustclock=%g  adjustRelativity=%g t_gd=%g adjust=%g\n",
+		adjustClock,adjustRelativity,eph.t_gd, adjust);
+	return OK;
+}
+
+
+static void MakeOrbit(EphemerisXmit& e, int k, Time toe)
+{
+	e.m_0 = k*0.5 - 3;  e.delta_n = 4.5e-9;  e.e = 0.002 + 0.0018*k;
+	e.sqrt_a = 5153.6;  e.omega_0 = (k%6)*PI/3 - 2;  e.i_0 = 0.96;
+	e.omega = 1 - k*0.3;  e.omegadot = -8e-9;  e.idot = 1e-10;
+	e.c_uc = 1e-6;  e.c_us = 8e-6;  e.c_rc = 200;  e.c_rs = -30;  e.c_ic = 1e-7;  e.c_is = -5e-8;
+	e.t_oe = toe;  e.t_oc = toe;  e.t_gd = -1e-8;
+	e.a_f0 = 1e-4;  e.a_f1 = 1e-12;  e.a_f2 = 0;
+	e.MinTime = toe - 2*NsecPerHour;  e.MaxTime = toe + 2*NsecPerHour;
+	e.Changed();
+}
+
+
+static bool SecondOrbit(Time toe)
+// A new orbit, written into the working fields and kept, must not be hidden by the cache
+{
+	EphemerisXmit eph(1, "Bench");
+	MakeOrbit(eph, 0, toe);
+	eph.Keep();
+
+	SatPosCache cache;
+	Position before, after; double adjust;
+	if (cache.SatPos(eph, 1, toe, before, adjust) != OK) return Error();
+	eph.m_0 += 1e-4;  eph.sqrt_a += 1;  eph.iode++;
+	eph.Keep();
+	if (cache.SatPos(eph, 1, toe, after, adjust) != OK) return Error();
+
+	Position orig; double origadj;
+	if (Original(eph, toe, orig, origadj) != OK) return Error();
+	printf("second orbit moved the satellite %.1f m, %.2e m from the original\n", 
+		Range(after - before), Range(after - orig));
+	if (Range(after - before) < 1)
+		return Error("The second orbit didn't change the satellite position\n");
+	if (Range(after - orig) > 1e-6)
+		return Error("The second orbit was worked out with the first one's terms\n");
+	return OK;
+}
+
+
+static bool CachedBatch(Time toe)
+// Each satellite at its own time, through the cache. The last has no orbit.
+{
+	Ephemerides all;
+	int sat[NrSats]; Time t[NrSats];
+	for (int k=0; k<NrSats; k++) {
+		EphemerisXmit* e = new EphemerisXmit(k+1, "Bench");
+		MakeOrbit(*e, k, toe);
+		all.eph[k+1] = e;
+		sat[k] = k+1;
+		t[k] = toe + NsecPerHour - (67 + 2*k) * (NsecPerSec/1000);
+	}
+	t[NrSats-1] = toe + 3*NsecPerHour;
+
+	SatPosCache cache;
+	Position pos[NrSats]; double adjust[NrSats]; bool ok[NrSats];
+	bool err = cache.SatPos(all, NrSats, sat, t, pos, adjust, ok);
+	ClearError();
+	double largest = 0;
+	for (int k=0; k<NrSats-1; k++) {
+		Position orig; double origadj;
+		if (!ok[k] || Original((EphemerisXmit&)all[k+1], t[k], orig, origadj) != OK)
+			return Error("No batched position for satellite %d\n", k+1);
+		largest = max(largest, Range(pos[k] - orig));
+	}
+
+	// Again, now from the cache
+	uint32 hits = cache.GetHits();
+	cache.SatPos(all, NrSats, sat, t, pos, adjust, ok);
+	ClearError();
+	printf("batch through the cache: largest difference %.2e m, %u of %d cached\n",
+		largest, (unsigned)(cache.GetHits() - hits), NrSats-1);
+	if (err == OK || ok[NrSats-1])
+		return Error("A satellite without an orbit was given a position\n");
+	if (largest > 1e-6)
+		return Error("The batched positions don't match the original\n");
+	if (cache.GetHits() - hits != NrSats-1)
+		return Error("The batched positions weren't cached\n");
+	return OK;
+}
+
+
+static bool ManyOrbits(Time toe)
+{
+	EphemerisXmit eph(1, "Bench");
+	EphemerisXmit single(1, "Bench");
+	for (int h=0; h<24; h+=2) {
+		MakeOrbit(eph, h, toe + h*NsecPerHour);
+		eph.Keep();
+	}
+
+	uint32 issue = eph.Issue;
+	double largest = 0;
+	for (Time t = toe - NsecPerHour; t < toe + 23*NsecPerHour; t += 60*NsecPerSec) {
+		int h = (int)((t - toe + NsecPerHour) / (2*NsecPerHour)) * 2;
+		MakeOrbit(single, h, toe + h*NsecPerHour);
+		Position pos, orig; double adjust, origadj;
+		if (eph.SatPos(t, pos, adjust) != OK || Original(single, t, orig, origadj) != OK)
+			return Error();
+		largest = max(largest, Range(pos - orig));
+	}
+	if (eph.Issue != issue)
+		return Error("Working out positions changed the ephemeris\n");
+
+	MakeOrbit(eph, 24, toe + 24*NsecPerHour);
+	eph.Keep();
+	printf("a day of orbits: largest difference %.2e m, %d of 13 orbits kept\n", 
+		largest, (int)eph.Records.size());
+	if (largest > 1e-6)
+		return Error("The wrong orbit was used\n");
+	if (eph.Records.size() != 3)
+		return Error("The stale orbits weren't pruned\n");
+	return OK;
+}
+
+
+int main(int argc, const char** argv)
+{
+	int epochs = 4*3600;
+	if (argc > 1) epochs = atoi(argv[1]);
+
+	Time toe = ConvertGpsTime(1400, 7200);
+	EphemerisXmit* eph[NrSats];
+	for (int k=0; k<NrSats; k++) {
+		eph[k] = new EphemerisXmit(k+1, "Bench");
+		MakeOrbit(*eph[k], k, toe);
+	}
+	Time first = toe - 2*NsecPerHour;
+	epochs = min(epochs, 4*3600);
+
+	// The original, keeping its positions to compare against
+	Position* orig = new Position[epochs*NrSats];
+	double* origadj = new double[epochs*NrSats];
+	Time start = GetCurrentTime();
+	for (int t=0; t<epochs; t++)
+		for (int k=0; k<NrSats; k++)
+			Original(*eph[k], first + t*NsecPerSec, orig[t*NrSats+k], origadj[t*NrSats+k]);
+	Time original = GetCurrentTime() - start;
+
+	// One at a time
+	double scalardiff = 0, scalaradj = 0;
+	start = GetCurrentTime();
+	for (int t=0; t<epochs; t++)
+		for (int k=0; k<NrSats; k++) {
+			Position pos; double adjust;
+			eph[k]->SatPos(first + t*NsecPerSec, pos, adjust);
+			scalardiff = max(scalardiff, Range(pos - orig[t*NrSats+k]));
+			scalaradj = max(scalaradj, abs(adjust - origadj[t*NrSats+k]));
+		}
+	Time scalar = GetCurrentTime() - start;
+
+	// All at once
+	static XmitBatch batch;
+	double batchdiff = 0, batchadj = 0;
+	start = GetCurrentTime();
+	for (int t=0; t<epochs; t++) {
+		batch.Clear();
+		for (int k=0; k<NrSats; k++)
+			batch.Add(*eph[k], first + t*NsecPerSec);
+		batch.SatPos();
+		for (int k=0; k<NrSats; k++) {
+			Position pos(batch.X[k], batch.Y[k], batch.Z[k]);
+			batchdiff = max(batchdiff, Range(pos - orig[t*NrSats+k]));
+			batchadj = max(batchadj, abs(batch.Adjust[k] - origadj[t*NrSats+k]));
+		}
+	}
+	Time batched = GetCurrentTime() - start;
+	ShowErrors();
+
+	double n = epochs*NrSats;
+	printf("%d satellites x %d epochs\n", NrSats, epochs);
+	printf("original   %10.0f positions/s\n", n/S(original));
+	printf("scalar     %10.0f positions/s   largest difference %.2e m, %.2e s\n", 
+		n/S(scalar), scalardiff, scalaradj);
+	printf("batch      %10.0f positions/s   largest difference %.2e m, %.2e s\n", 
+		n/S(batched), batchdiff, batchadj);
+	if (batchdiff > 1e-6)
+		{Error("The batch doesn't match the original\n"); return ShowErrors();}
+
+	if (CachedBatch(toe) != OK || SecondOrbit(toe) != OK || ManyOrbits(toe) != OK)
+		return ShowErrors();
+	return 0;
+}
@@ -0,0 +1,167 @@
+// OutputBench - times handing epochs to writers on threads of their own
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// A made up receiver produces epochs as fast as it can, each with a dozen
+//   satellites and an occasional new broadcast orbit. They go to three
+//   writers: one which keeps up, and two which stall now and then like
+//   a caster or an SD card. One of the slow ones waits for room, one
+//   drops the oldest epochs and one drops the newest.
+//
+// Each writer checks the epochs arrive in order with the observations
+//   and orbits they were sent with, and never with an orbit sent later.
+//   The time the receiver spent handing
+//   out epochs is shown, along with what each writer did.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "OutputPipeline.h"
+#include "GpsTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+static const int NrSats = 12;
+
+
+class MadeUpReceiver : public RawReceiver
+{
+public:
+	int Epoch;
+	MadeUpReceiver() : Epoch(0)
+	{
+		ErrCode = OK;
+		for (int s=1; s<=NrSats; s++)
+			eph[s] = new EphemerisXmit(s, "Made up");
+	}
+
+	bool NextEpoch()
+	{
+		Epoch++;
+		GpsTime = Epoch * NsecPerSec;
+		obs.Clear();
+		for (int s=1; s<=NrSats; s++) {
+			RawObservation* o = obs.Add(s);
+			if (o == NULL) return Error();
+			o->Valid = true;
+			o->PR = Epoch * 1000.0 + s;
+		}
+
+		// A new orbit for one satellite every few minutes
+		if (Epoch % 200 == 0) {
+			EphemerisXmit& e = *(EphemerisXmit*)eph[1 + Epoch/200 % NrSats];
+			e.t_oe = GpsTime;
+			e.MinTime = GpsTime - 2*NsecPerHour;
+			e.MaxTime = GpsTime + 2*NsecPerHour;
+			e.Keep();
+		}
+		return OK;
+	}
+};
+
+
+class CheckingWriter
+{
+public:
+	RawReceiver& Gps;
+	int Every, Msec;          // stall for Msec every so many epochs
+	int Epochs, Bad;
+	Time Last;
+
+	CheckingWriter(RawReceiver& gps, int every, int msec)
+		: Gps(gps), Every(every), Msec(msec), Epochs(0), Bad(0), Last(0) {}
+
+	bool OutputEpoch()
+	{
+		int epoch = Gps.GpsTime / NsecPerSec;
+		if (Gps.GpsTime <= Last || Gps.Active.Count() != NrSats) Bad++;
+		for (int s=1; s<=NrSats; s++)
+			if (Gps.obs[s].PR != epoch * 1000.0 + s) Bad++;
+
+		// The latest orbit sent must be here
+		int latest = epoch - epoch%200;
+		if (latest > 0) {
+			Ephemeris& e = Gps[1 + latest/200 % NrSats];
+			if (!e.Valid(latest * NsecPerSec + NsecPerHour)) Bad++;
+		}
+		for (int s=1; s<=NrSats; s++) {
+			EphemerisXmit* x = dynamic_cast<EphemerisXmit*>(Gps.eph[s]);
+			if (x != NULL && x->Records.size() > 0 && x->Records.back().t_oe > Gps.GpsTime) Bad++;
+		}
+
+		Last = Gps.GpsTime;
+		Epochs++;
+		if (Every > 0 && Epochs % Every == 0) Sleep(Msec);
+		return OK;
+	}
+};
+
+
+int main(int argc, const char** argv)
+{
+	int epochs = 20000;
+	if (argc > 1) epochs = atoi(argv[1]);
+	int depth = 64;
+	if (argc > 2) depth = atoi(argv[2]);
+
+	MadeUpReceiver gps;
+	OutputPipeline* out = new OutputPipeline(gps);
+
+	WriterSink<CheckingWriter>* fast = new WriterSink<CheckingWriter>("fast", gps, OutputSink::Block, depth);
+	fast->Out = new CheckingWriter(fast->Gps, 0, 0);
+	WriterSink<CheckingWriter>* lagging = new WriterSink<CheckingWriter>("lagging", gps, OutputSink::Block, depth);
+	lagging->Out = new CheckingWriter(lagging->Gps, 1000, 20);
+	WriterSink<CheckingWriter>* dropping = new WriterSink<CheckingWriter>("dropping", gps, OutputSink::DropOldest, depth);
+	dropping->Out = new CheckingWriter(dropping->Gps, 1000, 20);
+	WriterSink<CheckingWriter>* refusing = new WriterSink<CheckingWriter>("refusing", gps, OutputSink::DropNewest, depth);
+	refusing->Out = new CheckingWriter(refusing->Gps, 1000, 20);
+	if (out->Add(fast) != OK || out->Add(lagging) != OK || out->Add(dropping) != OK
+	 || out->Add(refusing) != OK)
+		return ShowErrors();
+
+	// Time how long the receiver's thread spends handing out epochs
+	Time handing = 0;
+	for (int e=0; e<epochs; e++) {
+		if (gps.NextEpoch() != OK) return ShowErrors();
+		Time start = GetCurrentTime();
+		if (out->OutputEpoch() != OK) return ShowErrors();
+		handing += GetCurrentTime() - start;
+	}
+
+	// Finish writing before looking at the writers
+	for (int i=0; i<out->NrSinks; i++)
+		out->Sinks[i]->Finish();
+
+	printf("epochs=%d  queue=%d  handing out %.2f usec/epoch\n", epochs, depth,
+		handing / (double)epochs / 1000);
+	CheckingWriter* w[4] = {fast->Out, lagging->Out, dropping->Out, refusing->Out};
+	int bad = 0;
+	for (int i=0; i<out->NrSinks; i++) {
+		OutputSink& s = *out->Sinks[i];
+		printf("%-9s  written=%u dropped=%u stalls=%u most queued=%d  bad=%d\n",
+			s.Name, (unsigned)s.Written, (unsigned)s.Dropped, (unsigned)s.Stalls, s.MostQueued, w[i]->Bad);
+		bad += w[i]->Bad;
+	}
+	delete out;
+	if (bad != 0) return 1;
+
+	return ShowErrors();
+}
@@ -0,0 +1,105 @@
+// RoverBench - times many rovers against one base, paired and shared
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Simulated rovers sit a few km from a simulated base, while simulated
+//   satellites circle overhead. The rovers are processed two ways:
+//   the old way, each with its own copy of the base and its own DoubleDiff,
+//   and sharing one base through MultiRover. The times are shown, along with
+//   the largest difference between the two sets of positions and the
+//   rms error of the shared positions.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "MultiRover.h"
+#include "GpsTime.h"
+#include "SimReceiver.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+
+static Position RoverTruth(int r)
+{
+	double a = r*2*PI/7;
+	return BaseTruth + Position(3000*cos(a), 3000*sin(a), 200*(r%3));
+}
+
+
+int main(int argc, const char** argv)
+{
+	int rovers = 8, epochs = 600;
+	if (argc > 1) rovers = min(atoi(argv[1]), (int)MaxRovers);
+	if (argc > 2) epochs = atoi(argv[2]);
+	static Position paired[MaxRovers][10000];
+	epochs = min(epochs, 10000);
+	SimEphemerides eph;
+
+	// Each rover with its own base
+	Time start = GetCurrentTime();
+	for (int r=0; r<rovers; r++) {
+		SimReceiver base(eph, BaseTruth, epochs, 1);
+		SimReceiver rover(eph, RoverTruth(r), epochs, 100+r);
+		rover.Pos = rover.Pos + Position(3, -2, 4);
+		DoubleDiff dbl(eph, base, rover);
+		Time t; Position pos; double cep, fit;
+		for (int e=0; dbl.NextPosition(t, pos, cep, fit) == OK; e++)
+			paired[r][e] = pos;
+		ClearError();
+	}
+	Time pairtime = GetCurrentTime() - start;
+
+	// All the rovers sharing one base
+	start = GetCurrentTime();
+	SimReceiver base(eph, BaseTruth, epochs, 1);
+	SimReceiver* rover[MaxRovers];
+	MultiRover fleet(eph, base);
+	for (int r=0; r<rovers; r++) {
+		rover[r] = new SimReceiver(eph, RoverTruth(r), epochs, 100+r);
+		rover[r]->Pos = rover[r]->Pos + Position(3, -2, 4);
+		fleet.Add(*rover[r]);
+	}
+	double maxdiff = 0, sum = 0;
+	int count = 0, nosolution = 0;
+	for (int e=0; fleet.NextEpoch() == OK; e++)
+		for (int r=0; r<rovers; r++) {
+			if (!fleet.Common[r]) continue;
+			if (fleet.Cep[r] < 0) {nosolution++; continue;}
+			maxdiff = max(maxdiff, Range(fleet.Pos[r] - paired[r][e]));
+			double err = Range(fleet.Pos[r] - RoverTruth(r));
+			sum += err*err;  count++;
+		}
+	ClearError();
+	Time sharedtime = GetCurrentTime() - start;
+
+	printf("rovers=%d  epochs=%d  processors=%d\n", rovers, epochs, Thread::Processors());
+	printf("paired   %8.3f s  %8.0f rover epochs/s\n", S(pairtime), rovers*epochs/S(pairtime));
+	printf("shared   %8.3f s  %8.0f rover epochs/s\n", S(sharedtime), rovers*epochs/S(sharedtime));
+	printf("largest difference=%.6f m   rms error=%.4f m  (%d positions, %d without a solution)\n", 
+		maxdiff, sqrt(sum/max(count,1)), count, nosolution);
+
+	bool failed = false;
+	for (int r=0; r<rovers; r++) {
+		failed = failed || fleet.Failed[r];
+		delete rover[r];
+	}
+	return failed;
+}
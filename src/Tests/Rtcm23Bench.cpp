@@ -0,0 +1,293 @@
+// Rtcm23Bench - times reading RTCM 2.3 frames and checks the parity tables
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// The table driven parity is compared with the bit at a time parity it
+//   replaced, on random words following both kinds of previous word.
+//
+// Then a file of RTCM 2.3 frames is written, with an occasional burst of
+//   noise or a damaged word, as from an old reference station on a radio
+//   link. It is read with Rtcm23In and with the way Rtcm23In used to read,
+//   a byte per call and bit at a time parity. Both must give the same
+//   frames. Then both are timed on a clean file, mapped into memory and
+//   read straight from the file, a system call per read, as from a port.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "Rtcm23In.h"
+#include "Rtcm23Out.h"
+#include "OutputFile.h"
+#include "MappedInputFile.h"
+#include "InputFile.h"
+#include "GpsTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+
+static uint32 Random32()
+{
+	return ((uint32)rand() << 16 ^ rand()) & 0xffffffff;
+}
+
+
+///////////////////////////////////////////////////////////////////
+//  The old way, the bit at a time
+///////////////////////////////////////////////////////////////////
+
+static uint32 OldParityOf(uint32 w)
+{
+	w ^= w>>16; w ^= w>>8; w ^= w>>4; w ^= w>>2; w ^= w>>1;
+	return (w&1);
+}
+
+static uint32 OldCalculateParity(uint32 word, uint32 PrevD29, uint32 PrevD30)
+{
+	uint32 data = ((PrevD30? ~word: word) >> 6) & 0xffffff;
+	uint32 D25 = PrevD29 ^ OldParityOf(data & 0xec7cd2);
+	uint32 D26 = PrevD30 ^ OldParityOf(data & 0x763e69);
+	uint32 D27 = PrevD29 ^ OldParityOf(data & 0xbb1f34);
+	uint32 D28 = PrevD30 ^ OldParityOf(data & 0x5d8f9a);
+	uint32 D29 = PrevD30 ^ OldParityOf(data & 0xaec7cd);
+	uint32 D30 = PrevD29 ^ OldParityOf(data & 0x2dea27);
+	return (D25<<5) + (D26<<4) + (D27<<3) + (D28<<2) + (D29<<1) + D30;
+}
+
+static bool OldCheckParity(uint32 word)
+{
+	uint32 PrevD29 = (word>>31)&1, PrevD30 = (word>>30)&1;
+	uint32 data = ((PrevD30)? ~word: word) & 0x3fffffc0;
+	return (word & 0x3f) != OldCalculateParity(data, PrevD29, PrevD30);
+}
+
+
+static byte Reverse[64];
+
+
+class OldRtcm23In
+{
+protected:
+	Stream& In;
+	uint64 RawWord;
+	int BitShift;
+
+public:
+	OldRtcm23In(Stream& in) : In(in), RawWord(0), BitShift(0) {}
+
+	bool ReadFrame(Frame& f, bool& slip)
+	{
+		f.Init();
+		int Length = 2;
+		slip = false;
+		while (f.NrWords < Length) {
+			uint32 word; bool wordslip;
+			if (ReadWord(word, wordslip) != OK) return Error();
+			slip |= wordslip;
+			if (wordslip) f.Init();
+			f.AddWord(word);
+			if (f.NrWords == 1 && f.GetField(1, 1, 8) != 0x66) {
+				f.Init();
+				slip = true;
+			}
+			else if (f.NrWords == 2)
+				Length = f.GetField(2, 17, 21);
+		}
+		return OK;
+	}
+
+	bool ReadWord(uint32& word, bool& slip)
+	{
+		for (int i=0; i<5; i++) {
+			byte b;
+			if (In.Read(b) != OK) return Error();
+			RawWord = (RawWord<<6) | Reverse[b&0x3f];
+		}
+		word = (uint32)(RawWord>>BitShift);
+		slip = (OldCheckParity(word) != OK);
+		if (slip && Synchronize(word) != OK) return Error();
+		word = RemoveParity(word);
+		return OK;
+	}
+
+	bool Synchronize(uint32& word)
+	{
+		do {
+			BitShift--;
+			if (BitShift < 0) {
+				byte b;
+				if (In.Read(b) != OK) return Error();
+				RawWord = (RawWord << 6) | Reverse[b&0x3f];
+				BitShift = 5;
+			}
+			word = (uint32)(RawWord>>BitShift);
+		} while (OldCheckParity(word) != OK);
+		return OK;
+	}
+};
+
+
+///////////////////////////////////////////////////////////////////
+//   Making up and reading the frames
+///////////////////////////////////////////////////////////////////
+
+static bool CompareParity(int trials)
+{
+	for (int t=0; t<trials; t++) {
+		uint32 w = Random32();
+		uint32 d29 = (w>>31)&1, d30 = (w>>30)&1;
+		if (CheckParity(w) != OldCheckParity(w)
+		 || AddParity(w, d29, d30) != ((((d30)? ~w: w) & 0x3fffffc0) | OldCalculateParity(w, d29, d30))) {
+			printf("Parity differs for %08x\n", (unsigned)w);
+			return false;
+		}
+
+		// A good word must pass, and the same word with a bit flipped must not
+		uint32 good = (d29<<31) | (d30<<30) | (AddParity(w, d29, d30) & 0x3fffffff);
+		uint32 bad = good ^ (1 << (rand()%30));
+		if (CheckParity(good) != OK || CheckParity(bad) == OK) {
+			printf("Parity doesn't check %08x\n", (unsigned)good);
+			return false;
+		}
+	}
+	return true;
+}
+
+
+class NoisyStream: public OutputFile
+// Damages a word now and then on its way to the file
+{
+public:
+	int Noise;
+	NoisyStream(const char* name, int noise) : OutputFile(name), Noise(noise) {}
+	bool Write(const byte* buf, size_t len)
+	{
+		byte b = *buf;
+		if (Noise > 0 && len == 1 && rand()%(30*Noise) == 0)
+			b ^= 1 << rand()%6;
+		return OutputFile::Write(&b, len);
+	}
+};
+
+
+static bool WriteFrames(const char* name, int frames, int noise)
+{
+	NoisyStream out(name, noise);
+	if (out.GetError() != OK) return Error();
+	Rtcm23Out com(out);
+
+	srand(1);
+	for (int i=0; i<frames; i++) {
+		Frame f(2 + rand()%30);
+		f.PutWord(1, (0x66<<22) | (18<<16) | (i%1024)<<6);
+		f.PutWord(2, ((i%6000)<<17) | ((i&7)<<14) | (f.NrWords<<9));
+		for (int w=3; w<=f.NrWords; w++)
+			f.PutWord(w, Random32() & 0x3fffffc0);
+		if (com.WriteFrame(f) != OK) return Error();
+
+		// A burst of noise, looking like RTCM bytes
+		if (noise > 0 && rand()%noise == 0) {
+			int len = 1 + rand()%40;
+			for (int k=0; k<len; k++) {
+				byte b = 0x40 | rand()%64;
+				if (out.OutputFile::Write(&b, 1) != OK) return Error();
+			}
+		}
+	}
+	return OK;
+}
+
+
+template <class Reader, class Input>
+static double ReadFrames(const char* name, Frame* frames, int max, int& nr, int& slips)
+// Returns frames per second
+{
+	Input in(name);
+	Reader com(in);
+	nr = slips = 0;
+	Time start = GetCurrentTime();
+	bool slip;
+	for (; nr < max && com.ReadFrame(frames[nr], slip) == OK; nr++)
+		slips += slip;
+	Time elapsed = GetCurrentTime() - start;
+	ClearError();
+	return nr / (elapsed / (double)NsecPerSec);
+}
+
+
+static bool SameFrames(Frame* a, Frame* b, int nr)
+{
+	for (int i=0; i<nr; i++)
+		if (a[i].NrWords != b[i].NrWords
+		 || memcmp(a[i].Data, b[i].Data, a[i].NrWords*sizeof(a[i].Data[0])) != 0) {
+			printf("Frame %d differs\n", i);
+			return false;
+		}
+	return true;
+}
+
+
+int main(int argc, const char** argv)
+{
+	int frames = 100000;
+	if (argc > 1) frames = atoi(argv[1]);
+
+	for (int b=0; b<64; b++)
+		for (int k=0; k<6; k++)
+			if (b & (1<<k)) Reverse[b] |= 0x20 >> k;
+
+	srand(1);
+	if (!CompareParity(1000000)) return 1;
+
+	Frame* old = new Frame[frames];
+	Frame* fast = new Frame[frames];
+	int oldnr, fastnr, oldslips, fastslips;
+
+	// A noisy link: about one frame in 20 is hit
+	if (WriteFrames("Rtcm23Bench.rtcm", frames, 20) != OK) return ShowErrors();
+	ReadFrames<OldRtcm23In, MappedInputFile>("Rtcm23Bench.rtcm", old, frames, oldnr, oldslips);
+	ReadFrames<Rtcm23In, MappedInputFile>("Rtcm23Bench.rtcm", fast, frames, fastnr, fastslips);
+	printf("noisy link: %d frames sent   old way read %d (%d slipped)   Rtcm23In read %d (%d slipped)\n",
+		frames, oldnr, oldslips, fastnr, fastslips);
+	bool failed = oldnr != fastnr || oldslips != fastslips || !SameFrames(old, fast, oldnr);
+
+	// A clean file, for speed, mapped and straight from the file like a serial port
+	if (WriteFrames("Rtcm23Bench.rtcm", frames, 0) != OK) return ShowErrors();
+	double oldrate = ReadFrames<OldRtcm23In, MappedInputFile>("Rtcm23Bench.rtcm", old, frames, oldnr, oldslips);
+	double fastrate = ReadFrames<Rtcm23In, MappedInputFile>("Rtcm23Bench.rtcm", fast, frames, fastnr, fastslips);
+	printf("clean file, mapped: old way %10.0f frames/s   Rtcm23In %10.0f frames/s   (%d %d frames)\n",
+		oldrate, fastrate, oldnr, fastnr);
+	failed = failed || oldnr != frames || fastnr != frames || !SameFrames(old, fast, frames);
+
+	oldrate = ReadFrames<OldRtcm23In, InputFile>("Rtcm23Bench.rtcm", old, frames, oldnr, oldslips);
+	fastrate = ReadFrames<Rtcm23In, InputFile>("Rtcm23Bench.rtcm", fast, frames, fastnr, fastslips);
+	printf("clean file, direct: old way %10.0f frames/s   Rtcm23In %10.0f frames/s   (%d %d frames)\n",
+		oldrate, fastrate, oldnr, fastnr);
+	failed = failed || oldnr != frames || fastnr != frames || !SameFrames(old, fast, frames);
+
+	remove("Rtcm23Bench.rtcm");
+	delete[] old;
+	delete[] fast;
+	if (failed) {
+		printf("Frames differ\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,128 @@
+#ifndef SIMRECEIVER_INCLUDED
+#define SIMRECEIVER_INCLUDED
+// SimReceiver - simulated satellites and receivers shared by the benches
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// SimSats satellites circle slowly overhead at fixed elevations above
+//   BaseTruth. A SimReceiver measures code and phase to them from a known
+//   position, with a random clock each epoch and noise drawn from its seed.
+//   Receivers given the same seed see exactly the same measurements.
+//
+// Each bench includes this once, so everything here is static.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "Ephemeris.h"
+#include "RawReceiver.h"
+
+static const int SimSats = 9;
+static Position BaseTruth(-2430e3, -4702e3, 3546e3);
+static const Time Start = 1000000000LL * NsecPerSec;
+
+
+static double Noise(unsigned& seed, double sigma)
+// Roughly normal, from the sum of uniform numbers
+{
+	double sum = 0;
+	for (int i=0; i<4; i++) {
+		seed = seed*1103515245 + 12345;
+		sum += (seed>>8) / (double)(1<<24) - 0.5;
+	}
+	return sum * sigma * 1.732;
+}
+
+
+class SimEphemeris: public Ephemeris
+// A satellite moving slowly across the base's sky
+{
+	double Azimuth, Elevation;
+public:
+	SimEphemeris(int s, int i): Ephemeris(s, "Simulated")
+		{Azimuth = i*2*PI/SimSats; Elevation = 0.4 + 0.12*(i%9); ErrCode = OK;}
+	virtual bool SatPos(Time t, Position& pos, double& adjust)
+	{
+		double az = Azimuth + S(t - Start) * 2*PI/43082;
+
+		// Local east, north and up at the base
+		Position up = BaseTruth / Range(BaseTruth);
+		Position east(-up.y, up.x, 0);  east = east / Range(east);
+		Position north(up.y*east.z - up.z*east.y, up.z*east.x - up.x*east.z, up.x*east.y - up.y*east.x);
+
+		double ce = cos(Elevation)*20200e3, se = sin(Elevation)*20200e3;
+		pos = BaseTruth + east*(ce*sin(az)) + north*(ce*cos(az)) + up*se;
+		adjust = 0;
+		return OK;
+	}
+	virtual double Accuracy(Time t) {return 1;}
+	virtual bool Valid(Time t) {return true;}
+};
+
+
+class SimEphemerides: public Ephemerides
+{
+public:
+	SimEphemerides() {for (int i=0; i<SimSats; i++) eph[SvidToSat(i+1)] = new SimEphemeris(SvidToSat(i+1), i);}
+};
+
+
+class SimReceiver: public RawReceiver
+// Measures the code and phase to the simulated satellites
+{
+	Position Truth;
+	Ephemerides& Eph;
+	int Epochs;
+	unsigned Seed;
+	double Ambiguity[SimSats];
+public:
+	SimReceiver(Ephemerides& eph, Position truth, int epochs, unsigned seed)
+		: Truth(truth), Eph(eph), Epochs(epochs), Seed(seed)
+	{
+		Pos = Truth;
+		GpsTime = Start;
+		for (int i=0; i<SimSats; i++)
+			Ambiguity[i] = (int)(Noise(Seed, 1e5));
+		ErrCode = OK;
+	}
+
+	virtual bool NextEpoch()
+	{
+		if (Epochs-- <= 0) return Error("SimReceiver - end of data\n");
+		GpsTime += NsecPerSec;
+		double clock = Noise(Seed, 1e3);
+		obs.Clear();
+		for (int i=0; i<SimSats; i++) {
+			int s = SvidToSat(i+1);
+			Position sat; double adjust;
+			Eph[s].SatPos(GpsTime, sat, adjust);
+			sat = RotateEarth(sat, -Range(sat-Truth)/C);
+			double range = Range(sat-Truth);
+			RawObservation* o = obs.Add(s);
+			if (o == NULL) return Error();
+			o->Sat = s;  o->Valid = true;  o->Slip = false;
+			o->PR = range + clock + Noise(Seed, 0.5);
+			o->Phase = (range + clock + Noise(Seed, 0.002))/L1WaveLength + Ambiguity[i];
+			o->SNR = 45;  o->Doppler = 0;
+		}
+		return OK;
+	}
+};
+
+#endif // SIMRECEIVER_INCLUDED
@@ -0,0 +1,197 @@
+// SmoothBench - times saving and smoothing a day of 1 Hz epochs
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// A rover wanders about while satellites rise and set, each one in view
+//   for a few hours. The equations are driven the way Solution drives them:
+//   a new position every epoch, satellites dropped as they set and added as
+//   they rise, and a new reference when the old one sets.
+//
+// The forward pass is timed with and without saving the epochs, then the
+//   backward pass is timed. Since the true positions are known, the errors
+//   before and after smoothing are shown as well.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "GpsEquations.h"
+#include "GpsTime.h"
+#include "SimReceiver.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+static const int NrSats = 12;
+static const int Period = 6*3600;         // each satellite repeats every 6 hours
+static const int Visible = 4*3600;        //    and is in view for 4 of them
+static const double CodeSigma = 1.0, PhaseSigma = 0.005;
+
+static Triple Los[MaxSats];
+static int Ambiguity[MaxSats];
+static bool InView[MaxSats];
+static unsigned Seed;
+
+static bool Up(int s, int epoch)
+{
+	return (epoch + s*Period/NrSats) % Period < Visible;
+}
+
+static int Remaining(int s, int epoch)
+{
+	return Visible - (epoch + s*Period/NrSats) % Period;
+}
+
+static Position Truth(int epoch)
+{
+	return Position(100*sin(epoch/500.0), 80*cos(epoch/700.0), 5*sin(epoch/300.0));
+}
+
+static void Geometry(int s, int epoch)
+{
+	double az = s*2*PI/NrSats + epoch*2*PI/Period;
+	double el = PI/2 * (1 - abs(2.0*Remaining(s, epoch)/Visible - 1)) + 0.1;
+	Los[s] = Triple(cos(el)*cos(az), cos(el)*sin(az), sin(el));
+}
+
+
+static double Run(int epochs, Smoother* store, double& err)
+// Returns epochs per second
+{
+	static GpsEquations eqn;
+	eqn.Reset();
+	if (store != NULL) eqn.Record(store);
+	for (int s=1; s<=NrSats; s++)
+		InView[s] = false;
+	int ref = -1;
+	double sum = 0;
+
+	Seed = 1;
+	Time start = GetCurrentTime();
+	for (int e=0; e<epochs; e++) {
+		eqn.NewPosition();
+		eqn.NewEpoch();
+		Position truth = Truth(e);
+
+		// Satellites which set
+		for (int s=1; s<=NrSats; s++)
+			if (InView[s] && !Up(s, e) && s != ref)
+				{eqn.DropPhase(s); InView[s] = false;}
+
+		// The best remaining reference, if the old one set
+		int best = -1;
+		for (int s=1; s<=NrSats; s++)
+			if (InView[s] && s != ref && (best == -1 || Remaining(s, e) > Remaining(best, e)))
+				best = s;
+		if (ref != -1 && !Up(ref, e)) {
+			eqn.ChangeReference(ref, best);
+			eqn.DropPhase(ref);
+			InView[ref] = false;
+			ref = best;
+		}
+
+		// Satellites which rise
+		for (int s=1; s<=NrSats; s++)
+			if (!InView[s] && Up(s, e)) {
+				eqn.AddPhase(s);
+				InView[s] = true;
+				Ambiguity[s] = (int)Noise(Seed, 1e6);
+			}
+		if (ref == -1) {
+			for (int s=1; s<=NrSats; s++)
+				if (InView[s] && (ref == -1 || Remaining(s, e) > Remaining(ref, e)))
+					ref = s;
+			eqn.DeletePhase(ref);
+		}
+
+		// The single difference code and phase equations
+		double tc = Noise(Seed, 10), tp = Noise(Seed, 10);
+		for (int s=1; s<=NrSats; s++) {
+			if (!InView[s]) continue;
+			Geometry(s, e);
+			double range = Los[s][0]*truth.x + Los[s][1]*truth.y + Los[s][2]*truth.z;
+			eqn.AppendCode(Los[s], tc + range + Noise(Seed, CodeSigma), 1/CodeSigma);
+			eqn.AppendPhase(Los[s], tp + range + Ambiguity[s]*L1WaveLength + Noise(Seed, PhaseSigma),
+				            s, L1WaveLength, 0, 1/PhaseSigma);
+		}
+
+		Position offset; double cep, fit;
+		if (eqn.SolvePosition(offset, cep, fit) != OK) return 0;
+		Position base(0,0,0);
+		if (eqn.SaveEpoch(e, base, offset, cep, fit) != OK) return 0;
+
+		// Error of the forward solution
+		double dx = offset.x-truth.x, dy = offset.y-truth.y, dz = offset.z-truth.z;
+		sum += dx*dx + dy*dy + dz*dz;
+	}
+	Time elapsed = GetCurrentTime() - start;
+
+	if (store != NULL) eqn.EndRecording();
+	err = sqrt(sum/epochs);
+	return epochs / (elapsed / (double)NsecPerSec);
+}
+
+
+static double Smooth(Smoother& store, int epochs, double& err)
+// Returns epochs per second
+{
+	Time start = GetCurrentTime();
+	if (store.Smooth() != OK) return 0;
+	Time elapsed = GetCurrentTime() - start;
+
+	double sum = 0;
+	store.Rewind();
+	for (int e=0; e<epochs; e++) {
+		Time t; Position pos; double cep, fit;
+		if (store.NextEpoch(t, pos, cep, fit) != OK) return 0;
+		Position truth = Truth(t);
+		double dx = pos.x-truth.x, dy = pos.y-truth.y, dz = pos.z-truth.z;
+		sum += dx*dx + dy*dy + dz*dz;
+	}
+
+	err = sqrt(sum/epochs);
+	return epochs / (elapsed / (double)NsecPerSec);
+}
+
+
+int main(int argc, const char** argv)
+{
+	int epochs = 24*3600;
+	if (argc > 1) epochs = atoi(argv[1]);
+	const char* name = "SmoothBench.tmp";
+	if (argc > 2) name = argv[2];
+
+	double plainerr = 0, forwarderr = 0, smootherr = 0;
+	double plain = Run(epochs, NULL, plainerr);
+
+	Smoother store(name);
+	if (store.GetError() != OK) {ShowErrors(); return 1;}
+	double forward = Run(epochs, &store, forwarderr);
+	double backward = Smooth(store, epochs, smootherr);
+	ShowErrors();
+
+	printf("epochs=%d  saved=%.1f MB (%.0f bytes/epoch)\n", epochs,
+		store.GetSize()/1e6, store.GetSize()/(double)epochs);
+	printf("forward, not saving   %10.0f epochs/s\n", plain);
+	printf("forward, saving       %10.0f epochs/s\n", forward);
+	printf("backward              %10.0f epochs/s\n", backward);
+	printf("rms error  forward=%.4f m  smoothed=%.4f m\n", forwarderr, smootherr);
+
+	return 0;
+}
@@ -0,0 +1,143 @@
+// SolveBench - times the least squares solver used for double difference positioning
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// Each epoch appends a code and a phase equation for every satellite to the
+//   equations left from the previous epoch, and solves. The variables are
+//   the two clocks, the position and an ambiguity for each satellite
+//   other than the reference.
+//
+// "before" is the original solver: a Householder QR of the whole matrix
+//    every epoch, working down the columns of a row ordered array.
+// "after" is LinearEquations, which folds the new rows into R.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "LinearEquation.h"
+#include "GpsTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+
+// The original solver, kept here for comparison
+struct HouseholderEquations
+{
+	double A[MaxRows][MaxCols], B[MaxRows], X[MaxCols];
+	int LastRow, LastCol;
+
+	HouseholderEquations() {LastRow = LastCol = -1;}
+	int AddRow() {LastRow++; for (int c=0; c<=LastCol; c++) A[LastRow][c] = 0; return LastRow;}
+	int AddCol() {LastCol++; for (int r=0; r<=LastRow; r++) A[r][LastCol] = 0; return LastCol;}
+	bool Solve()
+	{
+		for (int c=0; c<=LastCol; c++)
+			if (ApplyHouseholder(A, c, LastRow, c, LastCol, B, c, c) != OK)
+				return Error("Can't solve equations");
+		BackSubstitute(A, LastCol, LastCol, B, X);
+		LastRow = LastCol;
+		return OK;
+	}
+};
+
+
+// Line of sight to each satellite, and the measurements for the current epoch
+static double Los[MaxChannels][3];
+static double Code[MaxChannels], Phase[MaxChannels];
+
+static void NewEpoch(int nsats, int epoch)
+{
+	for (int s=0; s<nsats; s++) {
+		double az = s*2*PI/nsats + epoch*1e-4;
+		double el = (15 + (s*37)%70) * PI / 180;
+		Los[s][0] = cos(el)*cos(az);  Los[s][1] = cos(el)*sin(az);  Los[s][2] = sin(el);
+		Code[s] = (rand()%2001 - 1000) / 1000.0;
+		Phase[s] = (rand()%2001 - 1000) / 100000.0;
+	}
+}
+
+template <typename Eqn>
+static void Append(Eqn& eqn, int nsats)
+{
+	for (int s=0; s<nsats; s++) {
+		int r = eqn.AddRow();
+		eqn.A[r][0] = 1;
+		for (int i=0; i<3; i++) eqn.A[r][2+i] = Los[s][i];
+		eqn.B[r] = Code[s];
+
+		r = eqn.AddRow();
+		eqn.A[r][1] = 1;
+		for (int i=0; i<3; i++) eqn.A[r][2+i] = Los[s][i];
+		if (s > 0) eqn.A[r][4+s] = 1;   // satellite 0 is the reference
+		eqn.B[r] = Phase[s];
+	}
+}
+
+
+template <typename Eqn>
+static double Run(Eqn& eqn, int nsats, int epochs, double* x)
+// Returns solves per second
+{
+	for (int c=0; c<4+nsats; c++)
+		eqn.AddCol();
+
+	srand(1);
+	Time start = GetCurrentTime();
+	for (int e=0; e<epochs; e++) {
+		NewEpoch(nsats, e);
+		Append(eqn, nsats);
+		if (eqn.Solve() != OK) return 0;
+	}
+	Time elapsed = GetCurrentTime() - start;
+
+	for (int c=0; c<4+nsats; c++)
+		x[c] = eqn.X[c];
+	return epochs / (elapsed / (double)NsecPerSec);
+}
+
+
+int main(int argc, const char** argv)
+{
+	int epochs = 20000;
+	if (argc > 1) epochs = atoi(argv[1]);
+
+	static const int Sats[] = {6, 8, 10, 12, 16, 20};
+	printf("sats   before(solves/s)   after(solves/s)   speedup   maxdiff\n");
+	for (int i=0; i<(int)(sizeof(Sats)/sizeof(Sats[0])); i++) {
+		int nsats = Sats[i];
+
+		static HouseholderEquations before;
+		before = HouseholderEquations();
+		static LinearEquations<MaxRows, MaxCols> after;
+		after.Reset();
+
+		double xb[MaxCols], xa[MaxCols];
+		double rb = Run(before, nsats, epochs, xb);
+		double ra = Run(after, nsats, epochs, xa);
+
+		double diff = 0;
+		for (int c=0; c<4+nsats; c++)
+			diff = max(diff, abs(xb[c] - xa[c]));
+		printf("%4d   %18.0f   %15.0f   %7.2f   %.2g\n", nsats, rb, ra, ra/rb, diff);
+	}
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+// Sp3Bench - times SP3 interpolation
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// A day of 15 minute satellite positions and clocks, like an SP3 file,
+//   is interpolated at every second. The original Neville interpolation
+//   (10 points, worked out from scratch each time) is timed against
+//   the Interpolator's precomputed polynomials, and the largest differences
+//   between the two are shown.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "Interpolator.h"
+#include "GpsTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+static const Time Spacing = 15*60*NsecPerSec;
+static const int NrPoints = 97;
+
+
+static Position Orbit(Time t)
+{
+	double a = S(t) * 2*PI/43082;
+	double r = 26560e3 + 2e4*sin(2*a);
+	return Position(r*cos(a), r*sin(a)*0.5, r*sin(a)*0.87);
+}
+
+static double Clock(Time t)
+{
+	return 1e-4 + 1e-11*S(t) + 1e-9*sin(S(t)/5000);
+}
+
+
+// The original interpolation
+template<typename Ty>
+static void Neville(int32 n, Time* x, Ty* y, Time X, Ty& Y)
+{
+	Ty c[50], d[50];
+	Y = Ty(0);
+	for (int order = 0; order < n; order++){
+		d[order] = c[order] = y[order];
+		for (int i = order-1; i>=0; i--) {
+			Ty m = (c[i+1] - d[i]) / (x[i] - x[order]);
+			c[i] = (x[i]     - X) * m;
+			d[i] = (x[order] - X) * m;
+		}
+		Y = Y + c[0];
+	}
+}
+
+template<typename Ty>
+static void Original(Time* Xv, Ty* Yv, int size, Time x, Ty& y)
+{
+	int i = (x - Xv[0]) / (Xv[1] - Xv[0]);
+	int n = 10;
+	i = i-n/2;
+	if (i < 0)       i = 0;
+	if (n > size)    n = size;
+	if (i+n > size)  i = size - n;
+	Neville(n, &Xv[i], &Yv[i], x, y);
+}
+
+
+int main(int argc, const char** argv)
+{
+	Time xv[NrPoints];  Position pv[NrPoints];  double cv[NrPoints];
+	Interpolator<Time,Position> xPos;
+	Interpolator<Time,double> xClock;
+	for (int i=0; i<NrPoints; i++) {
+		xv[i] = i*Spacing;  pv[i] = Orbit(xv[i]);  cv[i] = Clock(xv[i]);
+		xPos.SetY(xv[i], pv[i]);
+		xClock.SetY(xv[i], cv[i]);
+	}
+	int epochs = S(xv[NrPoints-1]);
+
+	// The original, keeping its results to compare against
+	Position* orig = new Position[epochs];
+	double* origclock = new double[epochs];
+	Time start = GetCurrentTime();
+	for (int e=0; e<epochs; e++) {
+		Original(xv, pv, NrPoints, e*NsecPerSec, orig[e]);
+		Original(xv, cv, NrPoints, e*NsecPerSec, origclock[e]);
+	}
+	Time original = GetCurrentTime() - start;
+
+	// The precomputed polynomials. (The first lookup builds them.)
+	Position* pos = new Position[epochs];
+	double* clock = new double[epochs];
+	start = GetCurrentTime();
+	for (int e=0; e<epochs; e++) {
+		xPos.GetY(e*NsecPerSec, pos[e]);
+		xClock.GetY(e*NsecPerSec, clock[e]);
+	}
+	Time polynomial = GetCurrentTime() - start;
+
+	double posdiff = 0, clockdiff = 0, poserr = 0;
+	for (int e=0; e<epochs; e++) {
+		posdiff = max(posdiff, Range(pos[e] - orig[e]));
+		clockdiff = max(clockdiff, abs(clock[e] - origclock[e]));
+		poserr = max(poserr, Range(pos[e] - Orbit(e*NsecPerSec)));
+	}
+	ShowErrors();
+
+	printf("%d points, %d epochs\n", NrPoints, epochs);
+	printf("neville      %10.0f epochs/s\n", epochs/S(original));
+	printf("polynomial   %10.0f epochs/s\n", epochs/S(polynomial));
+	printf("largest difference  position=%.2e m  clock=%.2e s   (error from the orbit %.3f m)\n", 
+		posdiff, clockdiff, poserr);
+
+	return 0;
+}
@@ -0,0 +1,142 @@
+// StreamBench - times reading raw and text files through the streams
+//    Part of kinematic, a collection of utilities for GPS positioning
+//
+// Copyright (C) 2006  John Morris    www.precision-gps.org
+//
+// This program is free software; you can redistribute it and/or
+// modify it under the terms of the GNU General Public License
+// as published by the Free Software Foundation, version 2.
+
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+//////////////////////////////////////////////////////////////////////////////
+//
+// A file of RTCM 3 frames and a file of RINEX-like lines are written,
+//   then read back the way the decoders read them: frames with
+//   CommRtcm3::GetBlock, lines with ReadLine. Each is read straight from
+//   the InputFile, a byte per call, then through a BufferIn, and then
+//   from a MappedInputFile.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "InputFile.h"
+#include "OutputFile.h"
+#include "BufferIn.h"
+#include "MappedInputFile.h"
+#include "CommRtcm3.h"
+#include "GpsTime.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+int DebugLevel = 0;
+
+
+static bool WriteFrames(const char* name, int frames)
+{
+	OutputFile out(name);
+	if (out.GetError() != OK) return Error();
+	CommRtcm3 com(out);
+
+	srand(1);
+	for (int i=0; i<frames; i++) {
+		Block b;
+		b.Length = 20 + rand()%200;
+		for (int k=0; k<b.Length; k++)
+			b.Data[k] = rand();
+		if (com.PutBlock(b) != OK) return Error();
+	}
+	return OK;
+}
+
+
+static bool WriteLines(const char* name, int lines)
+{
+	OutputFile out(name);
+	if (out.GetError() != OK) return Error();
+	for (int i=0; i<lines; i++)
+		if (out.Printf(" %13.3f 8 %13.3f 6 %13.3f  %13.3f 7 %13.3f\n", 
+			       2e7+i, 1e8+i, 3e-3*i, -1.2e3+i, 44.5) != OK) return Error();
+	return OK;
+}
+
+
+enum {Direct, Buffered, Mapped};
+
+static double ReadFrames(const char* name, int how, int& frames)
+// Returns MB per second
+{
+	InputFile file(name);
+	BufferIn buf(file);
+	MappedInputFile mapped(name);
+	Stream& in = (how == Direct)? (Stream&)file: (how == Buffered)? (Stream&)buf: (Stream&)mapped;
+	CommRtcm3 com(in);
+
+	frames = 0;
+	size_t bytes = 0;
+	Time start = GetCurrentTime();
+	Block b;
+	while (com.GetBlock(b) == OK) {
+		frames++;
+		bytes += b.Length + 6;
+	}
+	Time elapsed = GetCurrentTime() - start;
+	ClearError();
+
+	return bytes / 1e6 / (elapsed / (double)NsecPerSec);
+}
+
+
+static double ReadLines(const char* name, int how, int& lines)
+// Returns lines per second
+{
+	InputFile file(name);
+	BufferIn buf(file);
+	MappedInputFile mapped(name);
+	Stream& in = (how == Direct)? (Stream&)file: (how == Buffered)? (Stream&)buf: (Stream&)mapped;
+
+	lines = 0;
+	Time start = GetCurrentTime();
+	char line[128];
+	while (in.ReadLine(line, sizeof(line)) == OK)
+		lines++;
+	Time elapsed = GetCurrentTime() - start;
+	ClearError();
+
+	return lines / (elapsed / (double)NsecPerSec);
+}
+
+
+int main(int argc, const char** argv)
+{
+	int frames = 200000;
+	if (argc > 1) frames = atoi(argv[1]);
+	int lines = 5*frames;
+
+	if (WriteFrames("StreamBench.rtcm", frames) != OK
+	 || WriteLines("StreamBench.txt", lines) != OK)
+		return ShowErrors();
+
+	int n[3];
+	double rate[3];
+	for (int how=Direct; how<=Mapped; how++)
+		rate[how] = ReadFrames("StreamBench.rtcm", how, n[how]);
+	printf("rtcm frames MB/s   direct %8.1f   buffered %8.1f   mapped %8.1f   (%d %d %d frames)\n",
+		rate[0], rate[1], rate[2], n[0], n[1], n[2]);
+
+	for (int how=Direct; how<=Mapped; how++)
+		rate[how] = ReadLines("StreamBench.txt", how, n[how]);
+	printf("text lines/s       direct %8.0f   buffered %8.0f   mapped %8.0f   (%d %d %d lines)\n",
+		rate[0], rate[1], rate[2], n[0], n[1], n[2]);
+
+	remove("StreamBench.rtcm");
+	remove("StreamBench.txt");
+	return 0;
+}
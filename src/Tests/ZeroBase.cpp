@@ -122,8 +122,8 @@ bool ZeroBase(int argc, const char** argv)
 
 bool ShortBaseDiff(RawReceiver* Base, RawReceiver* Roving, Ephemerides* eph)
 {
-	RawObservation* b = Base->obs;
-	RawObservation* r = Roving->obs;
+	SatArray<RawObservation, MaxInView>& b = Base->obs;
+	SatArray<RawObservation, MaxInView>& r = Roving->obs;
 	Time GpsTime = Base->GpsTime;
 	Ephemerides& e = *eph;
 
@@ -315,8 +315,10 @@ bool DoubleNextEpoch(RawReceiver& base, RawReceiver& rover)
 	} while (base.GpsTime != rover.GpsTime);
 
 	// Mark the receivers as slipped
-	for (int s=0; s<MaxSats; s++)
-		base.obs[s].Slip = rover.obs[s].Slip = Slip[s];
+	for (int s=0; s<MaxSats; s++) {
+		if (base.obs.Contains(s))  base.obs.Entry(s).Slip = Slip[s];
+		if (rover.obs.Contains(s)) rover.obs.Entry(s).Slip = Slip[s];
+	}
 	
 	return OK;
 }